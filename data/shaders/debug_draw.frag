@@ -2,9 +2,9 @@
 
 layout (location = 0) out vec4 FragColor;
 
-uniform vec3 COLOR;
+in vec3 color;
 
 void main()
 {
-	FragColor = vec4(COLOR, 1.0);
+	FragColor = vec4(color, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 440 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+
+out vec3 color;
+
+void main()
+{
+	color = aColor;
+	gl_Position = cameraMatrix * vec4(aPos, 1.0);
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #version 440 core
+#pragma keywords IMAGE_BASED_LIGHTING
 layout (location = 0) out vec4 FragColor; // Color
 layout (location = 1) out vec4 BrightColor; // Brights
 
@@ -9,8 +10,16 @@ uniform sampler2D fbTexture1; // xyz: w_FragPos
 uniform sampler2D fbTexture2; // xyz: w_Normal normalized and in range [-1;1]
 uniform sampler2D fbTexture3; // x: shininess
 
-uniform vec3 viewPos;
-uniform vec3 lightDir;
+#ifdef IMAGE_BASED_LIGHTING
+// Baked from the skybox, see gl::IblBaker and Skybox::AddLightingUniforms().
+uniform vec3 irradianceSH[9]; // Cosine convolved, E(n) is their sum weighted by the SH9 basis.
+uniform samplerCube prefilteredMap; // GGX prefiltered, one level per roughness step.
+uniform sampler2D brdfLut; // Split sum scale and bias of F0, by NdotV and roughness.
+uniform float maxSpecularLod;
+
+const float PI = 3.14159265359;
+const vec3 DIELECTRIC_F0 = vec3(0.04);
+#endif
 
 const float LIGHT_INTENSITY = 1.0;
 const vec3 SPECULAR_COLOR = vec3(1.0);
@@ -24,6 +33,31 @@ vec3 ExtendedReinhard(vec3 color, float maxWhite)
     return numerator / (1.0 + color);
 }
 
+#ifdef IMAGE_BASED_LIGHTING
+vec3 Irradiance(vec3 n)
+{
+    const vec3 E = irradianceSH[0] * 0.282095
+        + irradianceSH[1] * 0.488603 * n.y
+        + irradianceSH[2] * 0.488603 * n.z
+        + irradianceSH[3] * 0.488603 * n.x
+        + irradianceSH[4] * 1.092548 * n.x * n.y
+        + irradianceSH[5] * 1.092548 * n.y * n.z
+        + irradianceSH[6] * 0.315392 * (3.0 * n.z * n.z - 1.0)
+        + irradianceSH[7] * 1.092548 * n.x * n.z
+        + irradianceSH[8] * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(E, vec3(0.0)); // SH9 rings slightly below 0 opposite bright sources.
+}
+
+vec3 EnvironmentAmbient(vec3 albedo, vec3 normal, vec3 viewDir, float shininess)
+{
+    const float roughness = sqrt(2.0 / (shininess + 2.0)); // Blinn-Phong exponent to GGX roughness, alpha = roughness^2.
+    const float NdotV = max(dot(normal, viewDir), 0.0);
+    const vec3 prefiltered = textureLod(prefilteredMap, reflect(-viewDir, normal), roughness * maxSpecularLod).rgb;
+    const vec2 brdf = texture(brdfLut, vec2(NdotV, roughness)).rg;
+    return Irradiance(normal) * albedo / PI + prefiltered * (DIELECTRIC_F0 * brdf.x + brdf.y);
+}
+#endif
+
 void main()
 {
     const vec3 albedo = texture(fbTexture0, TexCoord).rgb;
@@ -34,14 +68,18 @@ void main()
     // If (1.0 / 0.0) is passed as fragPos.x, it means we're trying to render a pixel that comes from an object that shouldn't be rendered using blinn-phong, like a particle or a skybox.
     if (!isinf(fragPos.x))
     { // Default behaviour. Use blinn-phong to render the fragment as usual.
+        const vec3 viewDir = normalize(viewPos.xyz - fragPos);
+#ifdef IMAGE_BASED_LIGHTING
+        const vec3 ambient = EnvironmentAmbient(albedo, normal, viewDir, shininess);
+#else
         const vec3 ambient = AMBIENT_FACTOR * albedo;
+#endif
 
-        const float diffuseInstensity = max(dot(-lightDir, normal), 0.0);
+        const float diffuseInstensity = max(dot(-lightDir.xyz, normal), 0.0);
         const vec3 diffuse = (1.0 - AMBIENT_FACTOR) * diffuseInstensity * albedo;
 
-        const vec3 viewDir = normalize(viewPos - fragPos);
-        const vec3 reflectDir = reflect(lightDir, normal);
-        const vec3 halfwayDir = normalize(-lightDir + viewDir);
+        const vec3 reflectDir = reflect(lightDir.xyz, normal);
+        const vec3 halfwayDir = normalize(-lightDir.xyz + viewDir);
         const float specularIntensity = pow(max(dot(normal, halfwayDir), 0.0), shininess);
         const vec3 specular = (1.0 - AMBIENT_FACTOR) * specularIntensity * SPECULAR_COLOR;
 
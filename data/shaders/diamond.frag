@@ -11,7 +11,6 @@ in VS_OUT {
 } fs_in;
 
 uniform samplerCube cubemap;
-uniform vec3 viewPos;
 
 const float INVALID_FLOAT = 1.0/0.0; // Allowed by glsl. Can be checked via isinf().
 const float COLOR_MULTIPLIER = 10.0; // To make the diamond shine and bloom.
@@ -23,7 +22,7 @@ void main()
     fbTexture2 = vec4(1.0);
     fbTexture3 = vec4(1.0);
 
-    const vec3 cameraFront = normalize(fs_in.w_FragPos - viewPos);
+    const vec3 cameraFront = normalize(fs_in.w_FragPos - viewPos.xyz);
     const vec3 reflectDir = reflect(cameraFront, fs_in.w_Normal);
     const vec3 color = vec3(pow(texture(cubemap, reflectDir).rgb, vec3(2.2)));
 
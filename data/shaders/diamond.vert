@@ -11,8 +11,6 @@ out VS_OUT {
     vec3 w_Normal;
 } vs_out;
 
-uniform mat4 cameraMatrix;
-
 void main()
 {
     vs_out.w_FragPos = (aModel * vec4(aPos, 1.0)).xyz;
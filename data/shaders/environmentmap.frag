@@ -1,69 +1,55 @@
 #version 440 core
+#pragma keywords IMAGE_BASED_LIGHTING
 out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
 
-uniform vec3 viewPos;
-uniform sampler2D PosX;
-uniform sampler2D NegX;
-uniform sampler2D PosY;
-uniform sampler2D NegY;
-uniform sampler2D PosZ;
-uniform sampler2D NegZ;
+uniform vec3 albedo = vec3(1.0);
+uniform float roughness = 0.0; // 0 is a mirror, blurrier reflections up to 1.
+uniform float metallic = 1.0;
+
+#ifdef IMAGE_BASED_LIGHTING
+// Baked from the skybox, see gl::IblBaker and Skybox::AddLightingUniforms().
+uniform vec3 irradianceSH[9]; // Cosine convolved, E(n) is their sum weighted by the SH9 basis.
+uniform samplerCube prefilteredMap; // GGX prefiltered, one level per roughness step.
+uniform sampler2D brdfLut; // Split sum scale and bias of F0, by NdotV and roughness.
+uniform float maxSpecularLod;
+
+const float PI = 3.14159265359;
+
+vec3 Irradiance(vec3 n)
+{
+    const vec3 E = irradianceSH[0] * 0.282095
+        + irradianceSH[1] * 0.488603 * n.y
+        + irradianceSH[2] * 0.488603 * n.z
+        + irradianceSH[3] * 0.488603 * n.x
+        + irradianceSH[4] * 1.092548 * n.x * n.y
+        + irradianceSH[5] * 1.092548 * n.y * n.z
+        + irradianceSH[6] * 0.315392 * (3.0 * n.z * n.z - 1.0)
+        + irradianceSH[7] * 1.092548 * n.x * n.z
+        + irradianceSH[8] * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(E, vec3(0.0)); // SH9 rings slightly below 0 opposite bright sources.
+}
+#endif
 
 void main()
-{    
-    const vec3 viewDir = normalize(FragPos - viewPos);
-    const vec3 reflection = reflect(viewDir, normalize(Normal));
-    
-    const float dir[3] = float[]
-    (
-        abs(reflection.x),
-        abs(reflection.y),
-        abs(reflection.z)
-    );
+{
+#ifdef IMAGE_BASED_LIGHTING
+    const vec3 normal = normalize(Normal);
+    const vec3 viewDir = normalize(viewPos.xyz - FragPos);
+    const float NdotV = max(dot(normal, viewDir), 0.0);
+
+    // Reflection of the environment, blurred by the level of the prefiltered map matching the roughness.
+    const vec3 F0 = mix(vec3(0.04), albedo, metallic);
+    const vec3 F = F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(1.0 - NdotV, 5.0);
+    const vec3 prefiltered = textureLod(prefilteredMap, reflect(-viewDir, normal), roughness * maxSpecularLod).rgb;
+    const vec2 brdf = texture(brdfLut, vec2(NdotV, roughness)).rg;
+    const vec3 specular = prefiltered * (F * brdf.x + brdf.y);
+    const vec3 diffuse = (vec3(1.0) - F) * (1.0 - metallic) * Irradiance(normal) * albedo / PI;
 
-    if (dir[0] >= dir[1] && dir[0] >= dir[2])
-    {
-        // x is biggest
-        if (reflection.x >= 0)
-        {
-            // use PosX
-            FragColor = texture(PosX, reflection.yz);
-        }
-        else
-        {
-            // use NegX
-            FragColor = texture(NegX, reflection.yz);
-        }
-    }
-    else if(dir[1] >= dir[0] && dir[1] >= dir[2])
-    {
-        // y is biggest
-        if (reflection.y >= 0)
-        {
-            // use PosY
-            FragColor = texture(PosY, reflection.xz);
-        }
-        else
-        {
-            // use NegY
-            FragColor = texture(NegY, reflection.xz);
-        }
-    }
-    else if(dir[2] >= dir[0] && dir[2] >= dir[1])
-    {
-        // z is biggest
-        if (reflection.y >= 0)
-        {
-            // use PosZ
-            FragColor = texture(PosZ, reflection.xy);
-        }
-        else
-        {
-            // use NegZ
-            FragColor = texture(NegZ, reflection.xy);
-        }
-    }
-}
\ No newline at end of file
+    FragColor = vec4(diffuse + specular, 1.0);
+#else
+    FragColor = vec4(vec3(0.03) * albedo, 1.0); // Nothing to reflect without the baked environment.
+#endif
+}
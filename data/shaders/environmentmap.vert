@@ -8,11 +8,9 @@ layout (location = 4) in mat4 aModel;
 out vec3 FragPos;
 out vec3 Normal;
 
-uniform mat4 cameraMatrix;
-
 void main()
 {
 	FragPos = (aModel * vec4(aPos, 1.0)).xyz;
-	Normal = transpose(inverse(mat3(aModel))) * aPos;
+	Normal = transpose(inverse(mat3(aModel))) * aNormal;
 	gl_Position = cameraMatrix * aModel * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -12,8 +12,6 @@ out VS_OUT {
     mat3 TBN; // Have to perform TBN multiplication in fragment shader since TexCoords gets interpolated.
 } vs_out;
 
-uniform mat4 cameraMatrix;
-
 void main()
 {
     const mat3 normalMatrix = transpose(inverse(mat3(aModel)));
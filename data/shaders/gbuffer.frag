@@ -0,0 +1,140 @@
+#version 440 core
+
+layout (location = 0) out vec4 fbTexture0; // rgb: albedo
+layout (location = 1) out vec4 fbTexture1; // xyz: w_FragPos
+layout (location = 2) out vec4 fbTexture2; // xyz: w_Normal normalized and in range [-1;1]
+layout (location = 3) out vec4 fbTexture3; // x: shininess
+
+in VS_OUT {
+    vec3 w_FragPos;
+    vec2 TexCoords;
+    mat3 TBN; // Have to perform TBN multiplication in fragment shader since TexCoords gets interpolated.
+    vec4 l_FragPos;
+    flat uint materialId;
+} fs_in;
+
+// Keep in sync with gl::MaterialTable.
+const uint RECEIVE_SHADOWS = 1u << 0;
+const uint SKIP_LIGHTING = 1u << 1;
+const uint MESH_TEXTURES = 1u << 2;
+
+struct Material
+{
+    int diffuseArray; // -1 when the material has no diffuse map.
+    int diffuseLayer;
+    int normalArray; // -1 when the material has no normal map.
+    int normalLayer;
+    float shininess;
+    uint flags;
+};
+
+layout (std430, binding = 0) readonly buffer MaterialTable // MATERIAL_TABLE_BINDING
+{
+    Material materials[];
+};
+
+layout (binding = 5) uniform sampler2DArray materialTextures[8]; // MATERIAL_TEXTURE_ARRAYS_UNIT, MAX_MATERIAL_TEXTURE_ARRAYS
+uniform sampler2D meshDiffuseMap; // DIFFUSE_TEXTURE_UNIT, bound by the mesh's own material when MESH_TEXTURES is set.
+uniform sampler2D meshNormalMap; // NORMALMAP_TEXTURE_UNIT
+uniform sampler2D shadowmap; // FRAMEBUFFER_SHADOWMAP_UNIT
+
+const float INVALID_FLOAT = 1.0/0.0; // Allowed by glsl. Can be checked via isinf().
+
+vec4 SampleMaterialTexture(const int array, const int layer, const vec2 dx, const vec2 dy)
+{
+    // Sampler arrays can only be indexed with dynamically uniform expressions, and the material id varies per instance. Select with constant indices instead, using gradients computed in uniform control flow.
+    const vec3 uv = vec3(fs_in.TexCoords, float(layer));
+    switch (array)
+    {
+        case 0: return textureGrad(materialTextures[0], uv, dx, dy);
+        case 1: return textureGrad(materialTextures[1], uv, dx, dy);
+        case 2: return textureGrad(materialTextures[2], uv, dx, dy);
+        case 3: return textureGrad(materialTextures[3], uv, dx, dy);
+        case 4: return textureGrad(materialTextures[4], uv, dx, dy);
+        case 5: return textureGrad(materialTextures[5], uv, dx, dy);
+        case 6: return textureGrad(materialTextures[6], uv, dx, dy);
+        case 7: return textureGrad(materialTextures[7], uv, dx, dy);
+        default: return vec4(1.0);
+    }
+}
+
+float ComputeShadow(vec4 fragPosLightSpace)
+{
+    // perform perspective divide
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    // transform to [0,1] range
+    projCoords = projCoords * 0.5 + 0.5;
+    // get depth of current fragment from light's perspective
+    float currentDepth = projCoords.z;
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / textureSize(shadowmap, 0);
+    for(int x = -1; x <= 1; ++x)
+    {
+        for(int y = -1; y <= 1; ++y)
+        {
+            float pcfDepth = texture(shadowmap, projCoords.xy + vec2(x, y) * texelSize).r; 
+            shadow += currentDepth > pcfDepth  ? 1.0 : 0.0;        
+        }
+    }
+    shadow /= 9.0;
+    
+    // keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
+    if(projCoords.z > 1.0)
+        shadow = 0.0;
+        
+    return shadow;
+}
+
+void main()
+{
+    const Material material = materials[fs_in.materialId];
+    const vec2 dx = dFdx(fs_in.TexCoords);
+    const vec2 dy = dFdy(fs_in.TexCoords);
+    const float shadow = ComputeShadow(fs_in.l_FragPos); // Outside of any branch, it samples with implicit derivatives.
+    const vec4 meshDiffuse = texture(meshDiffuseMap, fs_in.TexCoords); // Same.
+    const vec4 meshNormal = texture(meshNormalMap, fs_in.TexCoords);
+    const bool meshTextures = (material.flags & MESH_TEXTURES) != 0u;
+
+    fbTexture0 = vec4(1.0);
+    fbTexture1 = vec4(1.0);
+    fbTexture2 = vec4(1.0);
+    fbTexture3 = vec4(1.0);
+
+    // Albedo.
+    if (meshTextures)
+    {
+        fbTexture0.rgb = pow(meshDiffuse.rgb, vec3(2.2));
+    }
+    else if (material.diffuseArray > -1)
+    {
+        fbTexture0.rgb = pow(SampleMaterialTexture(material.diffuseArray, material.diffuseLayer, dx, dy).rgb, vec3(2.2));
+    }
+    if ((material.flags & RECEIVE_SHADOWS) != 0u)
+    {
+        fbTexture0.rgb *= 1.0 - shadow;
+    }
+
+    // FragPos.
+    fbTexture1.xyz = fs_in.w_FragPos;
+    if ((material.flags & SKIP_LIGHTING) != 0u)
+    {
+        fbTexture1.x = INVALID_FLOAT;
+    }
+
+    // Normals. Retrieve from normalmap, remap to range [-1;1] and convert to world space.
+    if (meshTextures)
+    {
+        fbTexture2.xyz = fs_in.TBN * normalize(meshNormal.rgb * 2.0 - 1.0);
+    }
+    else if (material.normalArray > -1)
+    {
+        fbTexture2.xyz = fs_in.TBN * normalize(SampleMaterialTexture(material.normalArray, material.normalLayer, dx, dy).rgb * 2.0 - 1.0);
+    }
+    else
+    {
+        fbTexture2.xyz = fs_in.TBN[2];
+    }
+
+    // Shininess.
+    fbTexture3.x = material.shininess;
+}
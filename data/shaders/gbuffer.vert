@@ -0,0 +1,34 @@
+#version 440 core
+
+// Uber material G-buffer pass, shared by every opaque mesh feeding position, uv, normal and tangent to locations 0 to 3. See gl::MaterialTable.
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec3 aNormal;
+layout (location = 3) in vec3 aTangent;
+layout (location = 4) in mat4 aModel;
+layout (location = 8) in uint aMaterialId; // MATERIAL_ID_LOCATION
+
+out VS_OUT {
+    vec3 w_FragPos;
+    vec2 TexCoords;
+    mat3 TBN; // Have to perform TBN multiplication in fragment shader since TexCoords gets interpolated.
+    vec4 l_FragPos;
+    flat uint materialId;
+} vs_out;
+
+void main()
+{
+    const mat3 normalMatrix = transpose(inverse(mat3(aModel)));
+    vec3 T = normalize(normalMatrix * aTangent);
+    vec3 N = normalize(normalMatrix * aNormal);
+    T = normalize(T - dot(T, N) * N);
+    vec3 B = cross(N, T);
+    vs_out.TBN = mat3(T, B, N);
+
+    vs_out.w_FragPos  = (aModel * vec4(aPos, 1.0)).xyz;
+    vs_out.l_FragPos = lightMatrix * vec4(vs_out.w_FragPos, 1.0);
+    vs_out.TexCoords = aTexCoord;
+    vs_out.materialId = aMaterialId;
+
+    gl_Position = cameraMatrix * vec4(vs_out.w_FragPos, 1.0); // Need to write to gl_Position to allow the pipeline to clip fragments that are offscreen.
+}
@@ -1,4 +1,5 @@
 #version 440 core
+#pragma keywords IMAGE_BASED_LIGHTING
 out vec4 FragColor;
 
 in VS_OUT // w = world, l = light, t = tangent
@@ -32,6 +33,14 @@ struct Material
 
 uniform Material material;
 
+#ifdef IMAGE_BASED_LIGHTING
+// Image based lighting baked from the skybox on the CPU, see gl::IblBaker and Skybox::AddLightingUniforms().
+uniform vec3 irradianceSH[9]; // Cosine convolved, E(n) is their sum weighted by the SH9 basis.
+uniform samplerCube prefilteredMap; // GGX prefiltered, one level per roughness step.
+uniform sampler2D brdfLut; // Split sum scale and bias of F0, by NdotV and roughness.
+uniform float maxSpecularLod;
+#endif
+
 const float PI = 3.14159265359;
 const vec3 lightColor = vec3(150.0f);
 // ----------------------------------------------------------------------------
@@ -85,6 +94,27 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0)
 {
     return F0 + (1.0 - F0) * pow(max(1.0 - cosTheta, 0.0), 5.0);
 }
+#ifdef IMAGE_BASED_LIGHTING
+// ----------------------------------------------------------------------------
+vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
+{
+    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(max(1.0 - cosTheta, 0.0), 5.0);
+}
+// ----------------------------------------------------------------------------
+vec3 irradiance(vec3 n)
+{
+    vec3 E = irradianceSH[0] * 0.282095
+        + irradianceSH[1] * 0.488603 * n.y
+        + irradianceSH[2] * 0.488603 * n.z
+        + irradianceSH[3] * 0.488603 * n.x
+        + irradianceSH[4] * 1.092548 * n.x * n.y
+        + irradianceSH[5] * 1.092548 * n.y * n.z
+        + irradianceSH[6] * 0.315392 * (3.0 * n.z * n.z - 1.0)
+        + irradianceSH[7] * 1.092548 * n.x * n.z
+        + irradianceSH[8] * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(E, vec3(0.0)); // SH9 rings slightly below 0 opposite bright sources.
+}
+#endif
 // ----------------------------------------------------------------------------
 void main()
 {		
@@ -138,9 +168,22 @@ void main()
         Lo += (kD * albedo / PI + specular) * radiance * NdotL;  // note that we already multiplied the BRDF by the Fresnel (kS) so we won't multiply by kS again
     }   
     
-    // ambient lighting (note that the next IBL tutorial will replace 
-    // this ambient lighting with environment lighting).
+#ifdef IMAGE_BASED_LIGHTING
+    // ambient lighting from the environment, in world space since that's where it was baked.
+    vec3 w_N = normalize(fs_in.w_Normal);
+    vec3 w_T = normalize(fs_in.w_Tangent - dot(fs_in.w_Tangent, w_N) * w_N);
+    w_N = normalize(mat3(w_T, cross(w_N, w_T), w_N) * N);
+    vec3 w_V = normalize(fs_in.w_ViewPos.xyz - fs_in.w_FragPos.xyz);
+    float NdotV = max(dot(w_N, w_V), 0.0);
+    vec3 F_ambient = fresnelSchlickRoughness(NdotV, F0, roughness);
+    vec3 kD_ambient = (vec3(1.0) - F_ambient) * (1.0 - metallic);
+    vec3 prefiltered = textureLod(prefilteredMap, reflect(-w_V, w_N), roughness * maxSpecularLod).rgb;
+    vec2 brdf = texture(brdfLut, vec2(NdotV, roughness)).rg;
+    vec3 ambient = kD_ambient * irradiance(w_N) * albedo / PI + prefiltered * (F_ambient * brdf.x + brdf.y);
+#else
+    // constant ambient lighting when the environment wasn't baked.
     vec3 ambient = vec3(0.03) * albedo;
+#endif
     
     vec3 color = ambient + Lo;
 
@@ -25,14 +25,6 @@ out VS_OUT // w = world, l = light, t = tangent
 	vec3 t_Tangent;
 } vs_out;
 
-uniform mat4 lightMatrix;
-uniform mat4 projection;
-uniform mat4 view;
-
-uniform vec3 viewPos;
-
-const vec3 lightDir = normalize(vec3(-1.0, -1.0, -1.0));
-
 void main()
 {
     const mat3 normalMatrix = transpose(inverse(mat3(aModel)));
@@ -46,13 +38,13 @@ void main()
 	vs_out.l_FragPos = lightMatrix * vs_out.w_FragPos;
     vs_out.t_FragPos = vec4(TBN * vs_out.w_FragPos.rgb, vs_out.w_FragPos.w);
 
-    vs_out.w_LightDir = lightDir;
-    vs_out.l_LightDir = (lightMatrix * vec4(lightDir, 1.0)).rgb;
-    vs_out.t_LightDir = TBN * lightDir;
+    vs_out.w_LightDir = lightDir.xyz;
+    vs_out.l_LightDir = (lightMatrix * vec4(lightDir.xyz, 1.0)).rgb;
+    vs_out.t_LightDir = TBN * lightDir.xyz;
 
-    vs_out.w_ViewPos = vec4(viewPos, 1.0);
-    vs_out.l_ViewPos = lightMatrix * vec4(viewPos, 1.0);
-    vs_out.t_ViewPos = vec4(TBN * viewPos.rgb, 1.0);
+    vs_out.w_ViewPos = vec4(viewPos.xyz, 1.0);
+    vs_out.l_ViewPos = lightMatrix * vec4(viewPos.xyz, 1.0);
+    vs_out.t_ViewPos = vec4(TBN * viewPos.xyz, 1.0);
 
     vs_out.TexCoords = aTexCoord;
 
@@ -64,5 +56,5 @@ void main()
     vs_out.l_Tangent = (lightMatrix * vec4(T, 1.0)).rgb;
     vs_out.t_Tangent = TBN * T;
 
-	gl_Position = projection * view * aModel * vec4(aPos, 1.0);
+	gl_Position = cameraMatrix * aModel * vec4(aPos, 1.0);
 }
\ No newline at end of file
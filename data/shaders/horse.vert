@@ -15,7 +15,6 @@ out VS_OUT {
     mat3 TBN; // Have to perform TBN multiplication in fragment shader since TexCoords gets interpolated.
 } vs_out;
 
-uniform mat4 cameraMatrix;
 uniform float interpolationFactor = 0.5;
 
 void main()
@@ -7,8 +7,6 @@ layout (location = 2) in vec3 aModelPos;
 out vec2 TexCoords;
 out vec3 color;
 
-uniform mat4 cameraMatrix;
-
 const float SCALE = 0.05;
 
 void main()
@@ -20,7 +20,7 @@ vec3 MeanBlur()
 {
     const vec3 color = texture(fbTexture0, TexCoord).rgb;
 
-    const vec2 texelSize = 1.0 / textureSize(fbTexture1, 0);
+    const vec2 texelSize = resolution.zw; // The brights are rendered at the resolution of the pass.
     vec3 blurredSamples[MEAN_BLUR_MAXTRIX_ORDER * MEAN_BLUR_MAXTRIX_ORDER];
 
     for(int y = 0; y < MEAN_BLUR_MAXTRIX_ORDER; y++)
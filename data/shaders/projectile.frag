@@ -2,7 +2,7 @@
 
 layout (location = 0) out vec4 FragColor;
 
-uniform vec3 color = vec3(1.0);
+in vec3 color;
 
 void main()
 {
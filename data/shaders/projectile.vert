@@ -1,10 +1,11 @@
 #version 440 core
 
-layout (location = 0) in vec2 aPos; // Per-instance, world space.
+layout (location = 0) in vec2 aPos; // World space.
+layout (location = 1) in float aTimer; // Lifetime of the projectile owning this particle.
+layout (location = 2) in vec3 aColor;
+
+out vec3 color;
 
-uniform mat4 PROJECTION;
-uniform mat4 view;
-uniform float timer;
 uniform float NR_OF_VERTICES;
 uniform float EXPLOSION_RADIUS_MULTIPLIER;
 
@@ -23,14 +24,17 @@ float Random(const float factor) // Generates a pseudo random number between 0 a
 
 void main()
 {
+	color = aColor;
 	vec2 pos = aPos;
+	const float timer = aTimer;
+	const float particleIndex = float(gl_VertexID % int(NR_OF_VERTICES)); // Particles of every projectile share the same buffer.
 	if (timer < 0.0) // < 0 means projectile has passed into the particles state of it's lifetime (explosion).
 	{
 		// TODO: really need the normalize?
 		const vec2 dir = normalize(vec2(
-			sin(RemapToRange(0.0, NR_OF_VERTICES, 0.0, TWO_PI, float(gl_VertexID))),
-			cos(RemapToRange(0.0, NR_OF_VERTICES, 0.0, TWO_PI, float(gl_VertexID)))));
+			sin(RemapToRange(0.0, NR_OF_VERTICES, 0.0, TWO_PI, particleIndex)),
+			cos(RemapToRange(0.0, NR_OF_VERTICES, 0.0, TWO_PI, particleIndex))));
 		pos += dir * -timer * Random(timer) * EXPLOSION_RADIUS_MULTIPLIER; // Value of timer is in the negatives here. Invert it to have an explosion instead of an implosion.
 	}
-	gl_Position = PROJECTION * view * vec4(pos, 0.0, 1.0);
+	gl_Position = cameraMatrix * vec4(pos, 0.0, 1.0);
 }
\ No newline at end of file
@@ -4,9 +4,6 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoord;
 
-uniform mat4 projectionMatrix;
-uniform mat4 viewMatrix;
-
 void main()
 {
 	TexCoord = aPos;
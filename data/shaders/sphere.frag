@@ -20,7 +20,7 @@ struct Material
 };
 
 uniform Material material;
-uniform sampler2D shadowmap; // Texture unit 15, a framebuffer texture.
+uniform sampler2D shadowmap; // FRAMEBUFFER_SHADOWMAP_UNIT, a framebuffer texture.
 
 const float INVALID_FLOAT = 1.0/0.0; // Allowed by glsl. Can be checked via isinf().
 
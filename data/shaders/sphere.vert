@@ -13,9 +13,6 @@ out VS_OUT {
     vec4 l_FragPos;
 } vs_out;
 
-uniform mat4 cameraMatrix;
-uniform mat4 lightMatrix;
-
 void main()
 {
     const mat3 normalMatrix = transpose(inverse(mat3(aModel)));
@@ -0,0 +1,22 @@
+#version 440 core
+#pragma keywords SINGLE_CHANNEL
+
+layout (location = 0) out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D ALBEDO;
+#ifndef SINGLE_CHANNEL
+uniform vec3 color = vec3(1.0);
+#endif
+
+void main()
+{
+#ifdef SINGLE_CHANNEL // Greyscale texture stored in the red channel.
+	const float color = texture(ALBEDO, TexCoords).r;
+	FragColor = vec4(color, color, color, 1.0);
+#else
+	FragColor = texture(ALBEDO, TexCoords);
+	FragColor.rgb *= color;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace gl
+{
+    /*
+    @brief: Read only archive of assets. The file is memory mapped when opened and its table of contents is used in place, so finding an asset is a binary search and reading an uncompressed one is a pointer into the mapping. Entries can be LZ4 compressed individually, ReadMany() decompresses them in parallel.
+    Layout: a 64 byte Header, the table of contents sorted by hash, then the data of each entry aligned to ALIGNMENT. Written in the native byte order by Write(), see main/asset_packer.cpp.
+    */
+    class AssetPack
+    {
+    public:
+        enum class Compression : uint32_t
+        {
+            NONE = 0,
+            LZ4 = 1
+        };
+
+        struct alignas(64) Header
+        {
+            uint32_t magic = 0;
+            uint32_t version = 0;
+            uint64_t nrOfEntries = 0;
+            uint64_t dataOffset = 0; // First byte after the table of contents, aligned.
+            uint8_t reserved[40] = {}; // Up to the 64 bytes, zeroed rather than left as padding.
+        };
+        struct Entry
+        {
+            uint64_t hash = 0; // HashPath() of the asset's path.
+            uint64_t offset = 0; // From the start of the file, aligned.
+            uint32_t size = 0; // Uncompressed.
+            uint32_t storedSize = 0;
+            Compression compression = Compression::NONE;
+            uint32_t reserved = 0;
+        };
+        struct Source
+        {
+            std::string path = ""; // Key the asset is found by, relative to the packed directory.
+            std::string file = ""; // Where to read it from when packing.
+        };
+
+        constexpr static const uint32_t MAGIC = 0x4B50474C; // "GLPK"
+        constexpr static const uint32_t VERSION = 1;
+        constexpr static const size_t ALIGNMENT = 64;
+
+        AssetPack() = default;
+        ~AssetPack();
+        AssetPack(const AssetPack&) = delete;
+        AssetPack& operator=(const AssetPack&) = delete;
+
+        /*
+        @brief: Maps the archive, returns false when it can't be opened or isn't a valid archive.
+        */
+        bool Open(const std::string& path);
+        void Close();
+        bool IsOpen() const;
+
+        /*
+        @brief: Paths are normalized before hashing, "shaders/../shaders/a.vert" and "shaders\a.vert" find the same entry as "shaders/a.vert".
+        */
+        static uint64_t HashPath(std::string_view path);
+        const Entry* Find(std::string_view path) const;
+        std::span<const Entry> GetEntries() const;
+
+        /*
+        @brief: Bytes of an entry stored uncompressed, straight from the mapping and valid until Close(). Empty for compressed entries.
+        */
+        std::span<const char> View(const Entry& entry) const;
+        /*
+        @brief: Decompresses or copies the entry into out. Returns false if the stored data is corrupted.
+        */
+        bool Read(const Entry& entry, std::vector<char>& out) const;
+        /*
+        @brief: Read() of several entries split across the hardware threads.
+        */
+        std::vector<std::vector<char>> ReadMany(const std::vector<const Entry*>& entries) const;
+
+        /*
+        @brief: Packs the sources into a new archive at packPath. Sources are LZ4 compressed when asked for and when it makes them smaller. Returns false if a source can't be read, two paths share a hash or packPath can't be written.
+        */
+        static bool Write(const std::string& packPath, const std::vector<Source>& sources, Compression compression);
+    private:
+        const char* mapping_ = nullptr;
+        size_t mappingSize_ = 0;
+#if defined(_WIN32)
+        void* file_ = nullptr;
+        void* fileMapping_ = nullptr;
+#endif
+        std::span<const Entry> entries_ = {};
+    };
+}//!gl
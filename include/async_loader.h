@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gl
+{
+    /*
+    @brief: Runs asset loads as C++20 coroutines. A load co_awaits ToWorker() to read and decode its file on a worker thread, then co_awaits ToGlThread() to create and upload its gl objects. Gl work is drained by the Engine once per frame within a time budget, so loading never freezes the window and several loads overlap.
+    */
+    class AsyncLoader
+    {
+    public:
+        /*
+        @brief: Fire and forget coroutine, starts on the calling thread and destroys itself once finished.
+        */
+        struct Task
+        {
+            struct promise_type
+            {
+                promise_type();
+                ~promise_type();
+                Task get_return_object() { return {}; }
+                std::suspend_never initial_suspend() noexcept { return {}; }
+                std::suspend_never final_suspend() noexcept { return {}; }
+                void return_void() {}
+                void unhandled_exception() { std::terminate(); } // Same as any other engine error.
+            };
+        };
+
+        struct WorkerAwaiter
+        {
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) const;
+            void await_resume() const noexcept {}
+        };
+        struct GlThreadAwaiter
+        {
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) const;
+            void await_resume() const noexcept {}
+        };
+
+        struct Stats
+        {
+            size_t inFlight = 0; // Started loads that didn't finish yet.
+            size_t queuedGlWork = 0; // Loads waiting for the gl thread after the last drain.
+            size_t glWorkDone = 0;
+            float lastDrainMilliseconds = 0.0f;
+        };
+
+        AsyncLoader() = default;
+        ~AsyncLoader();
+        AsyncLoader(const AsyncLoader&) = delete;
+        static AsyncLoader& Get()
+        {
+            static gl::AsyncLoader instance;
+            return instance;
+        }
+
+        WorkerAwaiter ToWorker();
+        GlThreadAwaiter ToGlThread();
+
+        /*
+        @brief: Resumes the loads waiting for the gl thread until budgetMilliseconds is spent. At least one is resumed per call so that loads always progress. The Engine calls it once per frame before Program::Update().
+        */
+        void DrainGlQueue(float budgetMilliseconds);
+        /*
+        @brief: Joins the workers and drops every unfinished load. Called by the Engine before the gl context is destroyed.
+        */
+        void Shutdown();
+
+        Stats GetStats();
+    private:
+        void StartWorkers();
+        void WorkerLoop();
+
+        std::mutex mutex_;
+        std::condition_variable wakeWorkers_;
+        std::deque<std::coroutine_handle<>> workerQueue_ = {};
+        std::deque<std::coroutine_handle<>> glQueue_ = {};
+        std::vector<std::thread> workers_ = {};
+        bool stopping_ = false;
+
+        std::atomic<size_t> inFlight_ = 0;
+        size_t glWorkDone_ = 0;
+        float lastDrainMilliseconds_ = 0.0f;
+    };
+}//!gl
@@ -1,5 +1,7 @@
 #pragma once
+#include <string>
 
+#include "async_loader.h"
 #include "defines.h"
 
 namespace gl
@@ -8,10 +10,13 @@ namespace gl
     {
     public:
         void Load(const char* path); // This should be called by the ResourceManager
+        void LoadAsync(const char* path); // Decoded on a worker thread, the clip is silent until it lands and has to outlive the load.
         void Destroy(); // So should this.
         const unsigned char* const GetData() const;
         size_t GetLen() const;
     private:
+        AsyncLoader::Task Decode(std::string path);
+
         unsigned char* data = nullptr;
         size_t len = 0;
     };
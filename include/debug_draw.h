@@ -0,0 +1,104 @@
+#pragma once
+#include <array>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "defines.h"
+#include "shader.h"
+
+// Debug drawing is only compiled in debug builds. Define GL_DEBUG_DRAW_ENABLED to 0 or 1 to override.
+#ifndef GL_DEBUG_DRAW_ENABLED
+#ifdef NDEBUG
+#define GL_DEBUG_DRAW_ENABLED 0
+#else
+#define GL_DEBUG_DRAW_ENABLED 1
+#endif // NDEBUG
+#endif // !GL_DEBUG_DRAW_ENABLED
+
+// Wraps a call to the DebugDraw singleton so that the call and the evaluation of its arguments vanish in release builds.
+// ex: EngineDebugDraw(Arrow2D(pos, pos + velocity, GREEN));
+#if GL_DEBUG_DRAW_ENABLED
+#define EngineDebugDraw(call) gl::DebugDraw::Get().call
+#else
+#define EngineDebugDraw(call) ((void)0)
+#endif // GL_DEBUG_DRAW_ENABLED
+
+#if GL_DEBUG_DRAW_ENABLED
+namespace gl
+{
+    /*
+    @brief: Immediate mode debug primitives. Every primitive submitted during a frame is appended to a cpu side list, then Flush() uploads all of them into a single streaming vertex buffer and issues one draw call per primitive type and depth mode.
+    */
+    class DebugDraw
+    {
+    public:
+        struct Definition
+        {
+            std::string vertexPath = "";
+            std::string fragmentPath = "";
+            size_t maxVertices = 65536; // Capacity of the streaming vertex buffer. Primitives submitted past it are dropped.
+        };
+
+        DebugDraw() = default;
+        DebugDraw(const DebugDraw&) = delete;
+        static DebugDraw& Get()
+        {
+            static gl::DebugDraw instance;
+            return instance;
+        }
+
+        void Create(Definition def);
+        void Destroy();
+
+        // 3D primitives, in world space.
+        void Point(const glm::vec3 pos, const glm::vec3 color = GREEN, const bool depthTest = true);
+        void Line(const glm::vec3 from, const glm::vec3 to, const glm::vec3 color = GREEN, const bool depthTest = true);
+        void Arrow(const glm::vec3 from, const glm::vec3 to, const glm::vec3 color = GREEN, const bool depthTest = true);
+        void Box(const glm::vec3 center, const glm::vec3 halfExtents, const glm::vec3 color = GREEN, const bool depthTest = true);
+        void Box(const glm::mat4& model, const glm::vec3 color = GREEN, const bool depthTest = true); // Unit cube going from -1;-1;-1 to 1;1;1 transformed by model.
+        void Sphere(const glm::vec3 center, const float radius, const glm::vec3 color = GREEN, const bool depthTest = true, const size_t segments = 16);
+
+        // 2D primitives, lying on the z = 0 plane. Never depth tested.
+        void Point2D(const glm::vec2 pos, const glm::vec3 color = GREEN);
+        void Line2D(const glm::vec2 from, const glm::vec2 to, const glm::vec3 color = GREEN);
+        void Arrow2D(const glm::vec2 from, const glm::vec2 to, const glm::vec3 color = GREEN);
+        void Rectangle2D(const glm::vec2 bottomLeft, const glm::vec2 topRight, const glm::vec3 color = GREEN);
+        void Circle2D(const glm::vec2 center, const float radius, const glm::vec3 color = GREEN, const size_t segments = 16);
+
+        /*
+        @brief: Uploads everything submitted since the last Flush() and draws it with the camera matrix of the FrameData uniform buffer. Clears the submitted primitives afterwards.
+        */
+        void Flush();
+
+    private:
+        struct Vertex
+        {
+            glm::vec3 pos;
+            glm::vec3 color;
+        };
+        enum Primitive : size_t
+        {
+            POINTS = 0,
+            LINES = 1,
+            NR_OF_PRIMITIVES = 2
+        };
+        enum DepthMode : size_t
+        {
+            DEPTH_TESTED = 0,
+            ALWAYS_VISIBLE = 1,
+            NR_OF_DEPTH_MODES = 2
+        };
+
+        void Push(const Primitive primitive, const bool depthTest, const glm::vec3 a, const glm::vec3 color);
+        void Push(const Primitive primitive, const bool depthTest, const glm::vec3 a, const glm::vec3 b, const glm::vec3 color);
+
+        unsigned int VAO_ = 0, VBO_ = 0;
+        size_t maxVertices_ = 0;
+        bool overflowReported_ = false;
+        Shader shader_ = {};
+        std::array<std::array<std::vector<Vertex>, NR_OF_DEPTH_MODES>, NR_OF_PRIMITIVES> batches_ = {};
+    };
+}//!gl
+#endif // GL_DEBUG_DRAW_ENABLED
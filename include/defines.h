@@ -6,17 +6,35 @@
 
 #include "utility.h"
 
+// SIMD paths compiled in. Define GL_SIMD_SSE2 or GL_SIMD_AVX to 0 to compare them with the scalar ones.
+#ifndef GL_SIMD_SSE2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GL_SIMD_SSE2 1
+#else
+#define GL_SIMD_SSE2 0
+#endif
+#endif // !GL_SIMD_SSE2
+#ifndef GL_SIMD_AVX
+#if defined(__AVX__)
+#define GL_SIMD_AVX 1
+#else
+#define GL_SIMD_AVX 0
+#endif
+#endif // !GL_SIMD_AVX
+
 namespace gl
 {
 	// Window parameters.
 	constexpr const float SCREEN_RESOLUTION[2] = { 1024.0f, 768.0f }; // 4:3 aspect
 	constexpr const float PROJECTION_NEAR = 0.0f;
 	constexpr const float PROJECTION_FAR = 1.0f;
+	constexpr const float PERSPECTIVE_NEAR = 0.1f; // Perspective depth can't start at 0.
+	constexpr const float PERSPECTIVE_FAR = 100.0f;
 	constexpr const float PROJECTION_FOV = glm::radians(45.0f);
 	constexpr const float ORTHO_ZOOM = 50.0f;
 	constexpr const float ORTHO_HALF_HEIGHT = 0.375f * ORTHO_ZOOM;
 	constexpr const float ORTHO_HALF_WIDTH = 0.5f * ORTHO_ZOOM;
-	const glm::mat4 PERSPECTIVE = glm::perspective(PROJECTION_FOV, SCREEN_RESOLUTION[0] / SCREEN_RESOLUTION[1], PROJECTION_NEAR, PROJECTION_FAR);
+	const glm::mat4 PERSPECTIVE = glm::perspective(PROJECTION_FOV, SCREEN_RESOLUTION[0] / SCREEN_RESOLUTION[1], PERSPECTIVE_NEAR, PERSPECTIVE_FAR);
 	const glm::mat4 ORTHO = glm::ortho(-ORTHO_HALF_WIDTH, ORTHO_HALF_WIDTH, -ORTHO_HALF_HEIGHT, ORTHO_HALF_HEIGHT, PROJECTION_NEAR, PROJECTION_FAR);
 
 	// Audio parameters.
@@ -37,13 +55,29 @@ namespace gl
 #ifndef glDisplayMessageGuard
 #define EngineMessage(msg) gl::Message(__FILE__, __LINE__, msg)
 #endif //!glDisplayMessageGuard
+#if GL_ERROR_CHECKS_ENABLED
 #ifndef glCheckGlErrorGuard
 #define CheckGlError() gl::CheckGlError(__FILE__, __LINE__)
-// #define CheckGlError() [](){}
 #endif //!glCheckGlErrorGuard
 #ifndef glCheckFramebufferStatusGuard
 #define CheckFramebufferStatus() gl::CheckFramebufferStatus(__FILE__, __LINE__)
 #endif //!glCheckFramebufferStatusGuard
+#ifndef glCheckNamedFramebufferStatusGuard
+#define CheckNamedFramebufferStatus(FBO) gl::CheckNamedFramebufferStatus(__FILE__, __LINE__, FBO)
+#endif //!glCheckNamedFramebufferStatusGuard
+#ifndef glScopeGuard
+#define GL_SCOPE_CONCAT_(a, b) a##b
+#define GL_SCOPE_NAME_(line) GL_SCOPE_CONCAT_(glDebugScope, line)
+#define EngineGlScope(name) const gl::DebugScope GL_SCOPE_NAME_(__LINE__)(name, __FILE__, __LINE__)
+#define EngineGlScopeAllowingErrors(name) const gl::DebugScope GL_SCOPE_NAME_(__LINE__)(name, __FILE__, __LINE__, true)
+#endif //!glScopeGuard
+#else
+#define CheckGlError() ((void)0)
+#define CheckFramebufferStatus() ((void)0)
+#define CheckNamedFramebufferStatus(FBO) ((void)0)
+#define EngineGlScope(name) ((void)0)
+#define EngineGlScopeAllowingErrors(name) ((void)0)
+#endif // GL_ERROR_CHECKS_ENABLED
 
 	// GLM default values.
 	constexpr const glm::mat4 IDENTITY_MAT4 = glm::mat4(1.0f);
@@ -77,7 +111,70 @@ namespace gl
 	// Hashing parameters.
 	constexpr const uint32_t HASHING_SEED = 0xFFFF1337;
 
+	// Gpu memory the ResourceManager lets resources nobody holds a handle to stay in, see ResourceManager::SetMemoryBudget().
+	constexpr const size_t GPU_MEMORY_BUDGET = (size_t)512 * 1024 * 1024; // 512 MB
+	// Gl thread time per frame given to resources loaded asynchronously, see AsyncLoader::DrainGlQueue().
+	constexpr const float ASYNC_UPLOAD_BUDGET_MILLISECONDS = 2.0f;
+	// Persistently mapped memory texture data is streamed through, and bytes of it uploaded per frame, see UploadStream.
+	constexpr const size_t UPLOAD_RING_BYTES = (size_t)32 * 1024 * 1024; // 32 MB
+	constexpr const size_t UPLOAD_BUDGET_BYTES = (size_t)8 * 1024 * 1024; // 8 MB
+	// Mip streaming, see TextureStreamer. Levels up to STREAMING_RESIDENT_EXTENT texels wide and high always stay, the finer ones share the budget.
+	constexpr const size_t TEXTURE_STREAMING_BUDGET_BYTES = (size_t)256 * 1024 * 1024; // 256 MB
+	constexpr const size_t STREAMING_RESIDENT_EXTENT = 64;
+	constexpr const size_t STREAMING_RELEASE_FRAMES = 120; // Frames a level stays after it was last wanted.
+	constexpr const size_t STREAMING_LOADS_PER_FRAME = 4;
+
+	// Texture units, also used as the Texture::Type of a material's textures.
+	constexpr const int ALPHA_TEXTURE_UNIT = 0;
+	constexpr const int NORMALMAP_TEXTURE_UNIT = 1;
+	constexpr const int DIFFUSE_TEXTURE_UNIT = 2;
+	constexpr const int SPECULAR_TEXTURE_UNIT = 3;
+	constexpr const int CUBEMAP_TEXTURE_UNIT = 4;
+	constexpr const size_t NR_OF_MATERIAL_TEXTURE_UNITS = 5;
+	// Sampler names of the Material struct of the obj shaders in data/shaders, see ResourceManager::PreprocessShaderData().
+	constexpr const char* ALPHA_SAMPLER_NAME = "material.alphaMap";
+	constexpr const char* NORMALMAP_SAMPLER_NAME = "material.normalMap";
+	constexpr const char* DIFFUSE_SAMPLER_NAME = "material.diffuseMap";
+	constexpr const char* SPECULAR_SAMPLER_NAME = "material.specularMap";
+	constexpr const char* SHININESS_NAME = "material.shininess";
+	constexpr const char* CUBEMAP_SAMPLER_NAME = "cubemap";
+
+	// Uber material, keep in sync with data/shaders/gbuffer.vert and data/shaders/gbuffer.frag.
+	constexpr const int MATERIAL_TEXTURE_ARRAYS_UNIT = (int)NR_OF_MATERIAL_TEXTURE_UNITS; // First of MAX_MATERIAL_TEXTURE_ARRAYS consecutive units.
+	constexpr const size_t MAX_MATERIAL_TEXTURE_ARRAYS = 8;
+	constexpr const unsigned int MATERIAL_TABLE_BINDING = 0; // Shader storage buffer binding point.
+	constexpr const unsigned int MATERIAL_ID_LOCATION = 8; // Per instance vertex attribute, after the instanced model matrix at locations 4 to 7.
+
+	// Image based lighting baked from the skybox, see Skybox::BindLighting(). Keep in sync with the lit shaders declaring the keyword, ex: data/shaders/hello_pbr.frag.
+	constexpr const char* IMAGE_BASED_LIGHTING_KEYWORD = "IMAGE_BASED_LIGHTING";
+	constexpr const int IBL_SPECULAR_TEXTURE_UNIT = MATERIAL_TEXTURE_ARRAYS_UNIT + (int)MAX_MATERIAL_TEXTURE_ARRAYS;
+	constexpr const int IBL_BRDF_LUT_TEXTURE_UNIT = IBL_SPECULAR_TEXTURE_UNIT + 1;
+
+	// Framebuffer textures, see Framebuffer::BindGBuffer(). Color attachment i is bound to FRAMEBUFFER_TEXTURE0_UNIT + i and sampled as fbTexture<i>.
+	constexpr const int FRAMEBUFFER_TEXTURE0_UNIT = IBL_BRDF_LUT_TEXTURE_UNIT + 1;
+	constexpr const int FRAMEBUFFER_TEXTURE1_UNIT = FRAMEBUFFER_TEXTURE0_UNIT + 1;
+	constexpr const int FRAMEBUFFER_TEXTURE2_UNIT = FRAMEBUFFER_TEXTURE0_UNIT + 2;
+	constexpr const int FRAMEBUFFER_TEXTURE3_UNIT = FRAMEBUFFER_TEXTURE0_UNIT + 3;
+	constexpr const int FRAMEBUFFER_TEXTURE4_UNIT = FRAMEBUFFER_TEXTURE0_UNIT + 4;
+	constexpr const int FRAMEBUFFER_SHADOWMAP_UNIT = FRAMEBUFFER_TEXTURE0_UNIT + 5; // Depth attachment, after the color ones.
+	constexpr const char* FRAMEBUFFER_SAMPLER0_NAME = "fbTexture0";
+	constexpr const char* FRAMEBUFFER_SAMPLER1_NAME = "fbTexture1";
+	constexpr const char* FRAMEBUFFER_SAMPLER2_NAME = "fbTexture2";
+	constexpr const char* FRAMEBUFFER_SAMPLER3_NAME = "fbTexture3";
+	constexpr const char* FRAMEBUFFER_SAMPLER4_NAME = "fbTexture4";
+	constexpr const char* FRAMEBUFFER_SHADOWMAP_NAME = "shadowmap";
+
+	// Per instance model matrix of the meshes drawn by a Model, locations 4 to 7 in data/shaders.
+	constexpr const size_t MODEL_MATRIX_LOCATION = 4;
+
+	// Uniform buffer binding points shared by every program, keep in sync with the blocks declared in data/shaders.
+	constexpr const unsigned int FRAME_DATA_BINDING = 1;
+	constexpr const unsigned int PASS_DATA_BINDING = 2;
+
 	// GL parameters.
 	constexpr const float CLEAR_SCREEN_COLOR[4] = { 0.3f, 0.0f, 0.3f, 1.0f };
+	constexpr const int OPENGL_MAJOR_VERSION = 4;
+	constexpr const int OPENGL_MINOR_VERSION = 5; // Direct state access. Falls back to a 4.4 context when unavailable.
+	constexpr const int OPENGL_FALLBACK_MINOR_VERSION = 4;
 
 }//!gl
\ No newline at end of file
@@ -37,5 +37,6 @@ namespace gl
         SDL_GLContext glRenderContext_ = nullptr;
         glm::vec2 windowSize_{SCREEN_RESOLUTION[0], SCREEN_RESOLUTION[1]};
         float deltaTime_ = 0.0f;
+        float cpuFrameMilliseconds_ = 0.0f;
     };
 } // namespace gl
@@ -0,0 +1,108 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace gl
+{
+    class AssetPack;
+
+    /*
+    @brief: Every asset read of the engine goes through here. Paths are resolved against mount points, the most recently mounted first, and files are returned as read only spans: memory mapped loose files, views into a memory mapped AssetPack or caller owned memory. Paths no mount point serves are read from the disk as they are, so unmounted relative paths like "../data/..." keep working.
+    */
+    class FileSystem
+    {
+    public:
+        enum class Source
+        {
+            DIRECTORY,
+            ARCHIVE,
+            MEMORY,
+            NATIVE // Not under any mount point.
+        };
+
+        /*
+        @brief: Read only content of a file. Holds whatever backs the span, a mapping or a decompressed copy, until the last copy of the File is destroyed.
+        */
+        class File
+        {
+        public:
+            bool Exists() const { return exists_; }
+            const char* GetData() const { return data_.data(); }
+            size_t GetSize() const { return data_.size(); }
+            std::span<const char> GetSpan() const { return data_; }
+            std::string_view GetString() const { return std::string_view(data_.data(), data_.size()); }
+        private:
+            friend class FileSystem;
+            std::span<const char> data_ = {};
+            std::shared_ptr<const void> owner_ = nullptr;
+            bool exists_ = false;
+        };
+
+        struct FileStats
+        {
+            Source source = Source::NATIVE;
+            size_t reads = 0;
+            size_t bytes = 0;
+            float milliseconds = 0.0f; // Opening, mapping and decompressing. Parsing the data is up to the loaders.
+        };
+
+        FileSystem() = default;
+        FileSystem(const FileSystem&) = delete;
+        static FileSystem& Get()
+        {
+            static gl::FileSystem instance;
+            return instance;
+        }
+
+        /*
+        @brief: Files under mountPoint are read from directory, ex: MountDirectory("../data", "/home/me/mod") overrides the engine's data with a mod's.
+        */
+        void MountDirectory(std::string_view mountPoint, std::string_view directory);
+        /*
+        @brief: Files under mountPoint are read from the asset pack at packPath, with paths relative to the directory it was packed from. Returns false if the pack can't be opened.
+        */
+        bool MountArchive(std::string_view mountPoint, const std::string& packPath);
+        /*
+        @brief: Files under mountPoint are served from memory the caller keeps alive, ex: assets embedded in the executable. Keyed by their path relative to mountPoint.
+        */
+        void MountMemory(std::string_view mountPoint, std::vector<std::pair<std::string, std::span<const char>>> files);
+        void UnmountAll();
+
+        /*
+        @brief: Thread safe, loaders read from worker threads. The returned File doesn't exist when no mount point nor the disk has the path.
+        */
+        File Read(std::string_view path);
+        /*
+        @brief: Where the file is on disk, for watching it. Empty when it's served from an archive or from memory.
+        */
+        std::string GetNativePath(std::string_view path);
+
+        std::vector<std::pair<std::string, FileStats>> GetFileStats(); // Slowest files first.
+        void ResetFileStats();
+    private:
+        struct Mount
+        {
+            std::string mountPoint = ""; // Normalized, "" for the root.
+            Source source = Source::DIRECTORY;
+            std::string directory = "";
+            std::shared_ptr<AssetPack> pack = nullptr;
+            std::unordered_map<std::string, std::span<const char>> files = {};
+        };
+        using Mounts = std::vector<std::shared_ptr<const Mount>>;
+        /*
+        @brief: Finds the mount serving the normalized path and the path relative to it. Returns nullptr when the file is only on the disk. Touches the disk for directory mounts, called on a copy of the mounts from GetMounts() rather than under the lock.
+        */
+        static const Mount* Resolve(const Mounts& mounts, const std::string& path, std::string& relativePath);
+        Mounts GetMounts();
+
+        std::mutex mutex_; // Guards the list of mounts and the stats only, reads resolve and decompress without it.
+        Mounts mounts_ = {}; // Never edited once mounted, copies keep them alive through UnmountAll().
+        std::unordered_map<std::string, FileStats> fileStats_ = {};
+    };
+}//!gl
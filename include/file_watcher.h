@@ -0,0 +1,55 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gl
+{
+    /*
+    @brief: Watches source files for hot reloading. Changes are marked by the os as files get written (inotify on linux) and Poll() hands the changed paths to their callbacks on the gl thread, so resources are rebuilt at most a frame after an edit is saved. Directories are watched rather than files since editors often save by replacing the file.
+    */
+    class FileWatcher
+    {
+    public:
+        using Callback = std::function<void(const std::string& path)>; // Receives the path as it was passed to Watch().
+
+        struct Stats
+        {
+            size_t nrOfReloads = 0; // Changed files handed to their callbacks.
+            float lastReloadMilliseconds = 0.0f; // Time spent in the callbacks of the last Poll() that found changes.
+        };
+
+        FileWatcher() = default;
+        ~FileWatcher();
+        FileWatcher(const FileWatcher&) = delete;
+        static FileWatcher& Get()
+        {
+            static gl::FileWatcher instance;
+            return instance;
+        }
+
+        bool IsSupported();
+        /*
+        @brief: Calls onChange each time the file at path is written. Several callbacks can watch the same file, they're called in the order they were added. The path is resolved through the FileSystem's mount points, files served from an archive or from memory are never called back.
+        */
+        void Watch(const std::string& path, Callback onChange);
+        /*
+        @brief: Reads the pending file changes without blocking and runs their callbacks. The Engine calls it once per frame before Program::Update().
+        */
+        void Poll();
+
+        const Stats& GetStats() const;
+    private:
+        struct Watcher
+        {
+            std::string path = ""; // As passed to Watch(), the same file can be reached through different paths.
+            Callback onChange = nullptr;
+        };
+
+        int fd_ = -2; // -2: not initialized yet, -1: unsupported.
+        std::unordered_map<int, std::string> directories_ = {}; // Watch descriptor to canonical directory.
+        std::unordered_map<std::string, std::vector<Watcher>> files_ = {}; // Keyed by canonical path.
+        Stats stats_ = {};
+    };
+}//!gl
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+
+namespace gl
+{
+    enum class ResourceType : size_t
+    {
+        VERTEX_BUFFER = 0,
+        TEXTURE = 1,
+        FRAMEBUFFER = 2,
+        PROGRAM = 3, // Includes reading the sources, cached binaries or not.
+        NR_OF_RESOURCES = 4
+    };
+
+    class Texture;
+    class Shader;
+    class VertexBuffer;
+
+    template<typename T>
+    struct HandleTraits;
+    template<>
+    struct HandleTraits<Texture> { static constexpr ResourceType TYPE = ResourceType::TEXTURE; };
+    template<>
+    struct HandleTraits<Shader> { static constexpr ResourceType TYPE = ResourceType::PROGRAM; };
+    template<>
+    struct HandleTraits<VertexBuffer> { static constexpr ResourceType TYPE = ResourceType::VERTEX_BUFFER; }; // Keyed by the VAO.
+
+    // Reference counting of the ResourceManager, see Handle.
+    void RetainResource(ResourceType type, unsigned int gpuName);
+    void ReleaseResource(ResourceType type, unsigned int gpuName);
+
+    /*
+    @brief: Reference to a gpu resource tracked by the ResourceManager. Resources nobody holds a handle to anymore aren't deleted right away, they go to an LRU and are only evicted once the memory budget is exceeded, so recreating something used a moment ago is still free.
+    */
+    template<typename T>
+    class Handle
+    {
+    public:
+        Handle() = default;
+        explicit Handle(unsigned int gpuName) :
+            gpuName_(gpuName)
+        {
+            if (gpuName_ != 0) RetainResource(TYPE, gpuName_);
+        }
+        Handle(const Handle& other) :
+            Handle(other.gpuName_)
+        {
+        }
+        Handle(Handle&& other) noexcept :
+            gpuName_(std::exchange(other.gpuName_, 0))
+        {
+        }
+        Handle& operator=(Handle other) noexcept
+        {
+            std::swap(gpuName_, other.gpuName_);
+            return *this;
+        }
+        ~Handle()
+        {
+            if (gpuName_ != 0) ReleaseResource(TYPE, gpuName_);
+        }
+
+        unsigned int Get() const { return gpuName_; }
+        explicit operator bool() const { return gpuName_ != 0; }
+    private:
+        static constexpr ResourceType TYPE = HandleTraits<T>::TYPE;
+        unsigned int gpuName_ = 0;
+    };
+}//!gl
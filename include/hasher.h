@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace gl
+{
+    /*
+    @brief: Streaming XXH3 hasher used to build resource keys. Fields are fed in place as raw bytes, nothing is formatted or allocated, and the same sequence of Add() calls always gives the same key. Variable length fields are prefixed by their size so that ex: "ab" + "c" and "a" + "bc" don't collide.
+    */
+    class Hasher
+    {
+    public:
+        struct Hash128
+        {
+            uint64_t low = 0;
+            uint64_t high = 0;
+        };
+
+        explicit Hasher(uint64_t seed);
+        Hasher(const Hasher&) = delete;
+
+        Hasher& AddBytes(const void* data, size_t size);
+        Hasher& Add(std::string_view string);
+        /*
+        @brief: Plain values, glm vectors and matrices included. Floats are hashed bitwise, 0.0f and -0.0f give different keys. Pointers are refused, use AddAddress() to make hashing an address explicit.
+        */
+        template<typename T> requires (std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> && !std::is_array_v<T>)
+        Hasher& Add(const T& value)
+        {
+            return AddBytes(&value, sizeof(T));
+        }
+        template<typename T>
+        Hasher& Add(const std::vector<T>& values)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Only plain values can be hashed as raw bytes.");
+            const uint64_t count = values.size();
+            AddBytes(&count, sizeof(count));
+            return AddBytes(values.data(), sizeof(T) * values.size());
+        }
+        /*
+        @brief: Hashes the address itself, not the value it points to. Only stable for the lifetime of the pointed value, never write such keys to disk.
+        */
+        Hasher& AddAddress(const void* address);
+
+        uint64_t Digest64() const;
+        Hash128 Digest128() const;
+    private:
+        // XXH3_state_t, kept in place to avoid the heap allocation of XXH3_createState(). Size and alignment are checked in hasher.cpp.
+        alignas(64) unsigned char state_[576];
+    };
+}//!gl
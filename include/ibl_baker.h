@@ -0,0 +1,52 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace gl
+{
+    /*
+    @brief: Precomputes image based lighting from an environment cubemap on the CPU: SH9 irradiance for the diffuse part, a GGX prefiltered cubemap with one level per roughness and the split sum BRDF LUT for the specular part. Shading then takes a few fetches instead of integrating the environment per pixel. Texels are shared between the hardware threads and filtered with SSE, results are cached on disk keyed by a hash of the cubemap's file and of the Definition.
+    */
+    class IblBaker
+    {
+    public:
+        struct Definition
+        {
+            size_t specularSize = 128; // Of the level of roughness 0.
+            size_t nrOfSpecularLevels = 6; // Roughness goes from 0 to 1 across them, level i is max(1, specularSize >> i) wide.
+            size_t specularSamples = 128; // GGX samples per texel, filtered importance sampling keeps that low.
+            size_t brdfLutSize = 128;
+            size_t brdfSamples = 512;
+            std::string cacheDirectory = "ibl_cache/"; // Relative to the working directory, created on the first bake. Not part of the key.
+        };
+        // Linear RGBA floats, faces in the +X, -X, +Y, -Y, +Z, -Z order of gl.
+        struct Environment
+        {
+            size_t size = 0;
+            std::array<std::vector<float>, 6> faces = {};
+        };
+        struct Result
+        {
+            // Irradiance E(n) = sum of irradianceSH[i] * Y_i(n) over the 9 real SH basis functions, the cosine lobe is already convolved in. Diffuse lighting is albedo / PI * E(n).
+            std::array<glm::vec3, 9> irradianceSH = {};
+            size_t specularSize = 0;
+            size_t nrOfSpecularLevels = 0;
+            std::vector<float> specular = {}; // Linear RGBA floats, level by level, each one face by face.
+            size_t brdfLutSize = 0;
+            std::vector<float> brdfLut = {}; // RG floats: scale and bias of F0. x is NdotV, y is roughness.
+        };
+
+        /*
+        @brief: Result for the cubemap file at path, read from the cache or baked and stored. 8 bits per channel cubemaps are decoded with the same 2.2 gamma as skybox.frag. Returns false with a warning when the file can't be read or decoded.
+        */
+        static bool Load(std::string_view path, const Definition& def, Result& result);
+        static void Bake(const Environment& environment, const Definition& def, Result& result);
+
+        static size_t GetSpecularLevelOffset(const Result& result, size_t level); // In floats.
+    };
+}//!gl
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <array>
 #include <string>
 #include <vector>
 #include <utility>
 
 #include "texture.h"
+#include "sampler.h"
+#include "defines.h"
 
 namespace gl
 {
@@ -14,14 +17,43 @@ namespace gl
         struct Definition
         {
             std::vector<std::pair<std::string, Texture::Type>> texturePathsAndTypes = {};
+            Sampler::Definition sampler = {}; // Shared by all the material's textures. Cubemaps are always clamped to their edges to avoid seams.
+            bool loadAsync = false; // Textures are loaded with Texture::CreateAsync(), their placeholders are bound until they land.
+            bool streamMips = false; // Loads asynchronously too, the finer mips of 2D textures are then streamed in as they're drawn bigger, see TextureStreamer.
         };
 
         void Create(Definition def);
 
-        void Bind();
-        void Unbind();
+        /*
+        @brief: Binds every texture and sampler of the material with a single glBindTextures and a single glBindSamplers. If previous is the material that is currently bound, only the range of units that differ between both materials is touched.
+        */
+        void Bind(const Material* previous = nullptr) const;
+        void Unbind() const;
+        /*
+        @brief: The material is drawn this frame over about screenSize pixels across, asks the TextureStreamer for the levels of its streamed textures that match.
+        */
+        void RequestTextureLevels(float screenSize) const;
+
+        /*
+        @brief: Orders materials so that consecutive ones share as many texture units as possible. Binding them in that order with Bind(previous) touches fewer units.
+        */
+        static void Sort(std::vector<const Material*>& materials);
     private:
+        // Gpu names per texture unit, 0 for units the material doesn't use.
+        struct BindingTable
+        {
+            std::array<unsigned int, NR_OF_MATERIAL_TEXTURE_UNITS> TEXs = {};
+            std::array<unsigned int, NR_OF_MATERIAL_TEXTURE_UNITS> SAMPLERs = {};
+        };
+
+        /*
+        @brief: Swaps the placeholders of textures that landed for the real ones.
+        */
+        void RefreshLoadingTextures() const;
 
         std::vector<Texture> textures_ = {};
+        // Mutable, Bind() refreshes the names of textures still loading.
+        mutable BindingTable bindingTable_ = {};
+        mutable bool texturesLoaded_ = true;
     };
 }//!gl
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "resource_manager.h"
+#include "sampler.h"
+#include "defines.h"
+
+namespace gl
+{
+    /*
+    @brief: Every material of a scene packed for a single program. Material parameters live in a shader storage buffer indexed by a per instance material id, and textures sharing the same format and size are grouped as layers of GL_TEXTURE_2D_ARRAYs. Any number of differently textured objects sharing a vertex format can then be drawn without switching programs or textures.
+    */
+    class MaterialTable
+    {
+    public:
+        enum Flags : unsigned int
+        {
+            NONE = 0,
+            RECEIVE_SHADOWS = 1 << 0,
+            SKIP_LIGHTING = 1 << 1, // Written to the gbuffer as is, the lighting pass leaves it untouched.
+            MESH_TEXTURES = 1 << 2 // Samples the diffuse and normal maps the mesh's own Material binds at DIFFUSE_TEXTURE_UNIT and NORMALMAP_TEXTURE_UNIT instead, ex: streamed textures. The entry's maps are ignored.
+        };
+        struct Entry
+        {
+            std::string diffuseMap = ""; // Full path, optional.
+            std::string normalMap = ""; // Full path, optional. Falls back to the vertex normals.
+            float shininess = 64.0f;
+            unsigned int flags = Flags::NONE;
+        };
+        struct Definition
+        {
+            std::vector<Entry> entries = {}; // An entry's material id is its index.
+            Sampler::Definition sampler = {};
+        };
+
+        void Create(Definition def);
+        void Destroy();
+
+        /*
+        @brief: Binds the texture arrays starting at MATERIAL_TEXTURE_ARRAYS_UNIT and the material table at MATERIAL_TABLE_BINDING.
+        */
+        void Bind() const;
+        void Unbind() const;
+
+        /*
+        @brief: Sources the per instance material ids (one unsigned int per instance) of a VAO from a buffer. Reads them at MATERIAL_ID_LOCATION.
+        */
+        static void SetupMaterialIdAttribute(unsigned int VAO, unsigned int VBO);
+        /*
+        @brief: Converts the materials read from an obj file to material table entries.
+        */
+        static std::vector<Entry> EntriesFromObj(const std::vector<ResourceManager::ObjData>& objData);
+
+        size_t GetNrOfMaterials() const;
+        size_t GetNrOfTextureArrays() const;
+    private:
+        // Matches the std430 layout of the shader side struct.
+        struct GpuMaterial
+        {
+            int diffuseArray = -1;
+            int diffuseLayer = 0;
+            int normalArray = -1;
+            int normalLayer = 0;
+            float shininess = 64.0f;
+            unsigned int flags = Flags::NONE;
+            float padding[2] = { 0.0f, 0.0f };
+        };
+
+        unsigned int SSBO_ = 0;
+        std::vector<unsigned int> TEXs_ = {}; // One per texture array.
+        std::vector<unsigned int> SAMPLERs_ = {}; // Same sampler repeated for each array, to bind them all in one call.
+        size_t nrOfMaterials_ = 0;
+    };
+}//!gl
@@ -16,7 +16,15 @@ namespace gl
     public:
         void Create(const VertexBuffer::Definition vbdef, const Material::Definition matdef);
 
-        // void Draw(const std::vector<glm::mat4>& modelMatrices, Shader& shader, bool updateModels = true, size_t transformModelOffset = MODEL_MATRIX_LOCATION);
+        /*
+        @brief: Draws nrOfInstances instances with the mesh's material, their model matrices read from modelMatricesVBO at locations modelMatrixOffset to modelMatrixOffset + 3. The shader has to be bound already. With a materialIdsVBO, their MaterialTable ids are read from it at MATERIAL_ID_LOCATION.
+        */
+        void Draw(size_t nrOfInstances, unsigned int modelMatricesVBO, size_t modelMatrixOffset = MODEL_MATRIX_LOCATION, unsigned int materialIdsVBO = 0) const;
+
+        /*
+        @brief: Asks for the texture levels the mesh needs when drawn at each of modelMatrices, from the screen size of its bounding sphere at the closest of them. See TextureStreamer.
+        */
+        void RequestTextureLevels(const std::vector<glm::mat4>& modelMatrices) const;
 
         float GetBoundingSphereRadius() const;
     private:
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "file_system.h"
+#include "resource_manager.h"
+#include "vertex_buffer.h"
+
+namespace gl
+{
+    /*
+    @brief: Meshes cooked by main/assetcooker.cpp. Vertices are deduplicated, indexed and stored in their gpu format: float positions, normals and tangents packed as signed normalized 2_10_10_10 and uvs as half floats. That's 24 bytes per vertex against the 44 of the float triangle lists ReadObj() gives. Opening one maps it through the FileSystem, and the vertex buffer definitions it hands out point into the mapping, so loading a cooked mesh is its upload.
+    Layout: a Header, a Mesh per obj shape, the string table, then the vertices and indices of each mesh aligned to ALIGNMENT.
+    */
+    class MeshFile
+    {
+    public:
+        struct Header
+        {
+            uint32_t magic = 0;
+            uint32_t version = 0;
+            uint32_t nrOfMeshes = 0;
+            uint32_t stringsSize = 0; // The string table follows the meshes.
+        };
+        struct String
+        {
+            uint32_t offset = 0; // In the string table.
+            uint32_t size = 0;
+        };
+        struct Mesh
+        {
+            uint64_t verticesOffset = 0; // From the start of the file, aligned.
+            uint64_t indicesOffset = 0;
+            uint32_t nrOfVertices = 0;
+            uint32_t nrOfIndices = 0;
+            // Same as ResourceManager::ObjData.
+            String dir = {};
+            String alphaMap = {};
+            String normalMap = {};
+            String diffuseMap = {};
+            String specularMap = {};
+            float shininess = 64.0f;
+            uint32_t reserved = 0;
+        };
+        // Same attribute locations as the float layout { 3, 2, 3, 3 } of obj meshes.
+        struct Vertex
+        {
+            float position[3] = {};
+            uint32_t uv = 0; // 2 halves.
+            uint32_t normal = 0; // Signed normalized 2_10_10_10.
+            uint32_t tangent = 0;
+        };
+
+        constexpr static const uint32_t MAGIC = 0x534D4C47; // "GLMS"
+        constexpr static const uint32_t VERSION = 1;
+        constexpr static const size_t ALIGNMENT = 16;
+
+        /*
+        @brief: Maps the cooked mesh at path, returns false when it can't be read or isn't a valid mesh file.
+        */
+        bool Open(std::string_view path);
+        void Close();
+        bool IsOpen() const;
+
+        std::span<const Mesh> GetMeshes() const;
+        std::string_view GetString(const String& string) const;
+        /*
+        @brief: Packed and indexed vertex buffer of the mesh, valid until Close(). VertexBuffer::Create() copies it to the gpu.
+        */
+        VertexBuffer::Definition GetVertexBufferDefinition(const Mesh& mesh) const;
+        /*
+        @brief: Material half of the ObjData the mesh was cooked from, its vertices are left empty. For ResourceManager::PreprocessMaterialData() and PreprocessShaderData().
+        */
+        ResourceManager::ObjData GetMaterialData(const Mesh& mesh) const;
+
+        /*
+        @brief: Indexes and packs the meshes ReadObj() gives into a new mesh file at path. Returns false if it can't be written.
+        */
+        static bool Write(const std::string& path, const std::vector<ResourceManager::ObjData>& meshes);
+    private:
+        FileSystem::File file_ = {};
+        std::span<const Mesh> meshes_ = {};
+        std::string_view strings_ = {};
+    };
+}//!gl
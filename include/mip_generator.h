@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace gli
+{
+    class texture;
+}//!gli
+
+namespace gl
+{
+    /*
+    @brief: Builds the mip chain of RGBA8 images on the CPU, so textures decoded from pngs or cooked by main/assetcooker.cpp are uploaded with their mips instead of having the gpu generate them after each load. Every level is filtered from the float result of the previous one in two separable passes, with SSE (and AVX for the vertical pass when compiled for it). Rows are shared between the hardware threads when the level is big enough.
+    */
+    class MipGenerator
+    {
+    public:
+        enum class Filter
+        {
+            BOX, // 2x2 average, the same as glGenerateMipmap() on most drivers.
+            KAISER // Kaiser windowed sinc over 6x6 texels, keeps the smaller levels sharp.
+        };
+        struct Definition
+        {
+            Filter filter = Filter::KAISER;
+            bool srgb = false; // Colors are decoded to linear before filtering and encoded back, alpha is always linear.
+            float alphaCutoff = 0.0f; // Above 0, the alpha of each level is scaled so that the share of texels above alphaCutoff stays the one of level 0. For alpha tested textures.
+        };
+
+        static size_t GetNrOfLevels(size_t width, size_t height);
+        /*
+        @brief: Offset of level in a chain from Generate(), level 0 included.
+        */
+        static size_t GetLevelOffset(size_t width, size_t height, size_t level);
+        /*
+        @brief: Byte size of the whole chain of a width x height image, level 0 included.
+        */
+        static size_t GetChainSize(size_t width, size_t height);
+        /*
+        @brief: Writes every level of the RGBA8 image rgba, level 0 first, into chain which holds GetChainSize() bytes. Each level is max(1, size >> level) wide and high. rgba may be chain itself.
+        */
+        static void Generate(const uint8_t* rgba, size_t width, size_t height, const Definition& def, uint8_t* chain);
+        /*
+        @brief: image with every level, for 2D RGBA8 images (sRGB ones filtered in linear space) that only have their first one. Any other image is returned as it is.
+        */
+        static gli::texture Generate(const gli::texture& image);
+    };
+}//!gl
@@ -3,7 +3,9 @@
 #include <glm/glm.hpp>
 
 #include "mesh.h"
+#include "mesh_file.h"
 #include "material.h"
+#include "resource_manager.h"
 #include "shader.h"
 
 namespace gl
@@ -11,10 +13,26 @@ namespace gl
     class Model
     {
     public:
-        // void Create(std::vector<VertexBuffer::Definition> vb, std::vector<Material::Definition> mat, std::vector<glm::mat4> modelMatrices = { IDENTITY_MAT4 }, const size_t modelMatrixOffset = MODEL_MATRIX_LOCATION);
+        /*
+        @brief: One mesh per vertex buffer and material, all drawn at each of modelMatrices. Shaders read the model matrix at locations modelMatrixOffset to modelMatrixOffset + 3.
+        */
+        void Create(std::vector<VertexBuffer::Definition> vb, std::vector<Material::Definition> mat, std::vector<glm::mat4> modelMatrices = { IDENTITY_MAT4 }, const size_t modelMatrixOffset = MODEL_MATRIX_LOCATION);
+        /*
+        @brief: One mesh per primitive of the glb mesh, drawn at each of its node instances. The glb's GlbData has to outlive the call only. With streamTextures, the finer mips of its textures are only resident while the model is drawn big enough to need them, see TextureStreamer.
+        */
+        void Create(const ResourceManager::GlbMesh& glbMesh, Sampler::Definition sampler = {}, bool streamTextures = false);
+        /*
+        @brief: One mesh per mesh of a cooked mesh file, with the materials of the objs it was cooked from. The file only has to stay open during the call, its vertices are uploaded as they are stored. streamTextures is the same as for glb meshes.
+        */
+        void Create(const MeshFile& meshFile, std::vector<glm::mat4> modelMatrices = { IDENTITY_MAT4 }, Sampler::Definition sampler = {}, bool streamTextures = false);
 
         void Draw(Shader& shader, bool bypassFrustumCulling = false);
 
+        /*
+        @brief: Draws every instance of every mesh with the material of a MaterialTable, read by the shader at MATERIAL_ID_LOCATION.
+        */
+        void SetMaterialId(unsigned int materialId);
+
         void Translate(glm::vec3 v, size_t modelMatrixIndex = 0);
         void Rotate(glm::vec3 cardinalRotation, size_t modelMatrixIndex = 0);
         void Scale(glm::vec3 v, size_t modelMatrixIndex = 0);
@@ -24,9 +42,17 @@ namespace gl
     private:
         const std::vector<glm::mat4> ComputeVisibleModels() const;
 
-        // size_t modelMatrixOffset_ = MODEL_MATRIX_LOCATION;
+        void CreateModelMatricesVBO();
+        void UploadModelMatrices(const std::vector<glm::mat4>& modelMatrices);
+        void UploadMaterialIds();
+
+        size_t modelMatrixOffset_ = MODEL_MATRIX_LOCATION;
         std::vector<Mesh> meshes_ = {};
         std::vector<glm::mat4> modelMatrices_ = {};
         unsigned int modelMatricesVBO_ = 0;
+        size_t modelMatricesCapacity_ = 0; // In matrices.
+        unsigned int materialIdsVBO_ = 0; // Copies of materialId_, 0 without a material id.
+        size_t materialIdsCapacity_ = 0; // In ids, follows modelMatricesCapacity_.
+        unsigned int materialId_ = 0;
     };
 }//!gl
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace gl
+{
+    /*
+    @brief: On disk cache of linked program binaries. Entries are keyed by a hash of the final shader sources and of the driver's vendor, renderer and version strings, so that a driver update or a different gpu never gets fed a foreign binary. Binaries the driver still refuses are deleted and the caller compiles from source.
+    */
+    class ProgramCache
+    {
+    public:
+        struct Stats
+        {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t rejected = 0; // Found on disk but refused by the driver, counted as misses as well.
+        };
+
+        ProgramCache() = default;
+        ProgramCache(const ProgramCache&) = delete;
+        static ProgramCache& Get()
+        {
+            static gl::ProgramCache instance;
+            return instance;
+        }
+
+        /*
+        @brief: Directory the binaries are read from and written to, created on the first Store(). Relative to the working directory.
+        */
+        void SetDirectory(const std::string& directory);
+        bool IsSupported();
+
+        /*
+        @brief: Returns a linked program created from the cached binary of the given sources, or 0 when there is none or the driver refused it.
+        */
+        unsigned int Load(const uint64_t sourceHash);
+        /*
+        @brief: Writes the binary of a freshly linked program. The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+        */
+        void Store(const uint64_t sourceHash, const unsigned int PROGRAM);
+
+        const Stats& GetStats() const;
+    private:
+        struct Header
+        {
+            uint32_t magic = 0;
+            uint32_t binaryFormat = 0;
+            uint32_t binarySize = 0;
+            uint32_t padding = 0;
+        };
+        static constexpr uint32_t MAGIC_ = 0x4E494250; // "PBIN"
+
+        std::string GetPath(const uint64_t sourceHash);
+
+        std::string directory_ = "shader_cache/";
+        uint64_t driverHash_ = 0;
+        int isSupported_ = -1; // Queried once a context exists. -1: unknown.
+        Stats stats_ = {};
+    };
+}//!gl
@@ -1,13 +1,22 @@
 #pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <map>
 
 #include "camera.h"
-// #include "material.h"
+#include "defines.h"
+#include "file_system.h"
+#include "handle.h"
+#include "material.h"
 #include "shader.h"
-
-using XXH32_hash_t = unsigned int;
+#include "vertex_buffer.h"
 
 namespace gl
 {
@@ -32,6 +41,55 @@ namespace gl
             float shininess = 64.0f;
         };
 
+        // Draw call of a glb mesh. Its vertex buffer points into the glb's binary chunk, valid as long as the GlbData it came from.
+        struct GlbPrimitive
+        {
+            VertexBuffer::Definition vertexBuffer = {};
+            // Material data, image paths relative to dir. Images embedded in the glb aren't loaded.
+            std::string dir = "";
+            std::string normalMap = ""; // Tex unit 1
+            std::string diffuseMap = ""; // Tex unit 2, the base color.
+        };
+        struct GlbMesh
+        {
+            std::string name = "";
+            std::vector<GlbPrimitive> primitives = {};
+            std::vector<glm::mat4> instances = {}; // World matrix of every node of the default scene using the mesh.
+        };
+        struct GlbData
+        {
+            FileSystem::File file = {}; // Keeps the binary chunk mapped.
+            std::vector<GlbMesh> meshes = {};
+        };
+
+        using Resource = ResourceType;
+        struct CreationStats
+        {
+            size_t count = 0;
+            float milliseconds = 0.0f; // Cpu time spent issuing the gl calls, excluding disk io. The driver is free to defer the actual work.
+        };
+        /*
+        @brief: Accumulates the time spent creating a resource of the given type from construction to destruction. Used to measure resource creation throughput.
+        */
+        class CreationTimer
+        {
+        public:
+            CreationTimer(Resource resource, size_t count = 1); // count: number of resources the timed work creates, 0 to only add time to resources counted elsewhere.
+            ~CreationTimer();
+        private:
+            Resource resource_;
+            size_t count_;
+            std::chrono::high_resolution_clock::time_point start_;
+        };
+
+        struct MemoryStats
+        {
+            size_t count = 0;
+            size_t bytes = 0;
+            size_t unreferencedBytes = 0; // Held by the LRU only, evicted first when over budget.
+            size_t evictions = 0;
+        };
+
         ResourceManager() = default;
         ~ResourceManager();
         ResourceManager(const ResourceManager&) = delete; // Disallow things like ResourceManager r = ResourceManager::Get(), only allow ResourceManager& r = ResourceManager::Get() .
@@ -41,37 +99,104 @@ namespace gl
             return instance;
         }
 
-        // These functions return the gpu name of the data structure if the hashed data is identical to some instance that has been previously created. Else it returns 0.
-        unsigned int RequestVAO(XXH32_hash_t hash) const;
-        void AppendNewVAO(unsigned int gpuName, XXH32_hash_t hash = 0);
-        unsigned int RequestVBO(XXH32_hash_t hash) const;
-        void AppendNewVBO(unsigned int gpuName, XXH32_hash_t hash = 0);
-        unsigned int RequestTEX(XXH32_hash_t hash) const;
-        void AppendNewTEX(unsigned int gpuName, XXH32_hash_t hash = 0);
-        unsigned int RequestPROGRAM(XXH32_hash_t hash) const;
-        void AppendNewPROGRAM(unsigned int gpuName, XXH32_hash_t hash = 0);
+        // These functions return the gpu name of the data structure if the hashed data is identical to some instance that has been previously created. Else it returns 0. Keys are built with gl::Hasher.
+        unsigned int RequestVAO(uint64_t hash) const;
+        void AppendNewVAO(unsigned int gpuName, uint64_t hash = 0);
+        unsigned int RequestVBO(uint64_t hash) const;
+        void AppendNewVBO(unsigned int gpuName, uint64_t hash = 0);
+        unsigned int RequestTEX(uint64_t hash) const;
+        void AppendNewTEX(unsigned int gpuName, uint64_t hash = 0);
+        unsigned int RequestPROGRAM(uint64_t hash) const;
+        void AppendNewPROGRAM(unsigned int gpuName, uint64_t hash = 0);
+        unsigned int RequestSAMPLER(uint64_t hash) const;
+        void AppendNewSAMPLER(unsigned int gpuName, uint64_t hash = 0);
+
+        // For resources reloaded in place whose content, and so hash, changed. The entry keeps its previous hash if the new one is already taken.
+        void RekeyVAO(unsigned int gpuName, uint64_t hash);
+        void RekeyVBO(unsigned int gpuName, uint64_t hash);
 
         void DeleteVAO(unsigned int gpuName);
         void DeleteVBO(unsigned int gpuName);
         void DeleteTEX(unsigned int gpuName);
         void DeletePROGRAM(unsigned int gpuName);
+        void DeleteSAMPLER(unsigned int gpuName);
 
         static std::vector<ObjData> ReadObj(std::string_view path, bool generateOwnNormals = true, bool flipNormals = false, bool reverseWindingOrder = false);
         /*
-        @brief: This function returns a list of per mesh materials with material related data filled out. Use it to avoid having repetitive sections in a Program::Init().
+        @brief: Same as ReadObj() but returns false with the reason in error instead of aborting, tinyobj's warnings included. For tools and reloads.
         */
-        // static std::vector<Material::Definition> PreprocessMaterialData(const std::vector<ObjData> objData);
-        // static std::vector<Shader::Definition> PreprocessShaderData(const std::vector<ObjData> objData);
+        static bool TryReadObj(std::string_view path, std::vector<ObjData>& objData, std::string& error, bool generateOwnNormals = true, bool flipNormals = false, bool reverseWindingOrder = false);
+        /*
+        @brief: ReadObj() on a worker thread, see AsyncLoader. onLoaded receives the meshes on the gl thread, where their vertex buffers and materials can be created.
+        */
+        static void ReadObjAsync(std::string path, std::function<void(std::vector<ObjData>)> onLoaded, bool generateOwnNormals = true, bool flipNormals = false, bool reverseWindingOrder = false);
+        /*
+        @brief: Vertex buffer of the mesh-th mesh read from the obj at path, positions, uvs, normals and tangents interleaved (dataLayout { 3, 2, 3, 3 }). Pass the same flags as to ReadObj(): the buffer is rebuilt with them whenever the file changes on disk, see VertexBuffer::Definition::reload.
+        */
+        static VertexBuffer::Definition GetObjVertexBufferDefinition(const std::vector<ObjData>& objData, size_t mesh, std::string_view path, bool generateOwnNormals = true, bool flipNormals = false, bool reverseWindingOrder = false);
+        /*
+        @brief: Reads a binary glTF. Nothing is converted: the accessors' buffer views are handed to VertexBuffer as they are stored, interleaved or not, along with their index buffers. Attribute locations match ReadObj() meshes (position 0, uv 1, normal 2, tangent 3). Returns no meshes if the file can't be read.
+        */
+        static GlbData ReadGlb(std::string_view path);
+        /*
+        @brief: This function returns a list of per mesh materials with material related data filled out. Use it to avoid having repetitive sections in a Program::Init(). With loadAsync, see Material::Definition::loadAsync.
+        */
+        static std::vector<Material::Definition> PreprocessMaterialData(const std::vector<ObjData> objData, bool loadAsync = false);
+        static std::vector<Shader::Definition> PreprocessShaderData(const std::vector<ObjData> objData);
 
         Camera& GetCamera();
 
-        void Shutdown() const;
+        const CreationStats& GetCreationStats(Resource resource) const;
+        void ResetCreationStats();
+
+        /*
+        @brief: Accounts for the gpu memory of a resource, or updates it when it's tracked already. companion is deleted along with it on eviction, ex: the VBO of a VAO. Tracked resources are pinned until a Handle to them is released, only then can they be evicted.
+        */
+        void TrackMemory(Resource resource, unsigned int gpuName, size_t bytes, unsigned int companion = 0);
+        void UntrackMemory(Resource resource, unsigned int gpuName); // Called by the Delete functions, only needed for resources not deleted through them.
+        /*
+        @brief: onEvict is called right before an evicted resource is deleted, to let the module that created it forget about it.
+        */
+        void SetEvictionCallback(Resource resource, std::function<void(unsigned int gpuName)> onEvict);
+        void SetMemoryBudget(size_t bytes);
+        size_t GetMemoryBudget() const;
+        size_t GetTrackedBytes() const;
+        /*
+        @brief: Deletes the least recently released resources until the tracked memory fits the budget again. Resources still referenced are never evicted, the budget can be exceeded by them. The Engine calls it once per frame.
+        */
+        void EvictOverBudget();
+        const MemoryStats& GetMemoryStats(Resource resource) const;
+
+        void Shutdown();
 
     private:
-        std::map<XXH32_hash_t, unsigned int> VAOs_ = {};
-        std::map<XXH32_hash_t, unsigned int> VBOs_ = {};
-        std::map<XXH32_hash_t, unsigned int> TEXs_ = {};
-        std::map<XXH32_hash_t, unsigned int> PROGRAMs_ = {};
+        friend void RetainResource(ResourceType type, unsigned int gpuName);
+        friend void ReleaseResource(ResourceType type, unsigned int gpuName);
+
+        struct TrackedResource
+        {
+            size_t bytes = 0;
+            unsigned int companion = 0;
+            size_t references = 0;
+            bool inLru = false;
+            std::list<std::pair<Resource, unsigned int>>::iterator lru = {};
+        };
+        void Evict(Resource resource, unsigned int gpuName);
+
+        std::map<uint64_t, unsigned int> VAOs_ = {};
+        std::map<uint64_t, unsigned int> VBOs_ = {};
+        std::map<uint64_t, unsigned int> TEXs_ = {};
+        std::map<uint64_t, unsigned int> PROGRAMs_ = {};
+        std::map<uint64_t, unsigned int> SAMPLERs_ = {};
+
+        std::array<CreationStats, (size_t)Resource::NR_OF_RESOURCES> creationStats_ = {};
+
+        std::array<std::unordered_map<unsigned int, TrackedResource>, (size_t)Resource::NR_OF_RESOURCES> tracked_ = {}; // By gpu name.
+        std::list<std::pair<Resource, unsigned int>> lru_ = {}; // Unreferenced resources, most recently released first.
+        std::array<MemoryStats, (size_t)Resource::NR_OF_RESOURCES> memoryStats_ = {};
+        std::array<std::function<void(unsigned int)>, (size_t)Resource::NR_OF_RESOURCES> evictionCallbacks_ = {};
+        size_t memoryBudget_ = GPU_MEMORY_BUDGET;
+        size_t trackedBytes_ = 0;
 
         Camera camera_ = {}; // Most shaders need a view matrix and the camera's position, so it's need to be accessible globally.
     };
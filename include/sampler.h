@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+
+namespace gl
+{
+    /*
+    @brief: Sampling state decoupled from the textures. Identical definitions share the same gpu sampler object through the ResourceManager.
+    */
+    class Sampler
+    {
+    public:
+        enum class Filter
+        {
+            NEAREST = 0,
+            LINEAR = 1, // No mipmapping.
+            TRILINEAR = 2
+        };
+        enum class Wrap
+        {
+            REPEAT = 0,
+            MIRRORED_REPEAT = 1,
+            CLAMP_TO_EDGE = 2
+        };
+
+        struct Definition
+        {
+            Filter filter = Filter::TRILINEAR;
+            Wrap wrap = Wrap::REPEAT;
+
+            uint64_t GetHash() const;
+        };
+
+        // Those are hashed.
+        void Create(Definition def);
+
+        unsigned int GetSAMPLER() const;
+    private:
+
+        unsigned int SAMPLER_ = 0;
+    };
+}//!gl
@@ -1,14 +1,45 @@
 #pragma once
+#include <array>
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include <glm/glm.hpp>
 
-using XXH32_hash_t = unsigned int;
+#include "handle.h"
 
 namespace gl
 {
+    /*
+    @brief: Compile time hash (32 bit FNV-1a) of a uniform's name. String literals convert implicitly and are always hashed by the compiler, so shader.SetMat4("model", model) never hashes at runtime. Names only known at runtime go through FromRuntime().
+    */
+    struct UniformId
+    {
+        consteval UniformId(const char* name) : hash(Fnv1a(name)) {}
+        static constexpr UniformId FromRuntime(std::string_view name) { return UniformId(Fnv1a(name), 0); }
+
+        constexpr bool operator==(const UniformId other) const { return hash == other.hash; }
+        constexpr bool operator<(const UniformId other) const { return hash < other.hash; }
+
+        uint32_t hash = 0;
+    private:
+        constexpr UniformId(uint32_t value, int) : hash(value) {}
+        constexpr static uint32_t Fnv1a(std::string_view name)
+        {
+            uint32_t value = 2166136261u; // FNV offset basis.
+            for (const char c : name)
+            {
+                value ^= (uint32_t)(unsigned char)c;
+                value *= 16777619u; // FNV prime.
+            }
+            return value;
+        }
+    };
+
     class Shader
     {
     public:
@@ -27,42 +58,98 @@ namespace gl
 
             std::string vertexPath = "";
             std::string fragmentPath = "";
+            // Variant of the sources to compile. Each keyword must be declared by one of the sources with a "#pragma keywords A B ..." line, and is #defined to 1 when enabled.
+            std::vector<std::string> keywords = {};
 
-            XXH32_hash_t GetHash() const;
+            uint64_t GetHash() const;
         };
 
         void Create(Definition def);
+        /*
+        @brief: Creates every shader of the batch at once. All compiles and links are issued before any status is queried, so drivers exposing GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile build them concurrently. Static uniforms are set as each program becomes ready.
+        */
+        static void CreateBatch(std::vector<std::pair<Shader*, Definition>> batch);
+        /*
+        @brief: Two halves of Create(). Submit() issues the compile and link without waiting on the driver, Finish() waits for them, reports errors and sets the static uniforms. IsReady() tells whether Finish() would block.
+        */
+        void Submit(Definition def);
+        bool IsReady() const;
+        void Finish();
+        /*
+        @brief: Starts compiling variants that will be needed later so that creating them doesn't hitch. A Create() with an identical definition shares the prewarmed program right away. PollPrewarmed() finishes the prewarmed programs as they become ready, the Engine calls it once per frame.
+        */
+        static void Prewarm(std::vector<Definition> defs);
+        static void PollPrewarmed();
         unsigned int GetPROGRAM() const;
 
         void Bind();
         void Unbind();
 
-        void SetInt(const std::pair<std::string_view, int> pair);
-        void SetVec3(const std::pair<std::string_view, glm::vec3> pair);
-        void SetMat4(const std::pair<std::string_view, glm::mat4> pair);
-        void SetFloat(const std::pair<std::string_view, float> pair);
-    private:
-        unsigned int PROGRAM_ = 0;
-        bool isBound_ = false;
+        void SetInt(const UniformId id, const int value);
+        void SetVec3(const UniformId id, const glm::vec3& value);
+        void SetMat4(const UniformId id, const glm::mat4& value);
+        void SetFloat(const UniformId id, const float value);
 
-        int GetUniformLocation(std::string_view uniformName);
+        struct UniformUploadStats
+        {
+            size_t uploaded = 0;
+            size_t skipped = 0; // Dynamic uniforms left untouched by Bind() because the program already held their value.
+        };
+        static const UniformUploadStats& GetUniformUploadStats();
+        static void ResetUniformUploadStats();
+    private:
+        enum class UniformType
+        {
+            INT,
+            FLOAT,
+            VEC3,
+            MAT4
+        };
+        struct DynamicUniform
+        {
+            alignas(16) std::array<float, 16> shadow = {}; // Copy of the last uploaded value, only the first floats are used by the smaller types.
+            int location = -1;
+            UniformType type = UniformType::INT;
+            const void* ptr = nullptr;
+            bool uploaded = false; // False until the first upload, or when the program's value may differ from the shadow copy.
+        };
 
+        // Between Submit() and Finish().
+        struct Pending
+        {
+            Definition def = {};
+            unsigned int VERTEX = 0, FRAGMENT = 0; // 0 when the program was loaded from the program cache.
+            uint64_t sourceHash = 0;
+            bool shared = false; // Program created by another shader from an identical definition.
+        };
 
-        void SetInt(const std::pair<std::string_view, const int*> pair);
-        void SetVec3(const std::pair<std::string_view, const glm::vec3*> pair);
-        void SetMat4(const std::pair<std::string_view, const glm::mat4*> pair);
-        void SetFloat(const std::pair<std::string_view, const float*> pair);
+        unsigned int PROGRAM_ = 0;
+        Handle<Shader> handle_ = {}; // Keeps PROGRAM_ from being evicted, shared with every shader using the same program.
+        bool isBound_ = false;
+        uint32_t generation_ = 0; // Reload generation the uniform locations were resolved at.
+        const Shader** lastUploader_ = nullptr; // In the record of PROGRAM_, resolved once by Finish() so that Bind() only compares pointers.
+        std::shared_ptr<Pending> pending_ = nullptr;
 
-        std::map<std::string, int> staticInts_ = {}; // ex: texture units
-        std::map<std::string, glm::vec3> staticVec3s_ = {}; // ex: material's ambient color
-        std::map<std::string, glm::mat4> staticMat4s_ = {}; // ex: perspective matrix
-        std::map<std::string, float> staticFloats_ = {}; // ex: material's shininess
+        /*
+        @brief: Queries every active uniform of the program once and stores their locations sorted by UniformId.
+        */
+        void ResolveUniformLocations();
+        void ResolveDynamicUniforms(const Definition& def);
+        void SetStaticUniforms(const Definition& def);
+        int GetUniformLocation(const UniformId id) const;
+        bool HasUniform(const UniformId id) const;
+        /*
+        @brief: Hot reload of a source file, called by the FileWatcher. Every program built from it is recompiled and relinked under its current gpu name, programs whose edit doesn't compile are kept as they were. Shaders using a reloaded program resolve its uniforms again on their next Bind().
+        */
+        static void ReloadSource(const std::string& path);
+        /*
+        @brief: Forces the next Bind() to upload every dynamic uniform, or only the one at location when it isn't -1.
+        */
+        void InvalidateDynamicUniforms(const int location = -1);
 
-        std::map<std::string, const int*> dynamicInts_ = {}; // ex: boolean for using normalmapping
-        std::map<std::string, const glm::vec3*> dynamicVec3s_ = {}; // ex: camera position
-        std::map<std::string, const glm::mat4*> dynamicMat4s_ = {}; // ex: transform model matrix
-        std::map<std::string, const float*> dynamicFloats_ = {};
+        std::vector<std::pair<UniformId, int>> uniformLocations_ = {}; // Sorted, binary searched.
+        std::vector<DynamicUniform> dynamicUniforms_ = {}; // ex: camera position, boolean for using normalmapping. Uploaded on Bind() when they changed.
 
-        std::map<std::string, int> uniformNames_ = {};
+        static UniformUploadStats uploadStats_;
     };
-}//!gl
\ No newline at end of file
+}//!gl
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <array>
+
+#include <glm/glm.hpp>
+
+#include "ibl_baker.h"
 #include "vertex_buffer.h"
-#include "texture.h"
+#include "material.h"
 #include "shader.h"
 #include "defines.h"
 
@@ -14,15 +19,28 @@ public:
     {
         std::string path = "";
         Shader::Definition shader = {};
+        bool bakeLighting = false; // Bakes, or reads from the cache, the image based lighting of the cubemap at path. See IblBaker.
+        IblBaker::Definition lighting = {};
     };
 
     void Create(Definition def);
 
     void Draw();
+
+    /*
+    @brief: Enables the IMAGE_BASED_LIGHTING keyword of a lit shader, ex: hello_pbr.frag, and adds the baked irradiance and the units of the prefiltered cubemap and BRDF LUT to its static uniforms. Leaves the definition as is when the lighting wasn't baked, lit shaders fall back to a constant ambient without the keyword.
+    */
+    void AddLightingUniforms(Shader::Definition& def) const;
+    void BindLighting() const;
+    void UnbindLighting() const;
 private:
+    void CreateLightingTextures(const IblBaker::Result& result);
 
     VertexBuffer vb_ = {};
     Shader shader_ = {};
-    Texture cubemap_ = {};
+    Material cubemap_ = {};
+    std::array<glm::vec3, 9> irradianceSH_ = {};
+    float nrOfSpecularLevels_ = 0.0f;
+    std::array<unsigned int, 2> lightingTEXs_ = {}; // Prefiltered cubemap and BRDF LUT, in the order of their units.
 };
 }//!gl
\ No newline at end of file
@@ -1,8 +1,14 @@
 #pragma once
 #include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <string_view>
+#include <unordered_map>
 
+#include "async_loader.h"
 #include "defines.h"
+#include "handle.h"
 
 namespace gl
 {
@@ -11,25 +17,46 @@ namespace gl
     public:
         enum Type
         {
-            // ALPHA = ALPHA_TEXTURE_UNIT, // 0
-            // NORMALMAP = NORMALMAP_TEXTURE_UNIT, // 1
-            // DIFFUSE = DIFFUSE_TEXTURE_UNIT, // 2
-            // SPECULAR = SPECULAR_TEXTURE_UNIT, // 3
-            // CUBEMAP = CUBEMAP_TEXTURE_UNIT, // 4
-            // INVALID = CUBEMAP_TEXTURE_UNIT + 1
+            ALPHA = ALPHA_TEXTURE_UNIT, // 0
+            NORMALMAP = NORMALMAP_TEXTURE_UNIT, // 1
+            DIFFUSE = DIFFUSE_TEXTURE_UNIT, // 2
+            SPECULAR = SPECULAR_TEXTURE_UNIT, // 3
+            CUBEMAP = CUBEMAP_TEXTURE_UNIT, // 4
+            INVALID = CUBEMAP_TEXTURE_UNIT + 1
         };
 
         // Those are hashed.
         void Create(Type textureType, std::string_view path);
+        /*
+        @brief: Same as Create() but the file is read and decoded on a worker thread, see AsyncLoader, and its images are streamed through the UploadStream. Until the texture lands, GetTEX() returns a 1x1 placeholder holding the neutral value of the type, ex: a flat normal for normal maps.
+        With streamMips, 2D textures land with their levels up to STREAMING_RESIDENT_EXTENT only, the TextureStreamer then brings the finer ones in and out as they're drawn bigger or smaller. Textures loaded from the same file share their levels, the first one decides.
+        */
+        void CreateAsync(Type textureType, std::string_view path, bool streamMips = false);
+        bool IsLoaded() const;
 
         unsigned int GetTEX() const;
+        Type GetType() const; // The texture unit it's bound to.
 
+        /*
+        @brief: Binds the texture alone to its unit. Sampling state comes from the sampler bound to that same unit, see Material for binding whole sets of textures and samplers at once.
+        */
         void Bind() const;
         void Unbind() const;
     private:
+        // Result of an asynchronous load, shared by every texture waiting on the same file.
+        struct Loading
+        {
+            unsigned int TEX = 0; // 0 until the texture landed.
+            Handle<Texture> handle = {};
+        };
+        static AsyncLoader::Task Load(std::shared_ptr<Loading> loading, std::string path, uint64_t hash, bool streamMips);
+        // Textures asking for a file that is already loading wait on the same load. Keyed by the texture's hash, erased when the load lands.
+        static std::unordered_map<uint64_t, std::weak_ptr<Loading>> loadsInFlight_;
 
-        unsigned int TEX_ = 0;
-        // Texture::Type type_ = Type::INVALID;
+        unsigned int TEX_ = 0; // Placeholder while loading_ hasn't landed.
+        Handle<Texture> handle_ = {}; // Keeps TEX_ from being evicted, shared with every texture loaded from the same file.
+        Texture::Type type_ = Type::INVALID;
+        std::shared_ptr<Loading> loading_ = nullptr;
     };
 
 }//!gl
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace gl
+{
+    /*
+    @brief: CPU encoder of the block compressed formats gpus sample natively, so textures take 4 or 8 bits per texel in memory and bandwidth instead of 32. Each 4x4 block is fitted independently: colors from the diagonal of their bounding box refined by least squares, single channels from their range, with SSE2 for the texel searches. Images are compressed on every core, a block row at a time.
+    Used by main/assetcooker.cpp, the blocks it writes are laid out as gli expects them for the matching formats.
+    */
+    class TextureCompressor
+    {
+    public:
+        enum class Format
+        {
+            BC1, // RGB, 8 bytes per block. Alpha is dropped. gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8.
+            BC3, // RGBA, 16 bytes per block: a BC4 alpha block then a BC1 color block. gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16.
+            BC4, // R, 8 bytes per block. gli::FORMAT_R_ATI1N_UNORM_BLOCK8.
+            BC5  // RG, 16 bytes per block: a BC4 block per channel. For normal maps whose shader rebuilds z. gli::FORMAT_RG_ATI2N_UNORM_BLOCK16.
+        };
+
+        constexpr static const size_t BLOCK_EXTENT = 4;
+
+        static size_t GetBlockSize(Format format);
+        static size_t GetCompressedSize(Format format, size_t width, size_t height);
+        /*
+        @brief: BC1 when every texel is opaque, else BC3.
+        */
+        static Format ChooseFormat(const uint8_t* rgba, size_t nrOfTexels);
+
+        /*
+        @brief: Encodes 16 RGBA8 texels, row major, into one block of format.
+        */
+        static void EncodeBlock(const uint8_t* texels, Format format, uint8_t* block);
+        /*
+        @brief: Encodes a width x height RGBA8 image into GetCompressedSize() bytes of blocks, row major. Partial blocks at the right and bottom edges repeat the last column and row. Blocks rows are shared between the hardware threads when the image is big enough.
+        */
+        static void Compress(const uint8_t* rgba, size_t width, size_t height, Format format, uint8_t* blocks);
+    };
+}//!gl
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace gl
+{
+    /*
+    @brief: Keeps the mips of streamed textures resident according to how big they are drawn, see Texture::CreateAsync(). Meshes report the screen size of their visible instances every frame, each streamed texture is then wanted down to the level whose texels match the pixels it covers. Within a global budget, levels are granted coarsest first across textures, so every texture gets sharper before any gets its finest levels.
+    Missing levels are read on an AsyncLoader worker and uploaded through the UploadStream, GL_TEXTURE_BASE_LEVEL stays on the finest complete level until they all landed. Levels that weren't wanted for STREAMING_RELEASE_FRAMES are released. Gl thread only.
+    */
+    class TextureStreamer
+    {
+    public:
+        struct Stats
+        {
+            size_t textures = 0;
+            size_t residentBytes = 0;
+            size_t wantedBytes = 0; // With every wanted level resident.
+            size_t grantedBytes = 0; // What the budget allows of it.
+            size_t loadsInFlight = 0;
+            size_t levelsStreamedIn = 0;
+            size_t levelsReleased = 0;
+        };
+
+        TextureStreamer() = default;
+        TextureStreamer(const TextureStreamer&) = delete;
+        static TextureStreamer& Get()
+        {
+            static gl::TextureStreamer instance;
+            return instance;
+        }
+
+        /*
+        @brief: Called by Texture once the levels from residentLevel to the last one of TEX landed, those are never released. width and height are the ones of level 0, levelBytes the size of every level. streamIn reads and uploads the levels [first, end) and calls OnStreamedIn() with load once they landed. release frees the levels finer than the given one, GL_TEXTURE_BASE_LEVEL is already past them.
+        */
+        void Register(unsigned int TEX, size_t width, size_t height, std::vector<size_t> levelBytes, size_t residentLevel,
+            std::function<void(size_t first, size_t end, uint64_t load)> streamIn, std::function<void(size_t level)> release);
+        void Unregister(unsigned int TEX);
+        size_t GetResidentLevel(unsigned int TEX) const; // 0 for textures that aren't streamed.
+        /*
+        @brief: Whether load still is the one TEX waits for. Uploads of a load check it, the texture may have been evicted meanwhile.
+        */
+        bool IsLoading(unsigned int TEX, uint64_t load) const;
+        void OnStreamedIn(unsigned int TEX, uint64_t load, size_t level);
+
+        /*
+        @brief: TEX is drawn this frame, its whole uv range covering about screenSize pixels across. Ignored for textures that aren't streamed, ex: placeholders.
+        */
+        void Request(unsigned int TEX, float screenSize);
+        /*
+        @brief: Grants levels within budgetBytes, starts the loads of the missing ones and releases those no longer wanted. The Engine calls it once per frame after Program::Update().
+        */
+        void Update(size_t budgetBytes);
+        void Shutdown();
+
+        Stats GetStats() const;
+    private:
+        struct Streamed
+        {
+            size_t width = 0, height = 0;
+            std::vector<size_t> levelBytes = {};
+            size_t tailLevel = 0; // It and coarser levels are always resident.
+            size_t residentLevel = 0;
+            size_t wantedLevel = 0;
+            size_t grantedLevel = 0;
+            size_t requestedLevel = 0; // Finest asked for during requestFrame.
+            uint64_t requestFrame = 0;
+            uint64_t wantedFrame = 0; // Last frame wantedLevel was asked for.
+            uint64_t load = 0; // Of the levels in flight, 0 when none.
+            std::function<void(size_t, size_t, uint64_t)> streamIn = nullptr;
+            std::function<void(size_t)> release = nullptr;
+        };
+
+        size_t GetBytesFrom(const Streamed& streamed, size_t level) const;
+        void SetResidentLevel(unsigned int TEX, Streamed& streamed, size_t level);
+
+        std::unordered_map<unsigned int, Streamed> streamed_ = {};
+        uint64_t frame_ = 1;
+        uint64_t nextLoad_ = 1;
+        Stats stats_ = {};
+    };
+}//!gl
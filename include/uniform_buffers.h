@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "defines.h"
+
+namespace gl
+{
+    /*
+    @brief: Uniform buffer objects shared by every program. Per frame values (camera, light, time) and per pass values are uploaded once into std140 blocks bound at FRAME_DATA_BINDING and PASS_DATA_BINDING, instead of being set on each program that reads them. Per program uniforms are left with material and object data only.
+    */
+    class UniformBuffers
+    {
+    public:
+        // Matches the std140 layout of the FrameData block of GetShaderDeclarations().
+        struct FrameData
+        {
+            glm::mat4 cameraMatrix = IDENTITY_MAT4; // projection * view.
+            glm::mat4 viewMatrix = IDENTITY_MAT4;
+            glm::mat4 projectionMatrix = IDENTITY_MAT4;
+            glm::mat4 lightMatrix = IDENTITY_MAT4; // Light space projection * view, used for shadow mapping.
+            glm::vec4 viewPos = glm::vec4(0.0f); // w unused.
+            glm::vec4 lightDir = glm::vec4(0.0f, -1.0f, 0.0f, 0.0f); // Normalized, w unused.
+            float time = 0.0f; // Seconds since the program started.
+            float deltaTime = 0.0f;
+            float padding[2] = { 0.0f, 0.0f };
+        };
+        // Matches the std140 layout of the PassData block of GetShaderDeclarations().
+        struct PassData
+        {
+            glm::mat4 passMatrix = IDENTITY_MAT4; // projection * view the pass rasterizes with, ex: the camera for the gbuffer pass, the light for the shadow pass.
+            glm::vec4 resolution = glm::vec4(SCREEN_RESOLUTION[0], SCREEN_RESOLUTION[1], 1.0f / SCREEN_RESOLUTION[0], 1.0f / SCREEN_RESOLUTION[1]); // xy: render target size, zw: texel size.
+        };
+
+        UniformBuffers() = default;
+        UniformBuffers(const UniformBuffers&) = delete;
+        static UniformBuffers& Get()
+        {
+            static gl::UniformBuffers instance;
+            return instance;
+        }
+
+        /*
+        @brief: Creates both buffers and binds them to their binding points for the lifetime of the context. Needs a loaded gl context.
+        */
+        void Create();
+        void Destroy();
+
+        /*
+        @brief: Call once at the start of a frame, before any draw.
+        */
+        void UploadFrameData(const FrameData& data);
+        /*
+        @brief: Call before the draws of each pass that reads the PassData block.
+        */
+        void UploadPassData(const PassData& data);
+
+        /*
+        @brief: Glsl declarations of both blocks. Shader injects them after the #version directive of every source, shaders read the members without declaring the blocks.
+        */
+        static const std::string& GetShaderDeclarations();
+    private:
+        void Upload(const unsigned int UBO, const void* data, const size_t size);
+
+        unsigned int frameUBO_ = 0;
+        unsigned int passUBO_ = 0;
+    };
+}//!gl
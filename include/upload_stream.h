@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace gl
+{
+    /*
+    @brief: Streams texture data to the gpu through a ring of persistently mapped pixel buffer memory. Staged data is copied into the ring by the thread staging it, usually an AsyncLoader worker, and the gl thread only issues the uploads reading from it. Those are spread over frames within a byte budget, and a fence per frame tells when the ring memory they read can be reused.
+    Without GL 4.4 or ARB_buffer_storage, or for data bigger than the ring, the data is written to client memory and uploaded from there on the gl thread, within the same budget.
+    */
+    class UploadStream
+    {
+    public:
+        struct Stats
+        {
+            size_t ringBytes = 0; // 0 until the ring is created, or when persistent mapping isn't supported.
+            size_t ringBytesInUse = 0; // Staged or read by uploads the gpu may not have finished.
+            size_t pending = 0; // Waiting for room in the ring.
+            size_t staged = 0; // Written to the ring, waiting for their upload.
+            size_t uploads = 0;
+            size_t directUploads = 0; // Uploaded from client memory instead.
+            size_t lastFrameBytes = 0;
+            size_t ringFullFrames = 0; // Frames some data waited for the gpu to release ring memory.
+        };
+
+        UploadStream() = default;
+        UploadStream(const UploadStream&) = delete;
+        static UploadStream& Get()
+        {
+            static gl::UploadStream instance;
+            return instance;
+        }
+
+        /*
+        @brief: Queues size bytes for the gpu. write fills the staging memory it's given, right away on the calling thread if the ring has room, else on the gl thread once it has. upload then issues the gl calls reading the data on the gl thread, ex: glTextureSubImage2D(), passing pixels as their data pointer. The ring is bound as GL_PIXEL_UNPACK_BUFFER then, pixels is an offset into it. Uploads are issued in the order they were staged. Can be called from any thread.
+        */
+        void Stage(size_t size, std::function<void(char* destination)> write, std::function<void(const void* pixels)> upload);
+        /*
+        @brief: Issues the uploads of staged data until budgetBytes have been uploaded this frame, at least one so that uploads always progress, and fences them. The Engine calls it once per frame after Program::Update().
+        */
+        void Update(size_t budgetBytes);
+        /*
+        @brief: Drops what wasn't uploaded and deletes the ring. Called by the Engine before the gl context is destroyed, after the AsyncLoader's workers were joined.
+        */
+        void Shutdown();
+
+        Stats GetStats();
+    private:
+        struct Staging
+        {
+            size_t size = 0;
+            std::function<void(char*)> write = nullptr; // Reset once written.
+            std::function<void(const void*)> upload = nullptr;
+            size_t offset = 0; // In the ring.
+            uint64_t end = 0; // Value of allocated_ once allocated, the ring memory is released when the gpu is done with everything up to it.
+            bool written = false;
+            bool direct = false; // Uploaded from client memory, never took ring memory.
+        };
+        struct Fence
+        {
+            void* sync = nullptr; // GLsync.
+            uint64_t end = 0;
+        };
+
+        bool Allocate(Staging& staging); // Under mutex_.
+        void CreateRing();
+
+        std::mutex mutex_;
+        std::deque<std::unique_ptr<Staging>> staged_ = {}; // In ring order, written or being written.
+        std::deque<std::unique_ptr<Staging>> pending_ = {}; // Waiting for room, staged after every staged_ one.
+        size_t head_ = 0; // Next offset allocated in the ring.
+        uint64_t allocated_ = 0, released_ = 0; // Bytes ever taken from and given back to the ring, padding at its end included.
+
+        // Set by the gl thread before ringCreated_, under mutex_. mapping_ stays nullptr when persistent mapping isn't supported.
+        bool ringCreated_ = false;
+        unsigned int PBO_ = 0;
+        char* mapping_ = nullptr;
+        size_t ringBytes_ = 0;
+        std::deque<Fence> fences_ = {}; // Gl thread only.
+
+        Stats stats_ = {};
+    };
+}//!gl
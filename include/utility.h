@@ -1,16 +1,47 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <string>
 
 #include <glm/glm.hpp>
 
+// Define GL_FORCE_BIND_TO_EDIT to 1 to create resources the pre 4.5 way even when direct state access is available. Useful to compare both paths' throughput.
+#ifndef GL_FORCE_BIND_TO_EDIT
+#define GL_FORCE_BIND_TO_EDIT 0
+#endif // !GL_FORCE_BIND_TO_EDIT
+
+// Gl error checking is only compiled in debug builds. Define GL_ERROR_CHECKS_ENABLED to 0 or 1 to override. When disabled, CheckGlError(), the framebuffer status checks and the gl scopes compile to nothing.
+#ifndef GL_ERROR_CHECKS_ENABLED
+#ifdef NDEBUG
+#define GL_ERROR_CHECKS_ENABLED 0
+#else
+#define GL_ERROR_CHECKS_ENABLED 1
+#endif // NDEBUG
+#endif // !GL_ERROR_CHECKS_ENABLED
+
 namespace gl
 {
     /*
-    @brief: If there was any glError, throws an exception and prints out the gl error code and the file and line that triggered it.
+    @brief: If there was any glError, throws an exception and prints out the gl error code and the file and line that triggered it. Once EnableDebugOutput() succeeded, errors are reported by the driver as they happen and this only records the file and line as the last checkpoint, without a glGetError round trip.
     */
     void CheckGlError(const char* file, int line);
     /*
+    @brief: Installs a debug message callback reporting every gl error with the current DebugScope stack. Needs a context created with the debug flag, returns false otherwise and CheckGlError() keeps polling glGetError.
+    */
+    bool EnableDebugOutput();
+    /*
+    @brief: Names the gl calls issued during its lifetime, for the debug message callback and for frame debuggers (as a debug group). Scopes are tracked per thread.
+    */
+    class DebugScope
+    {
+    public:
+        DebugScope(const char* name, const char* file, int line, bool allowErrors = false); // allowErrors: errors are reported as warnings instead of aborting, for calls expected to fail.
+        ~DebugScope();
+        DebugScope(const DebugScope&) = delete;
+        DebugScope& operator=(const DebugScope&) = delete;
+    };
+    /*
     @brief: Raises an exception and prints out a message passed in arguments as well as the file and line that triggered it.
     */
     void Error(const char* file, int line, const char* msg);
@@ -22,6 +53,29 @@ namespace gl
     @brief: Ensures the currently bound framebuffer is complete, else throws an error with a brief reason for framebuffer incompleteness.
     */
     void CheckFramebufferStatus(const char* file, int line);
+    /*
+    @brief: Same as CheckFramebufferStatus but for the framebuffer object passed in arguments, without having to bind it.
+    */
+    void CheckNamedFramebufferStatus(const char* file, int line, unsigned int FBO);
+    /*
+    @brief: Calls function(i) for every i in [0, count), spread across the hardware threads with the calling thread working too. workPerItem and minWorkPerThread are in the same unit, ex: texels: no more threads are started than there's minWorkPerThread of work for. Called from a thread that already shares the hardware with others, see ParallelScope, everything runs on the calling thread.
+    */
+    void ParallelFor(size_t count, size_t workPerItem, size_t minWorkPerThread, const std::function<void(size_t)>& function);
+    /*
+    @brief: Marks the calling thread as one of a pool keeping every hardware thread busy already, ex: the AsyncLoader's workers or the assetcooker's jobs, for its lifetime. ParallelFor() then doesn't start more threads from it.
+    */
+    class ParallelScope
+    {
+    public:
+        ParallelScope();
+        ~ParallelScope();
+        ParallelScope(const ParallelScope&) = delete;
+        ParallelScope& operator=(const ParallelScope&) = delete;
+    };
+    /*
+    @brief: Whether resources can be created and edited without binding them (GL 4.5 or ARB_direct_state_access). Only valid once the gl context has been loaded.
+    */
+    bool HasDirectStateAccess();
     void Message(const char* file, int line, const std::string& msg, bool writeTriggerPoint = false);
 
     float RemapToRange(const float inputRangeLower, const float inputRangeUpper, const float outputRangeLower, const float outputRangeUpper, const float value);
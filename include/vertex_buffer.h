@@ -1,13 +1,45 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
 #include <vector>
 
+#include "handle.h"
+
 namespace gl
 {
     class VertexBuffer
     {
     public:
+        // Gpu formats of packed vertex attributes, valued as their gl enums. glTF's component types are the same values.
+        enum class AttributeType : unsigned int
+        {
+            BYTE = 0x1400,
+            UNSIGNED_BYTE = 0x1401,
+            SHORT = 0x1402,
+            UNSIGNED_SHORT = 0x1403,
+            FLOAT = 0x1406,
+            HALF_FLOAT = 0x140B,
+            INT_2_10_10_10_REV = 0x8D9F
+        };
+        enum class IndexType : unsigned int
+        {
+            UNSIGNED_BYTE = 0x1401,
+            UNSIGNED_SHORT = 0x1403,
+            UNSIGNED_INT = 0x1405
+        };
+        struct PackedAttribute
+        {
+            unsigned int size = 3; // Number of components, 0 leaves the attribute disabled.
+            AttributeType type = AttributeType::FLOAT;
+            bool normalized = false; // Integers read as [-1, 1] or [0, 1] floats by the shader.
+            unsigned int offset = 0; // In bytes from the start of packedData, the first vertex's attribute.
+            unsigned int stride = 0; // In bytes, 0 for packedStride. Attributes can come from separate arrays of the same data, ex: glTF buffer views.
+        };
         struct Definition
         {
             std::vector<unsigned int> dataLayout = // How data is laid out in the buffer. The unsigned ints indicate how many floats compose a single attribute.
@@ -16,6 +48,17 @@ namespace gl
             };
             std::vector<float> data = {};
             bool generateBoundingSphereRadius = true;
+            // Optional, file the data was built from. When it changes on disk, reload() rebuilds the data with the same dataLayout and the buffer is refilled under the same gpu names. Bounds computed from the data by the caller aren't updated.
+            std::string path = "";
+            std::function<std::vector<float>()> reload = nullptr;
+            // Optional, vertices already in their gpu format, ex: the spans of a MeshFile or of a glb. Uploaded as they are instead of data, attribute i is read as packedLayout[i]. Can't be reloaded.
+            std::span<const char> packedData = {};
+            std::vector<PackedAttribute> packedLayout = {};
+            unsigned int packedStride = 0; // In bytes.
+            size_t packedVerticesCount = 0; // 0 when packedData holds whole vertices of packedStride only.
+            // Optional, the vertices are drawn as indexed triangles.
+            std::span<const char> indices = {};
+            IndexType indexType = IndexType::UNSIGNED_INT;
         };
 
         void Create(Definition def);
@@ -33,8 +76,12 @@ namespace gl
         */
         void DrawSingle() const;
     private:
+        // Vertex data binding point when using direct state access. Instanced attributes set up with glVertexAttribPointer use their attribute index as binding point, keep this one out of their way.
+        constexpr static const unsigned int VERTEX_BUFFER_BINDING = 15;
 
         unsigned int VAO_ = 0, VBO_ = 0;
-        int verticesCount_ = 0;
+        Handle<VertexBuffer> handle_ = {}; // Keeps VAO_ and VBO_ from being evicted.
+        std::shared_ptr<int> verticesCount_ = nullptr; // Shared by every VertexBuffer drawing the same VAO, a reload can change it. Number of indices when indexed.
+        unsigned int indexType_ = 0; // Gl type of the indices, 0 when not indexed.
     };
 }//!gl
\ No newline at end of file
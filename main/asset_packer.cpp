@@ -0,0 +1,38 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+
+// Packs every file under a directory into a gl::AssetPack. Assets are found by their path relative to that directory.
+// Usage: asset_packer <directory> <output.pack> [--lz4]
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::printf("Usage: %s <directory> <output.pack> [--lz4]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const std::filesystem::path directory = argv[1];
+    const std::string packPath = argv[2];
+    const bool lz4 = argc > 3 && std::strcmp(argv[3], "--lz4") == 0;
+
+    std::vector<gl::AssetPack::Source> sources;
+    size_t totalSize = 0;
+    for (const auto& file : std::filesystem::recursive_directory_iterator(directory))
+    {
+        if (!file.is_regular_file()) continue;
+        sources.push_back({ std::filesystem::relative(file.path(), directory).generic_string(), file.path().string() });
+        totalSize += (size_t)file.file_size();
+    }
+
+    if (!gl::AssetPack::Write(packPath, sources, lz4 ? gl::AssetPack::Compression::LZ4 : gl::AssetPack::Compression::NONE))
+    {
+        return EXIT_FAILURE;
+    }
+    std::printf("Packed %zu files (%zu bytes) into %s (%zu bytes)%s.\n", sources.size(), totalSize, packPath.c_str(), (size_t)std::filesystem::file_size(packPath), lz4 ? ", LZ4 compressed" : "");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,541 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <gli/gli.hpp>
+#include <SDL2/SDL.h>
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "defines.h"
+#include "file_system.h"
+#include "hasher.h"
+#include "mesh_file.h"
+#include "mip_generator.h"
+#include "resource_manager.h"
+#include "texture_compressor.h"
+
+// Cooks every source asset under a directory into its engine ready format, mirrored under the output directory:
+//  .obj                          -> .mesh, indexed and packed, see gl::MeshFile.
+//  .png .jpg .jpeg .tga .bmp     -> .ktx, mipmapped and block compressed: BC1 when opaque, else BC3, see gl::TextureCompressor.
+//  .dds .ktx                     -> .ktx, RGBA8 ones mipmapped when without mips and block compressed the same way.
+//  .wav                          -> .wav, 16 bit PCM resampled to the audio device's format.
+//  .vert .frag .geom .comp ...   -> copied once they compile on a hidden gl context.
+//  anything else                 -> copied.
+// Assets are cooked in parallel. cook.db in the output directory keys every output with the content hashes of its inputs, so only what changed is cooked again.
+// Usage: assetcooker <source directory> <output directory> [--force]
+namespace
+{
+    namespace fs = std::filesystem;
+
+    constexpr const char* DATABASE_NAME = "cook.db";
+    constexpr const char* DATABASE_HEADER = "assetcooker 1";
+
+    struct Job;
+    struct Rule
+    {
+        const char* name = "";
+        uint32_t version = 1; // Bumped when the rule's output changes, recooks everything it made.
+        std::vector<std::string> extensions = {};
+        std::string outputExtension = ""; // Empty to keep the source's.
+        bool needsGlContext = false;
+        bool (*cook)(const Job& job) = nullptr;
+        std::vector<std::string> (*findDependencies)(const Job& job) = nullptr; // Paths relative to the source directory.
+    };
+
+    struct Job
+    {
+        const Rule* rule = nullptr;
+        std::string source = ""; // Relative to the source directory, generic.
+        std::string output = ""; // Relative to the output directory, generic.
+        fs::path sourcePath = {};
+        fs::path outputPath = {};
+        std::vector<std::string> dependencies = {}; // Inputs besides the source, relative to the source directory.
+        uint64_t key = 0;
+        enum class Result { UP_TO_DATE, COOKED, FAILED } result = Result::FAILED;
+    };
+
+    // Size and write time of an input when its content was hashed, so unchanged files aren't read again.
+    struct Stamp
+    {
+        uint64_t size = 0;
+        int64_t writeTime = 0;
+        uint64_t hash = 0;
+    };
+
+    struct Cooked
+    {
+        uint64_t key = 0;
+        std::string output = "";
+        std::vector<std::string> dependencies = {};
+    };
+
+    struct Database
+    {
+        std::unordered_map<std::string, Stamp> stamps = {}; // By input path relative to the source directory.
+        std::unordered_map<std::string, Cooked> cooked = {}; // By source.
+    };
+
+    fs::path sourceDirectory, outputDirectory;
+    Database previous, next;
+    std::mutex databaseMutex;
+    bool hasGlContext = false;
+
+    std::string Lowercase(std::string string)
+    {
+        std::transform(string.begin(), string.end(), string.begin(), [](const unsigned char c) { return (char)std::tolower(c); });
+        return string;
+    }
+
+    Database LoadDatabase(const fs::path& path)
+    {
+        Database database;
+        std::ifstream file(path);
+        std::string line;
+        if (!std::getline(file, line) || line != DATABASE_HEADER) return database; // Missing or from another version, everything is cooked.
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            std::string type, path;
+            fields >> type;
+            if (type == "stamp")
+            {
+                Stamp stamp;
+                fields >> stamp.size >> stamp.writeTime >> std::hex >> stamp.hash;
+                fields.ignore(1);
+                std::getline(fields, path);
+                database.stamps[path] = stamp;
+            }
+            else if (type == "cooked")
+            {
+                Cooked cooked;
+                fields >> std::hex >> cooked.key;
+                fields.ignore(1);
+                std::getline(fields, cooked.output, '\t');
+                std::getline(fields, path, '\t');
+                std::string dependency;
+                while (std::getline(fields, dependency, '\t'))
+                {
+                    cooked.dependencies.push_back(dependency);
+                }
+                database.cooked[path] = std::move(cooked);
+            }
+        }
+        return database;
+    }
+
+    bool SaveDatabase(const fs::path& path, const Database& database)
+    {
+        std::ofstream file(path, std::ios::trunc);
+        file << DATABASE_HEADER << '\n';
+        for (const auto& [input, stamp] : database.stamps)
+        {
+            file << "stamp " << stamp.size << ' ' << stamp.writeTime << ' ' << std::hex << stamp.hash << std::dec << ' ' << input << '\n';
+        }
+        for (const auto& [source, cooked] : database.cooked)
+        {
+            file << "cooked " << std::hex << cooked.key << std::dec << ' ' << cooked.output << '\t' << source;
+            for (const auto& dependency : cooked.dependencies)
+            {
+                file << '\t' << dependency;
+            }
+            file << '\n';
+        }
+        return file.good();
+    }
+
+    // Content hash of an input, 0 when it doesn't exist. Reuses the previous hash when the size and write time didn't change.
+    uint64_t HashInput(const std::string& input, bool* unchanged = nullptr)
+    {
+        const fs::path path = sourceDirectory / input;
+        std::error_code error;
+        const uint64_t size = (uint64_t)fs::file_size(path, error);
+        if (error) return 0;
+        const int64_t writeTime = (int64_t)fs::last_write_time(path, error).time_since_epoch().count();
+        {
+            std::lock_guard<std::mutex> lock(databaseMutex);
+            const auto stamp = previous.stamps.find(input);
+            if (stamp != previous.stamps.end() && stamp->second.size == size && stamp->second.writeTime == writeTime)
+            {
+                if (unchanged != nullptr) *unchanged = true;
+                next.stamps[input] = stamp->second;
+                return stamp->second.hash;
+            }
+        }
+
+        const gl::FileSystem::File file = gl::FileSystem::Get().Read(path.string());
+        gl::Hasher hasher(gl::HASHING_SEED);
+        hasher.AddBytes(file.GetData(), file.GetSize());
+        const uint64_t hash = std::max<uint64_t>(1, hasher.Digest64());
+        std::lock_guard<std::mutex> lock(databaseMutex);
+        next.stamps[input] = { size, writeTime, hash };
+        return hash;
+    }
+
+    // Also finds the job's dependencies, an unchanged source keeps the ones it had.
+    uint64_t ComputeKey(Job& job)
+    {
+        gl::Hasher hasher(gl::HASHING_SEED);
+        hasher.Add(std::string_view(job.rule->name)).Add(job.rule->version).Add(std::string_view(job.output));
+        bool unchanged = false;
+        hasher.Add(std::string_view(job.source)).Add(HashInput(job.source, &unchanged));
+        if (job.rule->findDependencies != nullptr)
+        {
+            std::unique_lock<std::mutex> lock(databaseMutex);
+            const auto cooked = previous.cooked.find(job.source);
+            if (unchanged && cooked != previous.cooked.end())
+            {
+                job.dependencies = cooked->second.dependencies;
+            }
+            else
+            {
+                lock.unlock();
+                job.dependencies = job.rule->findDependencies(job);
+            }
+        }
+        for (const auto& dependency : job.dependencies)
+        {
+            hasher.Add(std::string_view(dependency)).Add(HashInput(dependency));
+        }
+        return hasher.Digest64();
+    }
+
+    bool WriteFile(const fs::path& path, const void* data, const size_t size)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(static_cast<const char*>(data), (std::streamsize)size);
+        return file.good();
+    }
+
+    bool Copy(const Job& job)
+    {
+        std::error_code error;
+        fs::copy_file(job.sourcePath, job.outputPath, fs::copy_options::overwrite_existing, error);
+        return !error;
+    }
+
+    std::vector<std::string> FindMaterialLibraries(const Job& job)
+    {
+        std::vector<std::string> libraries;
+        const gl::FileSystem::File file = gl::FileSystem::Get().Read(job.sourcePath.string());
+        std::istringstream lines{ std::string(file.GetString()) };
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            if (line.rfind("mtllib", 0) != 0) continue;
+            std::istringstream names(line.substr(6));
+            std::string name;
+            while (names >> name)
+            {
+                libraries.push_back((fs::path(job.source).parent_path() / name).lexically_normal().generic_string());
+            }
+        }
+        return libraries;
+    }
+
+    bool CookMesh(const Job& job)
+    {
+        // TryReadObj() finds the .mtl next to the obj. A broken obj fails its job, not the whole cook.
+        std::vector<gl::ResourceManager::ObjData> meshes;
+        std::string error;
+        if (!gl::ResourceManager::TryReadObj(job.sourcePath.generic_string(), meshes, error))
+        {
+            std::printf("%s: %s\n", job.source.c_str(), error.c_str());
+            return false;
+        }
+        return gl::MeshFile::Write(job.outputPath.string(), meshes);
+    }
+
+    // Uncompressed 2D images get their whole mip chain. RGBA8 ones through gl::MipGenerator's Kaiser filter, sRGB ones filtered in linear space, others linearly by gli.
+    gli::texture GenerateMips(const gli::texture& image)
+    {
+        if (gli::is_compressed(image.format()) || image.target() != gli::TARGET_2D || image.levels() > 1) return image;
+        if (image.format() == gli::FORMAT_RGBA8_UNORM_PACK8 || image.format() == gli::FORMAT_RGBA8_SRGB_PACK8) return gl::MipGenerator::Generate(image);
+
+        const gli::extent2d extent(image.extent().x, image.extent().y);
+        gli::texture2d mipmapped(image.format(), extent, gli::levels(extent));
+        std::memcpy(mipmapped.data(0, 0, 0), image.data(0, 0, 0), image.size(0));
+        return gli::generate_mipmaps(mipmapped, gli::FILTER_LINEAR);
+    }
+
+    // RGBA8 images are block compressed, every face, layer and level. Other formats are kept.
+    gli::texture Compress(const gli::texture& image)
+    {
+        const bool srgb = image.format() == gli::FORMAT_RGBA8_SRGB_PACK8;
+        if (image.format() != gli::FORMAT_RGBA8_UNORM_PACK8 && !srgb) return image;
+        using Format = gl::TextureCompressor::Format;
+        const Format format = gl::TextureCompressor::ChooseFormat(static_cast<const uint8_t*>(image.data()), image.size() / 4);
+        const gli::format compressedFormat = format == Format::BC1
+            ? (srgb ? gli::FORMAT_RGBA_DXT1_SRGB_BLOCK8 : gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8)
+            : (srgb ? gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16 : gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16);
+        gli::texture compressed(image.target(), compressedFormat, image.extent(), image.layers(), image.faces(), image.levels());
+        for (size_t layer = 0; layer < image.layers(); layer++)
+        {
+            for (size_t face = 0; face < image.faces(); face++)
+            {
+                for (size_t level = 0; level < image.levels(); level++)
+                {
+                    const gli::extent3d extent = image.extent(level);
+                    const size_t sliceSize = gl::TextureCompressor::GetCompressedSize(format, (size_t)extent.x, (size_t)extent.y);
+                    for (int z = 0; z < extent.z; z++)
+                    {
+                        gl::TextureCompressor::Compress(
+                            static_cast<const uint8_t*>(image.data(layer, face, level)) + (size_t)z * extent.x * extent.y * 4, (size_t)extent.x, (size_t)extent.y, format,
+                            static_cast<uint8_t*>(compressed.data(layer, face, level)) + (size_t)z * sliceSize);
+                    }
+                }
+            }
+        }
+        return compressed;
+    }
+
+    bool CookTexture(const Job& job)
+    {
+        const gl::FileSystem::File file = gl::FileSystem::Get().Read(job.sourcePath.string());
+        const std::string extension = Lowercase(job.sourcePath.extension().string());
+        gli::texture image;
+        if (extension == ".dds" || extension == ".ktx")
+        {
+            image = gli::load(file.GetData(), file.GetSize());
+        }
+        else
+        {
+            int width = 0, height = 0, nrOfChannels = 0;
+            const std::unique_ptr<stbi_uc, void(*)(void*)> pixels(stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.GetData()), (int)file.GetSize(), &width, &height, &nrOfChannels, 4), stbi_image_free);
+            if (pixels == nullptr) return false;
+            image = gli::texture2d(gli::FORMAT_RGBA8_UNORM_PACK8, gli::extent2d(width, height), 1);
+            std::memcpy(image.data(0, 0, 0), pixels.get(), image.size(0));
+        }
+        if (image.empty()) return false;
+        return gli::save_ktx(Compress(GenerateMips(image)), job.outputPath.string().c_str());
+    }
+
+    bool CookAudio(const Job& job)
+    {
+        const gl::FileSystem::File file = gl::FileSystem::Get().Read(job.sourcePath.string());
+        SDL_AudioSpec spec;
+        Uint8* samples = nullptr;
+        Uint32 length = 0;
+        if (SDL_LoadWAV_RW(SDL_RWFromConstMem(file.GetData(), (int)file.GetSize()), 1, &spec, &samples, &length) == nullptr) return false;
+        const std::unique_ptr<Uint8, void(*)(Uint8*)> decoded(samples, SDL_FreeWAV);
+
+        // Clips are mixed into the device's buffer as they are, convert them once here.
+        SDL_AudioCVT conversion;
+        if (SDL_BuildAudioCVT(&conversion, spec.format, spec.channels, spec.freq, (SDL_AudioFormat)gl::AUDIO_FORMAT, (Uint8)gl::NR_OF_CHANNELS, (int)gl::DSP_FREQUENCY) < 0) return false;
+        std::vector<Uint8> converted((size_t)length * (size_t)std::max(1, conversion.len_mult));
+        std::memcpy(converted.data(), decoded.get(), length);
+        conversion.buf = converted.data();
+        conversion.len = (int)length;
+        if (conversion.needed && SDL_ConvertAudio(&conversion) < 0) return false;
+        converted.resize(conversion.needed ? (size_t)conversion.len_cvt : (size_t)length);
+
+        // Canonical 44 byte header, SDL_LoadWAV_RW() then only copies the samples.
+        const uint32_t dataSize = (uint32_t)converted.size();
+        const uint16_t channels = (uint16_t)gl::NR_OF_CHANNELS, bitsPerSample = (uint16_t)(gl::BYTES_PER_SAMPLE * 8), blockAlign = (uint16_t)(channels * gl::BYTES_PER_SAMPLE), pcm = 1;
+        const uint32_t frequency = (uint32_t)gl::DSP_FREQUENCY, byteRate = frequency * blockAlign, riffSize = 36 + dataSize, formatSize = 16;
+        std::vector<char> wav;
+        const auto append = [&wav](const void* data, const size_t size) { wav.insert(wav.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size); };
+        append("RIFF", 4); append(&riffSize, 4); append("WAVE", 4);
+        append("fmt ", 4); append(&formatSize, 4); append(&pcm, 2); append(&channels, 2); append(&frequency, 4); append(&byteRate, 4); append(&blockAlign, 2); append(&bitsPerSample, 2);
+        append("data", 4); append(&dataSize, 4); append(converted.data(), converted.size());
+        return WriteFile(job.outputPath, wav.data(), wav.size());
+    }
+
+    bool CookShader(const Job& job)
+    {
+        if (hasGlContext)
+        {
+            static const std::unordered_map<std::string, GLenum> STAGES =
+            {
+                { ".vert", GL_VERTEX_SHADER }, { ".frag", GL_FRAGMENT_SHADER }, { ".geom", GL_GEOMETRY_SHADER },
+                { ".comp", GL_COMPUTE_SHADER }, { ".tesc", GL_TESS_CONTROL_SHADER }, { ".tese", GL_TESS_EVALUATION_SHADER }
+            };
+            const gl::FileSystem::File file = gl::FileSystem::Get().Read(job.sourcePath.string());
+            const GLchar* source = file.GetData();
+            const GLint length = (GLint)file.GetSize();
+            // Only the variant without keywords is compiled, "#pragma keywords" lines are ignored by the compiler.
+            const GLuint SHADER = glCreateShader(STAGES.at(Lowercase(job.sourcePath.extension().string())));
+            glShaderSource(SHADER, 1, &source, &length);
+            glCompileShader(SHADER);
+            GLint success = GL_FALSE;
+            glGetShaderiv(SHADER, GL_COMPILE_STATUS, &success);
+            if (success != GL_TRUE)
+            {
+                char log[1024];
+                glGetShaderInfoLog(SHADER, sizeof(log), nullptr, log);
+                std::printf("%s: %s\n", job.source.c_str(), log);
+            }
+            glDeleteShader(SHADER);
+            if (success != GL_TRUE) return false;
+        }
+        return Copy(job);
+    }
+
+    const std::vector<Rule> RULES =
+    {
+        { "mesh", 1, { ".obj" }, ".mesh", false, CookMesh, FindMaterialLibraries },
+        { "texture", 3, { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".dds", ".ktx" }, ".ktx", false, CookTexture, nullptr },
+        { "audio", 1, { ".wav" }, "", false, CookAudio, nullptr },
+        { "shader", 1, { ".vert", ".frag", ".geom", ".comp", ".tesc", ".tese" }, "", true, CookShader, nullptr },
+        { "copy", 1, {}, "", false, Copy, nullptr } // Last, matches what the others don't.
+    };
+
+    const Rule& FindRule(const fs::path& source)
+    {
+        const std::string extension = Lowercase(source.extension().string());
+        for (const auto& rule : RULES)
+        {
+            if (std::find(rule.extensions.begin(), rule.extensions.end(), extension) != rule.extensions.end()) return rule;
+        }
+        return RULES.back();
+    }
+
+    void Run(Job& job, const bool force)
+    {
+        job.key = ComputeKey(job);
+        {
+            std::lock_guard<std::mutex> lock(databaseMutex);
+            const auto cooked = previous.cooked.find(job.source);
+            if (!force && cooked != previous.cooked.end() && cooked->second.key == job.key && fs::exists(job.outputPath))
+            {
+                job.result = Job::Result::UP_TO_DATE;
+                return;
+            }
+        }
+        std::error_code error;
+        fs::create_directories(job.outputPath.parent_path(), error);
+        job.result = job.rule->cook(job) ? Job::Result::COOKED : Job::Result::FAILED;
+        std::printf("%s %s -> %s\n", job.result == Job::Result::COOKED ? "cooked" : "FAILED", job.source.c_str(), job.output.c_str());
+    }
+
+    // Hidden window to validate shaders with the driver that will run them. Shaders are copied unchecked without one.
+    bool CreateGlContext(SDL_Window*& window, SDL_GLContext& context)
+    {
+        if (SDL_Init(SDL_INIT_VIDEO) != 0) return false;
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, gl::OPENGL_MAJOR_VERSION);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, gl::OPENGL_MINOR_VERSION);
+        window = SDL_CreateWindow("assetcooker", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+        if (window == nullptr) return false;
+        context = SDL_GL_CreateContext(window);
+        if (context == nullptr)
+        {
+            SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, gl::OPENGL_FALLBACK_MINOR_VERSION);
+            context = SDL_GL_CreateContext(window);
+        }
+        return context != nullptr && SDL_GL_MakeCurrent(window, context) == 0 && gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress);
+    }
+}//!anonymous
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::printf("Usage: %s <source directory> <output directory> [--force]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    sourceDirectory = argv[1];
+    outputDirectory = argv[2];
+    const bool force = argc > 3 && std::strcmp(argv[3], "--force") == 0;
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    std::error_code error;
+    fs::create_directories(outputDirectory, error);
+    const fs::path databasePath = outputDirectory / DATABASE_NAME;
+    previous = LoadDatabase(databasePath);
+
+    std::vector<Job> jobs;
+    for (const auto& entry : fs::recursive_directory_iterator(sourceDirectory))
+    {
+        if (!entry.is_regular_file()) continue;
+        Job job;
+        job.rule = &FindRule(entry.path());
+        job.source = fs::relative(entry.path(), sourceDirectory).generic_string();
+        fs::path output = job.source;
+        if (!job.rule->outputExtension.empty()) output.replace_extension(job.rule->outputExtension);
+        job.output = output.generic_string();
+        job.sourcePath = entry.path();
+        job.outputPath = outputDirectory / output;
+        jobs.push_back(std::move(job));
+    }
+
+    SDL_Window* window = nullptr;
+    SDL_GLContext context = nullptr;
+    const bool needsGlContext = std::any_of(jobs.begin(), jobs.end(), [](const Job& job) { return job.rule->needsGlContext; });
+    hasGlContext = needsGlContext && CreateGlContext(window, context);
+    if (needsGlContext && !hasGlContext)
+    {
+        std::printf("No gl context (%s), shaders are copied without being compiled.\n", SDL_GetError());
+    }
+
+    // Gl jobs stay on the thread owning the context, the others are spread across the hardware threads.
+    std::atomic<size_t> nextJob = 0;
+    const auto work = [&jobs, &nextJob, force]()
+    {
+        const gl::ParallelScope scope; // Jobs already use every hardware thread, their compression and mips don't start more.
+        for (size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+        {
+            if (!jobs[i].rule->needsGlContext) Run(jobs[i], force);
+        }
+    };
+    const size_t nrOfThreads = std::max(1u, std::thread::hardware_concurrency()); // hardware_concurrency() is 0 when unknown.
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < nrOfThreads; i++)
+    {
+        threads.emplace_back(work);
+    }
+    for (auto& job : jobs)
+    {
+        if (job.rule->needsGlContext) Run(job, force);
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    if (context != nullptr) SDL_GL_DeleteContext(context);
+    if (window != nullptr) SDL_DestroyWindow(window);
+    SDL_Quit();
+
+    // Failed jobs keep no entry and are retried next time. Outputs of deleted sources are removed.
+    size_t nrOfCooked = 0, nrOfUpToDate = 0, nrOfFailed = 0;
+    for (const auto& job : jobs)
+    {
+        switch (job.result)
+        {
+            case Job::Result::COOKED: nrOfCooked++; break;
+            case Job::Result::UP_TO_DATE: nrOfUpToDate++; break;
+            default: nrOfFailed++; continue;
+        }
+        next.cooked[job.source] = { job.key, job.output, job.dependencies };
+        previous.cooked.erase(job.source);
+    }
+    for (const auto& [source, cooked] : previous.cooked)
+    {
+        if (fs::exists(sourceDirectory / source)) continue;
+        fs::remove(outputDirectory / cooked.output, error);
+        std::printf("removed %s\n", cooked.output.c_str());
+    }
+    if (!SaveDatabase(databasePath, next))
+    {
+        std::printf("Could not write %s.\n", databasePath.string().c_str());
+        return EXIT_FAILURE;
+    }
+
+    const std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::printf("%zu cooked, %zu up to date, %zu failed in %.1f ms.\n", nrOfCooked, nrOfUpToDate, nrOfFailed, elapsed.count());
+    return nrOfFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -6,10 +6,13 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include "engine.h"
+#include "mesh_file.h"
 #include "model.h"
 #include "framebuffer.h"
+#include "material_table.h"
 #include "skybox.h"
 #include "resource_manager.h"
+#include "uniform_buffers.h"
 
 namespace gl
 {
@@ -24,6 +27,16 @@ namespace gl
 
     const size_t ROAD_LENGTH = 6;
 
+    // Material table entries of the opaque meshes drawn through the gbuffer program.
+    enum MaterialId : unsigned int
+    {
+        FLOOR_MATERIAL = 0,
+        SPHERE_MATERIAL,
+        CUBE_MATERIAL,
+        GLB_MATERIAL,
+        NR_OF_MATERIALS
+    };
+
     const glm::vec3 HORSE_POS =
         RIGHT_VEC3 *  6.0f +
         UP_VEC3 *     2.0f +
@@ -51,6 +64,7 @@ namespace gl
         UP_VEC3 * 1.0f +
         FRONT_VEC3 * -40.0f;
     const float SHADOW_SPHERES_SIZE = 0.5f;
+    const size_t SHADOWMAP_RESOLUTION = 1024;
     const glm::mat4 LIGHT_MATRIX = ORTHO * glm::lookAt(SHADOW_SPHERES_POS - LIGHT_DIR * 2.0f, SHADOW_SPHERES_POS, UP_VEC3); // Looking at SHADOW_SPHERES_POS from ~2 units away.
 
     const glm::vec3 CUBE_POS =
@@ -58,6 +72,11 @@ namespace gl
         UP_VEC3 * 1.0f +
         FRONT_VEC3 * -50.0f;
 
+    const glm::vec3 GLB_POS =
+        RIGHT_VEC3 * -6.0f +
+        UP_VEC3 * 1.0f +
+        FRONT_VEC3 * -30.0f;
+
     // Regions.
     const float TURN_AROUND_START = 0.1f;
     const float TURN_AROUND_END = 2.0f;
@@ -106,93 +125,43 @@ namespace gl
     private:
         void InitCube()
         {
-            const auto objData = ResourceManager::ReadObj(assetsPath + "models/brickCube/brickCube.obj");
-            VertexBuffer::Definition vbdef;
-            for (size_t i = 0; i < objData[0].positions.size(); i++)
-            {
-                vbdef.data.push_back(objData[0].positions[i].x);
-                vbdef.data.push_back(objData[0].positions[i].y);
-                vbdef.data.push_back(objData[0].positions[i].z);
-
-                vbdef.data.push_back(objData[0].uvs[i].x);
-                vbdef.data.push_back(objData[0].uvs[i].y);
-
-                vbdef.data.push_back(objData[0].normals[i].x);
-                vbdef.data.push_back(objData[0].normals[i].y);
-                vbdef.data.push_back(objData[0].normals[i].z);
-
-                vbdef.data.push_back(objData[0].tangents[i].x);
-                vbdef.data.push_back(objData[0].tangents[i].y);
-                vbdef.data.push_back(objData[0].tangents[i].z);
-            }
-            vbdef.dataLayout = { 3,2,3,3 };
-
-            cube_.Create({ vbdef }, { ResourceManager::PreprocessMaterialData(objData)[0] }, { glm::translate(IDENTITY_MAT4, CUBE_POS) });
+            // Last on the camera's path, it can be parsed while the demo already runs. Draws nothing until then.
+            // Seen from afar most of the demo, its finest mips are only streamed in as the camera comes close.
+            const std::string path = assetsPath + "models/brickCube/brickCube.obj";
+            ResourceManager::ReadObjAsync(path, [this, path](std::vector<ResourceManager::ObjData> objData)
+                {
+                    const VertexBuffer::Definition vbdef = ResourceManager::GetObjVertexBufferDefinition(objData, 0, path);
+                    Material::Definition matdef = ResourceManager::PreprocessMaterialData(objData, true)[0];
+                    matdef.streamMips = true;
+                    cube_.Create({ vbdef }, { matdef }, { glm::translate(IDENTITY_MAT4, CUBE_POS) });
+                    cube_.SetMaterialId(CUBE_MATERIAL);
+                });
+            materialEntries_[CUBE_MATERIAL].flags = MaterialTable::Flags::MESH_TEXTURES;
         }
         void InitSpheres()
         {
-            const auto objData = ResourceManager::ReadObj(assetsPath + "models/brickSphere/brickSphere.obj");
-            VertexBuffer::Definition vbdef;
-            for (size_t i = 0; i < objData[0].positions.size(); i++)
-            {
-                vbdef.data.push_back(objData[0].positions[i].x);
-                vbdef.data.push_back(objData[0].positions[i].y);
-                vbdef.data.push_back(objData[0].positions[i].z);
-
-                vbdef.data.push_back(objData[0].uvs[i].x);
-                vbdef.data.push_back(objData[0].uvs[i].y);
-
-                vbdef.data.push_back(objData[0].normals[i].x);
-                vbdef.data.push_back(objData[0].normals[i].y);
-                vbdef.data.push_back(objData[0].normals[i].z);
-
-                vbdef.data.push_back(objData[0].tangents[i].x);
-                vbdef.data.push_back(objData[0].tangents[i].y);
-                vbdef.data.push_back(objData[0].tangents[i].z);
-            }
-            vbdef.dataLayout = { 3,2,3,3 };
-
-            Shader::Definition sdef = ResourceManager::PreprocessShaderData(objData)[0];
-            sdef.vertexPath = "shaders/sphere.vert";
-            sdef.fragmentPath = "shaders/sphere.frag";
-            sdef.dynamicMat4s.insert({ CAMERA_MARIX_NAME, resourceManager_.GetCamera().GetCameraMatrixPtr() });
-            sdef.staticMat4s.insert({ LIGHT_MATRIX_NAME, LIGHT_MATRIX });
-            sdef.staticInts.insert({FRAMEBUFFER_SHADOWMAP_NAME, FRAMEBUFFER_SHADOWMAP_UNIT});
-            spheresShader_.Create(sdef);
-
-            sphere_.Create({ vbdef }, { ResourceManager::PreprocessMaterialData(objData)[0] }, {IDENTITY_MAT4, IDENTITY_MAT4, IDENTITY_MAT4});
+            const std::string path = assetsPath + "models/brickSphere/brickSphere.obj";
+            const auto objData = ResourceManager::ReadObj(path);
+            const VertexBuffer::Definition vbdef = ResourceManager::GetObjVertexBufferDefinition(objData, 0, path);
+
+            // Textured by the material table, shaded in the gbuffer pass already.
+            sphere_.Create({ vbdef }, { Material::Definition() }, {IDENTITY_MAT4, IDENTITY_MAT4, IDENTITY_MAT4});
+            sphere_.SetMaterialId(SPHERE_MATERIAL);
+            materialEntries_[SPHERE_MATERIAL] = MaterialTable::EntriesFromObj(objData)[0];
+            materialEntries_[SPHERE_MATERIAL].flags = MaterialTable::Flags::RECEIVE_SHADOWS | MaterialTable::Flags::SKIP_LIGHTING;
         }
         void InitDiamond()
         {
-            const auto objData = ResourceManager::ReadObj(assetsPath + "models/diamond/diamond.obj");
-            VertexBuffer::Definition vbdef;
-            for (size_t i = 0; i < objData[0].positions.size(); i++)
-            {
-                vbdef.data.push_back(objData[0].positions[i].x);
-                vbdef.data.push_back(objData[0].positions[i].y);
-                vbdef.data.push_back(objData[0].positions[i].z);
-
-                vbdef.data.push_back(objData[0].uvs[i].x);
-                vbdef.data.push_back(objData[0].uvs[i].y);
-
-                vbdef.data.push_back(objData[0].normals[i].x);
-                vbdef.data.push_back(objData[0].normals[i].y);
-                vbdef.data.push_back(objData[0].normals[i].z);
+            const std::string path = assetsPath + "models/diamond/diamond.obj";
+            const auto objData = ResourceManager::ReadObj(path);
+            const VertexBuffer::Definition vbdef = ResourceManager::GetObjVertexBufferDefinition(objData, 0, path);
 
-                vbdef.data.push_back(objData[0].tangents[i].x);
-                vbdef.data.push_back(objData[0].tangents[i].y);
-                vbdef.data.push_back(objData[0].tangents[i].z);
-            }
-            vbdef.dataLayout = { 3,2,3,3 };
-
-            Material::Definition matdef = ResourceManager::PreprocessMaterialData(objData)[0];
+            Material::Definition matdef = ResourceManager::PreprocessMaterialData(objData, true)[0];
             matdef.texturePathsAndTypes.push_back({ assetsPath + "textures/skybox/skybox.ktx", Texture::Type::CUBEMAP });
             Shader::Definition sdef = ResourceManager::PreprocessShaderData(objData)[0];
             sdef.vertexPath = "shaders/diamond.vert";
             sdef.fragmentPath = "shaders/diamond.frag";
-            sdef.dynamicMat4s.insert({ CAMERA_MARIX_NAME, camera_.GetCameraMatrixPtr() });
             sdef.staticInts.insert({ CUBEMAP_SAMPLER_NAME, CUBEMAP_TEXTURE_UNIT });
-            sdef.dynamicVec3s.insert({ VIEW_POSITION_NAME, camera_.GetPositionPtr() });
             diamondShader_.Create(sdef);
 
             diamond_.Create({ vbdef }, { matdef }, { glm::translate(IDENTITY_MAT4, DIAMOND_POS) });
@@ -231,12 +200,11 @@ namespace gl
             vbdef.dataLayout = { 3,2 };
             particleVertexBuffer_.Create(vbdef);
 
-            Material::Definition matdef = ResourceManager::PreprocessMaterialData(objData)[0];
+            Material::Definition matdef = ResourceManager::PreprocessMaterialData(objData, true)[0];
             particleMaterial_.Create(matdef);
             Shader::Definition sdef = ResourceManager::PreprocessShaderData(objData)[0];
             sdef.vertexPath = "shaders/particles.vert";
             sdef.fragmentPath = "shaders/particles.frag";
-            sdef.dynamicMat4s.insert({ CAMERA_MARIX_NAME, resourceManager_.GetCamera().GetCameraMatrixPtr() });
             particleShader_.Create(sdef);
 
             glBindVertexArray(particleVertexBuffer_.GetVAOandVBO()[0]);
@@ -289,7 +257,6 @@ namespace gl
             Shader::Definition sdef = ResourceManager::PreprocessShaderData(objData0)[0];
             sdef.vertexPath = "shaders/horse.vert";
             sdef.fragmentPath = "shaders/horse.frag";
-            sdef.dynamicMat4s.insert({ CAMERA_MARIX_NAME, resourceManager_.GetCamera().GetCameraMatrixPtr() });
             sdef.dynamicFloats.insert({ "interpolationFactor", &morphingFactor_ });
             horseShader_.Create(sdef);
 
@@ -298,37 +265,10 @@ namespace gl
             modelMatrices[0] = glm::rotate(modelMatrices[0], glm::radians(-90.0f), UP_VEC3);
             modelMatrices[0] = glm::scale(modelMatrices[0], glm::vec3(HORSE_SIZE));
 
-            horse_.Create({ vbdef }, { ResourceManager::PreprocessMaterialData(objData0)[0] }, modelMatrices, 7);
+            horse_.Create({ vbdef }, { ResourceManager::PreprocessMaterialData(objData0, true)[0] }, modelMatrices, 7);
         }
         void InitFloor()
         {
-            const auto objData = ResourceManager::ReadObj(assetsPath + "models/floor/floor.obj");
-            VertexBuffer::Definition vbdef;
-            for (size_t i = 0; i < objData[0].positions.size(); i++)
-            {
-                vbdef.data.push_back(objData[0].positions[i].x);
-                vbdef.data.push_back(objData[0].positions[i].y);
-                vbdef.data.push_back(objData[0].positions[i].z);
-
-                vbdef.data.push_back(objData[0].uvs[i].x);
-                vbdef.data.push_back(objData[0].uvs[i].y);
-
-                vbdef.data.push_back(objData[0].normals[i].x);
-                vbdef.data.push_back(objData[0].normals[i].y);
-                vbdef.data.push_back(objData[0].normals[i].z);
-
-                vbdef.data.push_back(objData[0].tangents[i].x);
-                vbdef.data.push_back(objData[0].tangents[i].y);
-                vbdef.data.push_back(objData[0].tangents[i].z);
-            }
-            vbdef.dataLayout = { 3,2,3,3 };
-
-            Shader::Definition sdef = ResourceManager::PreprocessShaderData(objData)[0];
-            sdef.vertexPath = "shaders/floor.vert";
-            sdef.fragmentPath = "shaders/floor.frag";
-            sdef.dynamicMat4s.insert({ CAMERA_MARIX_NAME, resourceManager_.GetCamera().GetCameraMatrixPtr() });
-            floorShader_.Create(sdef);
-
             const float scale = 5.0f;
             std::vector<glm::mat4> modelMatrices = std::vector<glm::mat4>(ROAD_LENGTH);
             for (size_t i = 0; i < ROAD_LENGTH; i++)
@@ -337,17 +277,64 @@ namespace gl
                 modelMatrices[i] = glm::scale(modelMatrices[i], ONE_VEC3 * scale);
             }
 
-            floor_.Create({ vbdef }, { ResourceManager::PreprocessMaterialData(objData)[0] }, modelMatrices);
+            // Cooked by the assetcooker when the demo runs from its output directory, parsed from the obj otherwise.
+            MeshFile cooked;
+            if (cooked.Open(assetsPath + "models/floor/floor.mesh") && !cooked.GetMeshes().empty())
+            {
+                floor_.Create(cooked, modelMatrices, {}, true); // Streamed, its own material binds the textures.
+                cooked.Close();
+                materialEntries_[FLOOR_MATERIAL].flags = MaterialTable::Flags::MESH_TEXTURES;
+            }
+            else
+            {
+                const std::string path = assetsPath + "models/floor/floor.obj";
+                const auto objData = ResourceManager::ReadObj(path);
+                floor_.Create({ ResourceManager::GetObjVertexBufferDefinition(objData, 0, path) }, { Material::Definition() }, modelMatrices);
+                materialEntries_[FLOOR_MATERIAL] = MaterialTable::EntriesFromObj(objData)[0];
+            }
+            floor_.SetMaterialId(FLOOR_MATERIAL);
+        }
+        void InitGlb()
+        {
+            // Drawn through the material table like the floor, glb primitives have the same attributes and normal and diffuse maps.
+            const auto glbData = ResourceManager::ReadGlb(assetsPath + "models/damagedHelmet/DamagedHelmet.glb");
+            for (const auto& glbMesh : glbData.meshes)
+            {
+                glbModels_.push_back(Model());
+                glbModels_.back().Create(glbMesh, {}, true); // Streamed like the cube's textures.
+                glbModels_.back().SetMaterialId(GLB_MATERIAL);
+                for (auto& modelMatrix : glbModels_.back().GetModelMatrices())
+                {
+                    modelMatrix = glm::translate(IDENTITY_MAT4, GLB_POS) * modelMatrix;
+                }
+            }
+            materialEntries_[GLB_MATERIAL].flags = MaterialTable::Flags::MESH_TEXTURES;
         }
         void InitModels()
         {
             InitFloor();
+            InitGlb();
             InitHorse();
             InitParticles();
             InitDiamond();
             InitSpheres();
             InitCube();
         }
+        void InitMaterialTable()
+        {
+            // Every opaque mesh feeding position, uv, normal and tangent to locations 0 to 3 is drawn with this one program, whatever its material.
+            MaterialTable::Definition mtdef;
+            mtdef.entries = std::vector<MaterialTable::Entry>(materialEntries_, materialEntries_ + NR_OF_MATERIALS);
+            materialTable_.Create(mtdef);
+
+            Shader::Definition sdef;
+            sdef.vertexPath = "shaders/gbuffer.vert";
+            sdef.fragmentPath = "shaders/gbuffer.frag";
+            sdef.staticInts.insert({ "meshDiffuseMap", DIFFUSE_TEXTURE_UNIT });
+            sdef.staticInts.insert({ "meshNormalMap", NORMALMAP_TEXTURE_UNIT });
+            sdef.staticInts.insert({ FRAMEBUFFER_SHADOWMAP_NAME, FRAMEBUFFER_SHADOWMAP_UNIT });
+            gbufferShader_.Create(sdef);
+        }
         void InitFramebuffers()
         {
             Framebuffer::Definition fbdef;
@@ -370,7 +357,7 @@ namespace gl
                 (
                     Framebuffer::Type::FBO_DEPTH_NO_DRAW
                 );
-            fbdef.resolution = {1024, 1024};
+            fbdef.resolution = { SHADOWMAP_RESOLUTION, SHADOWMAP_RESOLUTION };
             shadowpassFb_.Create(fbdef);
 
             // Init fbQuad_.
@@ -386,8 +373,7 @@ namespace gl
             sdef.staticInts.insert({ FRAMEBUFFER_SAMPLER1_NAME, FRAMEBUFFER_TEXTURE1_UNIT }); // FragPos( + shadowmap val?)
             sdef.staticInts.insert({ FRAMEBUFFER_SAMPLER2_NAME, FRAMEBUFFER_TEXTURE2_UNIT }); // normals
             sdef.staticInts.insert({ FRAMEBUFFER_SAMPLER3_NAME, FRAMEBUFFER_TEXTURE3_UNIT }); // shininess
-            sdef.dynamicVec3s.insert({ VIEW_POSITION_NAME, camera_.GetPositionPtr() });
-            sdef.staticVec3s.insert({"lightDir", LIGHT_DIR});
+            skybox_.AddLightingUniforms(sdef); // Ambient from the skybox instead of a constant.
             deferredShader_.Create(sdef);
 
             fbQuad_.Create({ vbdef }, { Material::Definition() });
@@ -405,7 +391,6 @@ namespace gl
             sdef = Shader::Definition();
             sdef.vertexPath = "shaders/shadowmapping.vert";
             sdef.fragmentPath = "shaders/empty.frag";
-            sdef.staticMat4s.insert({LIGHT_MATRIX_NAME, LIGHT_MATRIX});
             shadowpassShader_.Create(sdef);
         }
         void InitSkybox()
@@ -415,9 +400,8 @@ namespace gl
             skdef.path = assetsPath + "textures/skybox/skybox.ktx";
             skdef.shader.vertexPath = "shaders/skybox.vert";
             skdef.shader.fragmentPath = "shaders/skybox.frag";
-            skdef.shader.staticMat4s.insert({ PROJECTION_MARIX_NAME, PERSPECTIVE });
-            skdef.shader.dynamicMat4s.insert({ VIEW_MARIX_NAME, camera_.GetViewMatrixPtr() });
             skdef.shader.staticInts.insert({ CUBEMAP_SAMPLER_NAME, CUBEMAP_TEXTURE_UNIT });
+            skdef.bakeLighting = true;
             skybox_.Create(skdef);
         }
         void InitCamera()
@@ -612,7 +596,23 @@ namespace gl
         }
         void Render()
         {
+            // Camera, light and time for every program, uploaded once per frame.
+            UniformBuffers::FrameData frameData;
+            frameData.cameraMatrix = *camera_.GetCameraMatrixPtr();
+            frameData.viewMatrix = *camera_.GetViewMatrixPtr();
+            frameData.projectionMatrix = PERSPECTIVE;
+            frameData.lightMatrix = LIGHT_MATRIX;
+            frameData.viewPos = glm::vec4(camera_.GetPosition(), 1.0f);
+            frameData.lightDir = glm::vec4(LIGHT_DIR, 0.0f);
+            frameData.time = timer_;
+            frameData.deltaTime = lastDt_;
+            UniformBuffers::Get().UploadFrameData(frameData);
+
             // Shadow pass.
+            UniformBuffers::PassData passData;
+            passData.passMatrix = LIGHT_MATRIX;
+            passData.resolution = glm::vec4(glm::vec2((float)SHADOWMAP_RESOLUTION), glm::vec2(1.0f / (float)SHADOWMAP_RESOLUTION));
+            UniformBuffers::Get().UploadPassData(passData);
             glCullFace(GL_FRONT);
             shadowpassFb_.Bind();
             sphere_.Draw(shadowpassShader_, true); // We want shadows to be drawn even if the object itself is out of the frustum.
@@ -620,13 +620,22 @@ namespace gl
             glCullFace(GL_BACK);
 
             // Fill gbuffer.
+            passData.passMatrix = frameData.cameraMatrix;
+            passData.resolution = glm::vec4(SCREEN_RESOLUTION[0], SCREEN_RESOLUTION[1], 1.0f / SCREEN_RESOLUTION[0], 1.0f / SCREEN_RESOLUTION[1]);
+            UniformBuffers::Get().UploadPassData(passData);
             shadowpassFb_.BindGBuffer();
             deferredFb_.Bind();
             diamond_.Draw(diamondShader_);
             horse_.Draw(horseShader_);
-            sphere_.Draw(spheresShader_);
-            cube_.Draw(floorShader_);
-            floor_.Draw(floorShader_);
+            materialTable_.Bind();
+            sphere_.Draw(gbufferShader_);
+            cube_.Draw(gbufferShader_);
+            floor_.Draw(gbufferShader_);
+            for (auto& glbModel : glbModels_)
+            {
+                glbModel.Draw(gbufferShader_);
+            }
+            materialTable_.Unbind();
             RenderParticles();
             skybox_.Draw();
             deferredFb_.Unbind();
@@ -635,7 +644,9 @@ namespace gl
             // Apply shading.
             postprocessFb_.Bind();
             deferredFb_.BindGBuffer();
+            skybox_.BindLighting();
             fbQuad_.Draw(deferredShader_, true);
+            skybox_.UnbindLighting();
             deferredFb_.UnbindGBuffer();
             postprocessFb_.Unbind();
 
@@ -652,9 +663,10 @@ public:
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+            InitSkybox(); // Before the framebuffers, the deferred shader is lit by it.
             InitFramebuffers();
-            InitSkybox();
             InitModels();
+            InitMaterialTable(); // After the models, they fill in its entries.
             InitCamera();
             InitCameraMovements();
         }
@@ -664,6 +676,7 @@ public:
             const float fdt = dt.count();
             if (fdt > SKIP_FRAME_THRESHOLD) return; // Skip if the dt was unusually large. Ex: we've resumed execution of program after breakpoint.
             timer_ += fdt;
+            lastDt_ = fdt;
 
             // Clear screen.
             glClearColor(CLEAR_SCREEN_COLOR[0], CLEAR_SCREEN_COLOR[1], CLEAR_SCREEN_COLOR[2], CLEAR_SCREEN_COLOR[3]);
@@ -744,6 +757,7 @@ public:
 
     private:
         float timer_ = 0.0f;
+        float lastDt_ = 0.0f;
         bool mouseButtonDown_ = false;
         ResourceManager& resourceManager_ = ResourceManager::Get();
 
@@ -755,6 +769,7 @@ public:
             sphere_,
             cube_,
             fbQuad_;
+        std::vector<Model> glbModels_; // One per mesh of the glb.
         Framebuffer
             deferredFb_,
             postprocessFb_,
@@ -763,11 +778,12 @@ public:
             postprocessShader_,
             deferredShader_,
             shadowpassShader_,
-            floorShader_,
+            gbufferShader_,
             horseShader_,
             particleShader_,
-            diamondShader_,
-            spheresShader_;
+            diamondShader_;
+        MaterialTable materialTable_;
+        MaterialTable::Entry materialEntries_[NR_OF_MATERIALS];
 
         Camera& camera_ = resourceManager_.GetCamera();
         std::vector<Region> regions_;
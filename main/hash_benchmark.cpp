@@ -0,0 +1,148 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef XXH_INLINE_ALL
+#define XXH_INLINE_ALL
+#endif // !XXH_INLINE_ALL
+#include "xxhash.h"
+
+#include "defines.h"
+#include "hasher.h"
+#include "shader.h"
+
+// Compares the resource keys built by gl::Hasher with the string accumulating keys they replaced. No gl context needed.
+namespace
+{
+    constexpr const size_t NR_OF_VERTICES = 1 << 20;
+    constexpr const size_t NR_OF_VERTEX_BUFFER_RUNS = 20;
+    constexpr const size_t NR_OF_DEFINITION_RUNS = 100000;
+
+    // Previous VertexBuffer::Create() key.
+    uint32_t LegacyVertexBufferHash(const std::vector<float>& data, const std::vector<unsigned int>& dataLayout)
+    {
+        std::string accumulatedData = std::to_string(XXH32(data.data(), sizeof(float) * data.size(), gl::HASHING_SEED));
+        for (const auto& layout : dataLayout)
+        {
+            accumulatedData += std::to_string(layout);
+        }
+        return XXH32(accumulatedData.c_str(), sizeof(char) * accumulatedData.size(), gl::HASHING_SEED);
+    }
+
+    uint64_t VertexBufferHash(const std::vector<float>& data, const std::vector<unsigned int>& dataLayout)
+    {
+        gl::Hasher hasher(gl::HASHING_SEED);
+        hasher.Add(data).Add(dataLayout);
+        return hasher.Digest64();
+    }
+
+    // Previous Shader::Definition::GetHash(), address of the map nodes included.
+    uint32_t LegacyDefinitionHash(const gl::Shader::Definition& def)
+    {
+        std::string accumulatedData = def.vertexPath.data();
+        accumulatedData += def.fragmentPath.data();
+        for (const auto& pair : def.staticFloats)
+        {
+            accumulatedData += pair.first;
+            accumulatedData += std::to_string(pair.second);
+        }
+        for (const auto& pair : def.staticInts)
+        {
+            accumulatedData += pair.first;
+            accumulatedData += std::to_string(pair.second);
+        }
+        for (const auto& pair : def.staticMat4s)
+        {
+            accumulatedData += pair.first;
+            for (int column = 0; column < 4; column++)
+            {
+                for (int row = 0; row < 4; row++)
+                {
+                    accumulatedData += std::to_string(pair.second[column][row]);
+                }
+            }
+        }
+        for (const auto& pair : def.staticVec3s)
+        {
+            accumulatedData += pair.first;
+            accumulatedData += std::to_string(pair.second[0]);
+            accumulatedData += std::to_string(pair.second[1]);
+            accumulatedData += std::to_string(pair.second[2]);
+        }
+        for (const auto& pair : def.dynamicMat4s)
+        {
+            accumulatedData += pair.first;
+            accumulatedData += std::to_string((size_t)&pair.second);
+        }
+        for (const auto& pair : def.dynamicVec3s)
+        {
+            accumulatedData += pair.first;
+            accumulatedData += std::to_string((size_t)&pair.second);
+        }
+        return XXH32(accumulatedData.c_str(), sizeof(char) * accumulatedData.size(), gl::HASHING_SEED);
+    }
+
+    // Roughly the definition of a lit, shadowed material.
+    gl::Shader::Definition MakeDefinition(const glm::mat4& view, const glm::vec3& viewPos)
+    {
+        gl::Shader::Definition def;
+        def.vertexPath = "shaders/gbuffer.vert";
+        def.fragmentPath = "shaders/gbuffer.frag";
+        def.staticFloats = { { "shininess", 64.0f }, { "ambientStrength", 0.1f }, { "bias", 0.005f } };
+        def.staticInts = { { "alphaMap", gl::ALPHA_TEXTURE_UNIT }, { "normalMap", gl::NORMALMAP_TEXTURE_UNIT }, { "diffuseMap", gl::DIFFUSE_TEXTURE_UNIT }, { "specularMap", gl::SPECULAR_TEXTURE_UNIT } };
+        def.staticMat4s = { { "projection", gl::PERSPECTIVE }, { "ortho", gl::ORTHO }, { "model", gl::IDENTITY_MAT4 } };
+        def.staticVec3s = { { "lightColor", gl::WHITE }, { "ambientColor", gl::BLUE } };
+        def.dynamicMat4s = { { "view", &view } };
+        def.dynamicVec3s = { { "viewPos", &viewPos } };
+        return def;
+    }
+
+    // Returns the average milliseconds per call.
+    double Time(size_t runs, const std::function<void()>& work)
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < runs; i++)
+        {
+            work();
+        }
+        const std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+        return duration.count() / (double)runs;
+    }
+}//!anonymous
+
+int main(int argc, char** argv)
+{
+    std::mt19937 generator(1337);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    const std::vector<unsigned int> dataLayout = { 3, 3, 2 }; // Position, normal, uv.
+    std::vector<float> vertices(NR_OF_VERTICES * 8);
+    for (auto& value : vertices)
+    {
+        value = distribution(generator);
+    }
+
+    uint64_t sink = 0; // Keeps the hashes from being optimized away.
+    const double legacyVertices = Time(NR_OF_VERTEX_BUFFER_RUNS, [&]() { sink += LegacyVertexBufferHash(vertices, dataLayout); });
+    const double vertexHasher = Time(NR_OF_VERTEX_BUFFER_RUNS, [&]() { sink += VertexBufferHash(vertices, dataLayout); });
+    const double megabytes = (double)(sizeof(float) * vertices.size()) / (1024.0 * 1024.0);
+    std::printf("Vertex buffer, %zu vertices (%.1f MB):\n", NR_OF_VERTICES, megabytes);
+    std::printf("    string + XXH32: %8.3f ms (%6.2f GB/s)\n", legacyVertices, megabytes / legacyVertices * 1000.0 / 1024.0);
+    std::printf("    Hasher (XXH3):  %8.3f ms (%6.2f GB/s)\n", vertexHasher, megabytes / vertexHasher * 1000.0 / 1024.0);
+
+    const glm::mat4 view = gl::IDENTITY_MAT4;
+    const glm::vec3 viewPos = gl::ZERO_VEC3;
+    const gl::Shader::Definition def = MakeDefinition(view, viewPos);
+    const gl::Shader::Definition sameDef = MakeDefinition(view, viewPos);
+    const double legacyDefinition = Time(NR_OF_DEFINITION_RUNS, [&]() { sink += LegacyDefinitionHash(def); });
+    const double definitionHasher = Time(NR_OF_DEFINITION_RUNS, [&]() { sink += def.GetHash(); });
+    std::printf("Shader definition:\n");
+    std::printf("    string + XXH32: %8.3f us, identical definitions %s\n", legacyDefinition * 1000.0, LegacyDefinitionHash(def) == LegacyDefinitionHash(sameDef) ? "share a key" : "get different keys");
+    std::printf("    Hasher (XXH3):  %8.3f us, identical definitions %s\n", definitionHasher * 1000.0, def.GetHash() == sameDef.GetHash() ? "share a key" : "get different keys");
+
+    std::printf("(%llu)\n", (unsigned long long)sink);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+
+#include "mesh_file.h"
+#include "resource_manager.h"
+
+// Compares the cpu side of loading the same model from an obj, the way ReadObj() parses it into float vertices, from a glb read by ReadGlb() and optionally from the mesh assetcooker cooked out of the obj. The glb and the cooked mesh hand their mapped bytes to the gpu as they are, only their parsing is timed. No gl context needed.
+// Usage: mesh_benchmark <model.obj> <model.glb> [model.mesh]
+namespace
+{
+    constexpr const size_t NR_OF_RUNS = 20;
+
+    // Returns the average milliseconds per call.
+    double Time(const std::function<void()>& work)
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < NR_OF_RUNS; i++)
+        {
+            work();
+        }
+        const std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+        return duration.count() / (double)NR_OF_RUNS;
+    }
+}//!anonymous
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::printf("Usage: %s <model.obj> <model.glb> [model.mesh]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const std::string objPath = argv[1];
+    const std::string glbPath = argv[2];
+    const std::string meshPath = argc > 3 ? argv[3] : "";
+
+    size_t objBytes = 0, glbBytes = 0, meshBytes = 0; // Uploaded per load.
+    size_t sink = 0; // Keeps the reads from being optimized away.
+    const double obj = Time([&]()
+        {
+            objBytes = 0;
+            for (const auto& mesh : gl::ResourceManager::ReadObj(objPath))
+            {
+                objBytes += mesh.positions.size() * (sizeof(glm::vec3) * 3 + sizeof(glm::vec2));
+            }
+        });
+
+    const double glb = Time([&]()
+        {
+            glbBytes = 0;
+            const gl::ResourceManager::GlbData data = gl::ResourceManager::ReadGlb(glbPath);
+            for (const auto& mesh : data.meshes)
+            {
+                for (const auto& primitive : mesh.primitives)
+                {
+                    const auto& def = primitive.vertexBuffer;
+                    for (size_t i = 0; i < def.packedData.size(); i += 4096) sink += (unsigned char)def.packedData[i]; // Touch every page, as the upload would.
+                    glbBytes += def.packedData.size() + def.indices.size();
+                }
+            }
+        });
+
+    double mesh = 0.0;
+    if (!meshPath.empty())
+    {
+        mesh = Time([&]()
+            {
+                meshBytes = 0;
+                gl::MeshFile file;
+                if (!file.Open(meshPath)) std::exit(EXIT_FAILURE);
+                for (const auto& entry : file.GetMeshes())
+                {
+                    const auto def = file.GetVertexBufferDefinition(entry);
+                    for (size_t i = 0; i < def.packedData.size(); i += 4096) sink += (unsigned char)def.packedData[i];
+                    meshBytes += def.packedData.size() + def.indices.size();
+                }
+            });
+    }
+
+    std::printf("Average of %zu runs (warm file cache):\n", NR_OF_RUNS);
+    std::printf("    obj (ReadObj):          %8.3f ms, %10zu bytes to upload\n", obj, objBytes);
+    std::printf("    glb (ReadGlb):          %8.3f ms, %10zu bytes to upload (%.1fx)\n", glb, glbBytes, glb > 0.0 ? obj / glb : 0.0);
+    if (!meshPath.empty())
+    {
+        std::printf("    cooked (MeshFile):      %8.3f ms, %10zu bytes to upload (%.1fx)\n", mesh, meshBytes, mesh > 0.0 ? obj / mesh : 0.0);
+    }
+    std::printf("(%zu)\n", sink);
+    return EXIT_SUCCESS;
+}
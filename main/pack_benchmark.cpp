@@ -0,0 +1,94 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+
+// Compares reading every asset as loose files, the way the loaders open them, with reading them out of a gl::AssetPack packed from the same directory by asset_packer. No gl context needed.
+// Usage: pack_benchmark <directory> <pack>
+namespace
+{
+    constexpr const size_t NR_OF_RUNS = 20;
+
+    // Returns the average milliseconds per call.
+    double Time(const std::function<void()>& work)
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < NR_OF_RUNS; i++)
+        {
+            work();
+        }
+        const std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+        return duration.count() / (double)NR_OF_RUNS;
+    }
+}//!anonymous
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::printf("Usage: %s <directory> <pack>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const std::filesystem::path directory = argv[1];
+    const std::string packPath = argv[2];
+
+    std::vector<std::string> paths;
+    for (const auto& file : std::filesystem::recursive_directory_iterator(directory))
+    {
+        if (file.is_regular_file()) paths.push_back(std::filesystem::relative(file.path(), directory).generic_string());
+    }
+
+    size_t sink = 0; // Keeps the reads from being optimized away.
+    const double loose = Time([&]()
+        {
+            for (const auto& path : paths)
+            {
+                std::ifstream file(directory / path, std::ios::binary | std::ios::ate);
+                std::vector<char> data((size_t)file.tellg());
+                file.seekg(0);
+                file.read(data.data(), data.size());
+                sink += data.size();
+            }
+        });
+
+    const double packed = Time([&]()
+        {
+            gl::AssetPack pack;
+            if (!pack.Open(packPath)) std::exit(EXIT_FAILURE);
+            std::vector<const gl::AssetPack::Entry*> compressed;
+            for (const auto& path : paths)
+            {
+                const gl::AssetPack::Entry* entry = pack.Find(path);
+                if (entry == nullptr)
+                {
+                    std::printf("%s isn't in the pack, was it packed from %s?\n", path.c_str(), directory.string().c_str());
+                    std::exit(EXIT_FAILURE);
+                }
+                if (entry->compression == gl::AssetPack::Compression::NONE)
+                {
+                    const auto view = pack.View(*entry);
+                    for (size_t i = 0; i < view.size(); i += 4096) sink += (unsigned char)view[i]; // Touch every page, a view alone reads nothing.
+                }
+                else
+                {
+                    compressed.push_back(entry);
+                }
+            }
+            for (const auto& data : pack.ReadMany(compressed))
+            {
+                sink += data.size();
+            }
+        });
+
+    std::printf("%zu assets, average of %zu runs (warm file cache):\n", paths.size(), NR_OF_RUNS);
+    std::printf("    loose files (ifstream): %8.3f ms\n", loose);
+    std::printf("    asset pack (mmap):      %8.3f ms (%.1fx)\n", packed, packed > 0.0 ? loose / packed : 0.0);
+    std::printf("(%zu)\n", sink);
+    return EXIT_SUCCESS;
+}
@@ -1,9 +1,12 @@
 #include <limits>
 #include <assert.h>
+#include <cstring>
 #include <utility>
 #include <algorithm>
 #include <numeric>
 #include <functional>
+#include <memory>
+#include <string>
 
 #include <glad/glad.h>
 #include "imgui.h"
@@ -12,78 +15,26 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "async_loader.h"
 #include "engine.h"
+#include "file_system.h"
+#include "mip_generator.h"
 #include "shader.h"
+#include "sampler.h"
+#include "uniform_buffers.h"
+#include "upload_stream.h"
+#include "debug_draw.h"
 #include "PerlinNoise.h"
 
 namespace gl
 {
     constexpr const int NR_OF_PARTICLES_FOR_PROJECTILE = 64;
     constexpr const float PROJECTILE_EXPLOSION_RADIUS_MULTIPLIER = 2.0f;
-
-    class DrawableVector
-    {
-    public:
-        void Init(const glm::vec3 color, const glm::mat4& view)
-        {
-            Shader::Definition sdef;
-            sdef.vertexPath = "../data/shaders/drawableVector.vert";
-            sdef.fragmentPath = "../data/shaders/drawableVector.frag";
-            sdef.staticMat4s.insert({"PROJECTION", ORTHO});
-            sdef.dynamicMat4s.insert({ "view", &view });
-            sdef.staticVec3s.insert({"COLOR", GREEN});
-            shader_.Create(sdef);
-
-            CheckGlError();
-            glGenVertexArrays(1, &VAO_);
-            glGenBuffers(1, &VBO_);
-            glBindVertexArray(VAO_);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-            std::array<glm::vec2, 5> vertices_ =
-            {
-                glm::vec2(0.0f, 0.0f),
-                glm::vec2(1.0f, 0.0f),
-                glm::vec2(0.8f, 0.2f),
-                glm::vec2(0.8f, -0.2f),
-                glm::vec2(1.0f, 0.0f)
-            };
-            glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * vertices_.size(), vertices_.data(), GL_STATIC_DRAW);
-            CheckGlError();
-            glEnableVertexAttribArray(0);
-            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), 0);
-            CheckGlError();
-        }
-        void Destroy()
-        {
-            glDeleteBuffers(1, &VBO_);
-            glDeleteVertexArrays(1, &VAO_);
-            glDeleteProgram(shader_.GetPROGRAM());
-            CheckGlError();
-        }
-        void Update(const glm::vec2 newOrigin, const glm::vec2 newEnd)
-        {
-            const float SCALE_FACTOR = 50.0f;
-
-            glm::vec2 vec = newEnd - newOrigin;
-            const float scale = glm::length(vec);
-            vec = glm::normalize(vec);
-            const float rotation = (vec.x > 0) ? glm::atan(vec.y / vec.x) : glm::atan(vec.y / vec.x) + PI;
-
-            glm::mat4 model = glm::translate(IDENTITY_MAT4, ToVec3(newOrigin));
-            model = glm::rotate(model, rotation, FRONT_VEC3);
-            model = glm::scale(model, ONE_VEC3 * scale * SCALE_FACTOR);
-
-            shader_.Bind();
-            shader_.SetMat4({ "model" , model });
-            CheckGlError();
-            glBindVertexArray(VAO_);
-            glDrawArrays(GL_LINE_STRIP, 0, 5);
-            CheckGlError();
-        }
-    private:
-        unsigned int VAO_ = 0, VBO_ = 0;
-        Shader shader_;
-    };
+    constexpr const size_t NR_OF_PLAYER_PROJECTILES = 5;
+    constexpr const size_t NR_OF_AI_PROJECTILES = 1; // Per ai tank.
+    constexpr const float DEBUG_VECTOR_SCALE = 50.0f; // Per frame vectors are tiny, scale them up to make them visible when debug drawn.
+    constexpr const Sampler::Definition SPRITE_SAMPLER = { Sampler::Filter::LINEAR, Sampler::Wrap::CLAMP_TO_EDGE }; // Map chunks have no mips.
+    constexpr const Sampler::Definition TANK_SAMPLER = { Sampler::Filter::TRILINEAR, Sampler::Wrap::CLAMP_TO_EDGE };
 
     struct Rectangle
     {
@@ -162,6 +113,7 @@ namespace gl
                     }
                     fy += INCREMENT_;
                 }
+                dirty = true;
             }
             glm::vec2 WorldPos()
             {
@@ -170,6 +122,8 @@ namespace gl
 
             std::array<std::array<float, CHUNK_RESOLUTION_>, CHUNK_RESOLUTION_> data = { {0} };
             glm::ivec2 offset = { 0,0 };
+            unsigned int TEX = 0; // Chunks are swapped around as the player moves, their textures along with them.
+            bool dirty = false; // Generated since TEX was last uploaded.
         };
 
     public:
@@ -354,12 +308,12 @@ namespace gl
 
             if (updateRight) // Moving right.
             {
-                chunks_[0] = chunks_[1];
-                chunks_[1] = chunks_[2];
-                chunks_[3] = chunks_[4];
-                chunks_[4] = chunks_[5];
-                chunks_[6] = chunks_[7];
-                chunks_[7] = chunks_[8];
+                std::swap(chunks_[0], chunks_[1]);
+                std::swap(chunks_[1], chunks_[2]);
+                std::swap(chunks_[3], chunks_[4]);
+                std::swap(chunks_[4], chunks_[5]);
+                std::swap(chunks_[6], chunks_[7]);
+                std::swap(chunks_[7], chunks_[8]);
                 chunks_[2].offset = chunks_[1].offset + glm::ivec2(MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_, 0);
                 chunks_[5].offset = chunks_[4].offset + glm::ivec2(MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_, 0);
                 chunks_[8].offset = chunks_[7].offset + glm::ivec2(MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_, 0);
@@ -369,12 +323,12 @@ namespace gl
             }
             if (updateLeft) // Moving left.
             {
-                chunks_[2] = chunks_[1];
-                chunks_[1] = chunks_[0];
-                chunks_[5] = chunks_[4];
-                chunks_[4] = chunks_[3];
-                chunks_[8] = chunks_[7];
-                chunks_[7] = chunks_[6];
+                std::swap(chunks_[2], chunks_[1]);
+                std::swap(chunks_[1], chunks_[0]);
+                std::swap(chunks_[5], chunks_[4]);
+                std::swap(chunks_[4], chunks_[3]);
+                std::swap(chunks_[8], chunks_[7]);
+                std::swap(chunks_[7], chunks_[6]);
                 chunks_[0].offset = chunks_[1].offset - glm::ivec2(MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_, 0);
                 chunks_[3].offset = chunks_[4].offset - glm::ivec2(MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_, 0);
                 chunks_[6].offset = chunks_[7].offset - glm::ivec2(MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_, 0);
@@ -384,12 +338,12 @@ namespace gl
             }
             if (updateUp) // Moving up.
             {
-                chunks_[0] = chunks_[3];
-                chunks_[3] = chunks_[6];
-                chunks_[1] = chunks_[4];
-                chunks_[4] = chunks_[7];
-                chunks_[2] = chunks_[5];
-                chunks_[5] = chunks_[8];
+                std::swap(chunks_[0], chunks_[3]);
+                std::swap(chunks_[3], chunks_[6]);
+                std::swap(chunks_[1], chunks_[4]);
+                std::swap(chunks_[4], chunks_[7]);
+                std::swap(chunks_[2], chunks_[5]);
+                std::swap(chunks_[5], chunks_[8]);
                 chunks_[6].offset = chunks_[3].offset + glm::ivec2(0, MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_);
                 chunks_[7].offset = chunks_[4].offset + glm::ivec2(0, MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_);
                 chunks_[8].offset = chunks_[5].offset + glm::ivec2(0, MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_);
@@ -399,12 +353,12 @@ namespace gl
             }
             if (updateDown) // Moving down.
             {
-                chunks_[6] = chunks_[3];
-                chunks_[3] = chunks_[0];
-                chunks_[7] = chunks_[4];
-                chunks_[4] = chunks_[1];
-                chunks_[8] = chunks_[5];
-                chunks_[5] = chunks_[2];
+                std::swap(chunks_[6], chunks_[3]);
+                std::swap(chunks_[3], chunks_[0]);
+                std::swap(chunks_[7], chunks_[4]);
+                std::swap(chunks_[4], chunks_[1]);
+                std::swap(chunks_[8], chunks_[5]);
+                std::swap(chunks_[5], chunks_[2]);
                 chunks_[0].offset = chunks_[3].offset - glm::ivec2(0, MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_);
                 chunks_[1].offset = chunks_[4].offset - glm::ivec2(0, MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_);
                 chunks_[2].offset = chunks_[5].offset - glm::ivec2(0, MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_);
@@ -413,71 +367,155 @@ namespace gl
                 chunks_[2].Generate(perlinGenerator_);
             }
 
-            if (updateRight || updateLeft || updateDown || updateUp)
+            // Only the newly generated chunks are uploaded, streamed in the frame's upload budget. They're on the far side of the map, out of view.
+            for (auto& chunk : chunks_)
             {
-                for (int i = 0; i < 9; i++)
-                {
-                    glBindTexture(GL_TEXTURE_2D, TEXs_[i]);
-                    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, CHUNK_RESOLUTION_, CHUNK_RESOLUTION_, 0, GL_RED, GL_FLOAT, &(chunks_[i].data)[0][0]);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                }
+                if (!chunk.dirty) continue;
+                chunk.dirty = false;
+                const auto data = std::make_shared<const decltype(chunk.data)>(chunk.data); // The chunk can be regenerated before the ring has room for it.
+                const unsigned int TEX = chunk.TEX;
+                UploadStream::Get().Stage(
+                    sizeof(chunk.data),
+                    [data](char* destination) { std::memcpy(destination, data->data(), sizeof(*data)); },
+                    [TEX](const void* pixels)
+                    {
+                        glBindTexture(GL_TEXTURE_2D, TEX);
+                        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, CHUNK_RESOLUTION_, CHUNK_RESOLUTION_, GL_RED, GL_FLOAT, pixels);
+                        glBindTexture(GL_TEXTURE_2D, 0);
+                    });
             }
 
             // Draw map.
             shader_.Bind();
+            glBindSampler(0, sampler_.GetSAMPLER());
             for (int i = 0; i < 9; i++)
             {
                 glm::mat4 model = glm::translate(IDENTITY_MAT4, glm::vec3(chunks_[i].offset.x, chunks_[i].offset.y, 0.0f));
                 model = glm::scale(model, ONE_VEC3 * MAP_TILE_MULTIPLIER_);
-                shader_.SetMat4({ "model", model });
+                shader_.SetMat4("model", model);
                 glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, TEXs_[i]);
+                glBindTexture(GL_TEXTURE_2D, chunks_[i].TEX);
                 glDrawArrays(GL_TRIANGLES, 0, 6);
             }
         }
-        void Init(const glm::mat4& view)
+        static Shader::Definition GetShaderDefinition()
         {
             Shader::Definition sdef;
             sdef.vertexPath = "../data/shaders/sprite.vert";
-            sdef.fragmentPath = "../data/shaders/sprite_RED.frag";
+            sdef.fragmentPath = "../data/shaders/sprite.frag";
+            sdef.keywords = { "SINGLE_CHANNEL" }; // Chunks are greyscale.
             sdef.staticInts.insert({ "ALBEDO", 0 });
-            sdef.dynamicMat4s.insert({ "view", &view });
-            sdef.staticMat4s.insert({ "PROJECTION", ORTHO });
-            shader_.Create(sdef);
+            return sdef;
+        }
+        void Init()
+        {
+            shader_.Create(GetShaderDefinition());
+            sampler_.Create(SPRITE_SAMPLER);
 
             chunks_.resize(9);
-            glGenTextures(9, TEXs_);
             for (int y = -1; y < 2; y++)
             {
                 for (int x = -1; x < 2; x++)
                 {
-                    chunks_[(y + 1) * 3 + (x + 1)].offset = { x * MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_, y * MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_ };
-                    chunks_[(y + 1) * 3 + (x + 1)].Generate(perlinGenerator_);
-
-                    glBindTexture(GL_TEXTURE_2D, TEXs_[(y + 1) * 3 + (x + 1)]);
-                    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, CHUNK_RESOLUTION_, CHUNK_RESOLUTION_, 0, GL_RED, GL_FLOAT, &(chunks_[(y + 1) * 3 + (x + 1)].data)[0][0]);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                    MapChunk_& chunk = chunks_[(y + 1) * 3 + (x + 1)];
+                    chunk.offset = { x * MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_, y * MAP_TILE_MULTIPLIER_ * TEXTURE_QUAD_SIDE_LEN_ };
+                    chunk.Generate(perlinGenerator_);
+                    chunk.dirty = false; // Visible right away, uploaded directly.
+
+                    glGenTextures(1, &chunk.TEX);
+                    glBindTexture(GL_TEXTURE_2D, chunk.TEX);
+                    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, CHUNK_RESOLUTION_, CHUNK_RESOLUTION_, 0, GL_RED, GL_FLOAT, &(chunk.data)[0][0]);
                 }
             }
             CheckGlError();
         }
         void Destroy()
         {
-            glDeleteTextures(9, TEXs_);
-            glDeleteProgram(shader_.GetPROGRAM());
+            for (const auto& chunk : chunks_)
+            {
+                glDeleteTextures(1, &chunk.TEX); // shader_'s program belongs to the ResourceManager, it's released with the shader.
+            }
         }
 
     private:
-        unsigned int TEXs_[9] = {0};
         std::vector<MapChunk_> chunks_; // 0: LB, 1: MB, 2: RB, 3: LM, 4: MM, 5: RM, 6: LT, 7: MT, 8: RT 
         siv::BasicPerlinNoise<float> perlinGenerator_;
         Shader shader_;
+        Sampler sampler_;
+    };
+
+    /*
+    @brief: Shared gpu buffer holding the particles of every projectile. Projectiles submit their particles during the frame and all of them are drawn with a single draw call.
+    */
+    class ProjectileParticles
+    {
+    public:
+        void Init(const size_t maxNrOfProjectiles)
+        {
+            maxNrOfParticles_ = maxNrOfProjectiles * NR_OF_PARTICLES_FOR_PROJECTILE;
+            particles_.reserve(maxNrOfParticles_);
+
+            glGenVertexArrays(1, &VAO_);
+            glBindVertexArray(VAO_);
+            glGenBuffers(1, &VBO_);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+            glBufferData(GL_ARRAY_BUFFER, maxNrOfParticles_ * sizeof(Particle), nullptr, GL_STREAM_DRAW);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, pos));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, timer));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, color));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+            CheckGlError();
+        }
+        void Submit(const std::array<glm::vec2, NR_OF_PARTICLES_FOR_PROJECTILE>& positions, const float timer, const glm::vec3 color)
+        {
+            if (particles_.size() + NR_OF_PARTICLES_FOR_PROJECTILE > maxNrOfParticles_)
+            {
+                EngineWarning("Projectile particles buffer is full, projectile won't be drawn.");
+                return;
+            }
+            for (const auto& pos : positions)
+            {
+                particles_.push_back({ pos, timer, color });
+            }
+        }
+        void Draw(Shader& shader)
+        {
+            if (particles_.empty()) return;
+
+            // Orphan last frame's storage to avoid waiting on the gpu, then upload every submitted particle at once.
+            glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+            glBufferData(GL_ARRAY_BUFFER, maxNrOfParticles_ * sizeof(Particle), nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, particles_.size() * sizeof(Particle), particles_.data());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            shader.Bind();
+            glBindVertexArray(VAO_);
+            glDrawArrays(GL_POINTS, 0, (GLsizei)particles_.size());
+            glBindVertexArray(0);
+            CheckGlError();
+
+            particles_.clear();
+        }
+        void Destroy()
+        {
+            glDeleteBuffers(1, &VBO_);
+            glDeleteVertexArrays(1, &VAO_);
+        }
+    private:
+        struct Particle
+        {
+            glm::vec2 pos;
+            float timer;
+            glm::vec3 color;
+        };
+
+        unsigned int VAO_ = 0, VBO_ = 0;
+        size_t maxNrOfParticles_ = 0;
+        std::vector<Particle> particles_ = {};
     };
 
     class Projectile
@@ -490,13 +528,6 @@ namespace gl
         void Init(const glm::vec3 color)
         {
             color_ = color;
-            glGenVertexArrays(1, &VAO_);
-            glBindVertexArray(VAO_);
-            glGenBuffers(1, &VBO_);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-            glBufferData(GL_ARRAY_BUFFER, positions_.size() * sizeof(glm::vec2), positions_.data(), GL_DYNAMIC_DRAW);
-            glEnableVertexAttribArray(0);
-            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
         }
         void Launch(const glm::vec2 firingTankPos, const float firingTankGunPos)
         {
@@ -513,7 +544,7 @@ namespace gl
             avgPos_ /= NR_OF_PARTICLES_FOR_PROJECTILE;
             dir_ = glm::normalize(glm::vec2(glm::cos(firingTankGunPos), glm::sin(firingTankGunPos))); // TODO: is this normalize necessary?
         }
-        void Update(const Rectangle enemyHitbox, const float dt, std::function<void()> onHit, Shader& shader)
+        void Update(const Rectangle enemyHitbox, const float dt, std::function<void()> onHit, ProjectileParticles& particles)
         {
             if (InFlight())
             {
@@ -536,23 +567,12 @@ namespace gl
                     }
                 }
 
-                // Upload to gpu and issue draw call.
-                shader.Bind();
-                shader.SetFloat({"timer", timer_});
-                shader.SetVec3({"color", color_});
-                glBindVertexArray(VAO_);
-                glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-                glBufferSubData(GL_ARRAY_BUFFER, 0, positions_.size() * sizeof(glm::vec2), positions_.data());
-                glDrawArrays(GL_POINTS, 0, (GLsizei)positions_.size());
+                // Queue for the shared draw call.
+                particles.Submit(positions_, timer_, color_);
 
                 timer_ -= dt; // Must be at end of Draw for dir_ to be generated.
             }
         }
-        void Destroy()
-        {
-            glDeleteBuffers(1, &VBO_);
-            glDeleteVertexArrays(1, &VAO_);
-        }
     private:
         constexpr static const float PROJECTILE_MOV_SPEED_ = 20.0f;
         constexpr static const float PROJECTILE_STATE_LIFETIME_ = 1.0f;
@@ -560,13 +580,11 @@ namespace gl
 
         constexpr static const float PARTICLES_STATE_LIFETIME_ = 0.5f;
 
-        unsigned int VAO_ = 0, VBO_ = 0;
         std::array<glm::vec2, NR_OF_PARTICLES_FOR_PROJECTILE> positions_ = {};
         glm::vec2 dir_ = ZERO_VEC3;
         glm::vec2 avgPos_ = ZERO_VEC3;
         glm::vec3 color_ = ONE_VEC3;
 
-        // Uniforms.
         float timer_ = -PARTICLES_STATE_LIFETIME_ - 0.1f; // ----PARTICLE--- 0 ++++++PROJECTILE++++
     };
 
@@ -609,7 +627,7 @@ namespace gl
             hitbox_.topRight = startingPos + ToVec2(ONE_VEC3);
             projectile_.Init(color);
         }
-        void Update(const float dt, const glm::vec2 playerPos, const unsigned int VAO, Shader& tankShader, Shader& projectleShader, const unsigned int TEXs[2])
+        void Update(const float dt, const glm::vec2 playerPos, const unsigned int VAO, Shader& tankShader, ProjectileParticles& projectileParticles, const unsigned int TEXs[2])
         {
             if (!isDead_)
             {
@@ -625,7 +643,7 @@ namespace gl
                     playerTank_->GetHitBox(),
                     dt,
                     []() {},
-                    projectleShader
+                    projectileParticles
                 );
 
                 // Rotate tank.
@@ -650,8 +668,8 @@ namespace gl
                 // Draw tank body.
                 glm::mat4 model = glm::translate(IDENTITY_MAT4, ToVec3(pos_));
                 model = glm::rotate(model, bodyRot_, FRONT_VEC3);
-                tankShader.SetMat4({ "model", model });
-                tankShader.SetVec3({ "color", color_ });
+                tankShader.SetMat4("model", model);
+                tankShader.SetVec3("color", color_);
                 glBindTexture(GL_TEXTURE_2D, TEXs[0]);
                 glDrawArrays(GL_TRIANGLES, 0, 6);
 
@@ -659,15 +677,11 @@ namespace gl
                 model = glm::translate(IDENTITY_MAT4, ToVec3(pos_));
                 model = glm::rotate(model, gunRot_, FRONT_VEC3);
                 model = glm::scale(model, GUN_SCALE_);
-                tankShader.SetMat4({ "model", model });
+                tankShader.SetMat4("model", model);
                 glBindTexture(GL_TEXTURE_2D, TEXs[1]);
                 glDrawArrays(GL_TRIANGLES, 0, 6);
             }
         }
-        void Destroy()
-        {
-            projectile_.Destroy();
-        }
     private:
 
         constexpr static const float RELOAD_TIME_ = 1.5f;
@@ -681,7 +695,7 @@ namespace gl
     class PlayerTank : public A_Tank
     {
     public:
-        void Init(const glm::vec2 startingPos, const glm::vec3 color, std::vector<AiTank*> enemies, const glm::mat4& view)
+        void Init(const glm::vec2 startingPos, const glm::vec3 color, std::vector<AiTank*> enemies)
         {
             enemies_ = enemies;
             pos_ = startingPos;
@@ -692,9 +706,8 @@ namespace gl
             {
                 projectile.Init(color);
             }
-            movementVector_.Init(GREEN, view);
         }
-        void Update(const bool d, const bool w, const bool a, const bool s, const bool lmb, const float dt, const glm::vec2 relMousePos, const unsigned int VAO, unsigned int TEXs[2], Shader& tankShader, Shader& projectileShader, const Map& map)
+        void Update(const bool d, const bool w, const bool a, const bool s, const bool lmb, const float dt, const glm::vec2 relMousePos, const unsigned int VAO, unsigned int TEXs[2], Shader& tankShader, ProjectileParticles& projectileParticles, const Map& map)
         {
             // Rotate tank.
             if (d != a)
@@ -717,7 +730,7 @@ namespace gl
                 hitbox_.bottomLeft = pos_ - ToVec2(ONE_VEC3);
                 hitbox_.topRight = pos_ + ToVec2(ONE_VEC3);
             }
-            movementVector_.Update(pos_, pos_ + movementVec);
+            EngineDebugDraw(Arrow2D(pos_, pos_ + movementVec * DEBUG_VECTOR_SCALE, GREEN));
 
             // Rotate gun.
             gunRot_ = glm::atan(relMousePos.y / relMousePos.x);
@@ -740,7 +753,7 @@ namespace gl
                     enemies_.front()->GetHitBox(),
                     dt,
                     std::bind(&AiTank::Kill, enemies_.front()),
-                    projectileShader
+                    projectileParticles
                 );
             }
 
@@ -752,8 +765,8 @@ namespace gl
             // Draw tank body.
             glm::mat4 model = glm::translate(IDENTITY_MAT4, ToVec3(pos_));
             model = glm::rotate(model, bodyRot_, FRONT_VEC3);
-            tankShader.SetMat4({ "model", model });
-            tankShader.SetVec3({"color", color_});
+            tankShader.SetMat4("model", model);
+            tankShader.SetVec3("color", color_);
             glBindTexture(GL_TEXTURE_2D, TEXs[0]);
             glDrawArrays(GL_TRIANGLES, 0, 6);
 
@@ -761,23 +774,14 @@ namespace gl
             model = glm::translate(IDENTITY_MAT4, ToVec3(pos_));
             model = glm::rotate(model, gunRot_, FRONT_VEC3);
             model = glm::scale(model, GUN_SCALE_);
-            tankShader.SetMat4({ "model", model });
+            tankShader.SetMat4("model", model);
             glBindTexture(GL_TEXTURE_2D, TEXs[1]);
             glDrawArrays(GL_TRIANGLES, 0, 6);
         }
-        void Destroy()
-        {
-            for (auto& projectile : projectilePool_)
-            {
-                projectile.Destroy();
-            }
-            movementVector_.Destroy();
-        }
 
     private:
-        std::vector<Projectile> projectilePool_ = std::vector<Projectile>(5);
+        std::vector<Projectile> projectilePool_ = std::vector<Projectile>(NR_OF_PLAYER_PROJECTILES);
         std::vector<AiTank*> enemies_;
-        DrawableVector movementVector_;
     };
 
     class InputManager
@@ -1034,6 +1038,9 @@ namespace gl
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             glPointSize(PIXEL_SIZE_);
 
+            // The map's program compiles while the tank textures load.
+            Shader::Prewarm({ Map::GetShaderDefinition() });
+
             {
                 std::vector<float> data = QUAD_POSITIONS;
                 glGenVertexArrays(1, &quadVAO_);
@@ -1046,46 +1053,43 @@ namespace gl
                 CheckGlError();
             }
 
-            int width, height, nrOfChannels;
-            unsigned char* imgData = stbi_load("../data/tank_body.png", &width, &height, &nrOfChannels, 0);
-            assert(imgData != nullptr && width > 0 && height > 0 && nrOfChannels == 4);
+            // White until the sprites are decoded.
             glGenTextures(2, tankTextures_);
-            glBindTexture(GL_TEXTURE_2D, tankTextures_[0]);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, imgData);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            stbi_image_free(imgData);
-            imgData = stbi_load("../data/tank_gun.png", &width, &height, &nrOfChannels, 0);
-            assert(imgData != nullptr && width > 0 && height > 0 && nrOfChannels == 4);
-            glBindTexture(GL_TEXTURE_2D, tankTextures_[1]);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, imgData);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            const unsigned char white[4] = { 255, 255, 255, 255 };
+            for (const unsigned int TEX : tankTextures_)
+            {
+                glBindTexture(GL_TEXTURE_2D, TEX);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+            LoadSprite(tankTextures_[0], "../data/tank_body.png");
+            LoadSprite(tankTextures_[1], "../data/tank_gun.png");
+
+            // Both programs compile concurrently when the driver allows it.
+            Shader::Definition tankDef;
+            tankDef.vertexPath = "../data/shaders/sprite.vert";
+            tankDef.fragmentPath = "../data/shaders/sprite.frag";
+            tankDef.staticInts.insert({ "ALBEDO", 0 });
+            Shader::Definition projectileDef;
+            projectileDef.vertexPath = "../data/shaders/projectile.vert";
+            projectileDef.fragmentPath = "../data/shaders/projectile.frag";
+            projectileDef.staticFloats.insert({ "NR_OF_VERTICES", NR_OF_PARTICLES_FOR_PROJECTILE });
+            projectileDef.staticFloats.insert({ "EXPLOSION_RADIUS_MULTIPLIER", PROJECTILE_EXPLOSION_RADIUS_MULTIPLIER });
+            Shader::CreateBatch({ { &tankShader_, tankDef }, { &projectileShader_, projectileDef } });
+            tankSampler_.Create(TANK_SAMPLER);
+
+            projectileParticles_.Init(NR_OF_PLAYER_PROJECTILES + NR_OF_AI_PROJECTILES + MAX_NR_OF_STRESS_PROJECTILES_);
+            for (size_t i = 0; i < stressProjectiles_.size(); i++)
+            {
+                const float hue = (float)i / (float)stressProjectiles_.size();
+                stressProjectiles_[i].Init(glm::vec3(hue, 1.0f - hue, 0.5f));
+            }
 
-            Shader::Definition sdef;
-            sdef.vertexPath = "../data/shaders/sprite.vert";
-            sdef.fragmentPath = "../data/shaders/sprite_RGBA.frag";
-            sdef.staticInts.insert({ "ALBEDO", 0 });
-            sdef.dynamicMat4s.insert({ "view", &view_ });
-            sdef.staticMat4s.insert({ "PROJECTION", ORTHO });
-            tankShader_.Create(sdef);
-
-            sdef = {};
-            sdef.vertexPath = "../data/shaders/projectile.vert";
-            sdef.fragmentPath = "../data/shaders/projectile.frag";
-            sdef.dynamicMat4s.insert({ "view", &view_ });
-            sdef.staticMat4s.insert({ "PROJECTION", ORTHO });
-            sdef.staticFloats.insert({ "NR_OF_VERTICES", NR_OF_PARTICLES_FOR_PROJECTILE });
-            sdef.staticFloats.insert({ "EXPLOSION_RADIUS_MULTIPLIER", PROJECTILE_EXPLOSION_RADIUS_MULTIPLIER });
-            projectileShader_.Create(sdef);
-
-            map_.Init(view_);
-            playerTank_.Init(ZERO_VEC3, RED + BLUE + GREEN * 0.35f, {&enemyTank_}, view_);
+            map_.Init();
+            playerTank_.Init(ZERO_VEC3, RED + BLUE + GREEN * 0.35f, {&enemyTank_});
             enemyTank_.Init(ONE_VEC3 * 5.0f, RED, reinterpret_cast<A_Tank*>(&playerTank_));
+
+            EngineDebugDraw(Create({ "../data/shaders/debug_draw.vert", "../data/shaders/debug_draw.frag" }));
         }
 
         void Update(seconds dt) override
@@ -1096,18 +1100,28 @@ namespace gl
             const glm::vec2 playerPos = playerTank_.GetPos();
             view_ = glm::lookAt(ToVec3(playerPos) + FRONT_VEC3, ToVec3(playerPos), UP_VEC3);
 
+            // Camera and time for every program, uploaded once per frame.
+            UniformBuffers::FrameData frameData;
+            frameData.cameraMatrix = ORTHO * view_;
+            frameData.viewMatrix = view_;
+            frameData.projectionMatrix = ORTHO;
+            frameData.viewPos = glm::vec4(ToVec3(playerPos) + FRONT_VEC3, 1.0f);
+            frameData.time = timer_;
+            frameData.deltaTime = dt_;
+            UniformBuffers::Get().UploadFrameData(frameData);
+
             glClearColor(CLEAR_SCREEN_COLOR[0], CLEAR_SCREEN_COLOR[1], CLEAR_SCREEN_COLOR[2], CLEAR_SCREEN_COLOR[3]);
             glClear(GL_COLOR_BUFFER_BIT /* | GL_DEPTH_BUFFER_BIT*/);
 
             map_.Update(playerPos, quadVAO_);
 
-            // TODO: make all particles be drawn on top of all tanks.
+            glBindSampler(0, tankSampler_.GetSAMPLER()); // Tank sprites are sampled from unit 0.
             enemyTank_.Update(
                 dt_,
                 playerPos,
                 quadVAO_,
                 tankShader_,
-                projectileShader_,
+                projectileParticles_,
                 tankTextures_);
 
             playerTank_.Update(
@@ -1121,9 +1135,32 @@ namespace gl
                 quadVAO_,
                 tankTextures_,
                 tankShader_,
-                projectileShader_,
+                projectileParticles_,
                 map_);
 
+            if (stressTest_)
+            {
+                // Keep firing in every direction from the player's position.
+                for (int i = 0; i < nrOfStressProjectiles_; i++)
+                {
+                    auto& projectile = stressProjectiles_[i];
+                    if (!projectile.InFlight())
+                    {
+                        projectile.Launch(playerPos, (float)(rand() % 628) * 0.01f);
+                    }
+                    projectile.Update(enemyTank_.GetHitBox(), dt_, []() {}, projectileParticles_);
+                }
+            }
+
+            // Every projectile's particles are drawn at once, on top of all tanks.
+            projectileParticles_.Draw(projectileShader_);
+
+            // Debug visualisation, compiled out of release builds.
+            EngineDebugDraw(Arrow2D(playerPos, playerPos + map_.ComputeTerrainIncline(playerPos) * DEBUG_VECTOR_SCALE, BLUE));
+            EngineDebugDraw(Rectangle2D(playerTank_.GetHitBox().bottomLeft, playerTank_.GetHitBox().topRight, GREEN));
+            EngineDebugDraw(Rectangle2D(enemyTank_.GetHitBox().bottomLeft, enemyTank_.GetHitBox().topRight, RED));
+            EngineDebugDraw(Flush());
+
             inputManager_.UpdateButtons(); // TODO: wierd as fuck to put it down here... needs to be here for the InputManager's Just...() functions to work, look into it.
         }
         void Destroy() override
@@ -1134,12 +1171,9 @@ namespace gl
             
             glDeleteTextures(2, tankTextures_);
 
-            glDeleteProgram(tankShader_.GetPROGRAM());
-            glDeleteProgram(projectileShader_.GetPROGRAM());
-
-            playerTank_.Destroy();
-            enemyTank_.Destroy();
+            projectileParticles_.Destroy();
             map_.Destroy();
+            EngineDebugDraw(Destroy());
         }
         void OnEvent(SDL_Event& event) override
         {
@@ -1154,7 +1188,10 @@ namespace gl
         }
         void DrawImGui() override
         {
-
+            ImGui::Begin("Playground");
+            ImGui::Checkbox("Projectiles stress test", &stressTest_);
+            ImGui::SliderInt("Simultaneous shots", &nrOfStressProjectiles_, 1, (int)MAX_NR_OF_STRESS_PROJECTILES_);
+            ImGui::End();
         }
 
     private:
@@ -1164,13 +1201,53 @@ namespace gl
         float dt_ = 0.0f;
         float lastDt_ = 0.0f;
         
+        /*
+        @brief: Decodes the png on a worker thread and stages it with its mips in the UploadStream from there, TEX is respecified with them on the gl thread.
+        */
+        static AsyncLoader::Task LoadSprite(unsigned int TEX, std::string path)
+        {
+            co_await AsyncLoader::Get().ToWorker();
+            const FileSystem::File file = FileSystem::Get().Read(path);
+            int width = 0, height = 0, nrOfChannels = 0;
+            const std::shared_ptr<unsigned char> imgData(stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.GetData()), (int)file.GetSize(), &width, &height, &nrOfChannels, 0), stbi_image_free);
+            assert(imgData != nullptr && width > 0 && height > 0 && nrOfChannels == 4);
+
+            // The tanks are drawn smaller than their sprites, their mips are filtered here rather than by the driver after the upload.
+            MipGenerator::Definition mipDef;
+            mipDef.srgb = true;
+            const size_t size = MipGenerator::GetChainSize((size_t)width, (size_t)height);
+            UploadStream::Get().Stage(
+                size,
+                [imgData, width, height, mipDef](char* destination) { MipGenerator::Generate(imgData.get(), (size_t)width, (size_t)height, mipDef, reinterpret_cast<uint8_t*>(destination)); },
+                [TEX, width, height](const void* pixels)
+                {
+                    const size_t nrOfLevels = MipGenerator::GetNrOfLevels((size_t)width, (size_t)height);
+                    glBindTexture(GL_TEXTURE_2D, TEX);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)nrOfLevels - 1);
+                    for (size_t level = 0; level < nrOfLevels; level++)
+                    {
+                        glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA, std::max(width >> level, 1), std::max(height >> level, 1), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                            static_cast<const char*>(pixels) + MipGenerator::GetLevelOffset((size_t)width, (size_t)height, level));
+                    }
+                    glBindTexture(GL_TEXTURE_2D, 0);
+                });
+        }
+
         unsigned int quadVAO_ = 0, quadVBO_ = 0;
-        glm::mat4 view_ = IDENTITY_MAT4; // Uniform.
+        glm::mat4 view_ = IDENTITY_MAT4;
 
         constexpr static const float PIXEL_SIZE_ = 2.0f;
         PlayerTank playerTank_;
         AiTank enemyTank_;
         Shader tankShader_, projectileShader_;
+        ProjectileParticles projectileParticles_;
+        Sampler tankSampler_;
+
+        // Stress test firing thousands of projectiles simultaneously.
+        constexpr static const size_t MAX_NR_OF_STRESS_PROJECTILES_ = 4096;
+        bool stressTest_ = false;
+        int nrOfStressProjectiles_ = 2048;
+        std::vector<Projectile> stressProjectiles_ = std::vector<Projectile>(MAX_NR_OF_STRESS_PROJECTILES_);
         unsigned int tankTextures_[2] = {0};
 
         Map map_;
@@ -0,0 +1,254 @@
+#include "asset_pack.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "common/tracy_lz4.hpp"
+
+#include "defines.h"
+#include "hasher.h"
+
+static_assert(sizeof(gl::AssetPack::Header) == gl::AssetPack::ALIGNMENT, "The table of contents starts right after the header.");
+static_assert(sizeof(gl::AssetPack::Entry) == 32 && gl::AssetPack::ALIGNMENT % alignof(gl::AssetPack::Entry) == 0, "Entries are used in place from the mapping.");
+
+namespace
+{
+    size_t AlignUp(const size_t value)
+    {
+        return (value + gl::AssetPack::ALIGNMENT - 1) & ~(gl::AssetPack::ALIGNMENT - 1);
+    }
+}//!anonymous
+
+gl::AssetPack::~AssetPack()
+{
+    Close();
+}
+
+bool gl::AssetPack::Open(const std::string& path)
+{
+    Close();
+#if defined(_WIN32)
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+    {
+        file_ = nullptr;
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file_, &size);
+    mappingSize_ = (size_t)size.QuadPart;
+    fileMapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (fileMapping_ != nullptr)
+    {
+        mapping_ = static_cast<const char*>(MapViewOfFile(fileMapping_, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size > 0)
+    {
+        mappingSize_ = (size_t)status.st_size;
+        void* mapping = mmap(nullptr, mappingSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+        mapping_ = mapping == MAP_FAILED ? nullptr : static_cast<const char*>(mapping);
+    }
+    close(fd); // The mapping keeps the file alive.
+#endif
+    if (mapping_ == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(mapping_);
+    if (mappingSize_ < sizeof(Header) || header->magic != MAGIC || header->version != VERSION ||
+        header->dataOffset > mappingSize_ || sizeof(Header) + header->nrOfEntries * sizeof(Entry) > header->dataOffset)
+    {
+        EngineWarning(("Invalid asset pack " + path + ".").c_str());
+        Close();
+        return false;
+    }
+    entries_ = std::span<const Entry>(reinterpret_cast<const Entry*>(mapping_ + sizeof(Header)), (size_t)header->nrOfEntries);
+    for (const auto& entry : entries_)
+    {
+        if (entry.offset + entry.storedSize > mappingSize_)
+        {
+            EngineWarning(("Truncated asset pack " + path + ".").c_str());
+            Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void gl::AssetPack::Close()
+{
+#if defined(_WIN32)
+    if (mapping_ != nullptr) UnmapViewOfFile(mapping_);
+    if (fileMapping_ != nullptr) CloseHandle(fileMapping_);
+    if (file_ != nullptr) CloseHandle(file_);
+    fileMapping_ = nullptr;
+    file_ = nullptr;
+#else
+    if (mapping_ != nullptr) munmap(const_cast<char*>(mapping_), mappingSize_);
+#endif
+    mapping_ = nullptr;
+    mappingSize_ = 0;
+    entries_ = {};
+}
+
+bool gl::AssetPack::IsOpen() const
+{
+    return mapping_ != nullptr;
+}
+
+uint64_t gl::AssetPack::HashPath(std::string_view path)
+{
+    const std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+    Hasher hasher(HASHING_SEED);
+    hasher.Add(std::string_view(normalized));
+    return hasher.Digest64();
+}
+
+const gl::AssetPack::Entry* gl::AssetPack::Find(std::string_view path) const
+{
+    const uint64_t hash = HashPath(path);
+    const auto match = std::lower_bound(entries_.begin(), entries_.end(), hash, [](const Entry& entry, const uint64_t hash) { return entry.hash < hash; });
+    return match != entries_.end() && match->hash == hash ? &*match : nullptr;
+}
+
+std::span<const gl::AssetPack::Entry> gl::AssetPack::GetEntries() const
+{
+    return entries_;
+}
+
+std::span<const char> gl::AssetPack::View(const Entry& entry) const
+{
+    assert(IsOpen());
+    if (entry.compression != Compression::NONE) return {};
+    return std::span<const char>(mapping_ + entry.offset, entry.size);
+}
+
+bool gl::AssetPack::Read(const Entry& entry, std::vector<char>& out) const
+{
+    assert(IsOpen());
+    out.resize(entry.size);
+    const char* stored = mapping_ + entry.offset;
+    switch (entry.compression)
+    {
+        case Compression::NONE:
+            std::copy(stored, stored + entry.size, out.begin());
+            return true;
+        case Compression::LZ4:
+            return tracy::LZ4_decompress_safe(stored, out.data(), (int)entry.storedSize, (int)entry.size) == (int)entry.size;
+        default:
+            return false;
+    }
+}
+
+std::vector<std::vector<char>> gl::AssetPack::ReadMany(const std::vector<const Entry*>& entries) const
+{
+    std::vector<std::vector<char>> outs(entries.size());
+    // Entries are worth a thread each, from an AsyncLoader worker or a cooker job they're read on the calling thread.
+    ParallelFor(entries.size(), 1, 1, [&](const size_t i)
+    {
+        if (!Read(*entries[i], outs[i])) EngineError("Corrupted asset pack entry!");
+    });
+    return outs;
+}
+
+bool gl::AssetPack::Write(const std::string& packPath, const std::vector<Source>& sources, Compression compression)
+{
+    struct Packed
+    {
+        Entry entry = {};
+        std::vector<char> data = {};
+    };
+    std::vector<Packed> packed(sources.size());
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        std::ifstream file(sources[i].file, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            EngineWarning(("Could not read " + sources[i].file + ".").c_str());
+            return false;
+        }
+        std::vector<char> data((size_t)file.tellg());
+        file.seekg(0);
+        file.read(data.data(), data.size());
+
+        Entry& entry = packed[i].entry;
+        entry.hash = HashPath(sources[i].path);
+        entry.size = (uint32_t)data.size();
+        entry.compression = Compression::NONE;
+        if (compression == Compression::LZ4 && !data.empty())
+        {
+            std::vector<char> compressed((size_t)tracy::LZ4_compressBound((int)data.size()));
+            const int compressedSize = tracy::LZ4_compress_default(data.data(), compressed.data(), (int)data.size(), (int)compressed.size());
+            if (compressedSize > 0 && (size_t)compressedSize < data.size())
+            {
+                compressed.resize((size_t)compressedSize);
+                data = std::move(compressed);
+                entry.compression = Compression::LZ4;
+            }
+        }
+        entry.storedSize = (uint32_t)data.size();
+        packed[i].data = std::move(data);
+    }
+
+    // Sorted for Find()'s binary search.
+    std::sort(packed.begin(), packed.end(), [](const Packed& a, const Packed& b) { return a.entry.hash < b.entry.hash; });
+    for (size_t i = 1; i < packed.size(); i++)
+    {
+        if (packed[i].entry.hash == packed[i - 1].entry.hash)
+        {
+            EngineWarning("Two assets share the same path hash, or the same path was given twice.");
+            return false;
+        }
+    }
+
+    Header header; // Every byte is a member, packing the same files twice gives the same bytes.
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.nrOfEntries = packed.size();
+    header.dataOffset = AlignUp(sizeof(Header) + packed.size() * sizeof(Entry));
+    size_t offset = (size_t)header.dataOffset;
+    for (auto& asset : packed)
+    {
+        asset.entry.offset = offset;
+        offset = AlignUp(offset + asset.entry.storedSize);
+    }
+
+    std::ofstream file(packPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        EngineWarning(("Could not write " + packPath + ".").c_str());
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    for (const auto& asset : packed)
+    {
+        file.write(reinterpret_cast<const char*>(&asset.entry), sizeof(Entry));
+    }
+    const char padding[ALIGNMENT] = {};
+    size_t position = sizeof(Header) + packed.size() * sizeof(Entry);
+    for (const auto& asset : packed)
+    {
+        file.write(padding, (std::streamsize)(asset.entry.offset - position));
+        file.write(asset.data.data(), (std::streamsize)asset.data.size());
+        position = asset.entry.offset + asset.data.size();
+    }
+    file.write(padding, (std::streamsize)(AlignUp(position) - position));
+    return file.good();
+}
@@ -0,0 +1,139 @@
+#include "async_loader.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "defines.h"
+
+gl::AsyncLoader::Task::promise_type::promise_type()
+{
+    AsyncLoader::Get().inFlight_++;
+}
+
+gl::AsyncLoader::Task::promise_type::~promise_type()
+{
+    AsyncLoader::Get().inFlight_--;
+}
+
+void gl::AsyncLoader::WorkerAwaiter::await_suspend(std::coroutine_handle<> handle) const
+{
+    AsyncLoader& loader = AsyncLoader::Get();
+    loader.StartWorkers();
+    {
+        std::lock_guard<std::mutex> lock(loader.mutex_);
+        loader.workerQueue_.push_back(handle);
+    }
+    loader.wakeWorkers_.notify_one();
+}
+
+void gl::AsyncLoader::GlThreadAwaiter::await_suspend(std::coroutine_handle<> handle) const
+{
+    AsyncLoader& loader = AsyncLoader::Get();
+    std::lock_guard<std::mutex> lock(loader.mutex_);
+    loader.glQueue_.push_back(handle);
+}
+
+gl::AsyncLoader::~AsyncLoader()
+{
+    Shutdown();
+}
+
+gl::AsyncLoader::WorkerAwaiter gl::AsyncLoader::ToWorker()
+{
+    return {};
+}
+
+gl::AsyncLoader::GlThreadAwaiter gl::AsyncLoader::ToGlThread()
+{
+    return {};
+}
+
+void gl::AsyncLoader::StartWorkers()
+{
+    if (!workers_.empty()) return; // Loads start on the gl thread, so do the workers. Later calls from workers only read this.
+
+    // Leave a core to the gl thread, decoding is the bulk of the work.
+    const size_t nrOfWorkers = std::max<size_t>(2, std::thread::hardware_concurrency()) - 1; // hardware_concurrency() is 0 when unknown.
+    stopping_ = false;
+    for (size_t i = 0; i < nrOfWorkers; i++)
+    {
+        workers_.emplace_back(&AsyncLoader::WorkerLoop, this);
+    }
+}
+
+void gl::AsyncLoader::WorkerLoop()
+{
+    const ParallelScope scope; // Every hardware thread has a worker, decoding doesn't start more.
+    while (true)
+    {
+        std::coroutine_handle<> handle;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wakeWorkers_.wait(lock, [this]() { return stopping_ || !workerQueue_.empty(); });
+            if (stopping_) return;
+            handle = workerQueue_.front();
+            workerQueue_.pop_front();
+        }
+        handle.resume(); // Runs until the load awaits the gl thread or finishes.
+    }
+}
+
+void gl::AsyncLoader::DrainGlQueue(float budgetMilliseconds)
+{
+    EngineGlScope("AsyncLoader::DrainGlQueue");
+    const auto start = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<float, std::milli> elapsed(0.0f);
+    bool first = true;
+    while (first || elapsed.count() < budgetMilliseconds)
+    {
+        std::coroutine_handle<> handle;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (glQueue_.empty()) break;
+            handle = glQueue_.front();
+            glQueue_.pop_front();
+        }
+        handle.resume(); // Creates and uploads, or moves on to a worker for the next step.
+        glWorkDone_++;
+        first = false;
+        elapsed = std::chrono::high_resolution_clock::now() - start;
+    }
+    lastDrainMilliseconds_ = elapsed.count();
+}
+
+void gl::AsyncLoader::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeWorkers_.notify_all();
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+    workers_.clear();
+
+    // Suspended loads never resume, destroying them releases what they hold.
+    for (auto handle : workerQueue_)
+    {
+        handle.destroy();
+    }
+    workerQueue_.clear();
+    for (auto handle : glQueue_)
+    {
+        handle.destroy();
+    }
+    glQueue_.clear();
+}
+
+gl::AsyncLoader::Stats gl::AsyncLoader::GetStats()
+{
+    Stats stats;
+    stats.inFlight = inFlight_;
+    stats.glWorkDone = glWorkDone_;
+    stats.lastDrainMilliseconds = lastDrainMilliseconds_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.queuedGlWork = glQueue_.size();
+    return stats;
+}
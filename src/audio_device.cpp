@@ -4,13 +4,16 @@
 
 #include <SDL2/SDL.h>
 
+#include "file_system.h"
+
 void gl::Clip::Load(const char* path)
 {
+    const FileSystem::File file = FileSystem::Get().Read(path);
     SDL_AudioSpec desiredSpecs;
     unsigned int length;
     SDL_AudioSpec* recievedSpecs = SDL_LoadWAV_RW
     (
-        SDL_RWFromFile(path, "rb"),
+        SDL_RWFromConstMem(file.GetData(), (int)file.GetSize()),
         1,
         &desiredSpecs,
         &data,
@@ -22,6 +25,27 @@ void gl::Clip::Load(const char* path)
         EngineError("Could not read WAV file!");
     }
 }
+void gl::Clip::LoadAsync(const char* path)
+{
+    Decode(path);
+}
+gl::AsyncLoader::Task gl::Clip::Decode(std::string path)
+{
+    co_await AsyncLoader::Get().ToWorker();
+    const FileSystem::File file = FileSystem::Get().Read(path);
+    SDL_AudioSpec desiredSpecs;
+    unsigned char* decoded = nullptr;
+    unsigned int length = 0;
+    const SDL_AudioSpec* recievedSpecs = SDL_LoadWAV_RW(SDL_RWFromConstMem(file.GetData(), (int)file.GetSize()), 1, &desiredSpecs, &decoded, &length);
+
+    co_await AsyncLoader::Get().ToGlThread(); // The main thread, where clips are played from.
+    if (recievedSpecs == nullptr)
+    {
+        EngineError("Could not read WAV file!");
+    }
+    data = decoded;
+    len = length;
+}
 void gl::Clip::Destroy()
 {
     SDL_FreeWAV(data);
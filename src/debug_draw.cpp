@@ -0,0 +1,268 @@
+#include "debug_draw.h"
+
+#if GL_DEBUG_DRAW_ENABLED
+#include <cstddef>
+
+#include <glad/glad.h>
+
+void gl::DebugDraw::Create(Definition def)
+{
+    if (VAO_ != 0)
+    {
+        EngineError("Calling Create() a second time...");
+    }
+
+    assert(def.maxVertices > 0);
+    maxVertices_ = def.maxVertices;
+
+    Shader::Definition sdef;
+    sdef.vertexPath = def.vertexPath;
+    sdef.fragmentPath = def.fragmentPath;
+    shader_.Create(sdef);
+
+    glGenVertexArrays(1, &VAO_);
+    glBindVertexArray(VAO_);
+    glGenBuffers(1, &VBO_);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+    glBufferData(GL_ARRAY_BUFFER, maxVertices_ * sizeof(Vertex), nullptr, GL_STREAM_DRAW);
+    CheckGlError();
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    CheckGlError();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    CheckGlError();
+}
+
+void gl::DebugDraw::Destroy()
+{
+    glDeleteBuffers(1, &VBO_);
+    glDeleteVertexArrays(1, &VAO_);
+    VBO_ = 0;
+    VAO_ = 0;
+    for (auto& primitive : batches_)
+    {
+        for (auto& batch : primitive)
+        {
+            batch.clear();
+        }
+    }
+    CheckGlError();
+}
+
+void gl::DebugDraw::Push(const Primitive primitive, const bool depthTest, const glm::vec3 a, const glm::vec3 color)
+{
+    batches_[primitive][depthTest ? DEPTH_TESTED : ALWAYS_VISIBLE].push_back({ a, color });
+}
+
+void gl::DebugDraw::Push(const Primitive primitive, const bool depthTest, const glm::vec3 a, const glm::vec3 b, const glm::vec3 color)
+{
+    auto& batch = batches_[primitive][depthTest ? DEPTH_TESTED : ALWAYS_VISIBLE];
+    batch.push_back({ a, color });
+    batch.push_back({ b, color });
+}
+
+void gl::DebugDraw::Point(const glm::vec3 pos, const glm::vec3 color, const bool depthTest)
+{
+    Push(POINTS, depthTest, pos, color);
+}
+
+void gl::DebugDraw::Line(const glm::vec3 from, const glm::vec3 to, const glm::vec3 color, const bool depthTest)
+{
+    Push(LINES, depthTest, from, to, color);
+}
+
+void gl::DebugDraw::Arrow(const glm::vec3 from, const glm::vec3 to, const glm::vec3 color, const bool depthTest)
+{
+    const glm::vec3 vec = to - from;
+    const float len = glm::length(vec);
+    if (len <= 0.0f) return;
+
+    const glm::vec3 dir = vec / len;
+    // Any vector perpendicular to dir will do for the head, avoid crossing with a parallel vector.
+    const glm::vec3 reference = glm::abs(glm::dot(dir, UP_VEC3)) > 0.99f ? RIGHT_VEC3 : UP_VEC3;
+    const glm::vec3 side = glm::normalize(glm::cross(dir, reference)) * len * 0.2f;
+    const glm::vec3 up = glm::normalize(glm::cross(side, dir)) * len * 0.2f;
+    const glm::vec3 headBase = from + vec * 0.8f;
+
+    Push(LINES, depthTest, from, to, color);
+    Push(LINES, depthTest, to, headBase + side, color);
+    Push(LINES, depthTest, to, headBase - side, color);
+    Push(LINES, depthTest, to, headBase + up, color);
+    Push(LINES, depthTest, to, headBase - up, color);
+}
+
+void gl::DebugDraw::Box(const glm::vec3 center, const glm::vec3 halfExtents, const glm::vec3 color, const bool depthTest)
+{
+    glm::mat4 model = glm::translate(IDENTITY_MAT4, center);
+    model = glm::scale(model, halfExtents);
+    Box(model, color, depthTest);
+}
+
+void gl::DebugDraw::Box(const glm::mat4& model, const glm::vec3 color, const bool depthTest)
+{
+    std::array<glm::vec3, 8> corners;
+    for (size_t i = 0; i < 8; i++)
+    {
+        const glm::vec4 corner =
+        {
+            (i & 1) ? 1.0f : -1.0f,
+            (i & 2) ? 1.0f : -1.0f,
+            (i & 4) ? 1.0f : -1.0f,
+            1.0f
+        };
+        corners[i] = model * corner;
+    }
+
+    // Corners differing by a single bit of their index share an edge.
+    for (size_t i = 0; i < 8; i++)
+    {
+        for (size_t bit = 1; bit < 8; bit <<= 1)
+        {
+            if (!(i & bit))
+            {
+                Push(LINES, depthTest, corners[i], corners[i | bit], color);
+            }
+        }
+    }
+}
+
+void gl::DebugDraw::Sphere(const glm::vec3 center, const float radius, const glm::vec3 color, const bool depthTest, const size_t segments)
+{
+    assert(segments > 2);
+
+    // Approximate the sphere with it's 3 great circles aligned on the world axes.
+    const float increment = 2.0f * PI / (float)segments;
+    for (size_t i = 0; i < segments; i++)
+    {
+        const float a0 = increment * (float)i;
+        const float a1 = increment * (float)((i + 1) % segments); // Wrap around exactly to close the circle.
+        const glm::vec2 p0 = glm::vec2(glm::cos(a0), glm::sin(a0)) * radius;
+        const glm::vec2 p1 = glm::vec2(glm::cos(a1), glm::sin(a1)) * radius;
+
+        Push(LINES, depthTest, center + glm::vec3(p0.x, p0.y, 0.0f), center + glm::vec3(p1.x, p1.y, 0.0f), color);
+        Push(LINES, depthTest, center + glm::vec3(p0.x, 0.0f, p0.y), center + glm::vec3(p1.x, 0.0f, p1.y), color);
+        Push(LINES, depthTest, center + glm::vec3(0.0f, p0.x, p0.y), center + glm::vec3(0.0f, p1.x, p1.y), color);
+    }
+}
+
+void gl::DebugDraw::Point2D(const glm::vec2 pos, const glm::vec3 color)
+{
+    Push(POINTS, false, ToVec3(pos), color);
+}
+
+void gl::DebugDraw::Line2D(const glm::vec2 from, const glm::vec2 to, const glm::vec3 color)
+{
+    Push(LINES, false, ToVec3(from), ToVec3(to), color);
+}
+
+void gl::DebugDraw::Arrow2D(const glm::vec2 from, const glm::vec2 to, const glm::vec3 color)
+{
+    const glm::vec2 vec = to - from;
+    if (vec == ZERO_VEC2) return;
+
+    const glm::vec2 side = glm::vec2(-vec.y, vec.x) * 0.2f; // Perpendicular to vec, same length ratio as the old DrawableVector's head.
+    const glm::vec2 headBase = from + vec * 0.8f;
+
+    Line2D(from, to, color);
+    Line2D(to, headBase + side, color);
+    Line2D(to, headBase - side, color);
+}
+
+void gl::DebugDraw::Rectangle2D(const glm::vec2 bottomLeft, const glm::vec2 topRight, const glm::vec3 color)
+{
+    const glm::vec2 topLeft = glm::vec2(bottomLeft.x, topRight.y);
+    const glm::vec2 bottomRight = glm::vec2(topRight.x, bottomLeft.y);
+    Line2D(bottomLeft, bottomRight, color);
+    Line2D(bottomRight, topRight, color);
+    Line2D(topRight, topLeft, color);
+    Line2D(topLeft, bottomLeft, color);
+}
+
+void gl::DebugDraw::Circle2D(const glm::vec2 center, const float radius, const glm::vec3 color, const size_t segments)
+{
+    assert(segments > 2);
+
+    const float increment = 2.0f * PI / (float)segments;
+    for (size_t i = 0; i < segments; i++)
+    {
+        const float a0 = increment * (float)i;
+        const float a1 = increment * (float)((i + 1) % segments); // Wrap around exactly to close the circle.
+        Line2D(center + glm::vec2(glm::cos(a0), glm::sin(a0)) * radius, center + glm::vec2(glm::cos(a1), glm::sin(a1)) * radius, color);
+    }
+}
+
+void gl::DebugDraw::Flush()
+{
+    assert(VAO_ != 0);
+
+    // Clamp every batch so that they all fit in the streaming buffer.
+    size_t totalVertices = 0;
+    for (size_t primitive = 0; primitive < NR_OF_PRIMITIVES; primitive++)
+    {
+        for (auto& batch : batches_[primitive])
+        {
+            const size_t available = maxVertices_ - totalVertices;
+            if (batch.size() > available)
+            {
+                if (!overflowReported_)
+                {
+                    EngineWarning("Too many debug primitives submitted this frame, some of them won't be drawn.");
+                    overflowReported_ = true;
+                }
+                batch.resize(primitive == LINES ? available & ~(size_t)1 : available); // Don't cut a line in half.
+            }
+            totalVertices += batch.size();
+        }
+    }
+    if (totalVertices == 0) return;
+
+    // Orphan the previous frame's storage so the driver doesn't have to wait for it to be consumed, then append every batch.
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+    glBufferData(GL_ARRAY_BUFFER, maxVertices_ * sizeof(Vertex), nullptr, GL_STREAM_DRAW);
+    std::array<std::array<size_t, NR_OF_DEPTH_MODES>, NR_OF_PRIMITIVES> firsts = {};
+    size_t offset = 0;
+    for (size_t primitive = 0; primitive < NR_OF_PRIMITIVES; primitive++)
+    {
+        for (size_t depthMode = 0; depthMode < NR_OF_DEPTH_MODES; depthMode++)
+        {
+            const auto& batch = batches_[primitive][depthMode];
+            firsts[primitive][depthMode] = offset;
+            if (!batch.empty())
+            {
+                glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(Vertex), batch.size() * sizeof(Vertex), batch.data());
+            }
+            offset += batch.size();
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    CheckGlError();
+
+    const bool depthTestWasEnabled = glIsEnabled(GL_DEPTH_TEST);
+    shader_.Bind();
+    glBindVertexArray(VAO_);
+    for (size_t primitive = 0; primitive < NR_OF_PRIMITIVES; primitive++)
+    {
+        for (size_t depthMode = 0; depthMode < NR_OF_DEPTH_MODES; depthMode++)
+        {
+            auto& batch = batches_[primitive][depthMode];
+            if (batch.empty()) continue;
+
+            if (depthMode == DEPTH_TESTED) glEnable(GL_DEPTH_TEST);
+            else glDisable(GL_DEPTH_TEST);
+
+            glDrawArrays(primitive == POINTS ? GL_POINTS : GL_LINES, (GLint)firsts[primitive][depthMode], (GLsizei)batch.size());
+            CheckGlError();
+            batch.clear(); // Keeps the capacity, no reallocations next frame.
+        }
+    }
+    glBindVertexArray(0);
+    shader_.Unbind();
+
+    if (depthTestWasEnabled) glEnable(GL_DEPTH_TEST);
+    else glDisable(GL_DEPTH_TEST);
+    CheckGlError();
+}
+#endif // GL_DEBUG_DRAW_ENABLED
@@ -1,4 +1,5 @@
 #include <engine.h>
+#include <algorithm>
 #include <iostream>
 #include <glad/glad.h>
 
@@ -6,6 +7,16 @@
 #include "imgui_impl_opengl3.h"
 #include "imgui_impl_sdl.h"
 
+#include "async_loader.h"
+#include "file_system.h"
+#include "resource_manager.h"
+#include "program_cache.h"
+#include "shader.h"
+#include "texture_streamer.h"
+#include "uniform_buffers.h"
+#include "upload_stream.h"
+#include "file_watcher.h"
+
 namespace gl {
 
 Engine::Engine(Program& program) : program_(program)
@@ -16,9 +27,13 @@ void Engine::Init()
 {
 	SDL_Init(SDL_INIT_VIDEO);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 4);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, OPENGL_MAJOR_VERSION);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, OPENGL_MINOR_VERSION);
+#if GL_ERROR_CHECKS_ENABLED
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG | SDL_GL_CONTEXT_DEBUG_FLAG);
+#else
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
+#endif // GL_ERROR_CHECKS_ENABLED
 	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
 
 
@@ -47,6 +62,12 @@ void Engine::Init()
 		return;
 	}
 	glRenderContext_ = SDL_GL_CreateContext(window_);
+	if (glRenderContext_ == nullptr) // No 4.5 driver, resources will be created without direct state access.
+	{
+		std::cerr << "[Warning] Unable to create a " << OPENGL_MAJOR_VERSION << "." << OPENGL_MINOR_VERSION << " context, falling back to " << OPENGL_MAJOR_VERSION << "." << OPENGL_FALLBACK_MINOR_VERSION << "\n";
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, OPENGL_FALLBACK_MINOR_VERSION);
+		glRenderContext_ = SDL_GL_CreateContext(window_);
+	}
 	SDL_GL_MakeCurrent(window_, glRenderContext_);
 	SDL_GL_SetSwapInterval(1);
 
@@ -55,6 +76,13 @@ void Engine::Init()
 		std::cerr << "Failed to initialize OpenGL context\n";
 		assert(false);
 	}
+#if GL_ERROR_CHECKS_ENABLED
+	if (!EnableDebugOutput())
+	{
+		std::cerr << "[Warning] No debug context, gl errors will be polled with glGetError\n";
+	}
+#endif // GL_ERROR_CHECKS_ENABLED
+	UniformBuffers::Get().Create();
 
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -70,7 +98,15 @@ void Engine::Init()
 	ImGui_ImplSDL2_InitForOpenGL(window_, glRenderContext_);
 	ImGui_ImplOpenGL3_Init("#version 440 core");
 
-	program_.Init();
+	{
+		EngineGlScope("Program::Init");
+		program_.Init();
+	}
+
+	// Compare launches with an empty and a filled program cache to get the cold and warm setup times.
+	const auto& programStats = ResourceManager::Get().GetCreationStats(ResourceManager::Resource::PROGRAM);
+	const auto& cacheStats = ProgramCache::Get().GetStats();
+	std::cout << "[Message] Shader setup: " << programStats.count << " programs in " << programStats.milliseconds << " ms (" << cacheStats.hits << " from the program cache, " << cacheStats.misses << " compiled)\n";
 }
 
 void Engine::Run()
@@ -113,8 +149,20 @@ void Engine::Run()
 			ImGui::NewFrame();
 			DrawImGui();
 			ImGui::Render();
-			program_.Update(dt);
+			{
+				EngineGlScope("Program::Update");
+				FileWatcher::Get().Poll();
+				AsyncLoader::Get().DrainGlQueue(ASYNC_UPLOAD_BUDGET_MILLISECONDS);
+				Shader::PollPrewarmed();
+				program_.Update(dt);
+				TextureStreamer::Get().Update(TEXTURE_STREAMING_BUDGET_BYTES); // After the draws requested their levels, the loads it starts stage through the UploadStream.
+				UploadStream::Get().Update(UPLOAD_BUDGET_BYTES); // Same frame as what the update staged.
+				ResourceManager::Get().EvictOverBudget(); // After the update, resources released this frame and recreated right away are reused rather than evicted.
+			}
 			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+			// Cpu time spent on the frame, without the wait for vsync in SwapWindow. Smoothed to be readable.
+			const std::chrono::duration<float, std::milli> cpuFrameTime = std::chrono::system_clock::now() - start;
+			cpuFrameMilliseconds_ += (cpuFrameTime.count() - cpuFrameMilliseconds_) * 0.05f;
 			SDL_GL_SwapWindow(window_);
 		}
 
@@ -127,7 +175,11 @@ void Engine::Run()
 }
 void Engine::Destroy()
 {
+	AsyncLoader::Get().Shutdown(); // Loads still in flight would land in a destroyed program.
+	UploadStream::Get().Shutdown();
+	TextureStreamer::Get().Shutdown();
 	program_.Destroy();
+	UniformBuffers::Get().Destroy();
 	ImGui_ImplOpenGL3_Shutdown();
 	// Delete our OpengL context
 	SDL_GL_DeleteContext(glRenderContext_);
@@ -142,6 +194,127 @@ void Engine::DrawImGui()
 {
 	ImGui::Begin("Engine");
 	ImGui::Text("FPS: %f", 1.0f / deltaTime_);
+#if GL_ERROR_CHECKS_ENABLED
+	ImGui::Text("CPU frame: %.3f ms (gl error checks on)", cpuFrameMilliseconds_);
+#else
+	ImGui::Text("CPU frame: %.3f ms (gl error checks compiled out)", cpuFrameMilliseconds_);
+#endif // GL_ERROR_CHECKS_ENABLED
+	if (ImGui::CollapsingHeader("Resource creation"))
+	{
+		ImGui::Text("Direct state access: %s", HasDirectStateAccess() ? "on" : "off");
+		constexpr const char* RESOURCE_NAMES[(size_t)ResourceManager::Resource::NR_OF_RESOURCES] = { "Vertex buffers", "Textures", "Framebuffers", "Programs" };
+		for (size_t resource = 0; resource < (size_t)ResourceManager::Resource::NR_OF_RESOURCES; resource++)
+		{
+			const auto& stats = ResourceManager::Get().GetCreationStats((ResourceManager::Resource)resource);
+			ImGui::Text(
+				"%s: %zu in %.3f ms (%.1f per second)",
+				RESOURCE_NAMES[resource],
+				stats.count,
+				stats.milliseconds,
+				stats.milliseconds > 0.0f ? (float)stats.count * 1000.0f / stats.milliseconds : 0.0f);
+		}
+		const auto& cacheStats = ProgramCache::Get().GetStats();
+		ImGui::Text("Program cache: %zu hits, %zu misses (%zu rejected by the driver)", cacheStats.hits, cacheStats.misses, cacheStats.rejected);
+		if (ImGui::Button("Reset"))
+		{
+			ResourceManager::Get().ResetCreationStats();
+		}
+	}
+	if (ImGui::CollapsingHeader("Async loading"))
+	{
+		const auto stats = AsyncLoader::Get().GetStats();
+		ImGui::Text("In flight: %zu (%zu waiting for the gl thread)", stats.inFlight, stats.queuedGlWork);
+		ImGui::Text("Gl work done: %zu", stats.glWorkDone);
+		ImGui::Text("Last drain: %.3f ms (budget %.1f ms)", stats.lastDrainMilliseconds, ASYNC_UPLOAD_BUDGET_MILLISECONDS);
+	}
+	if (ImGui::CollapsingHeader("Texture streaming"))
+	{
+		constexpr const float MEGABYTE = 1024.0f * 1024.0f;
+		const auto stats = UploadStream::Get().GetStats();
+		if (stats.ringBytes > 0)
+		{
+			ImGui::Text("Ring: %.1f / %.1f MB in use", (float)stats.ringBytesInUse / MEGABYTE, (float)stats.ringBytes / MEGABYTE);
+		}
+		else
+		{
+			ImGui::Text("Ring: no persistent mapping, uploading from client memory");
+		}
+		ImGui::Text("Staged: %zu, waiting for room: %zu (%zu frames)", stats.staged, stats.pending, stats.ringFullFrames);
+		ImGui::Text("Uploads: %zu (%zu from client memory)", stats.uploads, stats.directUploads);
+		ImGui::Text("Last frame: %.2f MB (budget %.1f MB)", (float)stats.lastFrameBytes / MEGABYTE, (float)UPLOAD_BUDGET_BYTES / MEGABYTE);
+		const auto mips = TextureStreamer::Get().GetStats();
+		ImGui::Separator();
+		ImGui::Text("Streamed textures: %zu, loads in flight: %zu", mips.textures, mips.loadsInFlight);
+		ImGui::Text("Resident: %.1f MB, wanted: %.1f MB, granted: %.1f MB (budget %.1f MB)", (float)mips.residentBytes / MEGABYTE, (float)mips.wantedBytes / MEGABYTE, (float)mips.grantedBytes / MEGABYTE, (float)TEXTURE_STREAMING_BUDGET_BYTES / MEGABYTE);
+		ImGui::Text("Levels streamed in: %zu, released: %zu", mips.levelsStreamedIn, mips.levelsReleased);
+	}
+	if (ImGui::CollapsingHeader("File system"))
+	{
+		constexpr const size_t NR_OF_FILES_SHOWN = 10;
+		constexpr const char* SOURCE_NAMES[] = { "directory", "archive", "memory", "native" };
+		const auto stats = FileSystem::Get().GetFileStats();
+		float total = 0.0f;
+		for (const auto& file : stats)
+		{
+			total += file.second.milliseconds;
+		}
+		ImGui::Text("Files read: %zu, %.3f ms", stats.size(), total);
+		for (size_t i = 0; i < std::min(stats.size(), NR_OF_FILES_SHOWN); i++)
+		{
+			const auto& file = stats[i].second;
+			ImGui::Text("%.3f ms %zux %.1f KB (%s) %s", file.milliseconds, file.reads, (float)file.bytes / 1024.0f, SOURCE_NAMES[(size_t)file.source], stats[i].first.c_str());
+		}
+		if (ImGui::Button("Reset##files"))
+		{
+			FileSystem::Get().ResetFileStats();
+		}
+	}
+	if (ImGui::CollapsingHeader("Gpu memory"))
+	{
+		constexpr const float MEGABYTE = 1024.0f * 1024.0f;
+		constexpr const char* RESOURCE_NAMES[(size_t)ResourceManager::Resource::NR_OF_RESOURCES] = { "Vertex buffers", "Textures", "Framebuffers", "Programs" };
+		ImGui::Text("Tracked: %.1f MB, budget %.1f MB", (float)ResourceManager::Get().GetTrackedBytes() / MEGABYTE, (float)ResourceManager::Get().GetMemoryBudget() / MEGABYTE);
+		for (size_t resource = 0; resource < (size_t)ResourceManager::Resource::NR_OF_RESOURCES; resource++)
+		{
+			const auto& stats = ResourceManager::Get().GetMemoryStats((ResourceManager::Resource)resource);
+			ImGui::Text(
+				"%s: %zu, %.2f MB (%.2f MB unreferenced), %zu evicted",
+				RESOURCE_NAMES[resource],
+				stats.count,
+				(float)stats.bytes / MEGABYTE,
+				(float)stats.unreferencedBytes / MEGABYTE,
+				stats.evictions);
+		}
+		int budget = (int)(ResourceManager::Get().GetMemoryBudget() / (1024 * 1024));
+		if (ImGui::SliderInt("Budget (MB)", &budget, 0, 4096))
+		{
+			ResourceManager::Get().SetMemoryBudget((size_t)budget * 1024 * 1024);
+		}
+	}
+	if (ImGui::CollapsingHeader("Dynamic uniforms"))
+	{
+		const auto& stats = Shader::GetUniformUploadStats();
+		const size_t total = stats.uploaded + stats.skipped;
+		ImGui::Text("Uploaded: %zu", stats.uploaded);
+		ImGui::Text("Skipped: %zu (%.1f%%)", stats.skipped, total > 0 ? (float)stats.skipped * 100.0f / (float)total : 0.0f);
+		if (ImGui::Button("Reset##uniforms"))
+		{
+			Shader::ResetUniformUploadStats();
+		}
+	}
+	if (ImGui::CollapsingHeader("Hot reload"))
+	{
+		if (FileWatcher::Get().IsSupported())
+		{
+			const auto& stats = FileWatcher::Get().GetStats();
+			ImGui::Text("Reloaded files: %zu", stats.nrOfReloads);
+			ImGui::Text("Last reload: %.3f ms", stats.lastReloadMilliseconds);
+		}
+		else
+		{
+			ImGui::Text("Not supported on this platform.");
+		}
+	}
 	ImGui::End();
 	program_.DrawImGui();
 }
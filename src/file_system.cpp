@@ -0,0 +1,272 @@
+#include "file_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "asset_pack.h"
+#include "defines.h"
+
+namespace
+{
+    std::string Normalize(std::string_view path)
+    {
+        std::string normalized = std::filesystem::path(path).lexically_normal().generic_string();
+        while (!normalized.empty() && normalized.back() == '/') normalized.pop_back();
+        return normalized == "." ? "" : normalized;
+    }
+
+    // Read only mapping of a whole file, unmapped with its last reference.
+    struct MappedFile
+    {
+        const char* data = nullptr;
+        size_t size = 0;
+#if defined(_WIN32)
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE fileMapping = nullptr;
+        ~MappedFile()
+        {
+            if (data != nullptr) UnmapViewOfFile(data);
+            if (fileMapping != nullptr) CloseHandle(fileMapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        }
+#else
+        ~MappedFile()
+        {
+            if (data != nullptr) munmap(const_cast<char*>(data), size);
+        }
+#endif
+    };
+
+    // Returns nullptr when the file can't be opened. Empty files exist but aren't mapped.
+    std::shared_ptr<MappedFile> MapFile(const std::string& path)
+    {
+        auto mapped = std::make_shared<MappedFile>();
+#if defined(_WIN32)
+        mapped->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (mapped->file == INVALID_HANDLE_VALUE) return nullptr;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(mapped->file, &size)) return nullptr;
+        mapped->size = (size_t)size.QuadPart;
+        if (mapped->size == 0) return mapped;
+        mapped->fileMapping = CreateFileMappingA(mapped->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapped->fileMapping == nullptr) return nullptr;
+        mapped->data = static_cast<const char*>(MapViewOfFile(mapped->fileMapping, FILE_MAP_READ, 0, 0, 0));
+        if (mapped->data == nullptr) return nullptr;
+#else
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+        struct stat status;
+        if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode))
+        {
+            close(fd);
+            return nullptr;
+        }
+        mapped->size = (size_t)status.st_size;
+        if (mapped->size > 0)
+        {
+            void* data = mmap(nullptr, mapped->size, PROT_READ, MAP_PRIVATE, fd, 0);
+            mapped->data = data == MAP_FAILED ? nullptr : static_cast<const char*>(data);
+        }
+        close(fd); // The mapping keeps the file alive.
+        if (mapped->size > 0 && mapped->data == nullptr) return nullptr;
+#endif
+        return mapped;
+    }
+}//!anonymous
+
+void gl::FileSystem::MountDirectory(std::string_view mountPoint, std::string_view directory)
+{
+    Mount mount;
+    mount.mountPoint = Normalize(mountPoint);
+    mount.source = Source::DIRECTORY;
+    mount.directory = std::string(directory);
+    std::lock_guard<std::mutex> lock(mutex_);
+    mounts_.push_back(std::make_shared<const Mount>(std::move(mount)));
+}
+
+bool gl::FileSystem::MountArchive(std::string_view mountPoint, const std::string& packPath)
+{
+    auto pack = std::make_shared<AssetPack>();
+    if (!pack->Open(packPath))
+    {
+        EngineWarning(("Could not mount " + packPath + ".").c_str());
+        return false;
+    }
+    Mount mount;
+    mount.mountPoint = Normalize(mountPoint);
+    mount.source = Source::ARCHIVE;
+    mount.pack = std::move(pack);
+    std::lock_guard<std::mutex> lock(mutex_);
+    mounts_.push_back(std::make_shared<const Mount>(std::move(mount)));
+    return true;
+}
+
+void gl::FileSystem::MountMemory(std::string_view mountPoint, std::vector<std::pair<std::string, std::span<const char>>> files)
+{
+    Mount mount;
+    mount.mountPoint = Normalize(mountPoint);
+    mount.source = Source::MEMORY;
+    for (auto& file : files)
+    {
+        mount.files.insert({ Normalize(file.first), file.second });
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    mounts_.push_back(std::make_shared<const Mount>(std::move(mount)));
+}
+
+void gl::FileSystem::UnmountAll()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    mounts_.clear(); // Files read from archives keep their pack mapped until they're destroyed.
+}
+
+gl::FileSystem::Mounts gl::FileSystem::GetMounts()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mounts_;
+}
+
+const gl::FileSystem::Mount* gl::FileSystem::Resolve(const Mounts& mounts, const std::string& path, std::string& relativePath)
+{
+    for (auto it = mounts.rbegin(); it != mounts.rend(); it++)
+    {
+        const Mount* mount = it->get();
+        const std::string& point = mount->mountPoint;
+        if (!point.empty() && (path.compare(0, point.size(), point) != 0 || (path.size() > point.size() && path[point.size()] != '/')))
+        {
+            continue;
+        }
+        const std::string relative = path.size() > point.size() ? path.substr(point.empty() ? 0 : point.size() + 1) : "";
+
+        // Mounts overlay each other, a file missing from this one may be in an older one.
+        bool found = false;
+        switch (mount->source)
+        {
+            case Source::DIRECTORY:
+                found = std::filesystem::is_regular_file(std::filesystem::path(mount->directory) / relative);
+                break;
+            case Source::ARCHIVE:
+                found = mount->pack->Find(relative) != nullptr;
+                break;
+            case Source::MEMORY:
+                found = mount->files.find(relative) != mount->files.end();
+                break;
+            default:
+                break;
+        }
+        if (found)
+        {
+            relativePath = relative;
+            return mount;
+        }
+    }
+    return nullptr;
+}
+
+gl::FileSystem::File gl::FileSystem::Read(std::string_view path)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+    const std::string normalized = Normalize(path);
+
+    File file;
+    Source source = Source::NATIVE;
+    std::string nativePath = std::string(path);
+    const Mounts mounts = GetMounts(); // Workers decompress and touch the disk in parallel, only the copy is locked.
+    std::string relative;
+    const Mount* mount = Resolve(mounts, normalized, relative);
+    if (mount != nullptr)
+    {
+        source = mount->source;
+        switch (mount->source)
+        {
+            case Source::DIRECTORY:
+                nativePath = (std::filesystem::path(mount->directory) / relative).string();
+                break;
+            case Source::ARCHIVE:
+            {
+                const AssetPack::Entry& entry = *mount->pack->Find(relative);
+                if (entry.compression == AssetPack::Compression::NONE)
+                {
+                    file.data_ = mount->pack->View(entry);
+                    file.owner_ = mount->pack;
+                }
+                else
+                {
+                    auto decompressed = std::make_shared<std::vector<char>>();
+                    if (!mount->pack->Read(entry, *decompressed)) EngineError("Corrupted asset pack entry!");
+                    file.data_ = std::span<const char>(decompressed->data(), decompressed->size());
+                    file.owner_ = std::move(decompressed);
+                }
+                file.exists_ = true;
+                break;
+            }
+            case Source::MEMORY:
+                file.data_ = mount->files.at(relative);
+                file.exists_ = true;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (source == Source::DIRECTORY || source == Source::NATIVE)
+    {
+        auto mapped = MapFile(nativePath);
+        if (mapped != nullptr)
+        {
+            file.data_ = std::span<const char>(mapped->data, mapped->size);
+            file.owner_ = std::move(mapped);
+            file.exists_ = true;
+        }
+    }
+
+    const std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    if (file.exists_)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FileStats& stats = fileStats_[normalized];
+        stats.source = source;
+        stats.reads++;
+        stats.bytes += file.GetSize();
+        stats.milliseconds += elapsed.count();
+    }
+    return file;
+}
+
+std::string gl::FileSystem::GetNativePath(std::string_view path)
+{
+    const Mounts mounts = GetMounts();
+    std::string relative;
+    const Mount* mount = Resolve(mounts, Normalize(path), relative);
+    if (mount == nullptr) return std::string(path);
+    if (mount->source == Source::DIRECTORY) return (std::filesystem::path(mount->directory) / relative).string();
+    return "";
+}
+
+std::vector<std::pair<std::string, gl::FileSystem::FileStats>> gl::FileSystem::GetFileStats()
+{
+    std::vector<std::pair<std::string, FileStats>> stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.assign(fileStats_.begin(), fileStats_.end());
+    }
+    std::sort(stats.begin(), stats.end(), [](const auto& a, const auto& b) { return a.second.milliseconds > b.second.milliseconds; });
+    return stats;
+}
+
+void gl::FileSystem::ResetFileStats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    fileStats_.clear();
+}
@@ -0,0 +1,126 @@
+#include "file_watcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "defines.h"
+#include "file_system.h"
+
+namespace
+{
+    std::string Canonical(const std::string& path)
+    {
+        std::error_code error;
+        const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+        return error ? std::filesystem::absolute(path).lexically_normal().string() : canonical.string();
+    }
+}//!anonymous
+
+gl::FileWatcher::~FileWatcher()
+{
+#if defined(__linux__)
+    if (fd_ >= 0) close(fd_);
+#endif
+}
+
+bool gl::FileWatcher::IsSupported()
+{
+    if (fd_ == -2)
+    {
+#if defined(__linux__)
+        fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd_ < 0)
+        {
+            fd_ = -1;
+            EngineWarning("Could not initialize inotify, hot reloading is disabled.");
+        }
+#else
+        fd_ = -1;
+#endif
+    }
+    return fd_ >= 0;
+}
+
+void gl::FileWatcher::Watch(const std::string& path, Callback onChange)
+{
+    assert(!path.empty() && onChange != nullptr);
+    if (!IsSupported()) return;
+    const std::string native = FileSystem::Get().GetNativePath(path);
+    if (native.empty()) return; // Served from an archive or from memory, nothing on the disk to watch.
+
+    const std::string file = Canonical(native);
+    auto match = files_.find(file);
+    if (match == files_.end())
+    {
+#if defined(__linux__)
+        const std::string directory = std::filesystem::path(file).parent_path().string();
+        // Adding a directory twice returns the same descriptor.
+        const int wd = inotify_add_watch(fd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0)
+        {
+            EngineWarning(("Could not watch " + directory + ", its files won't be hot reloaded.").c_str());
+            return;
+        }
+        directories_[wd] = directory;
+#endif
+        match = files_.insert({ file, {} }).first;
+    }
+    match->second.push_back({ path, std::move(onChange) });
+}
+
+void gl::FileWatcher::Poll()
+{
+    if (fd_ < 0) return;
+
+    std::vector<std::string> changed; // Canonical paths, a save often raises several events for the same file.
+#if defined(__linux__)
+    alignas(inotify_event) char buffer[4096];
+    while (true)
+    {
+        const ssize_t length = read(fd_, buffer, sizeof(buffer));
+        if (length <= 0) break; // EAGAIN once every pending event has been read.
+
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+            if (event->len == 0) continue;
+
+            const auto directory = directories_.find(event->wd);
+            if (directory == directories_.end()) continue;
+            const std::string file = directory->second + '/' + event->name;
+            if (files_.find(file) != files_.end() && std::find(changed.begin(), changed.end(), file) == changed.end())
+            {
+                changed.push_back(file);
+            }
+        }
+    }
+#endif
+    if (changed.empty()) return;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& file : changed)
+    {
+        // Copied, callbacks are free to watch more files.
+        const std::vector<Watcher> watchers = files_.at(file);
+        EngineMessage("[Message] Reloading " + file);
+        for (const auto& watcher : watchers)
+        {
+            watcher.onChange(watcher.path);
+        }
+        stats_.nrOfReloads++;
+    }
+    const std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    stats_.lastReloadMilliseconds = elapsed.count();
+}
+
+const gl::FileWatcher::Stats& gl::FileWatcher::GetStats() const
+{
+    return stats_;
+}
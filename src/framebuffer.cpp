@@ -1,12 +1,34 @@
 #include "framebuffer.h"
 
+#include <algorithm>
+
 #include <glad/glad.h>
 
 #include "defines.h"
 #include "resource_manager.h"
 
+namespace
+{
+    // Attachments of a framebuffer, accounted to the framebuffer rather than to the textures.
+    size_t AttachmentBytes(const gl::Framebuffer::Definition& def, const size_t nrOfColorAttachments, const bool hasDepthTexture)
+    {
+        const size_t pixels = def.resolution[0] * def.resolution[1];
+        size_t colorPixels = 0; // Whole mip chain, generated by BindGBuffer().
+        for (size_t width = def.resolution[0], height = def.resolution[1];; width = std::max<size_t>(width / 2, 1), height = std::max<size_t>(height / 2, 1))
+        {
+            colorPixels += width * height;
+            if (width == 1 && height == 1) break;
+        }
+        size_t bytes = nrOfColorAttachments * colorPixels * 8; // GL_RGBA16F.
+        if (hasDepthTexture) bytes += pixels * 4; // Depth 24, padded to 32 bits by every driver.
+        if (def.type & gl::Framebuffer::Type::RBO) bytes += pixels * 4; // GL_DEPTH24_STENCIL8.
+        return bytes;
+    }
+}//!anonymous
+
 void gl::Framebuffer::Create(Definition def)
 {
+    EngineGlScope("Framebuffer::Create");
     if (FBO_ != 0)
     {
         EngineWarning("Recreating the Framebuffer!");
@@ -14,89 +36,170 @@ void gl::Framebuffer::Create(Definition def)
 
     defCopy_ = def;
 
-    glGenFramebuffers(1, &FBO_);
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO_);
-    CheckGlError();
+    const ResourceManager::CreationTimer timer(ResourceManager::Resource::FRAMEBUFFER);
 
-    if (def.type & Type::FBO_DEPTH_NO_DRAW)
+    if (HasDirectStateAccess())
     {
-        assert(
-            !(def.type & Type::FBO_RGBA0) && // Don't want to have both a depth attachment AND color attachments because of the glDrawBuffers and glReadBuffer conflicting.
-            !(def.type & Type::FBO_RGBA1) &&
-            !(def.type & Type::FBO_RGBA2) &&
-            !(def.type & Type::FBO_RGBA3) &&
-            !(def.type & Type::FBO_RGBA4)
-        );
-
-        CheckGlError();
-        // TEXs_.push_back({ 0, FRAMEBUFFER_SHADOWMAP_UNIT - FRAMEBUFFER_TEXTURE0_UNIT }); // Shadowmap's texture unit is the last out the ones attributed to framebuffers (15 in this case).
-        glGenTextures(1, &TEXs_.back().first);
-        assert(TEXs_.back().first != 0);
-        glBindTexture(GL_TEXTURE_2D, TEXs_.back().first);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, (GLsizei)def.resolution[0], (GLsizei)def.resolution[1], 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, TEXs_.back().first, 0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        CheckGlError();
-        GLenum drawBuffers = GL_NONE;
-        glDrawBuffers(1, &drawBuffers);
-        glReadBuffer(GL_NONE);
+        // Attachments get immutable storage and the framebuffer is assembled through its name, the current framebuffer binding is left untouched.
+        glCreateFramebuffers(1, &FBO_);
         CheckGlError();
+
+        if (def.type & Type::FBO_DEPTH_NO_DRAW)
+        {
+            assert(
+                !(def.type & Type::FBO_RGBA0) && // Don't want to have both a depth attachment AND color attachments because of the glDrawBuffers and glReadBuffer conflicting.
+                !(def.type & Type::FBO_RGBA1) &&
+                !(def.type & Type::FBO_RGBA2) &&
+                !(def.type & Type::FBO_RGBA3) &&
+                !(def.type & Type::FBO_RGBA4)
+            );
+
+            TEXs_.push_back({ 0, FRAMEBUFFER_SHADOWMAP_UNIT - FRAMEBUFFER_TEXTURE0_UNIT }); // Shadowmap's texture unit is the last one, apart from the ones of the color attachments.
+            glCreateTextures(GL_TEXTURE_2D, 1, &TEXs_.back().first);
+            assert(TEXs_.back().first != 0);
+            const unsigned int TEX = TEXs_.back().first;
+            glTextureStorage2D(TEX, 1, GL_DEPTH_COMPONENT24, (GLsizei)def.resolution[0], (GLsizei)def.resolution[1]);
+            glTextureParameteri(TEX, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTextureParameteri(TEX, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTextureParameteri(TEX, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(TEX, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glNamedFramebufferTexture(FBO_, GL_DEPTH_ATTACHMENT, TEX, 0);
+            glNamedFramebufferDrawBuffer(FBO_, GL_NONE);
+            glNamedFramebufferReadBuffer(FBO_, GL_NONE);
+            CheckGlError();
+        }
+        else
+        {
+            // Color attachments are sampled with mipmaps, allocate the whole chain upfront since immutable storage can't grow it later.
+            const GLsizei levels = 1 + (GLsizei)glm::floor(glm::log2((float)std::max(def.resolution[0], def.resolution[1])));
+            std::vector<unsigned int> attachments;
+            for (size_t colorAttachment = 0; colorAttachment < 5; colorAttachment++) // Max 5 color attachments.
+            {
+                if (def.type & (Type::FBO_RGBA0 << colorAttachment))
+                {
+                    attachments.push_back(GL_COLOR_ATTACHMENT0 + (unsigned int)colorAttachment);
+                    TEXs_.push_back({ 0, (unsigned int)colorAttachment });
+                    glCreateTextures(GL_TEXTURE_2D, 1, &TEXs_.back().first);
+                    assert(TEXs_.back().first != 0);
+                    const unsigned int TEX = TEXs_.back().first;
+                    glTextureStorage2D(TEX, levels, GL_RGBA16F, (GLsizei)def.resolution[0], (GLsizei)def.resolution[1]);
+                    glTextureParameteri(TEX, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // We want GL_LINEAR here to be able to blur textures as they get smaller.
+                    glTextureParameteri(TEX, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                    glTextureParameteri(TEX, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                    glTextureParameteri(TEX, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                    glNamedFramebufferTexture(FBO_, GL_COLOR_ATTACHMENT0 + (unsigned int)colorAttachment, TEX, 0);
+                    CheckGlError();
+                }
+            }
+            assert(attachments.size() < 6); // 5 color attachments max.
+            glNamedFramebufferDrawBuffers(FBO_, (int)attachments.size(), attachments.data());
+            CheckGlError();
+        }
+
+        if (def.type & Type::RBO)
+        {
+            glCreateRenderbuffers(1, &RBO_);
+            glNamedRenderbufferStorage(RBO_, GL_DEPTH24_STENCIL8, (int)def.resolution[0], (int)def.resolution[1]);
+            glNamedFramebufferRenderbuffer(FBO_, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO_);
+            CheckGlError();
+        }
+
+        CheckNamedFramebufferStatus(FBO_);
     }
     else
     {
-        std::vector<unsigned int> attachments;
-        for (size_t colorAttachment = 0; colorAttachment < 5; colorAttachment++) // Max 5 color attachments.
+        glGenFramebuffers(1, &FBO_);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO_);
+        CheckGlError();
+
+        if (def.type & Type::FBO_DEPTH_NO_DRAW)
+        {
+            assert(
+                !(def.type & Type::FBO_RGBA0) && // Don't want to have both a depth attachment AND color attachments because of the glDrawBuffers and glReadBuffer conflicting.
+                !(def.type & Type::FBO_RGBA1) &&
+                !(def.type & Type::FBO_RGBA2) &&
+                !(def.type & Type::FBO_RGBA3) &&
+                !(def.type & Type::FBO_RGBA4)
+            );
+
+            CheckGlError();
+            TEXs_.push_back({ 0, FRAMEBUFFER_SHADOWMAP_UNIT - FRAMEBUFFER_TEXTURE0_UNIT }); // Shadowmap's texture unit is the last one, apart from the ones of the color attachments.
+            glGenTextures(1, &TEXs_.back().first);
+            assert(TEXs_.back().first != 0);
+            glBindTexture(GL_TEXTURE_2D, TEXs_.back().first);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, (GLsizei)def.resolution[0], (GLsizei)def.resolution[1], 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, TEXs_.back().first, 0);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            CheckGlError();
+            GLenum drawBuffers = GL_NONE;
+            glDrawBuffers(1, &drawBuffers);
+            glReadBuffer(GL_NONE);
+            CheckGlError();
+        }
+        else
         {
-            if (def.type & (Type::FBO_RGBA0 << colorAttachment))
+            const GLint levels = 1 + (GLint)glm::floor(glm::log2((float)std::max(def.resolution[0], def.resolution[1])));
+            std::vector<unsigned int> attachments;
+            for (size_t colorAttachment = 0; colorAttachment < 5; colorAttachment++) // Max 5 color attachments.
             {
-                CheckGlError();
-                attachments.push_back(GL_COLOR_ATTACHMENT0 + (unsigned int)colorAttachment);
-                TEXs_.push_back({ 0, (unsigned int)colorAttachment });
-                glGenTextures(1, &TEXs_.back().first);
-                assert(TEXs_.back().first != 0);
-                glBindTexture(GL_TEXTURE_2D, TEXs_.back().first);
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, (int)def.resolution[0], (int)def.resolution[1], 0, GL_RGBA, GL_FLOAT, nullptr);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // We want GL_LINEAR here to be able to blur textures as they get smaller.
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Can't use mipmaps for magnification duh
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                glGenerateMipmap(GL_TEXTURE_2D);
-                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + (unsigned int)colorAttachment, GL_TEXTURE_2D, TEXs_.back().first, 0);
-                glBindTexture(GL_TEXTURE_2D, 0);
-                CheckGlError();
+                if (def.type & (Type::FBO_RGBA0 << colorAttachment))
+                {
+                    CheckGlError();
+                    attachments.push_back(GL_COLOR_ATTACHMENT0 + (unsigned int)colorAttachment);
+                    TEXs_.push_back({ 0, (unsigned int)colorAttachment });
+                    glGenTextures(1, &TEXs_.back().first);
+                    assert(TEXs_.back().first != 0);
+                    glBindTexture(GL_TEXTURE_2D, TEXs_.back().first);
+                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, (int)def.resolution[0], (int)def.resolution[1], 0, GL_RGBA, GL_FLOAT, nullptr);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // We want GL_LINEAR here to be able to blur textures as they get smaller.
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Can't use mipmaps for magnification duh
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                    // The levels only need to exist for the texture to be complete, filtering the empty level 0 into them was wasted gpu work. BindGBuffer(true) fills them once something was rendered.
+                    for (GLint level = 1; level < levels; level++)
+                    {
+                        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA16F, std::max((int)def.resolution[0] >> level, 1), std::max((int)def.resolution[1] >> level, 1), 0, GL_RGBA, GL_FLOAT, nullptr);
+                    }
+                    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + (unsigned int)colorAttachment, GL_TEXTURE_2D, TEXs_.back().first, 0);
+                    glBindTexture(GL_TEXTURE_2D, 0);
+                    CheckGlError();
+                }
             }
+            assert(attachments.size() < 6); // 5 color attachments max.
+            glDrawBuffers((int)attachments.size(), attachments.data());
+            CheckGlError();
+        }
+
+        if (def.type & Type::RBO)
+        {
+            CheckGlError();
+            glGenRenderbuffers(1, &RBO_);
+            glBindRenderbuffer(GL_RENDERBUFFER, RBO_);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, (int)def.resolution[0], (int)def.resolution[1]);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO_);
+            CheckGlError();
         }
-        assert(attachments.size() < 6); // 5 color attachments max.
-        glDrawBuffers((int)attachments.size(), attachments.data());
-        CheckGlError();
-    }
 
-    if (def.type & Type::RBO)
-    {
         CheckGlError();
-        glGenRenderbuffers(1, &RBO_);
-        glBindRenderbuffer(GL_RENDERBUFFER, RBO_);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, (int)def.resolution[0], (int)def.resolution[1]);
+        CheckFramebufferStatus();
         glBindRenderbuffer(GL_RENDERBUFFER, 0);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO_);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
         CheckGlError();
     }
 
-    CheckGlError();
-    CheckFramebufferStatus();
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    CheckGlError();
-
     for (const auto& tex : TEXs_)
     {
         ResourceManager::Get().AppendNewTEX(tex.first);
     }
+    const bool hasDepthTexture = def.type & Type::FBO_DEPTH_NO_DRAW;
+    ResourceManager::Get().TrackMemory(ResourceManager::Resource::FRAMEBUFFER, FBO_, AttachmentBytes(def, TEXs_.size() - (hasDepthTexture ? 1 : 0), hasDepthTexture)); // Pinned, owned by this.
 }
+
 void gl::Framebuffer::Resize(std::array<size_t, 2> newResolution)
 {
     defCopy_.resolution = newResolution;
@@ -105,6 +208,7 @@ void gl::Framebuffer::Resize(std::array<size_t, 2> newResolution)
         ResourceManager::Get().DeleteTEX(tex.first);
     }
     TEXs_.clear();
+    ResourceManager::Get().UntrackMemory(ResourceManager::Resource::FRAMEBUFFER, FBO_);
     glDeleteRenderbuffers(1, &RBO_);
     RBO_ = 0;
     glDeleteFramebuffers(1, &FBO_);
@@ -126,11 +230,20 @@ void gl::Framebuffer::BindGBuffer(bool generateMipmaps) const
     CheckGlError();
     for (const auto& tex : TEXs_)
     {
-        // glActiveTexture(GL_TEXTURE0 + FRAMEBUFFER_TEXTURE0_UNIT + tex.second);
-        glBindTexture(GL_TEXTURE_2D, tex.first);
+        const unsigned int unit = (unsigned int)FRAMEBUFFER_TEXTURE0_UNIT + tex.second;
+        glBindTextures(unit, 1, &tex.first);
         if (generateMipmaps)
         {
-            glGenerateMipmap(GL_TEXTURE_2D);
+            if (HasDirectStateAccess())
+            {
+                glGenerateTextureMipmap(tex.first);
+            }
+            else
+            {
+                glActiveTexture(GL_TEXTURE0 + unit);
+                glGenerateMipmap(GL_TEXTURE_2D);
+                glActiveTexture(GL_TEXTURE0);
+            }
         }
         CheckGlError();
     }
@@ -139,8 +252,8 @@ void gl::Framebuffer::UnbindGBuffer() const
 {
     for (const auto& tex : TEXs_)
     {
-        // glActiveTexture(GL_TEXTURE0 + FRAMEBUFFER_TEXTURE0_UNIT + tex.second);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        const unsigned int unit = (unsigned int)FRAMEBUFFER_TEXTURE0_UNIT + tex.second;
+        glBindTextures(unit, 1, nullptr);
         CheckGlError();
     }
 }
@@ -0,0 +1,55 @@
+#include "hasher.h"
+
+#ifndef XXH_INLINE_ALL
+#define XXH_INLINE_ALL
+#endif // !XXH_INLINE_ALL
+#include "xxhash.h"
+
+namespace
+{
+    XXH3_state_t* State(unsigned char* storage)
+    {
+        return reinterpret_cast<XXH3_state_t*>(storage);
+    }
+    const XXH3_state_t* State(const unsigned char* storage)
+    {
+        return reinterpret_cast<const XXH3_state_t*>(storage);
+    }
+}//!anonymous
+
+gl::Hasher::Hasher(const uint64_t seed)
+{
+    static_assert(sizeof(XXH3_state_t) <= sizeof(state_) && alignof(XXH3_state_t) <= 64, "Hasher::state_ is too small for this version of xxhash.");
+    // The 64 and 128 bit variants share the same state and reset, so both digests can be read from it.
+    XXH3_128bits_reset_withSeed(State(state_), seed);
+}
+
+gl::Hasher& gl::Hasher::AddBytes(const void* data, const size_t size)
+{
+    XXH3_128bits_update(State(state_), data, size);
+    return *this;
+}
+
+gl::Hasher& gl::Hasher::Add(const std::string_view string)
+{
+    const uint64_t size = string.size();
+    AddBytes(&size, sizeof(size));
+    return AddBytes(string.data(), string.size());
+}
+
+gl::Hasher& gl::Hasher::AddAddress(const void* address)
+{
+    const uintptr_t value = reinterpret_cast<uintptr_t>(address);
+    return AddBytes(&value, sizeof(value));
+}
+
+uint64_t gl::Hasher::Digest64() const
+{
+    return XXH3_64bits_digest(State(state_));
+}
+
+gl::Hasher::Hash128 gl::Hasher::Digest128() const
+{
+    const XXH128_hash_t hash = XXH3_128bits_digest(State(state_));
+    return { hash.low64, hash.high64 };
+}
@@ -0,0 +1,566 @@
+#include "ibl_baker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <gli/gli.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "defines.h"
+#include "file_system.h"
+#include "hasher.h"
+#if GL_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr float PI = 3.14159265358979f;
+    constexpr size_t WORK_PER_THREAD = 65536; // Texel fetches or samples, less isn't worth starting threads for.
+    constexpr uint32_t CACHE_MAGIC = 0x304C4249; // "IBL0"
+    constexpr uint32_t BAKER_VERSION = 1; // Part of the key, bump it when baked results change.
+
+    struct CacheHeader
+    {
+        uint32_t magic = 0;
+        uint32_t specularSize = 0;
+        uint32_t nrOfSpecularLevels = 0;
+        uint32_t brdfLutSize = 0;
+    };
+
+    // sum += texel * weight, on the 4 channels.
+    inline void AddScaled(float* sum, const float* texel, const float weight)
+    {
+#if GL_SIMD_SSE2
+        _mm_storeu_ps(sum, _mm_add_ps(_mm_loadu_ps(sum), _mm_mul_ps(_mm_loadu_ps(texel), _mm_set1_ps(weight))));
+#else
+        for (size_t channel = 0; channel < 4; channel++)
+        {
+            sum[channel] += texel[channel] * weight;
+        }
+#endif
+    }
+
+    // Not normalized direction through u and v, in [-1, 1] from the left and top of face.
+    glm::vec3 GetDirection(const size_t face, const float u, const float v)
+    {
+        switch (face)
+        {
+            case 0: return { 1.0f, -v, -u };
+            case 1: return { -1.0f, -v, u };
+            case 2: return { u, 1.0f, v };
+            case 3: return { u, -1.0f, -v };
+            case 4: return { u, -v, 1.0f };
+            default: return { -u, -v, -1.0f };
+        }
+    }
+
+    glm::vec3 GetTexelDirection(const size_t face, const size_t x, const size_t y, const size_t size)
+    {
+        const float scale = 2.0f / (float)size;
+        return glm::normalize(GetDirection(face, ((float)x + 0.5f) * scale - 1.0f, ((float)y + 0.5f) * scale - 1.0f));
+    }
+
+    // Inverse of GetDirection().
+    size_t GetFace(const glm::vec3& direction, float& u, float& v)
+    {
+        const glm::vec3 a = glm::abs(direction);
+        if (a.x >= a.y && a.x >= a.z)
+        {
+            u = (direction.x > 0.0f ? -direction.z : direction.z) / a.x;
+            v = -direction.y / a.x;
+            return direction.x > 0.0f ? 0 : 1;
+        }
+        if (a.y >= a.z)
+        {
+            u = direction.x / a.y;
+            v = (direction.y > 0.0f ? direction.z : -direction.z) / a.y;
+            return direction.y > 0.0f ? 2 : 3;
+        }
+        u = (direction.z > 0.0f ? direction.x : -direction.x) / a.z;
+        v = -direction.y / a.z;
+        return direction.z > 0.0f ? 4 : 5;
+    }
+
+    float AreaElement(const float x, const float y)
+    {
+        return std::atan2(x * y, std::sqrt(x * x + y * y + 1.0f));
+    }
+
+    float GetTexelSolidAngle(const size_t x, const size_t y, const size_t size)
+    {
+        const float scale = 2.0f / (float)size;
+        const float x0 = (float)x * scale - 1.0f, x1 = (float)(x + 1) * scale - 1.0f;
+        const float y0 = (float)y * scale - 1.0f, y1 = (float)(y + 1) * scale - 1.0f;
+        return AreaElement(x0, y0) - AreaElement(x0, y1) - AreaElement(x1, y0) + AreaElement(x1, y1);
+    }
+
+    // Box filtered levels of the environment, level 0 is the environment itself. Sampled from by the prefiltering so that rough levels don't alias.
+    std::vector<gl::IblBaker::Environment> BuildSourceChain(const gl::IblBaker::Environment& environment)
+    {
+        std::vector<gl::IblBaker::Environment> chain = { environment };
+        while (chain.back().size > 1)
+        {
+            const gl::IblBaker::Environment& source = chain.back();
+            gl::IblBaker::Environment level;
+            level.size = source.size / 2;
+            for (size_t face = 0; face < 6; face++)
+            {
+                level.faces[face].resize(level.size * level.size * 4);
+            }
+            gl::ParallelFor(6 * level.size, level.size * 4, WORK_PER_THREAD, [&](const size_t row)
+            {
+                const size_t face = row / level.size, y = row % level.size;
+                const float* texels = source.faces[face].data();
+                float* destination = level.faces[face].data() + y * level.size * 4;
+                for (size_t x = 0; x < level.size; x++)
+                {
+                    float sum[4] = {};
+                    for (size_t corner = 0; corner < 4; corner++)
+                    {
+                        const size_t sourceX = std::min(2 * x + (corner & 1), source.size - 1), sourceY = std::min(2 * y + (corner >> 1), source.size - 1);
+                        AddScaled(sum, texels + (sourceY * source.size + sourceX) * 4, 0.25f);
+                    }
+                    std::memcpy(destination + x * 4, sum, sizeof(sum));
+                }
+            });
+            chain.push_back(std::move(level));
+        }
+        return chain;
+    }
+
+    // Adds weight times the bilinear sample of face at u, v to sum. Clamped to the face's edges.
+    void SampleBilinear(const gl::IblBaker::Environment& level, const size_t face, const float u, const float v, const float weight, float* sum)
+    {
+        const float x = (u * 0.5f + 0.5f) * (float)level.size - 0.5f, y = (v * 0.5f + 0.5f) * (float)level.size - 0.5f;
+        const float floorX = std::floor(x), floorY = std::floor(y);
+        const float tx = x - floorX, ty = y - floorY;
+        const int64_t last = (int64_t)level.size - 1;
+        const size_t x0 = (size_t)std::clamp((int64_t)floorX, (int64_t)0, last), x1 = (size_t)std::clamp((int64_t)floorX + 1, (int64_t)0, last);
+        const size_t y0 = (size_t)std::clamp((int64_t)floorY, (int64_t)0, last), y1 = (size_t)std::clamp((int64_t)floorY + 1, (int64_t)0, last);
+        const float* texels = level.faces[face].data();
+        AddScaled(sum, texels + (y0 * level.size + x0) * 4, weight * (1.0f - tx) * (1.0f - ty));
+        AddScaled(sum, texels + (y0 * level.size + x1) * 4, weight * tx * (1.0f - ty));
+        AddScaled(sum, texels + (y1 * level.size + x0) * 4, weight * (1.0f - tx) * ty);
+        AddScaled(sum, texels + (y1 * level.size + x1) * 4, weight * tx * ty);
+    }
+
+    // Trilinear, between the levels of chain around lod.
+    void SampleCube(const std::vector<gl::IblBaker::Environment>& chain, const glm::vec3& direction, const float lod, const float weight, float* sum)
+    {
+        float u = 0.0f, v = 0.0f;
+        const size_t face = GetFace(direction, u, v);
+        const float clamped = std::clamp(lod, 0.0f, (float)(chain.size() - 1));
+        const size_t level = (size_t)clamped;
+        const float t = clamped - (float)level;
+        SampleBilinear(chain[level], face, u, v, weight * (1.0f - t), sum);
+        if (t > 0.0f) SampleBilinear(chain[level + 1], face, u, v, weight * t, sum);
+    }
+
+    void EvaluateSH(const glm::vec3& n, float* sh)
+    {
+        sh[0] = 0.282095f;
+        sh[1] = 0.488603f * n.y;
+        sh[2] = 0.488603f * n.z;
+        sh[3] = 0.488603f * n.x;
+        sh[4] = 1.092548f * n.x * n.y;
+        sh[5] = 1.092548f * n.y * n.z;
+        sh[6] = 0.315392f * (3.0f * n.z * n.z - 1.0f);
+        sh[7] = 1.092548f * n.x * n.z;
+        sh[8] = 0.546274f * (n.x * n.x - n.y * n.y);
+    }
+
+    void ProjectIrradiance(const gl::IblBaker::Environment& environment, std::array<glm::vec3, 9>& irradianceSH)
+    {
+        // One partial sum per row, added up in order afterwards so that the result doesn't depend on the threads.
+        const size_t size = environment.size;
+        std::vector<float> rows(6 * size * 9 * 4, 0.0f);
+        gl::ParallelFor(6 * size, size * 9, WORK_PER_THREAD, [&](const size_t row)
+        {
+            const size_t face = row / size, y = row % size;
+            float* sums = rows.data() + row * 9 * 4;
+            for (size_t x = 0; x < size; x++)
+            {
+                const float solidAngle = GetTexelSolidAngle(x, y, size);
+                float sh[9];
+                EvaluateSH(GetTexelDirection(face, x, y, size), sh);
+                const float* texel = environment.faces[face].data() + (y * size + x) * 4;
+                for (size_t i = 0; i < 9; i++)
+                {
+                    AddScaled(sums + i * 4, texel, sh[i] * solidAngle);
+                }
+            }
+        });
+
+        // Convolution with the clamped cosine lobe, per band.
+        constexpr float BAND_SCALES[9] = { PI, 2.0f * PI / 3.0f, 2.0f * PI / 3.0f, 2.0f * PI / 3.0f, PI / 4.0f, PI / 4.0f, PI / 4.0f, PI / 4.0f, PI / 4.0f };
+        for (size_t i = 0; i < 9; i++)
+        {
+            glm::vec3 sum = glm::vec3(0.0f);
+            for (size_t row = 0; row < 6 * size; row++)
+            {
+                const float* partial = rows.data() + (row * 9 + i) * 4;
+                sum += glm::vec3(partial[0], partial[1], partial[2]);
+            }
+            irradianceSH[i] = sum * BAND_SCALES[i];
+        }
+    }
+
+    float RadicalInverse(uint32_t bits)
+    {
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return (float)bits * 2.3283064365386963e-10f;
+    }
+
+    // GGX half vector of Hammersley point i out of nrOfSamples, around +z.
+    glm::vec3 SampleGgx(const size_t i, const size_t nrOfSamples, const float alpha)
+    {
+        const float phi = 2.0f * PI * (float)i / (float)nrOfSamples;
+        const float xi = RadicalInverse((uint32_t)i);
+        const float cosTheta = std::sqrt((1.0f - xi) / (1.0f + (alpha * alpha - 1.0f) * xi));
+        const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+        return { sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta };
+    }
+
+    // Light direction around a normal along +z, the view direction being the normal as well.
+    struct SpecularSample
+    {
+        glm::vec3 direction = glm::vec3(0.0f, 0.0f, 1.0f);
+        float weight = 1.0f; // NdotL.
+        float lod = 0.0f; // In the source chain.
+    };
+
+    // The same for every texel of a level, only rotated. Each sample reads the source level whose texels cover the solid angle it stands for (filtered importance sampling), few samples then suffice.
+    std::vector<SpecularSample> MakeSpecularSamples(const float roughness, const size_t nrOfSamples, const size_t sourceSize, const size_t size)
+    {
+        if (roughness == 0.0f)
+        {
+            SpecularSample mirror;
+            mirror.lod = std::log2((float)sourceSize / (float)size);
+            return { mirror };
+        }
+
+        const float alpha = roughness * roughness;
+        const float texelSolidAngle = 4.0f * PI / (6.0f * (float)sourceSize * (float)sourceSize);
+        std::vector<SpecularSample> samples;
+        for (size_t i = 0; i < nrOfSamples; i++)
+        {
+            const glm::vec3 H = SampleGgx(i, nrOfSamples, alpha);
+            const float NdotL = 2.0f * H.z * H.z - 1.0f;
+            if (NdotL <= 0.0f) continue;
+
+            const float denominator = H.z * H.z * (alpha * alpha - 1.0f) + 1.0f;
+            const float D = alpha * alpha / (PI * denominator * denominator);
+            const float pdf = D * 0.25f; // D * NdotH / (4 * VdotH), with V = N.
+            const float sampleSolidAngle = 1.0f / ((float)nrOfSamples * pdf + 0.0001f);
+            SpecularSample sample;
+            sample.direction = glm::vec3(2.0f * H.z * H.x, 2.0f * H.z * H.y, NdotL);
+            sample.weight = NdotL;
+            sample.lod = std::max(0.0f, 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f);
+            samples.push_back(sample);
+        }
+        return samples;
+    }
+
+    void PrefilterLevel(const std::vector<gl::IblBaker::Environment>& chain, const std::vector<SpecularSample>& samples, const size_t size, float* destination)
+    {
+        float totalWeight = 0.0f;
+        for (const auto& sample : samples)
+        {
+            totalWeight += sample.weight;
+        }
+
+        gl::ParallelFor(6 * size, size * samples.size() * 8, WORK_PER_THREAD, [&](const size_t row)
+        {
+            const size_t face = row / size, y = row % size;
+            for (size_t x = 0; x < size; x++)
+            {
+                const glm::vec3 N = GetTexelDirection(face, x, y, size);
+                const glm::vec3 up = std::abs(N.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                const glm::vec3 T = glm::normalize(glm::cross(up, N));
+                const glm::vec3 B = glm::cross(N, T);
+                float sum[4] = {};
+                for (const auto& sample : samples)
+                {
+                    SampleCube(chain, T * sample.direction.x + B * sample.direction.y + N * sample.direction.z, sample.lod, sample.weight / totalWeight, sum);
+                }
+                std::memcpy(destination + ((face * size + y) * size + x) * 4, sum, sizeof(sum));
+            }
+        });
+    }
+
+    // Split sum scale and bias of F0 for one NdotV and roughness, Schlick-GGX geometry with k = alpha / 2 as for image based lighting.
+    void IntegrateBrdf(const float NdotV, const float k, const std::vector<glm::vec3>& halfVectors, float* scaleAndBias)
+    {
+        const float Vx = std::sqrt(1.0f - NdotV * NdotV), Vz = NdotV;
+        float scale = 0.0f, bias = 0.0f;
+        for (const auto& H : halfVectors)
+        {
+            const float VdotH = std::max(0.0f, Vx * H.x + Vz * H.z);
+            const float NdotL = 2.0f * VdotH * H.z - Vz;
+            if (NdotL <= 0.0f) continue;
+            const float G = NdotV / (NdotV * (1.0f - k) + k) * NdotL / (NdotL * (1.0f - k) + k);
+            const float visibility = G * VdotH / (H.z * NdotV);
+            const float fresnel = std::pow(1.0f - VdotH, 5.0f);
+            scale += (1.0f - fresnel) * visibility;
+            bias += fresnel * visibility;
+        }
+        scaleAndBias[0] = scale / (float)halfVectors.size();
+        scaleAndBias[1] = bias / (float)halfVectors.size();
+    }
+
+    void IntegrateBrdfLut(const size_t size, const size_t nrOfSamples, float* lut)
+    {
+        gl::ParallelFor(size, size * nrOfSamples, WORK_PER_THREAD, [&](const size_t y)
+        {
+            // The half vectors only depend on the roughness, 4 NdotV are integrated at once against them.
+            const float roughness = ((float)y + 0.5f) / (float)size;
+            const float alpha = roughness * roughness;
+            const float k = alpha * 0.5f;
+            std::vector<glm::vec3> halfVectors(nrOfSamples);
+            for (size_t i = 0; i < nrOfSamples; i++)
+            {
+                halfVectors[i] = SampleGgx(i, nrOfSamples, alpha);
+            }
+
+            float* row = lut + y * size * 2;
+            size_t x = 0;
+#if GL_SIMD_SSE2
+            const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+            const __m128 K = _mm_set1_ps(k), oneMinusK = _mm_set1_ps(1.0f - k);
+            for (; x + 4 <= size; x += 4)
+            {
+                float NdotVs[4], Vxs[4];
+                for (size_t lane = 0; lane < 4; lane++)
+                {
+                    NdotVs[lane] = ((float)(x + lane) + 0.5f) / (float)size;
+                    Vxs[lane] = std::sqrt(1.0f - NdotVs[lane] * NdotVs[lane]);
+                }
+                const __m128 NdotV = _mm_loadu_ps(NdotVs), Vx = _mm_loadu_ps(Vxs);
+                const __m128 GV = _mm_div_ps(NdotV, _mm_add_ps(_mm_mul_ps(NdotV, oneMinusK), K));
+                __m128 scale = zero, bias = zero;
+                for (const auto& H : halfVectors)
+                {
+                    const __m128 Hx = _mm_set1_ps(H.x), Hz = _mm_set1_ps(H.z);
+                    const __m128 VdotH = _mm_max_ps(zero, _mm_add_ps(_mm_mul_ps(Vx, Hx), _mm_mul_ps(NdotV, Hz)));
+                    const __m128 NdotL = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(two, VdotH), Hz), NdotV);
+                    const __m128 lit = _mm_cmpgt_ps(NdotL, zero);
+                    const __m128 GL = _mm_div_ps(NdotL, _mm_add_ps(_mm_mul_ps(NdotL, oneMinusK), K));
+                    const __m128 visibility = _mm_and_ps(lit, _mm_div_ps(_mm_mul_ps(_mm_mul_ps(GV, GL), VdotH), _mm_mul_ps(Hz, NdotV)));
+                    const __m128 oneMinusVdotH = _mm_sub_ps(one, VdotH);
+                    const __m128 squared = _mm_mul_ps(oneMinusVdotH, oneMinusVdotH);
+                    const __m128 fresnel = _mm_mul_ps(_mm_mul_ps(squared, squared), oneMinusVdotH);
+                    scale = _mm_add_ps(scale, _mm_mul_ps(_mm_sub_ps(one, fresnel), visibility));
+                    bias = _mm_add_ps(bias, _mm_mul_ps(fresnel, visibility));
+                }
+                const __m128 inverse = _mm_set1_ps(1.0f / (float)nrOfSamples);
+                float scales[4], biases[4];
+                _mm_storeu_ps(scales, _mm_mul_ps(scale, inverse));
+                _mm_storeu_ps(biases, _mm_mul_ps(bias, inverse));
+                for (size_t lane = 0; lane < 4; lane++)
+                {
+                    row[(x + lane) * 2] = scales[lane];
+                    row[(x + lane) * 2 + 1] = biases[lane];
+                }
+            }
+#endif
+            for (; x < size; x++)
+            {
+                IntegrateBrdf(((float)x + 0.5f) / (float)size, k, halfVectors, row + x * 2);
+            }
+        });
+    }
+
+    // Texels of the first level of every face as linear RGBA floats. False for formats the baker doesn't read, ex: compressed ones.
+    bool Decode(const gli::texture& Texture, gl::IblBaker::Environment& environment)
+    {
+        if (Texture.empty() || Texture.target() != gli::TARGET_CUBE || Texture.faces() != 6 || Texture.extent().x != Texture.extent().y) return false;
+
+        size_t nrOfChannels = 4;
+        bool bgr = false, half = false, gamma = true; // 8 bits per channel unless half or float.
+        switch (Texture.format())
+        {
+            case gli::FORMAT_RGBA8_UNORM_PACK8: case gli::FORMAT_RGBA8_SRGB_PACK8: break;
+            case gli::FORMAT_BGRA8_UNORM_PACK8: case gli::FORMAT_BGRA8_SRGB_PACK8: bgr = true; break;
+            case gli::FORMAT_RGB8_UNORM_PACK8: case gli::FORMAT_RGB8_SRGB_PACK8: nrOfChannels = 3; break;
+            case gli::FORMAT_BGR8_UNORM_PACK8: case gli::FORMAT_BGR8_SRGB_PACK8: nrOfChannels = 3; bgr = true; break;
+            case gli::FORMAT_RGBA16_SFLOAT_PACK16: half = true; gamma = false; break;
+            case gli::FORMAT_RGBA32_SFLOAT_PACK32: gamma = false; break;
+            case gli::FORMAT_RGB32_SFLOAT_PACK32: nrOfChannels = 3; gamma = false; break;
+            default: return false;
+        }
+
+        environment.size = (size_t)Texture.extent().x;
+        const size_t nrOfTexels = environment.size * environment.size;
+        for (size_t face = 0; face < 6; face++)
+        {
+            std::vector<float>& texels = environment.faces[face];
+            texels.resize(nrOfTexels * 4);
+            const void* data = Texture.data(0, face, 0);
+            for (size_t texel = 0; texel < nrOfTexels; texel++)
+            {
+                float rgba[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+                for (size_t channel = 0; channel < nrOfChannels; channel++)
+                {
+                    const size_t index = texel * nrOfChannels + channel;
+                    if (half)
+                    {
+                        uint16_t bits = 0;
+                        std::memcpy(&bits, static_cast<const uint16_t*>(data) + index, sizeof(bits));
+                        rgba[channel] = glm::unpackHalf2x16(bits).x;
+                    }
+                    else if (gamma)
+                    {
+                        rgba[channel] = (float)static_cast<const uint8_t*>(data)[index] / 255.0f;
+                    }
+                    else
+                    {
+                        std::memcpy(&rgba[channel], static_cast<const float*>(data) + index, sizeof(float));
+                    }
+                }
+                if (bgr) std::swap(rgba[0], rgba[2]);
+                for (size_t channel = 0; gamma && channel < 3; channel++)
+                {
+                    rgba[channel] = std::pow(rgba[channel], 2.2f); // Same decoding as skybox.frag.
+                }
+                std::memcpy(texels.data() + texel * 4, rgba, sizeof(rgba));
+            }
+        }
+        return true;
+    }
+
+    size_t GetSpecularFloats(const size_t size, const size_t nrOfLevels)
+    {
+        size_t floats = 0;
+        for (size_t level = 0; level < nrOfLevels; level++)
+        {
+            const size_t levelSize = std::max<size_t>(1, size >> level);
+            floats += 6 * levelSize * levelSize * 4;
+        }
+        return floats;
+    }
+
+    bool ReadCache(const std::string& path, gl::IblBaker::Result& result)
+    {
+        gl::FileSystem::File file = gl::FileSystem::Get().Read(path);
+        if (!file.Exists()) return false;
+
+        CacheHeader header;
+        size_t specularFloats = 0, lutFloats = 0;
+        if (file.GetSize() >= sizeof(CacheHeader))
+        {
+            std::memcpy(&header, file.GetData(), sizeof(CacheHeader));
+            specularFloats = GetSpecularFloats(header.specularSize, header.nrOfSpecularLevels);
+            lutFloats = (size_t)header.brdfLutSize * header.brdfLutSize * 2;
+        }
+        if (header.magic != CACHE_MAGIC || file.GetSize() != sizeof(CacheHeader) + (9 * 3 + specularFloats + lutFloats) * sizeof(float))
+        {
+            file = {}; // Unmapped before removing it.
+            std::remove(path.c_str());
+            return false;
+        }
+
+        const char* data = file.GetData() + sizeof(CacheHeader);
+        std::memcpy(result.irradianceSH.data(), data, 9 * sizeof(glm::vec3));
+        data += 9 * sizeof(glm::vec3);
+        result.specularSize = header.specularSize;
+        result.nrOfSpecularLevels = header.nrOfSpecularLevels;
+        result.specular.resize(specularFloats);
+        std::memcpy(result.specular.data(), data, specularFloats * sizeof(float));
+        data += specularFloats * sizeof(float);
+        result.brdfLutSize = header.brdfLutSize;
+        result.brdfLut.resize(lutFloats);
+        std::memcpy(result.brdfLut.data(), data, lutFloats * sizeof(float));
+        return true;
+    }
+
+    void WriteCache(const std::string& path, const std::string& directory, const gl::IblBaker::Result& result)
+    {
+        static_assert(sizeof(glm::vec3) == 3 * sizeof(float));
+        CacheHeader header;
+        header.magic = CACHE_MAGIC;
+        header.specularSize = (uint32_t)result.specularSize;
+        header.nrOfSpecularLevels = (uint32_t)result.nrOfSpecularLevels;
+        header.brdfLutSize = (uint32_t)result.brdfLutSize;
+
+        std::error_code error;
+        if (!directory.empty()) std::filesystem::create_directories(directory, error);
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            EngineWarning("Could not write to the image based lighting cache, it will be baked on every launch.");
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+        file.write(reinterpret_cast<const char*>(result.irradianceSH.data()), 9 * sizeof(glm::vec3));
+        file.write(reinterpret_cast<const char*>(result.specular.data()), result.specular.size() * sizeof(float));
+        file.write(reinterpret_cast<const char*>(result.brdfLut.data()), result.brdfLut.size() * sizeof(float));
+    }
+}//!anonymous
+
+bool gl::IblBaker::Load(std::string_view path, const Definition& def, Result& result)
+{
+    const FileSystem::File file = FileSystem::Get().Read(path);
+    if (!file.Exists())
+    {
+        EngineWarning(("Could not open " + std::string(path) + ", no image based lighting.").c_str());
+        return false;
+    }
+
+    Hasher hasher(HASHING_SEED);
+    hasher.AddBytes(file.GetData(), file.GetSize()).Add(BAKER_VERSION);
+    hasher.Add(def.specularSize).Add(def.nrOfSpecularLevels).Add(def.specularSamples).Add(def.brdfLutSize).Add(def.brdfSamples);
+    std::string directory = def.cacheDirectory;
+    if (!directory.empty() && directory.back() != '/') directory += '/';
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)hasher.Digest64());
+    const std::string cachePath = directory + name + ".ibl";
+    if (ReadCache(cachePath, result)) return true;
+
+    Environment environment;
+    if (!Decode(gli::load(file.GetData(), file.GetSize()), environment))
+    {
+        EngineWarning((std::string(path) + " isn't an uncompressed cubemap, no image based lighting.").c_str());
+        return false;
+    }
+    Bake(environment, def, result);
+    WriteCache(cachePath, directory, result);
+    return true;
+}
+
+void gl::IblBaker::Bake(const Environment& environment, const Definition& def, Result& result)
+{
+    assert(environment.size > 0 && def.specularSize > 0 && def.nrOfSpecularLevels > 0 && def.brdfLutSize > 0);
+    ProjectIrradiance(environment, result.irradianceSH);
+
+    const std::vector<Environment> chain = BuildSourceChain(environment);
+    result.specularSize = def.specularSize;
+    result.nrOfSpecularLevels = std::min(def.nrOfSpecularLevels, (size_t)std::log2((float)def.specularSize) + 1); // Down to 1x1 at most.
+    result.specular.resize(GetSpecularFloats(result.specularSize, result.nrOfSpecularLevels));
+    for (size_t level = 0; level < result.nrOfSpecularLevels; level++)
+    {
+        const size_t size = std::max<size_t>(1, result.specularSize >> level);
+        const float roughness = result.nrOfSpecularLevels > 1 ? (float)level / (float)(result.nrOfSpecularLevels - 1) : 0.0f;
+        const auto samples = MakeSpecularSamples(roughness, def.specularSamples, environment.size, size);
+        PrefilterLevel(chain, samples, size, result.specular.data() + GetSpecularLevelOffset(result, level));
+    }
+
+    result.brdfLutSize = def.brdfLutSize;
+    result.brdfLut.resize(def.brdfLutSize * def.brdfLutSize * 2);
+    IntegrateBrdfLut(def.brdfLutSize, def.brdfSamples, result.brdfLut.data());
+}
+
+size_t gl::IblBaker::GetSpecularLevelOffset(const Result& result, size_t level)
+{
+    return GetSpecularFloats(result.specularSize, level);
+}
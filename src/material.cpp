@@ -1,33 +1,110 @@
 #include "material.h"
 
+#include <algorithm>
+
+#include <glad/glad.h>
+
 #include "resource_manager.h"
+#include "texture_streamer.h"
 
 void gl::Material::Create(Definition def)
 {
+    if (!textures_.empty())
+    {
+        EngineError("Calling Create() a second time...");
+    }
+
     for (const auto& pair : def.texturePathsAndTypes)
     {
-        // assert(!pair.first.empty() && (int)pair.second < (int)Texture::Type::INVALID);
+        assert(!pair.first.empty() && (int)pair.second < (int)Texture::Type::INVALID);
     }
 
+    Sampler sampler;
+    sampler.Create(def.sampler);
+    Sampler::Definition cubemapSamplerDef = def.sampler;
+    cubemapSamplerDef.wrap = Sampler::Wrap::CLAMP_TO_EDGE;
+    Sampler cubemapSampler;
+    cubemapSampler.Create(cubemapSamplerDef);
+
     for (size_t i = 0; i < def.texturePathsAndTypes.size(); i++)
     {
         Texture tex;
-        tex.Create(def.texturePathsAndTypes[i].second, def.texturePathsAndTypes[i].first);
+        if (def.loadAsync || def.streamMips)
+        {
+            tex.CreateAsync(def.texturePathsAndTypes[i].second, def.texturePathsAndTypes[i].first, def.streamMips);
+        }
+        else
+        {
+            tex.Create(def.texturePathsAndTypes[i].second, def.texturePathsAndTypes[i].first);
+        }
         textures_.push_back(tex);
+        texturesLoaded_ = texturesLoaded_ && tex.IsLoaded();
+
+        const size_t unit = (size_t)tex.GetType();
+        assert(bindingTable_.TEXs[unit] == 0); // Only one texture per unit.
+        bindingTable_.TEXs[unit] = tex.GetTEX();
+        bindingTable_.SAMPLERs[unit] = tex.GetType() == Texture::Type::CUBEMAP ? cubemapSampler.GetSAMPLER() : sampler.GetSAMPLER();
+    }
+}
+
+void gl::Material::Bind(const Material* previous) const
+{
+    if (!texturesLoaded_) RefreshLoadingTextures();
+
+    size_t first = 0, last = NR_OF_MATERIAL_TEXTURE_UNITS; // Range of units to rebind, last is excluded.
+    if (previous != nullptr)
+    {
+        while (first < last && previous->bindingTable_.TEXs[first] == bindingTable_.TEXs[first] && previous->bindingTable_.SAMPLERs[first] == bindingTable_.SAMPLERs[first])
+        {
+            first++;
+        }
+        while (last > first && previous->bindingTable_.TEXs[last - 1] == bindingTable_.TEXs[last - 1] && previous->bindingTable_.SAMPLERs[last - 1] == bindingTable_.SAMPLERs[last - 1])
+        {
+            last--;
+        }
+        if (first == last) return; // Same textures and samplers, nothing to do.
     }
+
+    // Units holding 0 get unbound, so that nothing from a previous material leaks into this one.
+    glBindTextures((GLuint)first, (GLsizei)(last - first), &bindingTable_.TEXs[first]);
+    glBindSamplers((GLuint)first, (GLsizei)(last - first), &bindingTable_.SAMPLERs[first]);
+    CheckGlError();
 }
 
-void gl::Material::Bind()
+void gl::Material::RefreshLoadingTextures() const
 {
-	for (const auto& texture : textures_)
-	{
-		texture.Bind();
-	}
+    texturesLoaded_ = true;
+    for (const auto& tex : textures_)
+    {
+        bindingTable_.TEXs[(size_t)tex.GetType()] = tex.GetTEX();
+        texturesLoaded_ = texturesLoaded_ && tex.IsLoaded();
+    }
 }
-void gl::Material::Unbind()
+
+void gl::Material::Unbind() const
+{
+    glBindTextures(0, (GLsizei)NR_OF_MATERIAL_TEXTURE_UNITS, nullptr);
+    glBindSamplers(0, (GLsizei)NR_OF_MATERIAL_TEXTURE_UNITS, nullptr);
+    CheckGlError();
+}
+
+void gl::Material::RequestTextureLevels(float screenSize) const
 {
-	for (const auto& texture : textures_)
-	{
-		texture.Unbind();
-	}
-}
\ No newline at end of file
+    for (const auto& tex : textures_)
+    {
+        TextureStreamer::Get().Request(tex.GetTEX(), screenSize);
+    }
+}
+
+void gl::Material::Sort(std::vector<const Material*>& materials)
+{
+    // Lexicographic order on the binding tables: materials sharing their lower units end up next to each other.
+    std::sort(materials.begin(), materials.end(), [](const Material* a, const Material* b)
+        {
+            if (a->bindingTable_.TEXs != b->bindingTable_.TEXs)
+            {
+                return a->bindingTable_.TEXs < b->bindingTable_.TEXs;
+            }
+            return a->bindingTable_.SAMPLERs < b->bindingTable_.SAMPLERs;
+        });
+}
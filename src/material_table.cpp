@@ -0,0 +1,261 @@
+#include "material_table.h"
+
+#include <map>
+#include <tuple>
+
+#include <glad/glad.h>
+#include <gli/gli.hpp>
+
+#include "file_system.h"
+#include "mip_generator.h"
+
+void gl::MaterialTable::Create(Definition def)
+{
+    EngineGlScope("MaterialTable::Create");
+    if (SSBO_ != 0)
+    {
+        EngineError("Calling Create() a second time...");
+    }
+    assert(!def.entries.empty());
+
+    // Load every distinct image once.
+    std::vector<gli::texture> images;
+    std::map<std::string, size_t> imageIndices;
+    for (const auto& entry : def.entries)
+    {
+        if (entry.flags & Flags::MESH_TEXTURES) continue;
+        for (const std::string& path : { entry.diffuseMap, entry.normalMap })
+        {
+            if (path.empty() || imageIndices.find(path) != imageIndices.end()) continue;
+
+            const FileSystem::File file = FileSystem::Get().Read(path);
+            gli::texture image = file.Exists() ? MipGenerator::Generate(gli::load(file.GetData(), file.GetSize())) : gli::texture();
+            if (image.empty()) EngineError("Could not open image file!");
+            if (image.target() != gli::TARGET_2D) EngineError("Material table only supports 2D textures!");
+            imageIndices.insert({ path, images.size() });
+            images.push_back(image);
+        }
+    }
+
+    // Group images sharing a format, a size and a number of mip levels into the layers of the same array.
+    using ArrayKey = std::tuple<int, int, int, size_t>; // Format, width, height, levels.
+    std::map<ArrayKey, size_t> arrayIndices;
+    std::vector<std::vector<size_t>> arrayLayers; // Image indices, per array.
+    std::vector<std::pair<int, int>> imageLocations(images.size()); // Array and layer, per image.
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        const ArrayKey key = { (int)images[i].format(), (int)images[i].extent().x, (int)images[i].extent().y, images[i].levels() };
+        auto match = arrayIndices.find(key);
+        if (match == arrayIndices.end())
+        {
+            match = arrayIndices.insert({ key, arrayLayers.size() }).first;
+            arrayLayers.push_back({});
+        }
+        imageLocations[i] = { (int)match->second, (int)arrayLayers[match->second].size() };
+        arrayLayers[match->second].push_back(i);
+    }
+    if (arrayLayers.size() > MAX_MATERIAL_TEXTURE_ARRAYS)
+    {
+        EngineError("Too many different texture formats and sizes for a single material table!");
+    }
+
+    const ResourceManager::CreationTimer timer(ResourceManager::Resource::TEXTURE);
+
+    gli::gl GL(gli::gl::PROFILE_GL33);
+    for (const auto& layers : arrayLayers)
+    {
+        const gli::texture& first = images[layers.front()];
+        const gli::gl::format format = GL.translate(first.format(), first.swizzles());
+        const GLsizei levels = (GLsizei)first.levels();
+        const bool compressed = gli::is_compressed(first.format());
+
+        TEXs_.push_back(0);
+        unsigned int& TEX = TEXs_.back();
+        if (HasDirectStateAccess())
+        {
+            glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &TEX);
+            glTextureParameteri(TEX, GL_TEXTURE_MAX_LEVEL, levels - 1);
+            glTextureParameteri(TEX, GL_TEXTURE_SWIZZLE_R, format.Swizzles[0]);
+            glTextureParameteri(TEX, GL_TEXTURE_SWIZZLE_G, format.Swizzles[1]);
+            glTextureParameteri(TEX, GL_TEXTURE_SWIZZLE_B, format.Swizzles[2]);
+            glTextureParameteri(TEX, GL_TEXTURE_SWIZZLE_A, format.Swizzles[3]);
+            glTextureStorage3D(TEX, levels, format.Internal, (GLsizei)first.extent().x, (GLsizei)first.extent().y, (GLsizei)layers.size());
+            CheckGlError();
+        }
+        else
+        {
+            glGenTextures(1, &TEX);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, TEX);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_R, format.Swizzles[0]);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_G, format.Swizzles[1]);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_B, format.Swizzles[2]);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_A, format.Swizzles[3]);
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, format.Internal, (GLsizei)first.extent().x, (GLsizei)first.extent().y, (GLsizei)layers.size());
+            CheckGlError();
+        }
+
+        for (size_t layer = 0; layer < layers.size(); layer++)
+        {
+            const gli::texture& image = images[layers[layer]];
+            for (size_t level = 0; level < image.levels(); level++)
+            {
+                const glm::tvec3<GLsizei> extent(image.extent(level));
+                if (HasDirectStateAccess())
+                {
+                    if (compressed)
+                    {
+                        glCompressedTextureSubImage3D(TEX, (GLint)level, 0, 0, (GLint)layer, extent.x, extent.y, 1, format.Internal, (GLsizei)image.size(level), image.data(0, 0, level));
+                    }
+                    else
+                    {
+                        glTextureSubImage3D(TEX, (GLint)level, 0, 0, (GLint)layer, extent.x, extent.y, 1, format.External, format.Type, image.data(0, 0, level));
+                    }
+                }
+                else
+                {
+                    if (compressed)
+                    {
+                        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, (GLint)layer, extent.x, extent.y, 1, format.Internal, (GLsizei)image.size(level), image.data(0, 0, level));
+                    }
+                    else
+                    {
+                        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, (GLint)layer, extent.x, extent.y, 1, format.External, format.Type, image.data(0, 0, level));
+                    }
+                }
+                CheckGlError();
+            }
+        }
+        if (!HasDirectStateAccess())
+        {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        }
+        ResourceManager::Get().AppendNewTEX(TEX);
+        ResourceManager::Get().TrackMemory(ResourceManager::Resource::TEXTURE, TEX, first.size() * layers.size()); // Pinned, owned by the table. Every layer has the first one's layout.
+    }
+
+    // Material parameters, indexed by material id in the shaders.
+    std::vector<GpuMaterial> materials(def.entries.size());
+    for (size_t i = 0; i < def.entries.size(); i++)
+    {
+        const Entry& entry = def.entries[i];
+        materials[i].shininess = entry.shininess;
+        materials[i].flags = entry.flags;
+        if (entry.flags & Flags::MESH_TEXTURES) continue;
+        if (!entry.diffuseMap.empty())
+        {
+            const auto& location = imageLocations[imageIndices.at(entry.diffuseMap)];
+            materials[i].diffuseArray = location.first;
+            materials[i].diffuseLayer = location.second;
+        }
+        if (!entry.normalMap.empty())
+        {
+            const auto& location = imageLocations[imageIndices.at(entry.normalMap)];
+            materials[i].normalArray = location.first;
+            materials[i].normalLayer = location.second;
+        }
+    }
+    nrOfMaterials_ = materials.size();
+
+    if (HasDirectStateAccess())
+    {
+        glCreateBuffers(1, &SSBO_);
+        glNamedBufferStorage(SSBO_, materials.size() * sizeof(GpuMaterial), materials.data(), 0);
+    }
+    else
+    {
+        glGenBuffers(1, &SSBO_);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, SSBO_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, materials.size() * sizeof(GpuMaterial), materials.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    CheckGlError();
+    ResourceManager::Get().AppendNewVBO(SSBO_);
+
+    Sampler sampler;
+    sampler.Create(def.sampler);
+    SAMPLERs_ = std::vector<unsigned int>(TEXs_.size(), sampler.GetSAMPLER());
+}
+
+void gl::MaterialTable::Destroy()
+{
+    for (const auto TEX : TEXs_)
+    {
+        ResourceManager::Get().DeleteTEX(TEX);
+    }
+    TEXs_.clear();
+    SAMPLERs_.clear();
+    if (SSBO_ != 0)
+    {
+        ResourceManager::Get().DeleteVBO(SSBO_);
+        SSBO_ = 0;
+    }
+    nrOfMaterials_ = 0;
+}
+
+void gl::MaterialTable::Bind() const
+{
+    assert(SSBO_ != 0);
+    if (!TEXs_.empty())
+    {
+        glBindTextures(MATERIAL_TEXTURE_ARRAYS_UNIT, (GLsizei)TEXs_.size(), TEXs_.data());
+        glBindSamplers(MATERIAL_TEXTURE_ARRAYS_UNIT, (GLsizei)SAMPLERs_.size(), SAMPLERs_.data());
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_TABLE_BINDING, SSBO_);
+    CheckGlError();
+}
+
+void gl::MaterialTable::Unbind() const
+{
+    glBindTextures(MATERIAL_TEXTURE_ARRAYS_UNIT, (GLsizei)MAX_MATERIAL_TEXTURE_ARRAYS, nullptr);
+    glBindSamplers(MATERIAL_TEXTURE_ARRAYS_UNIT, (GLsizei)MAX_MATERIAL_TEXTURE_ARRAYS, nullptr);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_TABLE_BINDING, 0);
+    CheckGlError();
+}
+
+void gl::MaterialTable::SetupMaterialIdAttribute(unsigned int VAO, unsigned int VBO)
+{
+    if (HasDirectStateAccess())
+    {
+        glVertexArrayVertexBuffer(VAO, MATERIAL_ID_LOCATION, VBO, 0, sizeof(unsigned int));
+        glEnableVertexArrayAttrib(VAO, MATERIAL_ID_LOCATION);
+        glVertexArrayAttribIFormat(VAO, MATERIAL_ID_LOCATION, 1, GL_UNSIGNED_INT, 0);
+        glVertexArrayAttribBinding(VAO, MATERIAL_ID_LOCATION, MATERIAL_ID_LOCATION);
+        glVertexArrayBindingDivisor(VAO, MATERIAL_ID_LOCATION, 1);
+    }
+    else
+    {
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glEnableVertexAttribArray(MATERIAL_ID_LOCATION);
+        glVertexAttribIPointer(MATERIAL_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*)0);
+        glVertexAttribDivisor(MATERIAL_ID_LOCATION, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+    CheckGlError();
+}
+
+std::vector<gl::MaterialTable::Entry> gl::MaterialTable::EntriesFromObj(const std::vector<ResourceManager::ObjData>& objData)
+{
+    std::vector<Entry> returnVal;
+    for (const auto& mesh : objData)
+    {
+        Entry entry;
+        if (!mesh.diffuseMap.empty()) entry.diffuseMap = mesh.dir + mesh.diffuseMap;
+        if (!mesh.normalMap.empty()) entry.normalMap = mesh.dir + mesh.normalMap;
+        if (mesh.shininess > 1.0f) entry.shininess = mesh.shininess;
+        returnVal.push_back(entry);
+    }
+    return returnVal;
+}
+
+size_t gl::MaterialTable::GetNrOfMaterials() const
+{
+    return nrOfMaterials_;
+}
+
+size_t gl::MaterialTable::GetNrOfTextureArrays() const
+{
+    return TEXs_.size();
+}
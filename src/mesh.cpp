@@ -1,10 +1,15 @@
 #include "mesh.h"
 
-#include <numeric>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
 
 #include <glad/glad.h>
 
+#include "material_table.h"
+#include "resource_manager.h"
+
 void gl::Mesh::Create(const VertexBuffer::Definition vbdef, const Material::Definition matdef)
 {
     if (vb_.GetVAOandVBO()[0] != 0)
@@ -16,13 +21,30 @@ void gl::Mesh::Create(const VertexBuffer::Definition vbdef, const Material::Defi
     {
         // Compute spherical bounds by using the distance to the furthest vertex of the mesh as a radius.
         float furthestDistanceToVertex = 0.0f;
-        const size_t stride = (size_t)std::accumulate(vbdef.dataLayout.begin(), vbdef.dataLayout.end(), 0u);
-        assert(stride > 2); // For 2D objects, no sense in having a bounding sphere. 2D objects are always in the camera's frustum.
-        // Assuming the very first element in vbdef.data is a position.
-        for (size_t vertex = 0; vertex < vbdef.data.size(); vertex += stride)
+        if (!vbdef.packedData.empty())
+        {
+            // Packed vertices keep their position as the first attribute too, full floats.
+            const auto& position = vbdef.packedLayout[0];
+            assert(position.size == 3 && position.type == VertexBuffer::AttributeType::FLOAT);
+            const size_t stride = position.stride != 0 ? position.stride : vbdef.packedStride;
+            const size_t verticesCount = vbdef.packedVerticesCount != 0 ? vbdef.packedVerticesCount : vbdef.packedData.size() / vbdef.packedStride;
+            for (size_t vertex = 0; vertex < verticesCount; vertex++)
+            {
+                glm::vec3 currentVertexPos;
+                std::memcpy(&currentVertexPos, vbdef.packedData.data() + position.offset + vertex * stride, sizeof(glm::vec3));
+                furthestDistanceToVertex = std::max(furthestDistanceToVertex, glm::length(currentVertexPos));
+            }
+        }
+        else
         {
-            const glm::vec3 currentVertexPos = { vbdef.data[vertex], vbdef.data[vertex + 1], vbdef.data[vertex + 2] };
-            furthestDistanceToVertex = std::max(furthestDistanceToVertex, glm::length(currentVertexPos));
+            const size_t stride = (size_t)std::accumulate(vbdef.dataLayout.begin(), vbdef.dataLayout.end(), 0u);
+            assert(stride > 2); // For 2D objects, no sense in having a bounding sphere. 2D objects are always in the camera's frustum.
+            // Assuming the very first element in vbdef.data is a position.
+            for (size_t vertex = 0; vertex < vbdef.data.size(); vertex += stride)
+            {
+                const glm::vec3 currentVertexPos = { vbdef.data[vertex], vbdef.data[vertex + 1], vbdef.data[vertex + 2] };
+                furthestDistanceToVertex = std::max(furthestDistanceToVertex, glm::length(currentVertexPos));
+            }
         }
         boundingSphereRadius_ = furthestDistanceToVertex;
     }
@@ -37,38 +59,47 @@ void gl::Mesh::Create(const VertexBuffer::Definition vbdef, const Material::Defi
     CheckGlError();
 }
 
-/*void gl::Mesh::Draw(const std::vector<glm::mat4>& modelMatrices, Shader& shader, bool updateModels, size_t transformModelOffset)
+void gl::Mesh::Draw(size_t nrOfInstances, unsigned int modelMatricesVBO, size_t modelMatrixOffset, unsigned int materialIdsVBO) const
 {
-    if (updateModels)
+    // Pointed to every draw, identical vertex buffers share their VAO between models.
+    if (materialIdsVBO != 0)
     {
-        const auto& vaoAndVbo = vb_.GetVAOandVBO();
-        glBindVertexArray(vaoAndVbo[0]);
-
-        // Update pointers here in case multiple models use the same VAO/VBO.
-        glEnableVertexAttribArray((unsigned int)transformModelOffset);
-        glVertexAttribPointer((unsigned int)transformModelOffset, 4, GL_FLOAT, GL_FALSE, 4 * 4 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray((unsigned int)transformModelOffset + 1);
-        glVertexAttribPointer((unsigned int)transformModelOffset + 1, 4, GL_FLOAT, GL_FALSE, 4 * 4 * sizeof(float), (void*)(4 * sizeof(float)));
-        glEnableVertexAttribArray((unsigned int)transformModelOffset + 2);
-        glVertexAttribPointer((unsigned int)transformModelOffset + 2, 4, GL_FLOAT, GL_FALSE, 4 * 4 * sizeof(float), (void*)(2 * 4 * sizeof(float)));
-        glEnableVertexAttribArray((unsigned int)transformModelOffset + 3);
-        glVertexAttribPointer((unsigned int)transformModelOffset + 3, 4, GL_FLOAT, GL_FALSE, 4 * 4 * sizeof(float), (void*)(3 * 4 * sizeof(float)));
-        glVertexAttribDivisor((unsigned int)transformModelOffset, 1);
-        glVertexAttribDivisor((unsigned int)transformModelOffset + 1, 1);
-        glVertexAttribDivisor((unsigned int)transformModelOffset + 2, 1);
-        glVertexAttribDivisor((unsigned int)transformModelOffset + 3, 1);
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
-        CheckGlError();
+        MaterialTable::SetupMaterialIdAttribute(vb_.GetVAOandVBO()[0], materialIdsVBO);
+    }
+    glBindVertexArray(vb_.GetVAOandVBO()[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, modelMatricesVBO);
+    for (unsigned int column = 0; column < 4; column++)
+    {
+        const unsigned int location = (unsigned int)modelMatrixOffset + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
     }
-    
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    CheckGlError();
+
     material_.Bind();
-    shader.Bind();
-    vb_.Draw(modelMatrices.size());
-    shader.Unbind();
+    vb_.Draw((int)nrOfInstances);
     material_.Unbind();
-}*/
+}
+
+void gl::Mesh::RequestTextureLevels(const std::vector<glm::mat4>& modelMatrices) const
+{
+    if (modelMatrices.empty() || boundingSphereRadius_ <= 0.0f) return;
+
+    // Pixels across the bounding sphere's projection, the textures cover about that much of the screen.
+    const glm::vec3 cameraPos = ResourceManager::Get().GetCamera().GetPosition();
+    const float pixelsPerUnitAtOne = SCREEN_RESOLUTION[1] / (2.0f * std::tan(PROJECTION_FOV * 0.5f));
+    float screenSize = 0.0f;
+    for (const auto& modelMatrix : modelMatrices)
+    {
+        const glm::vec3 scale = glm::vec3(glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2])));
+        const float radius = boundingSphereRadius_ * std::max(std::max(scale.x, scale.y), scale.z);
+        const float distance = std::max(glm::length(glm::vec3(modelMatrix[3]) - cameraPos), radius); // Inside the sphere, as close as it gets.
+        screenSize = std::max(screenSize, 2.0f * radius * pixelsPerUnitAtOne / distance);
+    }
+    material_.RequestTextureLevels(screenSize);
+}
 
 float gl::Mesh::GetBoundingSphereRadius() const
 {
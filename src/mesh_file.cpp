@@ -0,0 +1,204 @@
+#include "mesh_file.h"
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include <glm/gtc/packing.hpp>
+
+#include "defines.h"
+#include "hasher.h"
+
+static_assert(sizeof(gl::MeshFile::Header) % alignof(gl::MeshFile::Mesh) == 0, "Meshes are used in place from the mapping.");
+static_assert(sizeof(gl::MeshFile::Vertex) == 24, "Vertices are uploaded as they are stored.");
+
+namespace
+{
+    size_t AlignUp(const size_t value)
+    {
+        return (value + gl::MeshFile::ALIGNMENT - 1) & ~(gl::MeshFile::ALIGNMENT - 1);
+    }
+
+    gl::MeshFile::String AddString(std::string& strings, const std::string& string)
+    {
+        const gl::MeshFile::String added = { (uint32_t)strings.size(), (uint32_t)string.size() };
+        strings += string;
+        return added;
+    }
+}//!anonymous
+
+bool gl::MeshFile::Open(std::string_view path)
+{
+    Close();
+    FileSystem::File file = FileSystem::Get().Read(path);
+    if (!file.Exists()) return false;
+
+    Header header;
+    if (file.GetSize() >= sizeof(Header)) std::memcpy(&header, file.GetData(), sizeof(Header));
+    const size_t stringsOffset = sizeof(Header) + (size_t)header.nrOfMeshes * sizeof(Mesh);
+    if (file.GetSize() < sizeof(Header) || header.magic != MAGIC || header.version != VERSION ||
+        reinterpret_cast<uintptr_t>(file.GetData()) % alignof(Mesh) != 0 || stringsOffset + header.stringsSize > file.GetSize())
+    {
+        EngineWarning(("Invalid mesh file " + std::string(path) + ".").c_str());
+        return false;
+    }
+    const std::span<const Mesh> meshes(reinterpret_cast<const Mesh*>(file.GetData() + sizeof(Header)), header.nrOfMeshes);
+    for (const auto& mesh : meshes)
+    {
+        if (mesh.verticesOffset + (uint64_t)mesh.nrOfVertices * sizeof(Vertex) > file.GetSize() ||
+            mesh.indicesOffset + (uint64_t)mesh.nrOfIndices * sizeof(uint32_t) > file.GetSize() ||
+            mesh.verticesOffset % ALIGNMENT != 0 || mesh.indicesOffset % ALIGNMENT != 0)
+        {
+            EngineWarning(("Truncated mesh file " + std::string(path) + ".").c_str());
+            return false;
+        }
+    }
+
+    meshes_ = meshes;
+    strings_ = std::string_view(file.GetData() + stringsOffset, header.stringsSize);
+    file_ = std::move(file);
+    return true;
+}
+
+void gl::MeshFile::Close()
+{
+    file_ = {};
+    meshes_ = {};
+    strings_ = {};
+}
+
+bool gl::MeshFile::IsOpen() const
+{
+    return file_.Exists();
+}
+
+std::span<const gl::MeshFile::Mesh> gl::MeshFile::GetMeshes() const
+{
+    return meshes_;
+}
+
+std::string_view gl::MeshFile::GetString(const String& string) const
+{
+    assert((size_t)string.offset + string.size <= strings_.size());
+    return strings_.substr(string.offset, string.size);
+}
+
+gl::VertexBuffer::Definition gl::MeshFile::GetVertexBufferDefinition(const Mesh& mesh) const
+{
+    assert(IsOpen());
+    using Type = VertexBuffer::AttributeType;
+    VertexBuffer::Definition def;
+    def.packedData = std::span<const char>(file_.GetData() + mesh.verticesOffset, (size_t)mesh.nrOfVertices * sizeof(Vertex));
+    def.packedLayout =
+    {
+        { 3, Type::FLOAT, false, (unsigned int)offsetof(Vertex, position) },
+        { 2, Type::HALF_FLOAT, false, (unsigned int)offsetof(Vertex, uv) },
+        { 4, Type::INT_2_10_10_10_REV, true, (unsigned int)offsetof(Vertex, normal) }, // The shaders' vec3 drop the 2 bits of w.
+        { 4, Type::INT_2_10_10_10_REV, true, (unsigned int)offsetof(Vertex, tangent) }
+    };
+    def.packedStride = sizeof(Vertex);
+    def.indices = std::span<const char>(file_.GetData() + mesh.indicesOffset, (size_t)mesh.nrOfIndices * sizeof(uint32_t));
+    def.indexType = VertexBuffer::IndexType::UNSIGNED_INT;
+    return def;
+}
+
+gl::ResourceManager::ObjData gl::MeshFile::GetMaterialData(const Mesh& mesh) const
+{
+    assert(IsOpen());
+    ResourceManager::ObjData objData;
+    objData.dir = GetString(mesh.dir);
+    objData.alphaMap = GetString(mesh.alphaMap);
+    objData.normalMap = GetString(mesh.normalMap);
+    objData.diffuseMap = GetString(mesh.diffuseMap);
+    objData.specularMap = GetString(mesh.specularMap);
+    objData.shininess = mesh.shininess;
+    return objData;
+}
+
+bool gl::MeshFile::Write(const std::string& path, const std::vector<ResourceManager::ObjData>& meshes)
+{
+    std::vector<Mesh> entries(meshes.size());
+    std::vector<std::vector<Vertex>> vertices(meshes.size());
+    std::vector<std::vector<uint32_t>> indices(meshes.size());
+    std::string strings;
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        const auto& obj = meshes[i];
+        assert(obj.uvs.size() == obj.positions.size() && obj.normals.size() == obj.positions.size() && obj.tangents.size() == obj.positions.size());
+
+        // Triangle lists repeat every shared vertex, identical packed vertices are kept once.
+        std::unordered_map<uint64_t, uint32_t> indexOfVertex;
+        indices[i].reserve(obj.positions.size());
+        for (size_t v = 0; v < obj.positions.size(); v++)
+        {
+            Vertex vertex;
+            std::memcpy(vertex.position, &obj.positions[v], sizeof(vertex.position));
+            vertex.uv = glm::packHalf2x16(obj.uvs[v]);
+            vertex.normal = glm::packSnorm3x10_1x2(glm::vec4(obj.normals[v], 0.0f));
+            vertex.tangent = glm::packSnorm3x10_1x2(glm::vec4(obj.tangents[v], 0.0f));
+
+            Hasher hasher(HASHING_SEED);
+            hasher.AddBytes(&vertex, sizeof(Vertex));
+            const auto [match, inserted] = indexOfVertex.insert({ hasher.Digest64(), (uint32_t)vertices[i].size() });
+            if (inserted || std::memcmp(&vertices[i][match->second], &vertex, sizeof(Vertex)) != 0)
+            {
+                indices[i].push_back((uint32_t)vertices[i].size()); // Hash collisions just aren't shared.
+                vertices[i].push_back(vertex);
+            }
+            else
+            {
+                indices[i].push_back(match->second);
+            }
+        }
+
+        Mesh& entry = entries[i];
+        entry.nrOfVertices = (uint32_t)vertices[i].size();
+        entry.nrOfIndices = (uint32_t)indices[i].size();
+        entry.dir = AddString(strings, obj.dir);
+        entry.alphaMap = AddString(strings, obj.alphaMap);
+        entry.normalMap = AddString(strings, obj.normalMap);
+        entry.diffuseMap = AddString(strings, obj.diffuseMap);
+        entry.specularMap = AddString(strings, obj.specularMap);
+        entry.shininess = obj.shininess;
+    }
+
+    Header header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.nrOfMeshes = (uint32_t)entries.size();
+    header.stringsSize = (uint32_t)strings.size();
+    size_t offset = AlignUp(sizeof(Header) + entries.size() * sizeof(Mesh) + strings.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        entries[i].verticesOffset = offset;
+        offset = AlignUp(offset + vertices[i].size() * sizeof(Vertex));
+        entries[i].indicesOffset = offset;
+        offset = AlignUp(offset + indices[i].size() * sizeof(uint32_t));
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        EngineWarning(("Could not write " + path + ".").c_str());
+        return false;
+    }
+    const char padding[ALIGNMENT] = {};
+    size_t position = 0;
+    const auto write = [&](const void* data, const size_t size, const size_t at)
+    {
+        file.write(padding, (std::streamsize)(at - position));
+        file.write(static_cast<const char*>(data), (std::streamsize)size);
+        position = at + size;
+    };
+    write(&header, sizeof(Header), 0);
+    write(entries.data(), entries.size() * sizeof(Mesh), position);
+    write(strings.data(), strings.size(), position);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        write(vertices[i].data(), vertices[i].size() * sizeof(Vertex), (size_t)entries[i].verticesOffset);
+        write(indices[i].data(), indices[i].size() * sizeof(uint32_t), (size_t)entries[i].indicesOffset);
+    }
+    file.write(padding, (std::streamsize)(AlignUp(position) - position));
+    return file.good();
+}
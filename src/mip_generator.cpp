@@ -0,0 +1,301 @@
+#include "mip_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <gli/gli.hpp>
+
+#include "defines.h"
+#if GL_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#if GL_SIMD_AVX
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    constexpr size_t TEXELS_PER_THREAD = 16384; // Smaller levels aren't worth starting threads for.
+    constexpr size_t MAX_NR_OF_TAPS = 6;
+    constexpr float KAISER_ALPHA = 4.0f;
+    constexpr int ALPHA_COVERAGE_ITERATIONS = 10;
+
+    // Source texels 2 * x + first to 2 * x + first + nrOfTaps - 1 make destination texel x.
+    struct Kernel
+    {
+        int first = 0;
+        int nrOfTaps = 1;
+        float weights[MAX_NR_OF_TAPS] = { 1.0f };
+    };
+
+    float Sinc(const float x)
+    {
+        constexpr float PI = 3.14159265358979f;
+        return x == 0.0f ? 1.0f : std::sin(PI * x) / (PI * x);
+    }
+
+    // Modified Bessel function of the first kind, order 0.
+    float Bessel0(const float x)
+    {
+        float sum = 1.0f, term = 1.0f;
+        for (int k = 1; k < 16; k++)
+        {
+            term *= (x * 0.5f / (float)k) * (x * 0.5f / (float)k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    Kernel MakeKernel(const gl::MipGenerator::Filter filter, const size_t sourceSize)
+    {
+        Kernel kernel;
+        if (sourceSize == 1) return kernel; // The axis isn't halved any more.
+        if (filter == gl::MipGenerator::Filter::BOX)
+        {
+            kernel.nrOfTaps = 2;
+            kernel.weights[0] = kernel.weights[1] = 0.5f;
+            return kernel;
+        }
+
+        // Destination centers fall between source texels 2 * x and 2 * x + 1, the taps are 0.5, 1.5 and 2.5 source texels away on each side.
+        constexpr float RADIUS = 3.0f;
+        kernel.first = -2;
+        kernel.nrOfTaps = 6;
+        float sum = 0.0f;
+        for (int tap = 0; tap < kernel.nrOfTaps; tap++)
+        {
+            const float distance = (float)tap - 2.5f;
+            const float window = Bessel0(KAISER_ALPHA * std::sqrt(1.0f - (distance / RADIUS) * (distance / RADIUS))) / Bessel0(KAISER_ALPHA);
+            kernel.weights[tap] = Sinc(distance * 0.5f) * window;
+            sum += kernel.weights[tap];
+        }
+        for (int tap = 0; tap < kernel.nrOfTaps; tap++)
+        {
+            kernel.weights[tap] /= sum;
+        }
+        return kernel;
+    }
+
+    struct Conversions
+    {
+        float toLinear[256] = {};
+        float toUnorm[256] = {};
+        uint8_t toSrgb[4096] = {}; // By linear value * 4095.
+
+        Conversions()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                const float value = (float)i / 255.0f;
+                toUnorm[i] = value;
+                toLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < 4096; i++)
+            {
+                const float value = (float)i / 4095.0f;
+                const float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+                toSrgb[i] = (uint8_t)std::clamp((int)(encoded * 255.0f + 0.5f), 0, 255);
+            }
+        }
+    };
+
+    const Conversions& GetConversions()
+    {
+        static const Conversions conversions;
+        return conversions;
+    }
+
+    void FilterRowHorizontally(const float* source, const size_t sourceWidth, const Kernel& kernel, float* destination, const size_t destinationWidth)
+    {
+        for (size_t x = 0; x < destinationWidth; x++)
+        {
+#if GL_SIMD_SSE2
+            __m128 sum = _mm_setzero_ps();
+            for (int tap = 0; tap < kernel.nrOfTaps; tap++)
+            {
+                const size_t sourceX = (size_t)std::clamp((int64_t)(2 * x) + kernel.first + tap, (int64_t)0, (int64_t)sourceWidth - 1);
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source + sourceX * 4), _mm_set1_ps(kernel.weights[tap])));
+            }
+            _mm_storeu_ps(destination + x * 4, sum);
+#else
+            float sum[4] = {};
+            for (int tap = 0; tap < kernel.nrOfTaps; tap++)
+            {
+                const size_t sourceX = (size_t)std::clamp((int64_t)(2 * x) + kernel.first + tap, (int64_t)0, (int64_t)sourceWidth - 1);
+                for (size_t c = 0; c < 4; c++)
+                {
+                    sum[c] += source[sourceX * 4 + c] * kernel.weights[tap];
+                }
+            }
+            std::memcpy(destination + x * 4, sum, sizeof(sum));
+#endif
+        }
+    }
+
+    void FilterRowVertically(const float* const* rows, const Kernel& kernel, float* destination, const size_t nrOfFloats)
+    {
+        size_t i = 0;
+#if GL_SIMD_AVX
+        for (; i + 8 <= nrOfFloats; i += 8)
+        {
+            __m256 sum = _mm256_setzero_ps();
+            for (int tap = 0; tap < kernel.nrOfTaps; tap++)
+            {
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(rows[tap] + i), _mm256_set1_ps(kernel.weights[tap])));
+            }
+            _mm256_storeu_ps(destination + i, sum);
+        }
+#endif
+#if GL_SIMD_SSE2
+        for (; i + 4 <= nrOfFloats; i += 4)
+        {
+            __m128 sum = _mm_setzero_ps();
+            for (int tap = 0; tap < kernel.nrOfTaps; tap++)
+            {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[tap] + i), _mm_set1_ps(kernel.weights[tap])));
+            }
+            _mm_storeu_ps(destination + i, sum);
+        }
+#endif
+        for (; i < nrOfFloats; i++)
+        {
+            float sum = 0.0f;
+            for (int tap = 0; tap < kernel.nrOfTaps; tap++)
+            {
+                sum += rows[tap][i] * kernel.weights[tap];
+            }
+            destination[i] = sum;
+        }
+    }
+
+    float GetAlphaCoverage(const std::vector<float>& level, const float alphaReference)
+    {
+        size_t covered = 0;
+        for (size_t i = 3; i < level.size(); i += 4)
+        {
+            covered += level[i] > alphaReference ? 1 : 0;
+        }
+        return (float)covered / (float)(level.size() / 4);
+    }
+
+    // Scale bringing the alpha coverage of level back to coverage: the alpha reference that gives it is searched, then mapped to the cutoff.
+    float FindAlphaScale(const std::vector<float>& level, const float alphaCutoff, const float coverage)
+    {
+        float low = 0.0f, high = 1.0f, reference = alphaCutoff;
+        for (int i = 0; i < ALPHA_COVERAGE_ITERATIONS; i++)
+        {
+            if (GetAlphaCoverage(level, reference) > coverage) low = reference;
+            else high = reference;
+            reference = (low + high) * 0.5f;
+        }
+        // Filtered alpha often takes a few values only, the coverage jumps between low and high: keep the closest.
+        reference = std::abs(GetAlphaCoverage(level, low) - coverage) < std::abs(GetAlphaCoverage(level, high) - coverage) ? low : high;
+        return reference > 0.0f ? alphaCutoff / reference : 1.0f;
+    }
+}//!anonymous
+
+size_t gl::MipGenerator::GetNrOfLevels(size_t width, size_t height)
+{
+    size_t levels = 1;
+    for (size_t size = std::max(width, height); size > 1; size >>= 1)
+    {
+        levels++;
+    }
+    return levels;
+}
+
+size_t gl::MipGenerator::GetLevelOffset(size_t width, size_t height, size_t level)
+{
+    size_t offset = 0;
+    for (size_t i = 0; i < level; i++)
+    {
+        offset += std::max<size_t>(1, width >> i) * std::max<size_t>(1, height >> i) * 4;
+    }
+    return offset;
+}
+
+size_t gl::MipGenerator::GetChainSize(size_t width, size_t height)
+{
+    return GetLevelOffset(width, height, GetNrOfLevels(width, height));
+}
+
+void gl::MipGenerator::Generate(const uint8_t* rgba, size_t width, size_t height, const Definition& def, uint8_t* chain)
+{
+    if (width == 0 || height == 0) return;
+    const Conversions& conversions = GetConversions();
+    const float* const toFloat = def.srgb ? conversions.toLinear : conversions.toUnorm;
+
+    // Levels are filtered from the float result of the previous one, only what is written to the chain is quantized.
+    std::vector<float> source(width * height * 4), horizontal, destination;
+    for (size_t i = 0; i < width * height * 4; i++)
+    {
+        source[i] = (i & 3) == 3 ? conversions.toUnorm[rgba[i]] : toFloat[rgba[i]];
+    }
+    if (rgba != chain) std::memcpy(chain, rgba, width * height * 4);
+    const float coverage = def.alphaCutoff > 0.0f ? GetAlphaCoverage(source, def.alphaCutoff) : 0.0f;
+
+    size_t sourceWidth = width, sourceHeight = height;
+    const size_t nrOfLevels = GetNrOfLevels(width, height);
+    for (size_t level = 1; level < nrOfLevels; level++)
+    {
+        const size_t levelWidth = std::max<size_t>(1, sourceWidth / 2), levelHeight = std::max<size_t>(1, sourceHeight / 2);
+        const Kernel horizontalKernel = MakeKernel(def.filter, sourceWidth), verticalKernel = MakeKernel(def.filter, sourceHeight);
+
+        horizontal.resize(levelWidth * sourceHeight * 4);
+        gl::ParallelFor(sourceHeight, sourceWidth, TEXELS_PER_THREAD, [&](const size_t y)
+        {
+            FilterRowHorizontally(source.data() + y * sourceWidth * 4, sourceWidth, horizontalKernel, horizontal.data() + y * levelWidth * 4, levelWidth);
+        });
+        destination.resize(levelWidth * levelHeight * 4);
+        gl::ParallelFor(levelHeight, levelWidth, TEXELS_PER_THREAD, [&](const size_t y)
+        {
+            const float* rows[MAX_NR_OF_TAPS];
+            for (int tap = 0; tap < verticalKernel.nrOfTaps; tap++)
+            {
+                const size_t sourceY = (size_t)std::clamp((int64_t)(2 * y) + verticalKernel.first + tap, (int64_t)0, (int64_t)sourceHeight - 1);
+                rows[tap] = horizontal.data() + sourceY * levelWidth * 4;
+            }
+            FilterRowVertically(rows, verticalKernel, destination.data() + y * levelWidth * 4, levelWidth * 4);
+        });
+
+        // The scale only applies to the stored level, the next one is still filtered from the unscaled alpha.
+        const float alphaScale = def.alphaCutoff > 0.0f ? FindAlphaScale(destination, def.alphaCutoff, coverage) : 1.0f;
+        uint8_t* const stored = chain + GetLevelOffset(width, height, level);
+        gl::ParallelFor(levelHeight, levelWidth, TEXELS_PER_THREAD, [&](const size_t y)
+        {
+            for (size_t i = y * levelWidth * 4; i < (y + 1) * levelWidth * 4; i += 4)
+            {
+                for (size_t c = 0; c < 3; c++)
+                {
+                    const float value = std::clamp(destination[i + c], 0.0f, 1.0f);
+                    stored[i + c] = def.srgb ? conversions.toSrgb[(int)(value * 4095.0f + 0.5f)] : (uint8_t)(value * 255.0f + 0.5f);
+                }
+                stored[i + 3] = (uint8_t)(std::clamp(destination[i + 3] * alphaScale, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        });
+
+        std::swap(source, destination);
+        sourceWidth = levelWidth;
+        sourceHeight = levelHeight;
+    }
+}
+
+gli::texture gl::MipGenerator::Generate(const gli::texture& image)
+{
+    const bool srgb = image.format() == gli::FORMAT_RGBA8_SRGB_PACK8;
+    if (image.empty() || image.target() != gli::TARGET_2D || image.levels() > 1 || (image.format() != gli::FORMAT_RGBA8_UNORM_PACK8 && !srgb)) return image;
+
+    const size_t width = (size_t)image.extent().x, height = (size_t)image.extent().y;
+    gli::texture2d mipmapped(image.format(), gli::extent2d(image.extent().x, image.extent().y), GetNrOfLevels(width, height));
+    Definition def;
+    def.srgb = srgb;
+    std::vector<uint8_t> chain(GetChainSize(width, height));
+    Generate(static_cast<const uint8_t*>(image.data(0, 0, 0)), width, height, def, chain.data());
+    for (size_t level = 0; level < mipmapped.levels(); level++)
+    {
+        std::memcpy(mipmapped.data(0, 0, level), chain.data() + GetLevelOffset(width, height, level), mipmapped.size(level));
+    }
+    return mipmapped;
+}
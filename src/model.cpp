@@ -1,30 +1,124 @@
 #include "model.h"
 
+#include <algorithm>
+
 #include <glad/glad.h>
 #include "tiny_obj_loader.h"
 #include "glm/gtc/quaternion.hpp"
 
 #include "resource_manager.h"
 
-/*void gl::Model::Create(std::vector<VertexBuffer::Definition> vb, std::vector<Material::Definition> mat, std::vector<glm::mat4> modelMatrices, const size_t modelMatrixOffset)
+void gl::Model::Create(std::vector<VertexBuffer::Definition> vb, std::vector<Material::Definition> mat, std::vector<glm::mat4> modelMatrices, const size_t modelMatrixOffset)
 {
+    if (modelMatricesVBO_ != 0)
+    {
+        EngineError("Calling Create() a second time...");
+    }
+    assert(vb.size() == mat.size());
+
     modelMatrices_ = modelMatrices;
     modelMatrixOffset_ = modelMatrixOffset;
+    CreateModelMatricesVBO();
 
-    assert(vb.size() == mat.size());
+    for (size_t i = 0; i < vb.size(); i++)
+    {
+        meshes_.push_back(Mesh());
+        meshes_.back().Create(vb[i], mat[i]);
+        CheckGlError();
+    }
+}
+
+void gl::Model::Create(const ResourceManager::GlbMesh& glbMesh, Sampler::Definition sampler, bool streamTextures)
+{
+    if (modelMatricesVBO_ != 0)
+    {
+        EngineError("Calling Create() a second time...");
+    }
+
+    modelMatrices_ = glbMesh.instances.empty() ? std::vector<glm::mat4>{ IDENTITY_MAT4 } : glbMesh.instances;
+    CreateModelMatricesVBO();
+
+    for (const auto& primitive : glbMesh.primitives)
+    {
+        Material::Definition material;
+        material.sampler = sampler;
+        material.streamMips = streamTextures;
+        if (!primitive.normalMap.empty())
+        {
+            material.texturePathsAndTypes.push_back({ primitive.dir + primitive.normalMap, Texture::Type::NORMALMAP });
+        }
+        if (!primitive.diffuseMap.empty())
+        {
+            material.texturePathsAndTypes.push_back({ primitive.dir + primitive.diffuseMap, Texture::Type::DIFFUSE });
+        }
+        meshes_.push_back(Mesh());
+        meshes_.back().Create(primitive.vertexBuffer, material);
+        CheckGlError();
+    }
+}
+
+void gl::Model::Create(const MeshFile& meshFile, std::vector<glm::mat4> modelMatrices, Sampler::Definition sampler, bool streamTextures)
+{
+    if (modelMatricesVBO_ != 0)
+    {
+        EngineError("Calling Create() a second time...");
+    }
 
+    modelMatrices_ = modelMatrices;
+    CreateModelMatricesVBO();
+
+    for (const auto& mesh : meshFile.GetMeshes())
+    {
+        Material::Definition material = ResourceManager::PreprocessMaterialData({ meshFile.GetMaterialData(mesh) })[0];
+        material.sampler = sampler;
+        material.streamMips = streamTextures;
+        meshes_.push_back(Mesh());
+        meshes_.back().Create(meshFile.GetVertexBufferDefinition(mesh), material);
+        CheckGlError();
+    }
+}
+
+void gl::Model::CreateModelMatricesVBO()
+{
     glGenBuffers(1, &modelMatricesVBO_);
     ResourceManager::Get().AppendNewVBO(modelMatricesVBO_);
     glBindBuffer(GL_ARRAY_BUFFER, modelMatricesVBO_);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * modelMatrices_.size(), &modelMatrices_[0][0], GL_DYNAMIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * modelMatrices_.size(), modelMatrices_.empty() ? nullptr : &modelMatrices_[0][0], GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    CheckGlError();
+    modelMatricesCapacity_ = modelMatrices_.size();
+}
 
-    for (size_t i = 0; i < vb.size(); i++)
+void gl::Model::UploadModelMatrices(const std::vector<glm::mat4>& modelMatrices)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, modelMatricesVBO_);
+    if (modelMatrices.size() > modelMatricesCapacity_) // Instances were added through GetModelMatrices().
     {
-        meshes_.push_back(Mesh());
-        meshes_.back().Create(vb[i], mat[i]);
-        CheckGlError();
+        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * modelMatrices.size(), &modelMatrices[0][0], GL_DYNAMIC_DRAW);
+        modelMatricesCapacity_ = modelMatrices.size();
     }
-}*/
+    else
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * modelMatrices.size(), &modelMatrices[0][0]);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    CheckGlError();
+
+    if (materialIdsVBO_ != 0 && materialIdsCapacity_ < modelMatricesCapacity_) // Every instance drawn needs an id.
+    {
+        UploadMaterialIds();
+    }
+}
+
+void gl::Model::UploadMaterialIds()
+{
+    const std::vector<unsigned int> materialIds(modelMatricesCapacity_, materialId_);
+    glBindBuffer(GL_ARRAY_BUFFER, materialIdsVBO_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(unsigned int) * materialIds.size(), materialIds.empty() ? nullptr : materialIds.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    CheckGlError();
+    materialIdsCapacity_ = materialIds.size();
+}
 
 void gl::Model::Draw(Shader& shader, bool bypassFrustumCulling)
 {
@@ -35,34 +129,39 @@ void gl::Model::Draw(Shader& shader, bool bypassFrustumCulling)
 
         if (modelMatricesToDraw.size() > 0)
         {
-            {
-                glBindBuffer(GL_ARRAY_BUFFER, modelMatricesVBO_);
-                glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * modelMatricesToDraw.size(), (void*)&modelMatricesToDraw[0][0]);
-
-            }
+            UploadModelMatrices(modelMatricesToDraw);
             for (size_t i = 0; i < meshes_.size(); i++)
             {
-                // meshes_[i].Draw(modelMatricesToDraw, shader, true, modelMatrixOffset_);
+                meshes_[i].RequestTextureLevels(modelMatricesToDraw);
+                meshes_[i].Draw(modelMatricesToDraw.size(), modelMatricesVBO_, modelMatrixOffset_, materialIdsVBO_);
             }
         }
     }
     else // Draw all models. Used for things like direct shadow rendering passes.
     {
+        if (modelMatrices_.size() > 0)
         {
-            if (modelMatrices_.size() > 0)
+            UploadModelMatrices(modelMatrices_);
+            for (size_t i = 0; i < meshes_.size(); i++)
             {
-                glBindBuffer(GL_ARRAY_BUFFER, modelMatricesVBO_);
-                glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * modelMatrices_.size(), (void*)&modelMatrices_[0][0]);
+                meshes_[i].Draw(modelMatrices_.size(), modelMatricesVBO_, modelMatrixOffset_, materialIdsVBO_);
             }
         }
-        for (size_t i = 0; i < meshes_.size(); i++)
-        {
-            // meshes_[i].Draw(modelMatrices_, shader, modelMatrices_.size() > 0, modelMatrixOffset_);
-        }
     }
     shader.Unbind();
 }
 
+void gl::Model::SetMaterialId(unsigned int materialId)
+{
+    if (materialIdsVBO_ == 0)
+    {
+        glGenBuffers(1, &materialIdsVBO_);
+        ResourceManager::Get().AppendNewVBO(materialIdsVBO_);
+    }
+    materialId_ = materialId;
+    UploadMaterialIds();
+}
+
 void gl::Model::Translate(glm::vec3 v, size_t modelMatrixIndex)
 {
     modelMatrices_[modelMatrixIndex] = glm::translate(modelMatrices_[modelMatrixIndex], v);
@@ -90,8 +189,8 @@ const std::vector<glm::mat4> gl::Model::ComputeVisibleModels() const
     std::vector<glm::mat4> returnVal;
 
     // Cull off screen meshes.
-    const float near = PROJECTION_NEAR;
-    const float far = PROJECTION_FAR;
+    const float near = PERSPECTIVE_NEAR;
+    const float far = PERSPECTIVE_FAR;
     const float aspect = SCREEN_RESOLUTION[0] / SCREEN_RESOLUTION[1];
     const float fovY = PROJECTION_FOV * 0.5f;
     const float fovX = std::atan(std::tan(PROJECTION_FOV * 0.5f) * aspect);
@@ -100,61 +199,64 @@ const std::vector<glm::mat4> gl::Model::ComputeVisibleModels() const
     const glm::vec3 up = ResourceManager::Get().GetCamera().GetUp();
     const glm::vec3 front = ResourceManager::Get().GetCamera().GetFront();
 
-    for (size_t mesh = 0; mesh < meshes_.size(); mesh++)
+    // Meshes of a model share its matrices, cull against the sphere bounding all of them so that each matrix is kept at most once.
+    float boundingSphereRadius = 0.0f;
+    for (const auto& mesh : meshes_)
     {
-        for (size_t i = 0; i < modelMatrices_.size(); i++)
-        {
-            const glm::vec3 column0 = modelMatrices_[i][0];
-            const glm::vec3 column1 = modelMatrices_[i][1];
-            const glm::vec3 column2 = modelMatrices_[i][2];
-            const glm::vec3 column3 = modelMatrices_[i][3];
-
-            const glm::vec3 relativeMeshPosition = column3 - cameraPos;
-            const glm::vec3 scale = glm::vec3(glm::length(column0), glm::length(column1), glm::length(column2)); // This only works for scale values > 0.
-            const float biggestScale = std::max(std::max(scale.x, scale.y), scale.z);
-            const float boundingSphereRadius = meshes_[mesh].GetBoundingSphereRadius();
-
-            { // Front and back.
-                const float projection = glm::dot(front, relativeMeshPosition);
-                if (projection < (near - boundingSphereRadius * biggestScale) || projection >(far + boundingSphereRadius * biggestScale))
-                {
-                    continue;
-                }
+        boundingSphereRadius = std::max(boundingSphereRadius, mesh.GetBoundingSphereRadius());
+    }
+
+    for (size_t i = 0; i < modelMatrices_.size(); i++)
+    {
+        const glm::vec3 column0 = modelMatrices_[i][0];
+        const glm::vec3 column1 = modelMatrices_[i][1];
+        const glm::vec3 column2 = modelMatrices_[i][2];
+        const glm::vec3 column3 = modelMatrices_[i][3];
+
+        const glm::vec3 relativeMeshPosition = column3 - cameraPos;
+        const glm::vec3 scale = glm::vec3(glm::length(column0), glm::length(column1), glm::length(column2)); // This only works for scale values > 0.
+        const float biggestScale = std::max(std::max(scale.x, scale.y), scale.z);
+
+        { // Front and back.
+            const float projection = glm::dot(front, relativeMeshPosition);
+            if (projection < (near - boundingSphereRadius * biggestScale) || projection >(far + boundingSphereRadius * biggestScale))
+            {
+                continue;
             }
-            { // Left.
-                const glm::vec3 normal = glm::angleAxis(fovX, up) * -right; // Normal to the left side of the frustum.
-                const float projection = glm::dot(normal, relativeMeshPosition);
-                if (projection > boundingSphereRadius * biggestScale) // projection is positive, meaning the position is outside the frustrum on the left.
-                {
-                    continue;
-                }
+        }
+        { // Left.
+            const glm::vec3 normal = glm::angleAxis(fovX, up) * -right; // Normal to the left side of the frustum.
+            const float projection = glm::dot(normal, relativeMeshPosition);
+            if (projection > boundingSphereRadius * biggestScale) // projection is positive, meaning the position is outside the frustrum on the left.
+            {
+                continue;
             }
-            { // Right.
-                const glm::vec3 normal = glm::angleAxis(-fovX, up) * right;
-                const float projection = glm::dot(normal, relativeMeshPosition);
-                if (projection > boundingSphereRadius * biggestScale)
-                {
-                    continue;
-                }
+        }
+        { // Right.
+            const glm::vec3 normal = glm::angleAxis(-fovX, up) * right;
+            const float projection = glm::dot(normal, relativeMeshPosition);
+            if (projection > boundingSphereRadius * biggestScale)
+            {
+                continue;
             }
-            { // Bottom.
-                const glm::vec3 normal = glm::angleAxis(fovY, -right) * -up;
-                const float projection = glm::dot(normal, relativeMeshPosition);
-                if (projection > boundingSphereRadius * biggestScale)
-                {
-                    continue;
-                }
+        }
+        { // Bottom.
+            const glm::vec3 normal = glm::angleAxis(fovY, -right) * -up;
+            const float projection = glm::dot(normal, relativeMeshPosition);
+            if (projection > boundingSphereRadius * biggestScale)
+            {
+                continue;
             }
-            { // Top.
-                const glm::vec3 normal = glm::angleAxis(-fovY, -right) * up;
-                const float projection = glm::dot(normal, relativeMeshPosition);
-                if (projection > boundingSphereRadius * biggestScale)
-                {
-                    continue;
-                }
+        }
+        { // Top.
+            const glm::vec3 normal = glm::angleAxis(-fovY, -right) * up;
+            const float projection = glm::dot(normal, relativeMeshPosition);
+            if (projection > boundingSphereRadius * biggestScale)
+            {
+                continue;
             }
-            returnVal.push_back(modelMatrices_[i]);
         }
+        returnVal.push_back(modelMatrices_[i]);
     }
 
     return returnVal;
@@ -0,0 +1,141 @@
+#include "program_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <glad/glad.h>
+#ifndef XXH_INLINE_ALL
+#define XXH_INLINE_ALL
+#endif // !XXH_INLINE_ALL
+#include "xxhash.h"
+
+#include "defines.h"
+#include "file_system.h"
+
+void gl::ProgramCache::SetDirectory(const std::string& directory)
+{
+    assert(!directory.empty());
+    directory_ = directory;
+    if (directory_.back() != '/') directory_ += '/';
+}
+
+bool gl::ProgramCache::IsSupported()
+{
+    if (isSupported_ == -1)
+    {
+        GLint nrOfFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nrOfFormats);
+        isSupported_ = nrOfFormats > 0 ? 1 : 0;
+
+        std::string driver;
+        for (const GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+        {
+            const GLubyte* value = glGetString(name);
+            if (value != nullptr) driver += reinterpret_cast<const char*>(value);
+            driver += '\n';
+        }
+        driverHash_ = XXH64(driver.data(), driver.size(), HASHING_SEED);
+        CheckGlError();
+    }
+    return isSupported_ == 1;
+}
+
+unsigned int gl::ProgramCache::Load(const uint64_t sourceHash)
+{
+    if (!IsSupported())
+    {
+        stats_.misses++;
+        return 0;
+    }
+
+    const std::string path = GetPath(sourceHash);
+    FileSystem::File file = FileSystem::Get().Read(path);
+    if (!file.Exists())
+    {
+        stats_.misses++;
+        return 0;
+    }
+
+    // The binary is handed to the driver straight from the file's span.
+    Header header;
+    std::span<const char> binary = {};
+    if (file.GetSize() >= sizeof(Header))
+    {
+        std::memcpy(&header, file.GetData(), sizeof(Header));
+        if (header.magic == MAGIC_) binary = file.GetSpan().subspan(sizeof(Header));
+    }
+    if (binary.empty() || binary.size() != header.binarySize)
+    {
+        file = {}; // Unmapped before removing it.
+        stats_.misses++;
+        stats_.rejected++;
+        std::remove(path.c_str());
+        return 0;
+    }
+
+    EngineGlScopeAllowingErrors("ProgramCache::Load"); // Drivers are allowed to refuse any binary.
+    const GLuint PROGRAM = glCreateProgram();
+    glProgramBinary(PROGRAM, (GLenum)header.binaryFormat, binary.data(), (GLsizei)binary.size());
+    GLint success = GL_FALSE;
+    glGetProgramiv(PROGRAM, GL_LINK_STATUS, &success);
+    if (success != GL_TRUE)
+    {
+        // Ex: after a driver update that kept the same version string.
+        glGetError(); // A rejected binary format raises GL_INVALID_ENUM, which isn't an error here.
+        glDeleteProgram(PROGRAM);
+        file = {};
+        stats_.misses++;
+        stats_.rejected++;
+        std::remove(path.c_str());
+        return 0;
+    }
+    CheckGlError();
+    stats_.hits++;
+    return PROGRAM;
+}
+
+void gl::ProgramCache::Store(const uint64_t sourceHash, const unsigned int PROGRAM)
+{
+    if (!IsSupported()) return;
+
+    GLint size = 0;
+    glGetProgramiv(PROGRAM, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0) return;
+
+    Header header;
+    header.magic = MAGIC_;
+    std::vector<char> binary((size_t)size);
+    GLsizei length = 0;
+    GLenum format = 0;
+    glGetProgramBinary(PROGRAM, size, &length, &format, binary.data());
+    CheckGlError();
+    header.binaryFormat = (uint32_t)format;
+    header.binarySize = (uint32_t)length;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    std::ofstream file(GetPath(sourceHash), std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        EngineWarning("Could not write to the program cache, programs will be compiled on every launch.");
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.write(binary.data(), length);
+}
+
+const gl::ProgramCache::Stats& gl::ProgramCache::GetStats() const
+{
+    return stats_;
+}
+
+std::string gl::ProgramCache::GetPath(const uint64_t sourceHash)
+{
+    const uint64_t keys[2] = { sourceHash, driverHash_ };
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)XXH64(keys, sizeof(keys), HASHING_SEED));
+    return directory_ + name + ".bin";
+}
@@ -1,9 +1,19 @@
 #include "resource_manager.h"
 
-#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <map>
 #include <numeric>
+#include <span>
+#include <streambuf>
+#include <string>
 
 #include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #ifndef XXH_INLINE_ALL
 #define XXH_INLINE_ALL
 #endif // !XXH_INLINE_ALL
@@ -13,15 +23,57 @@
 #endif // !TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
-// #include "material.h"
+#include "material.h"
+#include "async_loader.h"
 #include "defines.h"
+#include "file_system.h"
+
+namespace
+{
+    // Lets tinyobj's stream parser read a file's span in place.
+    class SpanStreamBuffer : public std::streambuf
+    {
+    public:
+        explicit SpanStreamBuffer(std::span<const char> data)
+        {
+            char* begin = const_cast<char*>(data.data()); // Only ever read from, no put area is set.
+            setg(begin, begin, begin + data.size());
+        }
+    };
+
+    // Reads the .mtl files an obj refers to through the FileSystem, relative to the obj's directory.
+    class FileSystemMaterialReader : public tinyobj::MaterialReader
+    {
+    public:
+        explicit FileSystemMaterialReader(std::string directory) : directory_(std::move(directory)) {}
+        bool operator()(const std::string& materialId, std::vector<tinyobj::material_t>* materials, std::map<std::string, int>* materialMap, std::string* warning, std::string* error) override
+        {
+            const gl::FileSystem::File file = gl::FileSystem::Get().Read(directory_ + materialId);
+            if (!file.Exists())
+            {
+                if (warning != nullptr) *warning += "Material file [ " + directory_ + materialId + " ] not found.\n";
+                return false;
+            }
+            SpanStreamBuffer buffer(file.GetSpan());
+            std::istream stream(&buffer);
+            tinyobj::LoadMtl(materialMap, materials, &stream, warning, error);
+            return true;
+        }
+    private:
+        std::string directory_;
+    };
+
+    // Handles held by other statics can be released after the ResourceManager was destroyed.
+    bool resourceManagerDestroyed = false;
+}//!anonymous
 
 gl::ResourceManager::~ResourceManager()
 {
     EngineWarning("Destroying an instance of ResourceManager. This should only happen at the end of the program's lifetime.");
+    resourceManagerDestroyed = true;
 }
 
-void gl::ResourceManager::Shutdown() const
+void gl::ResourceManager::Shutdown()
 {
     for (const auto& pair : PROGRAMs_)
     {
@@ -31,6 +83,10 @@ void gl::ResourceManager::Shutdown() const
     {
         glDeleteTextures(1, &pair.second);
     }
+    for (const auto& pair : SAMPLERs_)
+    {
+        glDeleteSamplers(1, &pair.second);
+    }
     for (const auto& pair : VBOs_)
     {
         glDeleteBuffers(1, &pair.second);
@@ -39,9 +95,16 @@ void gl::ResourceManager::Shutdown() const
     {
         glDeleteVertexArrays(1, &pair.second);
     }
+    for (auto& tracked : tracked_)
+    {
+        tracked.clear();
+    }
+    lru_.clear();
+    memoryStats_ = {};
+    trackedBytes_ = 0;
 }
 
-GLuint gl::ResourceManager::RequestVAO(XXH32_hash_t hash) const
+GLuint gl::ResourceManager::RequestVAO(uint64_t hash) const
 {
     const auto match = VAOs_.find(hash);
     if (match != VAOs_.end()) // Such a VAO exists already, return it'd gpu name.
@@ -52,7 +115,7 @@ GLuint gl::ResourceManager::RequestVAO(XXH32_hash_t hash) const
     else return 0; // No VAO with such data exists, let the caller create a new VBO.
 }
 
-void gl::ResourceManager::AppendNewVAO(unsigned int gpuName, XXH32_hash_t hash)
+void gl::ResourceManager::AppendNewVAO(unsigned int gpuName, uint64_t hash)
 {
     if (hash == 0) hash = (unsigned int)VAOs_.size();
     assert(VAOs_.find(hash) == VAOs_.end());
@@ -60,7 +123,7 @@ void gl::ResourceManager::AppendNewVAO(unsigned int gpuName, XXH32_hash_t hash)
     VAOs_.insert({ hash, gpuName });
 }
 
-GLuint gl::ResourceManager::RequestVBO(XXH32_hash_t hash) const
+GLuint gl::ResourceManager::RequestVBO(uint64_t hash) const
 {
     const auto match = VBOs_.find(hash);
     if (match != VBOs_.end())
@@ -71,7 +134,7 @@ GLuint gl::ResourceManager::RequestVBO(XXH32_hash_t hash) const
     else return 0;
 }
 
-void gl::ResourceManager::AppendNewVBO(unsigned int gpuName, XXH32_hash_t hash)
+void gl::ResourceManager::AppendNewVBO(unsigned int gpuName, uint64_t hash)
 {
     if (hash == 0) hash = (unsigned int)VBOs_.size();
     assert(VBOs_.find(hash) == VBOs_.end());
@@ -79,7 +142,7 @@ void gl::ResourceManager::AppendNewVBO(unsigned int gpuName, XXH32_hash_t hash)
     VBOs_.insert({ hash, gpuName });
 }
 
-GLuint gl::ResourceManager::RequestTEX(XXH32_hash_t hash) const
+GLuint gl::ResourceManager::RequestTEX(uint64_t hash) const
 {
     const auto match = TEXs_.find(hash);
     if (match != TEXs_.end())
@@ -90,7 +153,7 @@ GLuint gl::ResourceManager::RequestTEX(XXH32_hash_t hash) const
     else return 0;
 }
 
-void gl::ResourceManager::AppendNewTEX(unsigned int gpuName, XXH32_hash_t hash)
+void gl::ResourceManager::AppendNewTEX(unsigned int gpuName, uint64_t hash)
 {
     if (hash == 0) hash = (unsigned int)TEXs_.size();
     assert(TEXs_.find(hash) == TEXs_.end());
@@ -98,7 +161,7 @@ void gl::ResourceManager::AppendNewTEX(unsigned int gpuName, XXH32_hash_t hash)
     TEXs_.insert({ hash, gpuName });
 }
 
-unsigned int gl::ResourceManager::RequestPROGRAM(XXH32_hash_t hash) const
+unsigned int gl::ResourceManager::RequestPROGRAM(uint64_t hash) const
 {
     const auto match = PROGRAMs_.find(hash);
     if (match != PROGRAMs_.end())
@@ -109,7 +172,7 @@ unsigned int gl::ResourceManager::RequestPROGRAM(XXH32_hash_t hash) const
     else return 0;
 }
 
-void gl::ResourceManager::AppendNewPROGRAM(unsigned int gpuName, XXH32_hash_t hash)
+void gl::ResourceManager::AppendNewPROGRAM(unsigned int gpuName, uint64_t hash)
 {
     if (hash == 0) hash = (unsigned int)PROGRAMs_.size();
     assert(PROGRAMs_.find(hash) == PROGRAMs_.end());
@@ -117,6 +180,52 @@ void gl::ResourceManager::AppendNewPROGRAM(unsigned int gpuName, XXH32_hash_t ha
     PROGRAMs_.insert({ hash, gpuName });
 }
 
+unsigned int gl::ResourceManager::RequestSAMPLER(uint64_t hash) const
+{
+    const auto match = SAMPLERs_.find(hash);
+    if (match != SAMPLERs_.end())
+    {
+        return match->second; // Sharing samplers is the whole point, no need to warn about it.
+    }
+    else return 0;
+}
+
+void gl::ResourceManager::AppendNewSAMPLER(unsigned int gpuName, uint64_t hash)
+{
+    if (hash == 0) hash = (unsigned int)SAMPLERs_.size();
+    assert(SAMPLERs_.find(hash) == SAMPLERs_.end());
+
+    SAMPLERs_.insert({ hash, gpuName });
+}
+
+namespace
+{
+    void Rekey(std::map<uint64_t, unsigned int>& entries, const unsigned int gpuName, const uint64_t hash)
+    {
+        if (entries.find(hash) != entries.end()) return;
+        for (auto it = entries.begin(); it != entries.end(); it++)
+        {
+            if (it->second == gpuName)
+            {
+                entries.erase(it);
+                entries.insert({ hash, gpuName });
+                return;
+            }
+        }
+        EngineError("Trying to rekey a non existent gpu name!");
+    }
+}//!anonymous
+
+void gl::ResourceManager::RekeyVAO(unsigned int gpuName, uint64_t hash)
+{
+    Rekey(VAOs_, gpuName, hash);
+}
+
+void gl::ResourceManager::RekeyVBO(unsigned int gpuName, uint64_t hash)
+{
+    Rekey(VBOs_, gpuName, hash);
+}
+
 void gl::ResourceManager::DeleteVAO(unsigned int gpuName)
 {
     for (const auto& pair : VAOs_)
@@ -125,6 +234,7 @@ void gl::ResourceManager::DeleteVAO(unsigned int gpuName)
         {
             glDeleteVertexArrays(1, &gpuName);
             VAOs_.erase(pair.first);
+            UntrackMemory(Resource::VERTEX_BUFFER, gpuName);
             return;
         }
     }
@@ -153,6 +263,7 @@ void gl::ResourceManager::DeleteTEX(unsigned int gpuName)
         {
             glDeleteTextures(1, &gpuName);
             TEXs_.erase(pair.first);
+            UntrackMemory(Resource::TEXTURE, gpuName);
             return;
         }
     }
@@ -167,51 +278,254 @@ void gl::ResourceManager::DeletePROGRAM(unsigned int gpuName)
         {
             glDeleteProgram(gpuName);
             PROGRAMs_.erase(pair.first);
+            UntrackMemory(Resource::PROGRAM, gpuName);
             return;
         }
     }
     EngineError("Trying to delete a non existent PROGRAMs_!");
 }
 
+void gl::ResourceManager::DeleteSAMPLER(unsigned int gpuName)
+{
+    for (const auto& pair : SAMPLERs_)
+    {
+        if (pair.second == gpuName)
+        {
+            glDeleteSamplers(1, &gpuName);
+            SAMPLERs_.erase(pair.first);
+            return;
+        }
+    }
+    EngineError("Trying to delete a non existent SAMPLER!");
+}
+
 gl::Camera& gl::ResourceManager::GetCamera()
 {
     return camera_;
 }
 
+gl::ResourceManager::CreationTimer::CreationTimer(Resource resource, size_t count) :
+    resource_(resource),
+    count_(count),
+    start_(std::chrono::high_resolution_clock::now())
+{
+}
+
+gl::ResourceManager::CreationTimer::~CreationTimer()
+{
+    const std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start_;
+    auto& stats = ResourceManager::Get().creationStats_[(size_t)resource_];
+    stats.count += count_;
+    stats.milliseconds += elapsed.count();
+}
+
+void gl::RetainResource(ResourceType type, unsigned int gpuName)
+{
+    ResourceManager& manager = ResourceManager::Get();
+    const auto match = manager.tracked_[(size_t)type].find(gpuName);
+    if (match == manager.tracked_[(size_t)type].end())
+    {
+        EngineError("Trying to hold a handle to an untracked or evicted resource!");
+    }
+
+    auto& entry = match->second;
+    if (entry.inLru)
+    {
+        manager.lru_.erase(entry.lru);
+        entry.inLru = false;
+        manager.memoryStats_[(size_t)type].unreferencedBytes -= entry.bytes;
+    }
+    entry.references++;
+}
+
+void gl::ReleaseResource(ResourceType type, unsigned int gpuName)
+{
+    if (resourceManagerDestroyed) return;
+
+    ResourceManager& manager = ResourceManager::Get();
+    const auto match = manager.tracked_[(size_t)type].find(gpuName);
+    if (match == manager.tracked_[(size_t)type].end()) return; // Deleted explicitly while still referenced.
+
+    auto& entry = match->second;
+    assert(entry.references > 0);
+    if (--entry.references == 0)
+    {
+        // Kept alive until the budget is exceeded, recreating it in the meantime is free.
+        manager.lru_.push_front({ type, gpuName });
+        entry.lru = manager.lru_.begin();
+        entry.inLru = true;
+        manager.memoryStats_[(size_t)type].unreferencedBytes += entry.bytes;
+    }
+}
+
+void gl::ResourceManager::TrackMemory(Resource resource, unsigned int gpuName, size_t bytes, unsigned int companion)
+{
+    assert(resource < Resource::NR_OF_RESOURCES && gpuName != 0);
+    auto& stats = memoryStats_[(size_t)resource];
+    const auto [it, inserted] = tracked_[(size_t)resource].try_emplace(gpuName);
+    auto& entry = it->second;
+    if (inserted)
+    {
+        stats.count++;
+    }
+    else
+    {
+        stats.bytes -= entry.bytes;
+        trackedBytes_ -= entry.bytes;
+        if (entry.inLru) stats.unreferencedBytes -= entry.bytes;
+    }
+
+    entry.bytes = bytes;
+    if (companion != 0) entry.companion = companion;
+    stats.bytes += bytes;
+    trackedBytes_ += bytes;
+    if (entry.inLru) stats.unreferencedBytes += bytes;
+}
+
+void gl::ResourceManager::UntrackMemory(Resource resource, unsigned int gpuName)
+{
+    auto& tracked = tracked_[(size_t)resource];
+    const auto match = tracked.find(gpuName);
+    if (match == tracked.end()) return;
+
+    auto& stats = memoryStats_[(size_t)resource];
+    const auto& entry = match->second;
+    if (entry.inLru)
+    {
+        lru_.erase(entry.lru);
+        stats.unreferencedBytes -= entry.bytes;
+    }
+    stats.count--;
+    stats.bytes -= entry.bytes;
+    trackedBytes_ -= entry.bytes;
+    tracked.erase(match);
+}
+
+void gl::ResourceManager::SetEvictionCallback(Resource resource, std::function<void(unsigned int gpuName)> onEvict)
+{
+    assert(resource < Resource::NR_OF_RESOURCES);
+    evictionCallbacks_[(size_t)resource] = std::move(onEvict);
+}
+
+void gl::ResourceManager::SetMemoryBudget(size_t bytes)
+{
+    memoryBudget_ = bytes;
+}
+
+size_t gl::ResourceManager::GetMemoryBudget() const
+{
+    return memoryBudget_;
+}
+
+size_t gl::ResourceManager::GetTrackedBytes() const
+{
+    return trackedBytes_;
+}
+
+void gl::ResourceManager::EvictOverBudget()
+{
+    while (trackedBytes_ > memoryBudget_ && !lru_.empty())
+    {
+        const auto [resource, gpuName] = lru_.back();
+        Evict(resource, gpuName);
+    }
+}
+
+void gl::ResourceManager::Evict(Resource resource, unsigned int gpuName)
+{
+    const unsigned int companion = tracked_[(size_t)resource].at(gpuName).companion;
+    memoryStats_[(size_t)resource].evictions++;
+    if (evictionCallbacks_[(size_t)resource] != nullptr)
+    {
+        evictionCallbacks_[(size_t)resource](gpuName);
+    }
+
+    switch (resource)
+    {
+        case Resource::VERTEX_BUFFER:
+            DeleteVAO(gpuName);
+            if (companion != 0) DeleteVBO(companion);
+            break;
+        case Resource::TEXTURE:
+            DeleteTEX(gpuName);
+            break;
+        case Resource::PROGRAM:
+            DeletePROGRAM(gpuName);
+            break;
+        default:
+            assert(0); // Framebuffers are owned by their Framebuffer, never handed out.
+            break;
+    }
+    UntrackMemory(resource, gpuName); // Already done by the Delete functions, keeps EvictOverBudget() from looping if it wasn't.
+    CheckGlError();
+}
+
+const gl::ResourceManager::MemoryStats& gl::ResourceManager::GetMemoryStats(Resource resource) const
+{
+    assert(resource < Resource::NR_OF_RESOURCES);
+    return memoryStats_[(size_t)resource];
+}
+
+const gl::ResourceManager::CreationStats& gl::ResourceManager::GetCreationStats(Resource resource) const
+{
+    assert(resource < Resource::NR_OF_RESOURCES);
+    return creationStats_[(size_t)resource];
+}
+
+void gl::ResourceManager::ResetCreationStats()
+{
+    creationStats_ = {};
+}
+
 std::vector<gl::ResourceManager::ObjData> gl::ResourceManager::ReadObj(std::string_view path, bool generateOwnNormals, bool flipNormals, bool reverseWindingOrder)
 {
     std::vector<ObjData> returnVal;
+    std::string error;
+    if (!TryReadObj(path, returnVal, error, generateOwnNormals, flipNormals, reverseWindingOrder))
+    {
+        EngineError(error.c_str());
+    }
+    return returnVal;
+}
 
-    tinyobj::ObjReaderConfig reader_config;
-    std::string dir = std::string(path.begin(), path.begin() + path.find_last_of('/') + 1);
-    reader_config.mtl_search_path = dir;
-    tinyobj::ObjReader reader;
+bool gl::ResourceManager::TryReadObj(std::string_view path, std::vector<ObjData>& returnVal, std::string& error, bool generateOwnNormals, bool flipNormals, bool reverseWindingOrder)
+{
+    returnVal.clear();
 
-    if (!reader.ParseFromFile(path.data(), reader_config))
+    const FileSystem::File file = FileSystem::Get().Read(path);
+    if (!file.Exists())
     {
-        if (!reader.Error().empty())
-        {
-            EngineError(reader.Error().c_str());
-        }
-        else
+        error = "Failed to load file at path: " + std::string(path);
+        return false;
+    }
+    SpanStreamBuffer buffer(file.GetSpan());
+    std::istream stream(&buffer);
+    const std::string dir = std::string(path.begin(), path.begin() + path.find_last_of('/') + 1);
+    FileSystemMaterialReader materialReader(dir);
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warning;
+    error.clear();
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error, &stream, &materialReader))
+    {
+        if (error.empty())
         {
-            std::string msg = "Failed to load file at path: ";
-            msg += path.data();
-            msg += ", at directory: ";
-            msg += dir.c_str();
-            EngineError(msg.c_str());
+            error = "Failed to load file at path: ";
+            error += path;
+            error += ", at directory: ";
+            error += dir;
         }
+        return false;
     }
 
-    if (!reader.Warning().empty())
+    if (!warning.empty())
     {
-        EngineError(reader.Warning().c_str());
+        error = warning;
+        return false;
     }
 
-    const auto& attrib = reader.GetAttrib();
-    const auto& shapes = reader.GetShapes();
-    const auto& materials = reader.GetMaterials();
-
     for (size_t shape = 0; shape < shapes.size(); shape++)
     {
         size_t index_offset = 0;
@@ -347,15 +661,455 @@ std::vector<gl::ResourceManager::ObjData> gl::ResourceManager::ReadObj(std::stri
             });
     }
 
-    return returnVal;
+    return true;
+}
+
+namespace
+{
+    gl::AsyncLoader::Task ReadObjTask(std::string path, std::function<void(std::vector<gl::ResourceManager::ObjData>)> onLoaded, bool generateOwnNormals, bool flipNormals, bool reverseWindingOrder)
+    {
+        co_await gl::AsyncLoader::Get().ToWorker();
+        std::vector<gl::ResourceManager::ObjData> objData = gl::ResourceManager::ReadObj(path, generateOwnNormals, flipNormals, reverseWindingOrder);
+        co_await gl::AsyncLoader::Get().ToGlThread();
+        onLoaded(std::move(objData));
+    }
+}//!anonymous
+
+void gl::ResourceManager::ReadObjAsync(std::string path, std::function<void(std::vector<ObjData>)> onLoaded, bool generateOwnNormals, bool flipNormals, bool reverseWindingOrder)
+{
+    assert(onLoaded != nullptr);
+    ReadObjTask(std::move(path), std::move(onLoaded), generateOwnNormals, flipNormals, reverseWindingOrder);
+}
+
+namespace
+{
+    // Positions, uvs, normals and tangents one vertex after the other, dataLayout { 3, 2, 3, 3 }.
+    std::vector<float> InterleaveObjMesh(const gl::ResourceManager::ObjData& mesh)
+    {
+        std::vector<float> data;
+        data.reserve(mesh.positions.size() * 11);
+        for (size_t i = 0; i < mesh.positions.size(); i++)
+        {
+            data.insert(data.end(), { mesh.positions[i].x, mesh.positions[i].y, mesh.positions[i].z });
+            data.insert(data.end(), { mesh.uvs[i].x, mesh.uvs[i].y });
+            data.insert(data.end(), { mesh.normals[i].x, mesh.normals[i].y, mesh.normals[i].z });
+            data.insert(data.end(), { mesh.tangents[i].x, mesh.tangents[i].y, mesh.tangents[i].z });
+        }
+        return data;
+    }
+}//!anonymous
+
+gl::VertexBuffer::Definition gl::ResourceManager::GetObjVertexBufferDefinition(const std::vector<ObjData>& objData, size_t mesh, std::string_view path, bool generateOwnNormals, bool flipNormals, bool reverseWindingOrder)
+{
+    assert(mesh < objData.size());
+
+    VertexBuffer::Definition vbdef;
+    vbdef.data = InterleaveObjMesh(objData[mesh]);
+    vbdef.dataLayout = { 3,2,3,3 };
+    vbdef.path = path;
+    vbdef.reload = [path = std::string(path), mesh, generateOwnNormals, flipNormals, reverseWindingOrder]()
+        {
+            // A half saved file mustn't take the program down, empty data keeps the previous buffer.
+            std::vector<ObjData> reloaded;
+            std::string error;
+            if (!TryReadObj(path, reloaded, error, generateOwnNormals, flipNormals, reverseWindingOrder))
+            {
+                EngineWarning(error.c_str());
+                return std::vector<float>();
+            }
+            return mesh < reloaded.size() ? InterleaveObjMesh(reloaded[mesh]) : std::vector<float>();
+        };
+    return vbdef;
+}
+
+namespace
+{
+    // Just enough json for glTF: strings are kept as views of the document, escapes included.
+    struct JsonValue
+    {
+        enum class Type { NONE, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+        Type type = Type::NONE;
+        double number = 0.0;
+        std::string_view string = {};
+        std::vector<JsonValue> elements = {};
+        std::vector<std::pair<std::string_view, JsonValue>> members = {};
+
+        const JsonValue& operator[](std::string_view key) const
+        {
+            static const JsonValue none = {};
+            for (const auto& member : members)
+            {
+                if (member.first == key) return member.second;
+            }
+            return none;
+        }
+        const JsonValue& operator[](size_t index) const
+        {
+            static const JsonValue none = {};
+            return index < elements.size() ? elements[index] : none;
+        }
+        bool Exists() const { return type != Type::NONE; }
+        double Number(double fallback) const { return type == Type::NUMBER ? number : fallback; }
+        size_t Index() const { return type == Type::NUMBER && number >= 0.0 ? (size_t)number : SIZE_MAX; } // SIZE_MAX when absent.
+        size_t Size() const { return elements.size(); }
+    };
+
+    class JsonParser
+    {
+    public:
+        explicit JsonParser(std::string_view text) : text_(text) {}
+
+        // Returns false on malformed documents.
+        bool Parse(JsonValue& value)
+        {
+            return ParseValue(value, 0) && (SkipSpaces(), position_ == text_.size());
+        }
+    private:
+        constexpr static const size_t MAX_DEPTH = 64;
+
+        void SkipSpaces()
+        {
+            while (position_ < text_.size() && (text_[position_] == ' ' || text_[position_] == '\t' || text_[position_] == '\n' || text_[position_] == '\r'))
+            {
+                position_++;
+            }
+        }
+        bool Consume(char c)
+        {
+            SkipSpaces();
+            if (position_ >= text_.size() || text_[position_] != c) return false;
+            position_++;
+            return true;
+        }
+        bool ParseString(std::string_view& string)
+        {
+            if (!Consume('"')) return false;
+            const size_t start = position_;
+            while (position_ < text_.size() && text_[position_] != '"')
+            {
+                position_ += text_[position_] == '\\' ? 2 : 1;
+            }
+            if (position_ >= text_.size()) return false;
+            string = text_.substr(start, position_++ - start);
+            return true;
+        }
+        bool ParseValue(JsonValue& value, size_t depth)
+        {
+            SkipSpaces();
+            if (position_ >= text_.size() || depth > MAX_DEPTH) return false;
+            const char c = text_[position_];
+            if (c == '{')
+            {
+                position_++;
+                value.type = JsonValue::Type::OBJECT;
+                if (Consume('}')) return true;
+                do
+                {
+                    std::pair<std::string_view, JsonValue> member;
+                    if (!ParseString(member.first) || !Consume(':') || !ParseValue(member.second, depth + 1)) return false;
+                    value.members.push_back(std::move(member));
+                } while (Consume(','));
+                return Consume('}');
+            }
+            if (c == '[')
+            {
+                position_++;
+                value.type = JsonValue::Type::ARRAY;
+                if (Consume(']')) return true;
+                do
+                {
+                    value.elements.emplace_back();
+                    if (!ParseValue(value.elements.back(), depth + 1)) return false;
+                } while (Consume(','));
+                return Consume(']');
+            }
+            if (c == '"')
+            {
+                value.type = JsonValue::Type::STRING;
+                return ParseString(value.string);
+            }
+            for (const std::string_view literal : { std::string_view("true"), std::string_view("false"), std::string_view("null") })
+            {
+                if (text_.compare(position_, literal.size(), literal) == 0)
+                {
+                    position_ += literal.size();
+                    value.type = literal == "null" ? JsonValue::Type::NONE : JsonValue::Type::BOOLEAN;
+                    value.number = literal == "true" ? 1.0 : 0.0;
+                    return true;
+                }
+            }
+            // Copied out, strtod could read past the end of the chunk.
+            const size_t start = position_;
+            while (position_ < text_.size() && std::string_view("+-.0123456789eE").find(text_[position_]) != std::string_view::npos)
+            {
+                position_++;
+            }
+            const std::string number(text_.substr(start, position_ - start));
+            char* end = nullptr;
+            value.number = std::strtod(number.c_str(), &end);
+            value.type = JsonValue::Type::NUMBER;
+            return !number.empty() && end == number.c_str() + number.size();
+        }
+
+        std::string_view text_;
+        size_t position_ = 0;
+    };
+
+    // Bytes of a glb accessor inside the binary chunk.
+    struct GlbAccessor
+    {
+        size_t offset = 0; // From the start of the binary chunk.
+        size_t stride = 0;
+        size_t count = 0;
+        size_t elementSize = 0;
+        unsigned int componentType = 0;
+        unsigned int components = 0;
+        bool normalized = false;
+    };
+
+    size_t GetComponentSize(const unsigned int componentType)
+    {
+        switch (componentType)
+        {
+            case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+            case GL_SHORT: case GL_UNSIGNED_SHORT: return 2;
+            case GL_UNSIGNED_INT: case GL_FLOAT: return 4;
+            default: return 0;
+        }
+    }
+
+    unsigned int GetComponentsCount(std::string_view type)
+    {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        return 0; // Matrices aren't vertex attributes.
+    }
+
+    // Returns false if the accessor isn't in the binary chunk or isn't a tightly described array of vectors.
+    bool ReadGlbAccessor(const JsonValue& document, size_t index, size_t binarySize, GlbAccessor& accessor)
+    {
+        const JsonValue& json = document["accessors"][index];
+        const JsonValue& bufferView = document["bufferViews"][json["bufferView"].Index()];
+        if (!bufferView.Exists() || json["sparse"].Exists() || bufferView["buffer"].Index() != 0) return false;
+
+        accessor.componentType = (unsigned int)json["componentType"].Number(0.0);
+        accessor.components = GetComponentsCount(json["type"].string);
+        accessor.count = json["count"].Index();
+        accessor.normalized = json["normalized"].number != 0.0;
+        const size_t componentSize = GetComponentSize(accessor.componentType);
+        accessor.elementSize = componentSize * accessor.components;
+        accessor.stride = (size_t)bufferView["byteStride"].Number((double)accessor.elementSize);
+        accessor.offset = (size_t)bufferView["byteOffset"].Number(0.0) + (size_t)json["byteOffset"].Number(0.0);
+        const size_t viewEnd = (size_t)bufferView["byteOffset"].Number(0.0) + (size_t)bufferView["byteLength"].Number(0.0);
+        return accessor.elementSize > 0 && accessor.count > 0 && accessor.count != SIZE_MAX && accessor.stride >= accessor.elementSize &&
+            accessor.offset % componentSize == 0 && accessor.offset + (accessor.count - 1) * accessor.stride + accessor.elementSize <= std::min(viewEnd, binarySize);
+    }
+
+    glm::mat4 GetGlbNodeMatrix(const JsonValue& node)
+    {
+        const JsonValue& matrix = node["matrix"];
+        if (matrix.Size() == 16)
+        {
+            float elements[16];
+            for (size_t i = 0; i < 16; i++) elements[i] = (float)matrix[i].number; // Column major, as glm.
+            return glm::make_mat4(elements);
+        }
+        const JsonValue& t = node["translation"];
+        const JsonValue& r = node["rotation"];
+        const JsonValue& s = node["scale"];
+        const glm::vec3 translation = { (float)t[0].Number(0.0), (float)t[1].Number(0.0), (float)t[2].Number(0.0) };
+        const glm::quat rotation = { (float)r[3].Number(1.0), (float)r[0].Number(0.0), (float)r[1].Number(0.0), (float)r[2].Number(0.0) }; // Stored x, y, z, w.
+        const glm::vec3 scale = { (float)s[0].Number(1.0), (float)s[1].Number(1.0), (float)s[2].Number(1.0) };
+        return glm::translate(gl::IDENTITY_MAT4, translation) * glm::mat4_cast(rotation) * glm::scale(gl::IDENTITY_MAT4, scale);
+    }
+
+    // Image path of a glTF texture info, empty for embedded images.
+    std::string GetGlbImagePath(const JsonValue& document, const JsonValue& textureInfo)
+    {
+        if (!textureInfo.Exists()) return "";
+        const JsonValue& texture = document["textures"][textureInfo["index"].Index()];
+        const JsonValue& image = document["images"][texture["source"].Index()];
+        const std::string_view uri = image["uri"].string;
+        return uri.starts_with("data:") ? "" : std::string(uri);
+    }
+
+    constexpr const uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+    constexpr const uint32_t GLB_VERSION = 2;
+    constexpr const uint32_t GLB_JSON_CHUNK = 0x4E4F534A; // "JSON"
+    constexpr const uint32_t GLB_BINARY_CHUNK = 0x004E4942; // "BIN\0"
+}//!anonymous
+
+gl::ResourceManager::GlbData gl::ResourceManager::ReadGlb(std::string_view path)
+{
+    GlbData glb;
+    glb.file = FileSystem::Get().Read(path);
+    if (!glb.file.Exists())
+    {
+        EngineWarning(("Could not read " + std::string(path) + ".").c_str());
+        return {};
+    }
+
+    // Header then chunks of { length, type, data }, all little endian and 4 bytes aligned.
+    const std::span<const char> file = glb.file.GetSpan();
+    const auto readUint32 = [&file](size_t offset)
+    {
+        uint32_t value = 0;
+        if (offset + sizeof(uint32_t) <= file.size()) std::memcpy(&value, file.data() + offset, sizeof(uint32_t));
+        return value;
+    };
+    const size_t jsonSize = readUint32(12);
+    const size_t binaryChunk = 20 + jsonSize;
+    if (readUint32(0) != GLB_MAGIC || readUint32(4) != GLB_VERSION || readUint32(16) != GLB_JSON_CHUNK || binaryChunk > file.size())
+    {
+        EngineWarning(("Invalid glb file " + std::string(path) + ".").c_str());
+        return {};
+    }
+    std::span<const char> binary = {}; // Optional, only the first buffer of a glTF can be stored in it.
+    if (binaryChunk + 8 <= file.size() && readUint32(binaryChunk + 4) == GLB_BINARY_CHUNK && readUint32(binaryChunk) <= file.size() - binaryChunk - 8)
+    {
+        binary = file.subspan(binaryChunk + 8, readUint32(binaryChunk));
+    }
+
+    JsonValue document;
+    JsonParser parser(std::string_view(file.data() + 20, jsonSize));
+    if (!parser.Parse(document))
+    {
+        EngineWarning(("Invalid json chunk in " + std::string(path) + ".").c_str());
+        return {};
+    }
+    if (document["extensionsRequired"].Size() > 0)
+    {
+        EngineWarning((std::string(path) + " requires glTF extensions, compressed meshes aren't supported.").c_str());
+        return {};
+    }
+
+    const std::string dir = std::string(path.substr(0, path.find_last_of("/\\") + 1));
+    const JsonValue& meshes = document["meshes"];
+    glb.meshes.resize(meshes.Size());
+    for (size_t m = 0; m < meshes.Size(); m++)
+    {
+        GlbMesh& mesh = glb.meshes[m];
+        mesh.name = std::string(meshes[m]["name"].string);
+        const JsonValue& primitives = meshes[m]["primitives"];
+        for (size_t p = 0; p < primitives.Size(); p++)
+        {
+            const JsonValue& primitive = primitives[p];
+            if (primitive["mode"].Number(4.0) != 4.0)
+            {
+                EngineWarning(("Skipping a primitive of " + std::string(path) + ", only triangle lists are supported.").c_str());
+                continue;
+            }
+
+            // Same locations and sizes as the float layout of obj meshes, tangents keep their w.
+            constexpr const std::array<std::pair<std::string_view, unsigned int>, 4> ATTRIBUTES = { { { "POSITION", 3 }, { "TEXCOORD_0", 2 }, { "NORMAL", 3 }, { "TANGENT", 4 } } };
+            std::array<GlbAccessor, ATTRIBUTES.size()> accessors = {};
+            bool valid = true;
+            size_t begin = SIZE_MAX, end = 0;
+            for (size_t i = 0; i < ATTRIBUTES.size(); i++)
+            {
+                const size_t index = primitive["attributes"][ATTRIBUTES[i].first].Index();
+                if (index == SIZE_MAX) continue;
+                GlbAccessor& accessor = accessors[i];
+                valid = valid && ReadGlbAccessor(document, index, binary.size(), accessor) && accessor.components == ATTRIBUTES[i].second && accessor.componentType != GL_UNSIGNED_INT;
+                begin = std::min(begin, accessor.offset);
+                end = std::max(end, accessor.offset + (accessor.count - 1) * accessor.stride + accessor.elementSize);
+            }
+            const GlbAccessor& position = accessors[0];
+            if (!valid || position.componentType != GL_FLOAT || (accessors[2].count != 0 && accessors[2].componentType != GL_FLOAT))
+            {
+                EngineWarning(("Skipping a primitive of " + std::string(path) + ", its attributes aren't float positions and normals in the binary chunk.").c_str());
+                continue;
+            }
+
+            // A single upload of the range covering every attribute, interleaved or in separate views. Bytes of other views in between come along.
+            begin &= ~(size_t)3;
+            GlbPrimitive& added = mesh.primitives.emplace_back();
+            VertexBuffer::Definition& def = added.vertexBuffer;
+            def.packedData = binary.subspan(begin, end - begin);
+            def.packedStride = (unsigned int)position.stride;
+            def.packedVerticesCount = position.count;
+            def.packedLayout.resize(ATTRIBUTES.size());
+            for (size_t i = 0; i < ATTRIBUTES.size(); i++)
+            {
+                const GlbAccessor& accessor = accessors[i];
+                if (accessor.count < position.count)
+                {
+                    def.packedLayout[i].size = 0;
+                    continue;
+                }
+                def.packedLayout[i] = { accessor.components, (VertexBuffer::AttributeType)accessor.componentType, accessor.normalized, (unsigned int)(accessor.offset - begin), (unsigned int)accessor.stride };
+            }
+            while (def.packedLayout.back().size == 0) def.packedLayout.pop_back();
+
+            const size_t indices = primitive["indices"].Index();
+            if (indices != SIZE_MAX)
+            {
+                GlbAccessor accessor;
+                if (!ReadGlbAccessor(document, indices, binary.size(), accessor) || accessor.components != 1 || accessor.stride != accessor.elementSize ||
+                    (accessor.componentType != GL_UNSIGNED_BYTE && accessor.componentType != GL_UNSIGNED_SHORT && accessor.componentType != GL_UNSIGNED_INT))
+                {
+                    EngineWarning(("Skipping a primitive of " + std::string(path) + ", invalid indices.").c_str());
+                    mesh.primitives.pop_back();
+                    continue;
+                }
+                def.indices = binary.subspan(accessor.offset, accessor.count * accessor.elementSize);
+                def.indexType = (VertexBuffer::IndexType)accessor.componentType;
+            }
+
+            const JsonValue& material = document["materials"][primitive["material"].Index()];
+            added.dir = dir;
+            added.diffuseMap = GetGlbImagePath(document, material["pbrMetallicRoughness"]["baseColorTexture"]);
+            added.normalMap = GetGlbImagePath(document, material["normalTexture"]);
+        }
+    }
+
+    // World matrices of the default scene, or of every root node without one.
+    const JsonValue& nodes = document["nodes"];
+    std::vector<std::pair<size_t, glm::mat4>> stack;
+    const JsonValue& scene = document["scenes"][document["scene"].Exists() ? document["scene"].Index() : 0];
+    if (scene.Exists())
+    {
+        for (const auto& node : scene["nodes"].elements) stack.push_back({ node.Index(), IDENTITY_MAT4 });
+    }
+    else
+    {
+        std::vector<bool> isChild(nodes.Size(), false);
+        for (const auto& node : nodes.elements)
+        {
+            for (const auto& child : node["children"].elements)
+            {
+                if (child.Index() < isChild.size()) isChild[child.Index()] = true;
+            }
+        }
+        for (size_t i = 0; i < nodes.Size(); i++)
+        {
+            if (!isChild[i]) stack.push_back({ i, IDENTITY_MAT4 });
+        }
+    }
+    size_t visited = 0;
+    while (!stack.empty() && visited++ < nodes.Size()) // A node is only ever visited once in a valid glTF.
+    {
+        const auto [index, parent] = stack.back();
+        stack.pop_back();
+        const JsonValue& node = nodes[index];
+        if (!node.Exists()) continue;
+        const glm::mat4 world = parent * GetGlbNodeMatrix(node);
+        const size_t mesh = node["mesh"].Index();
+        if (mesh < glb.meshes.size()) glb.meshes[mesh].instances.push_back(world);
+        for (const auto& child : node["children"].elements) stack.push_back({ child.Index(), world });
+    }
+    return glb;
 }
 
-/*std::vector<gl::Material::Definition> gl::ResourceManager::PreprocessMaterialData(const std::vector<gl::ResourceManager::ObjData> objData)
+std::vector<gl::Material::Definition> gl::ResourceManager::PreprocessMaterialData(const std::vector<gl::ResourceManager::ObjData> objData, bool loadAsync)
 {
     std::vector<gl::Material::Definition> returnVal = std::vector<gl::Material::Definition>(objData.size(), gl::Material::Definition());
 
     for (size_t mesh = 0; mesh < objData.size(); mesh++)
     {
+        returnVal[mesh].loadAsync = loadAsync;
         std::string dir = objData[mesh].dir.data();
         std::string path = dir;
         path += objData[mesh].alphaMap;
@@ -422,4 +1176,4 @@ std::vector<gl::Shader::Definition> gl::ResourceManager::PreprocessShaderData(co
         }
     }
     return returnVal;
-}*/
+}
@@ -0,0 +1,83 @@
+#include "sampler.h"
+
+#include <glad/glad.h>
+
+#include "hasher.h"
+#include "resource_manager.h"
+#include "defines.h"
+
+uint64_t gl::Sampler::Definition::GetHash() const
+{
+    Hasher hasher(HASHING_SEED);
+    hasher.Add("sampler"); // Keep sampler hashes apart from other resources'.
+    hasher.Add(filter).Add(wrap);
+    return hasher.Digest64();
+}
+
+void gl::Sampler::Create(Definition def)
+{
+    if (SAMPLER_ != 0)
+    {
+        EngineError("Calling Create() a second time...");
+    }
+
+    const uint64_t hash = def.GetHash();
+    SAMPLER_ = ResourceManager::Get().RequestSAMPLER(hash);
+    if (SAMPLER_ != 0) // Some other texture samples the same way already, share its sampler.
+    {
+        return;
+    }
+
+    GLint minFilter = GL_LINEAR_MIPMAP_LINEAR, magFilter = GL_LINEAR;
+    switch (def.filter)
+    {
+        case Filter::NEAREST:
+            minFilter = GL_NEAREST;
+            magFilter = GL_NEAREST;
+            break;
+        case Filter::LINEAR:
+            minFilter = GL_LINEAR;
+            magFilter = GL_LINEAR;
+            break;
+        case Filter::TRILINEAR:
+            minFilter = GL_LINEAR_MIPMAP_LINEAR;
+            magFilter = GL_LINEAR;
+            break;
+        default:
+            assert(0);
+            break;
+    }
+
+    GLint wrap = GL_REPEAT;
+    switch (def.wrap)
+    {
+        case Wrap::REPEAT:
+            wrap = GL_REPEAT;
+            break;
+        case Wrap::MIRRORED_REPEAT:
+            wrap = GL_MIRRORED_REPEAT;
+            break;
+        case Wrap::CLAMP_TO_EDGE:
+            wrap = GL_CLAMP_TO_EDGE;
+            break;
+        default:
+            assert(0);
+            break;
+    }
+
+    // Sampler objects have always been edited through their names, no need for a direct state access path here.
+    glGenSamplers(1, &SAMPLER_);
+    glSamplerParameteri(SAMPLER_, GL_TEXTURE_MIN_FILTER, minFilter);
+    glSamplerParameteri(SAMPLER_, GL_TEXTURE_MAG_FILTER, magFilter);
+    glSamplerParameteri(SAMPLER_, GL_TEXTURE_WRAP_S, wrap);
+    glSamplerParameteri(SAMPLER_, GL_TEXTURE_WRAP_T, wrap);
+    glSamplerParameteri(SAMPLER_, GL_TEXTURE_WRAP_R, wrap);
+    CheckGlError();
+
+    ResourceManager::Get().AppendNewSAMPLER(SAMPLER_, hash);
+}
+
+unsigned int gl::Sampler::GetSAMPLER() const
+{
+    return SAMPLER_;
+}
@@ -1,6 +1,9 @@
 #include "shader.h"
 
-#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <memory>
 #include <sstream>
 
 // #include <glm/glm.hpp>
@@ -11,93 +14,336 @@
 #include "xxhash.h"
 
 #include "defines.h"
+#include "file_system.h"
+#include "hasher.h"
+#if GL_SIMD_SSE2
+#include <emmintrin.h>
+#endif
 
 #include "resource_manager.h"
+#include "program_cache.h"
+#include "file_watcher.h"
+#include "uniform_buffers.h"
 
-GLint gl::Shader::GetUniformLocation(std::string_view uniformName)
+gl::Shader::UniformUploadStats gl::Shader::uploadStats_ = {};
+
+namespace
 {
-    const auto match = uniformNames_.find(uniformName.data());
-    if (match != uniformNames_.end()) // Name of uniform already known, use it.
+    bool HasParallelShaderCompile()
+    {
+        return GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+    }
+
+    // Lets the driver use as many compiler threads as it wants.
+    void EnableParallelShaderCompile()
+    {
+        static bool enabled = false;
+        if (enabled) return;
+        enabled = true;
+        if (GLAD_GL_KHR_parallel_shader_compile)
+        {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        }
+        else if (GLAD_GL_ARB_parallel_shader_compile)
+        {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        }
+    }
+
+    // Shader file, read once and shared by every variant compiled from it.
+    struct SourceFile
+    {
+        std::string code = ""; // With the keyword pragmas blanked out.
+        uint64_t hash = 0;
+        std::vector<std::string> keywords = {}; // Declared with "#pragma keywords A B ..." lines.
+        size_t versionLine = 0; // Index of the #version directive, defines are injected right after it.
+    };
+    std::unordered_map<std::string, SourceFile> sourceFiles;
+
+    // Variants compiling in the background, see Shader::Prewarm().
+    std::vector<gl::Shader> prewarmed;
+
+    // Returns nullptr when the file can't be read.
+    const SourceFile* LoadSourceFile(const std::string& path)
+    {
+        const auto match = sourceFiles.find(path);
+        if (match != sourceFiles.end()) return &match->second;
+
+        const gl::FileSystem::File file = gl::FileSystem::Get().Read(path);
+        if (!file.Exists()) return nullptr;
+        std::string code(file.GetString()); // Copied, the pragma lines are blanked and an editor may truncate the mapped file while hot reloading.
+
+        SourceFile source;
+        source.hash = XXH64(code.data(), code.size(), gl::HASHING_SEED);
+        constexpr std::string_view KEYWORDS_PRAGMA = "#pragma keywords";
+        size_t lineStart = 0, lineIndex = 0;
+        while (lineStart < code.size())
+        {
+            size_t lineEnd = code.find('\n', lineStart);
+            if (lineEnd == std::string::npos) lineEnd = code.size();
+            const std::string_view line(code.data() + lineStart, lineEnd - lineStart);
+            if (line.rfind("#version", 0) == 0)
+            {
+                source.versionLine = lineIndex;
+            }
+            else if (line.rfind(KEYWORDS_PRAGMA, 0) == 0)
+            {
+                std::stringstream keywords{ std::string(line.substr(KEYWORDS_PRAGMA.size())) };
+                std::string keyword;
+                while (keywords >> keyword)
+                {
+                    if (std::find(source.keywords.begin(), source.keywords.end(), keyword) == source.keywords.end()) source.keywords.push_back(keyword);
+                }
+                std::fill(code.begin() + lineStart, code.begin() + lineEnd, ' '); // Keeps line numbers intact for error messages.
+            }
+            lineStart = lineEnd + 1;
+            lineIndex++;
+        }
+        source.code = std::move(code);
+        return &sourceFiles.insert({ path, std::move(source) }).first->second;
+    }
+
+    // Declares the shared uniform blocks and defines every enabled keyword right after the #version directive, then restores the line numbering of the file.
+    std::string InjectPrelude(const SourceFile& source, const std::vector<std::string>& keywords)
+    {
+        size_t insertAt = 0;
+        for (size_t line = 0; line <= source.versionLine; line++)
+        {
+            insertAt = source.code.find('\n', insertAt);
+            if (insertAt == std::string::npos) EngineError("Shader has nothing after its #version directive!");
+            insertAt++;
+        }
+        std::string prelude = gl::UniformBuffers::GetShaderDeclarations();
+        for (const auto& keyword : keywords)
+        {
+            prelude += "#define " + keyword + " 1\n";
+        }
+        prelude += "#line " + std::to_string(source.versionLine + 2) + "\n";
+        std::string code = source.code;
+        code.insert(insertAt, prelude);
+        return code;
+    }
+
+    // Final sources of a definition, prelude injected.
+    struct Variant
+    {
+        std::string vertexCode = "";
+        std::string fragmentCode = "";
+        uint64_t sourceHash = 0; // Key of the program cache.
+    };
+
+    // Returns an empty string on success, the reason of the failure otherwise.
+    std::string BuildVariant(const gl::Shader::Definition& def, Variant& variant)
     {
-        return match->second;
+        const SourceFile* vertexSource = LoadSourceFile(def.vertexPath);
+        const SourceFile* fragmentSource = LoadSourceFile(def.fragmentPath);
+        if (vertexSource == nullptr || fragmentSource == nullptr) return "Could not open shader file!";
+
+        auto declared = vertexSource->keywords; // Mask bits follow the declaration order, vertex shader first.
+        for (const auto& keyword : fragmentSource->keywords)
+        {
+            if (std::find(declared.begin(), declared.end(), keyword) == declared.end()) declared.push_back(keyword);
+        }
+        assert(declared.size() <= 32);
+        uint32_t keywordMask = 0;
+        for (const auto& keyword : def.keywords)
+        {
+            const auto match = std::find(declared.begin(), declared.end(), keyword);
+            if (match == declared.end()) return "Shader keyword isn't declared by any of the shader's sources!";
+            keywordMask |= 1u << (uint32_t)(match - declared.begin());
+        }
+        variant.vertexCode = InjectPrelude(*vertexSource, def.keywords);
+        variant.fragmentCode = InjectPrelude(*fragmentSource, def.keywords);
+
+        static const uint64_t preludeHash = XXH64(gl::UniformBuffers::GetShaderDeclarations().data(), gl::UniformBuffers::GetShaderDeclarations().size(), gl::HASHING_SEED); // Cached binaries of an older prelude don't match.
+        const uint64_t variantKey[4] = { vertexSource->hash, fragmentSource->hash, keywordMask, preludeHash };
+        variant.sourceHash = XXH64(variantKey, sizeof(variantKey), gl::HASHING_SEED);
+        return "";
     }
-    else
+
+    // Programs built from source files and the files they depend on, rebuilt in place when one of those changes. See Shader::ReloadSource().
+    struct ReloadableProgram
+    {
+        gl::Shader::Definition def = {};
+        uint32_t generation = 0; // reloadGeneration of its last reload.
+        // Last Shader that uploaded dynamic uniforms into the program. Shaders created from identical definitions share their program, a shadow copy is only trusted if nobody else wrote to the program since.
+        const gl::Shader* lastUploader = nullptr;
+    };
+    std::unordered_map<unsigned int, ReloadableProgram> reloadablePrograms;
+    std::unordered_map<std::string, std::vector<unsigned int>> programsBySource;
+    uint32_t reloadGeneration = 0; // Bumped by every reload, shaders compare it to theirs before looking their program up.
+
+    // Eviction callback of the ResourceManager, the program is deleted right after.
+    void ForgetProgram(const unsigned int PROGRAM)
     {
-        const int uniformIntName = glGetUniformLocation(PROGRAM_, uniformName.data());
-        if (uniformIntName < 0) EngineError("Trying to get the location of a non existent uniform!");
+        reloadablePrograms.erase(PROGRAM);
+        for (auto& pair : programsBySource)
+        {
+            auto& programs = pair.second;
+            programs.erase(std::remove(programs.begin(), programs.end(), PROGRAM), programs.end());
+        }
+    }
+    bool forgetsEvictedPrograms = false;
+
+    // Driver's size of the linked program, the closest thing to its gpu footprint gl exposes.
+    size_t ProgramBytes(const unsigned int PROGRAM)
+    {
+        GLint size = 0;
+        glGetProgramiv(PROGRAM, GL_PROGRAM_BINARY_LENGTH, &size);
         CheckGlError();
-        uniformNames_.insert({ uniformName.data(), uniformIntName }); // Add the new entry.
-        return uniformIntName;
+        return (size_t)std::max(size, 0);
     }
-}
 
-void gl::Shader::SetInt(const std::pair<std::string_view, int> pair)
+    size_t NrOfFloats(const int type)
+    {
+        constexpr size_t NR_OF_FLOATS[] = { 1, 1, 3, 16 }; // INT, FLOAT, VEC3, MAT4.
+        return NR_OF_FLOATS[type];
+    }
+
+    // Bitwise rather than float comparison: -0.0 and 0.0 are uploaded, NaNs aren't reuploaded every frame.
+    bool Mat4Equal(const float* a, const float* b)
+    {
+#if GL_SIMD_SSE2
+        __m128i equal = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)a), _mm_loadu_si128((const __m128i*)b));
+        equal = _mm_and_si128(equal, _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(a + 4)), _mm_loadu_si128((const __m128i*)(b + 4))));
+        equal = _mm_and_si128(equal, _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(a + 8)), _mm_loadu_si128((const __m128i*)(b + 8))));
+        equal = _mm_and_si128(equal, _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(a + 12)), _mm_loadu_si128((const __m128i*)(b + 12))));
+        return _mm_movemask_epi8(equal) == 0xFFFF;
+#else
+        return std::memcmp(a, b, 16 * sizeof(float)) == 0;
+#endif
+    }
+}//!anonymous
+
+void gl::Shader::ResolveUniformLocations()
 {
-    assert(isBound_);
-    const int gpuName = GetUniformLocation(pair.first);
-    glUniform1i(gpuName, pair.second);
+    uniformLocations_.clear();
+
+    GLint nrOfUniforms = 0, maxNameLength = 0;
+    glGetProgramiv(PROGRAM_, GL_ACTIVE_UNIFORMS, &nrOfUniforms);
+    glGetProgramiv(PROGRAM_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::string name((size_t)maxNameLength, '\0');
+    for (GLint i = 0; i < nrOfUniforms; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(PROGRAM_, (GLuint)i, maxNameLength, &length, &size, &type, name.data());
+        const std::string_view uniformName(name.data(), (size_t)length);
+        const GLint location = glGetUniformLocation(PROGRAM_, name.c_str());
+        if (location < 0) continue; // Uniforms living in uniform blocks have no location.
+
+        uniformLocations_.push_back({ UniformId::FromRuntime(uniformName), location });
+
+        // Arrays are reported as "name[0]", also make them reachable through "name" and each of their elements.
+        const size_t bracket = uniformName.rfind("[0]");
+        if (bracket != std::string_view::npos && bracket + 3 == uniformName.size())
+        {
+            const std::string baseName(uniformName.substr(0, bracket));
+            uniformLocations_.push_back({ UniformId::FromRuntime(baseName), location });
+            for (GLint element = 1; element < size; element++)
+            {
+                const std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                const GLint elementLocation = glGetUniformLocation(PROGRAM_, elementName.c_str());
+                if (elementLocation < 0) continue;
+                uniformLocations_.push_back({ UniformId::FromRuntime(elementName), elementLocation });
+            }
+        }
+    }
     CheckGlError();
+
+    std::sort(uniformLocations_.begin(), uniformLocations_.end());
+    for (size_t i = 1; i < uniformLocations_.size(); i++)
+    {
+        if (uniformLocations_[i - 1].first == uniformLocations_[i].first)
+        {
+            EngineError("Two uniform names of this program hash to the same UniformId!");
+        }
+    }
 }
 
-void gl::Shader::SetInt(const std::pair<std::string_view, const int*> pair)
+GLint gl::Shader::GetUniformLocation(const UniformId id) const
 {
-    assert(isBound_);
-    const int gpuName = GetUniformLocation(pair.first);
-    glUniform1i(gpuName, *(pair.second));
-    CheckGlError();
+    const auto match = std::lower_bound(uniformLocations_.begin(), uniformLocations_.end(), id,
+        [](const std::pair<UniformId, int>& entry, const UniformId id) { return entry.first < id; });
+    if (match == uniformLocations_.end() || !(match->first == id))
+    {
+        EngineError("Trying to get the location of a non existent uniform!");
+    }
+    return match->second;
 }
 
-void gl::Shader::SetVec3(const std::pair<std::string_view, glm::vec3> pair)
+bool gl::Shader::HasUniform(const UniformId id) const
 {
-    assert(isBound_);
-    const int gpuName = GetUniformLocation(pair.first);
-    glUniform3fv(gpuName, 1, &pair.second[0]);
-    CheckGlError();
+    return std::binary_search(uniformLocations_.begin(), uniformLocations_.end(), std::pair<UniformId, int>(id, 0),
+        [](const std::pair<UniformId, int>& a, const std::pair<UniformId, int>& b) { return a.first < b.first; });
 }
 
-void gl::Shader::SetVec3(const std::pair<std::string_view, const glm::vec3*> pair)
+void gl::Shader::SetInt(const UniformId id, const int value)
 {
     assert(isBound_);
-    const int gpuName = GetUniformLocation(pair.first);
-    glUniform3fv(gpuName, 1, &(*pair.second)[0]);
+    const int location = GetUniformLocation(id);
+    glUniform1i(location, value);
+    InvalidateDynamicUniforms(location); // Set behind the shadow copy's back.
     CheckGlError();
 }
 
-void gl::Shader::SetMat4(const std::pair<std::string_view, glm::mat4> pair)
+void gl::Shader::SetVec3(const UniformId id, const glm::vec3& value)
 {
     assert(isBound_);
-    const int gpuName = GetUniformLocation(pair.first);
-    glUniformMatrix4fv(gpuName, 1, GL_FALSE, &pair.second[0][0]);
+    const int location = GetUniformLocation(id);
+    glUniform3fv(location, 1, &value[0]);
+    InvalidateDynamicUniforms(location);
     CheckGlError();
 }
 
-void gl::Shader::SetMat4(const std::pair<std::string_view, const glm::mat4*> pair)
+void gl::Shader::SetMat4(const UniformId id, const glm::mat4& value)
 {
-    CheckGlError();
     assert(isBound_);
-    const int gpuName = GetUniformLocation(pair.first);
-    glUniformMatrix4fv(gpuName, 1, GL_FALSE, &(*pair.second)[0][0]);
+    const int location = GetUniformLocation(id);
+    glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+    InvalidateDynamicUniforms(location);
     CheckGlError();
 }
 
-void gl::Shader::SetFloat(const std::pair<std::string_view, float> pair)
+void gl::Shader::SetFloat(const UniformId id, const float value)
 {
     assert(isBound_);
-    const int gpuName = GetUniformLocation(pair.first);
-    glUniform1f(gpuName, pair.second);
+    const int location = GetUniformLocation(id);
+    glUniform1f(location, value);
+    InvalidateDynamicUniforms(location);
     CheckGlError();
 }
 
-void gl::Shader::SetFloat(const std::pair<std::string_view, const float*> pair)
+void gl::Shader::Create(Definition def)
 {
-    assert(isBound_);
-    const int gpuName = GetUniformLocation(pair.first);
-    glUniform1f(gpuName, *pair.second);
-    CheckGlError();
+    Submit(std::move(def));
+    Finish();
 }
 
-void gl::Shader::Create(Definition def)
+void gl::Shader::CreateBatch(std::vector<std::pair<Shader*, Definition>> batch)
 {
+    std::vector<Shader*> pending;
+    pending.reserve(batch.size());
+    for (auto& pair : batch)
+    {
+        pair.first->Submit(std::move(pair.second));
+        pending.push_back(pair.first);
+    }
+
+    // Finish programs as soon as they're ready so that uniform setup overlaps with the compiles still running on the driver's threads.
+    while (!pending.empty())
+    {
+        const auto ready = std::find_if(pending.begin(), pending.end(), [](Shader* shader) { return shader->IsReady(); });
+        const auto next = ready != pending.end() ? ready : pending.begin(); // Nothing ready yet, block on the oldest one.
+        (*next)->Finish();
+        pending.erase(next);
+    }
+}
+
+void gl::Shader::Submit(Definition def)
+{
+    EngineGlScope("Shader::Submit");
     assert(!def.vertexPath.empty() && !def.fragmentPath.empty());
 
     if (PROGRAM_ != 0)
@@ -105,124 +351,311 @@ void gl::Shader::Create(Definition def)
         EngineError("Calling Create() a second time...");
     }
 
-    // Note: this manner of hashing differenciates between identical shader sources if they're in different directories! Shouldn't be a problem since all shaders are in the same folder anyways.
-    std::string accumulatedData = std::to_string(def.GetHash());
-    const XXH32_hash_t hash = XXH32(accumulatedData.c_str(), sizeof(char) * accumulatedData.size(), HASHING_SEED);
+    EnableParallelShaderCompile();
+    if (!forgetsEvictedPrograms)
+    {
+        ResourceManager::Get().SetEvictionCallback(ResourceManager::Resource::PROGRAM, ForgetProgram);
+        forgetsEvictedPrograms = true;
+    }
+
+    pending_ = std::make_shared<Pending>();
+    pending_->def = std::move(def);
+
+    const uint64_t hash = pending_->def.GetHash();
 
     PROGRAM_ = ResourceManager::Get().RequestPROGRAM(hash);
-    staticFloats_ = def.staticFloats;
-    staticInts_ = def.staticInts;
-    staticMat4s_ = def.staticMat4s;
-    staticVec3s_ = def.staticVec3s;
-    dynamicFloats_ = def.dynamicFloats;
-    dynamicInts_ = def.dynamicInts;
-    dynamicMat4s_ = def.dynamicMat4s;
-    dynamicVec3s_ = def.dynamicVec3s;
     if (PROGRAM_ != 0)
     {
+        // Static uniforms are part of the hash, the shared program uses the same values.
+        pending_->shared = true;
+        handle_ = Handle<Shader>(PROGRAM_);
         return;
     }
 
-    // Load shader.
-    std::string vertexCode;
-    std::string fragmentCode;
-    {
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
-        {
-            vShaderFile.open(def.vertexPath.data());
-            fShaderFile.open(def.fragmentPath.data());
+    const ResourceManager::CreationTimer timer(ResourceManager::Resource::PROGRAM);
 
-            // read file's buffer contents into streams
-            std::stringstream vShaderStream, fShaderStream, gShaderStream;
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
+    // Load shader, variants only differ by the keywords defined at the top of their sources.
+    Variant variant;
+    const std::string error = BuildVariant(pending_->def, variant);
+    if (!error.empty())
+    {
+        EngineError(error.c_str());
+    }
+    pending_->sourceHash = variant.sourceHash;
+    PROGRAM_ = ProgramCache::Get().Load(pending_->sourceHash);
+    if (PROGRAM_ == 0)
+    {
+        // Only issue the work, every status is queried in Finish(). Drivers supporting parallel shader compilation return right away.
+        const char* vShaderCode = variant.vertexCode.c_str();
+        const char* fShaderCode = variant.fragmentCode.c_str();
+
+        pending_->VERTEX = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(pending_->VERTEX, 1, &vShaderCode, NULL);
+        glCompileShader(pending_->VERTEX);
+
+        pending_->FRAGMENT = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(pending_->FRAGMENT, 1, &fShaderCode, NULL);
+        glCompileShader(pending_->FRAGMENT);
+
+        PROGRAM_ = glCreateProgram();
+        glAttachShader(PROGRAM_, pending_->VERTEX);
+        glAttachShader(PROGRAM_, pending_->FRAGMENT);
+        glProgramParameteri(PROGRAM_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); // For the program cache.
+        glLinkProgram(PROGRAM_);
+        CheckGlError();
+    }
 
-            vShaderFile.close();
-            fShaderFile.close();
+    // Registered right away so that identical definitions later in the same batch share the program instead of compiling it again.
+    ResourceManager::Get().AppendNewPROGRAM(PROGRAM_, hash);
+    ResourceManager::Get().TrackMemory(ResourceManager::Resource::PROGRAM, PROGRAM_, 0); // Size known once linked, see Finish().
+    handle_ = Handle<Shader>(PROGRAM_);
 
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure&)
+    reloadablePrograms[PROGRAM_].def = pending_->def;
+    for (const auto& path : { pending_->def.vertexPath, pending_->def.fragmentPath })
+    {
+        const bool watched = programsBySource.find(path) != programsBySource.end(); // Kept when its programs were evicted, the watcher still is.
+        auto& programs = programsBySource[path];
+        if (!watched)
         {
-            EngineError("Could not open shader file!");
+            FileWatcher::Get().Watch(path, [](const std::string& changed) { ReloadSource(changed); });
         }
+        if (std::find(programs.begin(), programs.end(), PROGRAM_) == programs.end()) programs.push_back(PROGRAM_);
     }
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
+}
 
-    unsigned int vertex, fragment;
-    GLint success;
-    GLchar infoLog[1024];
+void gl::Shader::Prewarm(std::vector<Definition> defs)
+{
+    for (auto& def : defs)
+    {
+        prewarmed.emplace_back().Submit(std::move(def));
+    }
+}
 
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-    CheckGlError();
-    if (!success)
+void gl::Shader::PollPrewarmed()
+{
+    // Without parallel shader compilation Finish() blocks until the program is built, spread those over several frames.
+    const size_t maxNrOfFinished = HasParallelShaderCompile() ? prewarmed.size() : 1;
+    size_t nrOfFinished = 0;
+    for (auto it = prewarmed.begin(); it != prewarmed.end() && nrOfFinished < maxNrOfFinished;)
     {
-        glGetShaderInfoLog(vertex, 1024, NULL, infoLog);
-        EngineError(infoLog);
+        if (it->IsReady())
+        {
+            it->Finish();
+            it = prewarmed.erase(it);
+            nrOfFinished++;
+        }
+        else
+        {
+            it++;
+        }
     }
+}
 
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
+bool gl::Shader::IsReady() const
+{
+    if (pending_ == nullptr) return true;
+    if (!HasParallelShaderCompile()) return true; // Querying would block.
 
-    CheckGlError();
-    if (!success)
+    GLint done = GL_TRUE;
+    glGetProgramiv(PROGRAM_, GLAD_GL_KHR_parallel_shader_compile ? GL_COMPLETION_STATUS_KHR : GL_COMPLETION_STATUS_ARB, &done);
+    return done == GL_TRUE;
+}
+
+void gl::Shader::Finish()
+{
+    EngineGlScope("Shader::Finish");
+    assert(pending_ != nullptr);
+    const std::shared_ptr<Pending> pending = std::move(pending_);
+    generation_ = reloadGeneration;
+    lastUploader_ = &reloadablePrograms.at(PROGRAM_).lastUploader; // Nodes don't move, and the handle keeps the program from being forgotten.
+    if (pending->shared)
     {
-        glGetShaderInfoLog(vertex, 1024, NULL, infoLog);
-        EngineError(infoLog);
+        ResolveUniformLocations();
+        ResolveDynamicUniforms(pending->def);
+        SetStaticUniforms(pending->def); // Already set unless the shader that created the program is still pending, ex: a prewarmed variant.
+        return;
     }
 
-    PROGRAM_ = glCreateProgram();
-    glAttachShader(PROGRAM_, vertex);
-    glAttachShader(PROGRAM_, fragment);
-    glLinkProgram(PROGRAM_);
-    glGetProgramiv(PROGRAM_, GL_LINK_STATUS, &success);
-    CheckGlError();
-    if (!success)
+    const ResourceManager::CreationTimer timer(ResourceManager::Resource::PROGRAM, 0); // Already counted by Submit().
+
+    if (pending->VERTEX != 0) // Compiled from source rather than loaded from the program cache.
     {
-        glGetShaderInfoLog(PROGRAM_, 1024, NULL, infoLog);
-        EngineError(infoLog);
+        GLint success;
+        GLchar infoLog[1024];
+
+        glGetShaderiv(pending->VERTEX, GL_COMPILE_STATUS, &success);
+        CheckGlError();
+        if (!success)
+        {
+            glGetShaderInfoLog(pending->VERTEX, 1024, NULL, infoLog);
+            EngineError(infoLog);
+        }
+
+        glGetShaderiv(pending->FRAGMENT, GL_COMPILE_STATUS, &success);
+        CheckGlError();
+        if (!success)
+        {
+            glGetShaderInfoLog(pending->FRAGMENT, 1024, NULL, infoLog);
+            EngineError(infoLog);
+        }
+
+        glGetProgramiv(PROGRAM_, GL_LINK_STATUS, &success);
+        CheckGlError();
+        if (!success)
+        {
+            glGetProgramInfoLog(PROGRAM_, 1024, NULL, infoLog);
+            EngineError(infoLog);
+        }
+
+        glDetachShader(PROGRAM_, pending->VERTEX);
+        glDetachShader(PROGRAM_, pending->FRAGMENT);
+        glDeleteShader(pending->VERTEX);
+        glDeleteShader(pending->FRAGMENT);
+        ProgramCache::Get().Store(pending->sourceHash, PROGRAM_);
     }
+    ResourceManager::Get().TrackMemory(ResourceManager::Resource::PROGRAM, PROGRAM_, ProgramBytes(PROGRAM_));
+
+    ResolveUniformLocations();
+    ResolveDynamicUniforms(pending->def);
 
-    // Set up static uniforms.
+    SetStaticUniforms(pending->def);
+}
+
+void gl::Shader::SetStaticUniforms(const Definition& def)
+{
     glUseProgram(PROGRAM_);
     isBound_ = true;
-    for (const auto& pair : staticFloats_)
+    for (const auto& pair : def.staticFloats)
     {
-        SetFloat(pair);
+        SetFloat(UniformId::FromRuntime(pair.first), pair.second);
     }
-    for (const auto& pair : staticInts_)
+    for (const auto& pair : def.staticInts)
     {
-        SetInt(pair);
+        SetInt(UniformId::FromRuntime(pair.first), pair.second);
     }
-    for (const auto& pair : staticMat4s_)
+    for (const auto& pair : def.staticMat4s)
     {
-        SetMat4(pair);
+        SetMat4(UniformId::FromRuntime(pair.first), pair.second);
     }
-    for (const auto& pair : staticVec3s_)
+    for (const auto& pair : def.staticVec3s)
     {
-        SetVec3(pair);
+        SetVec3(UniformId::FromRuntime(pair.first), pair.second);
     }
-
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
     glUseProgram(0);
     isBound_ = false;
     CheckGlError();
+}
 
-    ResourceManager::Get().AppendNewPROGRAM(PROGRAM_, hash);
+void gl::Shader::ReloadSource(const std::string& path)
+{
+    EngineGlScope("Shader::ReloadSource");
+    sourceFiles.erase(path);
+    for (const unsigned int PROGRAM : programsBySource[path])
+    {
+        ReloadableProgram& reloadable = reloadablePrograms.at(PROGRAM);
+        Variant variant;
+        const std::string error = BuildVariant(reloadable.def, variant);
+        if (!error.empty())
+        {
+            EngineWarning((error + " Keeping the previous program.").c_str());
+            continue;
+        }
+
+        const char* vShaderCode = variant.vertexCode.c_str();
+        const char* fShaderCode = variant.fragmentCode.c_str();
+        const GLuint VERTEX = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(VERTEX, 1, &vShaderCode, NULL);
+        glCompileShader(VERTEX);
+        const GLuint FRAGMENT = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(FRAGMENT, 1, &fShaderCode, NULL);
+        glCompileShader(FRAGMENT);
+
+        // Linked on the side first, a broken edit must not leave the program in use unlinked.
+        Shader candidate;
+        candidate.PROGRAM_ = glCreateProgram();
+        glAttachShader(candidate.PROGRAM_, VERTEX);
+        glAttachShader(candidate.PROGRAM_, FRAGMENT);
+        glLinkProgram(candidate.PROGRAM_);
+        CheckGlError();
+
+        GLint success = GL_FALSE;
+        GLchar infoLog[1024] = "";
+        std::string failure;
+        glGetShaderiv(VERTEX, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(VERTEX, 1024, NULL, infoLog);
+            failure = infoLog;
+        }
+        glGetShaderiv(FRAGMENT, GL_COMPILE_STATUS, &success);
+        if (failure.empty() && !success)
+        {
+            glGetShaderInfoLog(FRAGMENT, 1024, NULL, infoLog);
+            failure = infoLog;
+        }
+        glGetProgramiv(candidate.PROGRAM_, GL_LINK_STATUS, &success);
+        if (failure.empty() && !success)
+        {
+            glGetProgramInfoLog(candidate.PROGRAM_, 1024, NULL, infoLog);
+            failure = infoLog;
+        }
+        if (failure.empty())
+        {
+            // The definition's uniforms must survive the edit, GetUniformLocation() would abort otherwise.
+            candidate.ResolveUniformLocations();
+            const auto checkUniforms = [&candidate, &failure](const auto& uniforms)
+            {
+                for (const auto& pair : uniforms)
+                {
+                    if (failure.empty() && !candidate.HasUniform(UniformId::FromRuntime(pair.first)))
+                    {
+                        failure = "Uniform " + pair.first + " of the definition isn't used by the program anymore.";
+                    }
+                }
+            };
+            const Definition& def = reloadable.def;
+            checkUniforms(def.staticInts);
+            checkUniforms(def.staticVec3s);
+            checkUniforms(def.staticMat4s);
+            checkUniforms(def.staticFloats);
+            checkUniforms(def.dynamicInts);
+            checkUniforms(def.dynamicVec3s);
+            checkUniforms(def.dynamicMat4s);
+            checkUniforms(def.dynamicFloats);
+        }
+        glDeleteProgram(candidate.PROGRAM_);
+        candidate.PROGRAM_ = 0;
+
+        if (failure.empty())
+        {
+            // Same gpu name, holders of the program don't have to know about the reload.
+            glAttachShader(PROGRAM, VERTEX);
+            glAttachShader(PROGRAM, FRAGMENT);
+            glProgramParameteri(PROGRAM, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            glLinkProgram(PROGRAM);
+            glDetachShader(PROGRAM, VERTEX);
+            glDetachShader(PROGRAM, FRAGMENT);
+            CheckGlError();
+            ProgramCache::Get().Store(variant.sourceHash, PROGRAM);
+            ResourceManager::Get().TrackMemory(ResourceManager::Resource::PROGRAM, PROGRAM, ProgramBytes(PROGRAM));
+
+            // Linking reset every uniform to its default.
+            Shader relinked;
+            relinked.PROGRAM_ = PROGRAM;
+            relinked.ResolveUniformLocations();
+            relinked.SetStaticUniforms(reloadable.def);
+            relinked.PROGRAM_ = 0;
+            reloadable.lastUploader = nullptr;
+            reloadable.generation = ++reloadGeneration;
+        }
+        else
+        {
+            EngineWarning((failure + " Keeping the previous program.").c_str());
+        }
+        glDeleteShader(VERTEX);
+        glDeleteShader(FRAGMENT);
+        CheckGlError();
+    }
 }
 
 unsigned int gl::Shader::GetPROGRAM() const
@@ -232,97 +665,165 @@ unsigned int gl::Shader::GetPROGRAM() const
 
 void gl::Shader::Bind()
 {
-    glUseProgram(PROGRAM_);
-    isBound_ = true;
-    // Update dynamic uniforms.
-    for (const auto& pair : dynamicFloats_)
+    assert(pending_ == nullptr); // Created with Submit() but not finished yet.
+    if (generation_ != reloadGeneration)
     {
-        SetFloat(pair);
+        // Some program was hot reloaded, locations of this one's uniforms may have moved if it was.
+        const auto reloadable = reloadablePrograms.find(PROGRAM_);
+        if (reloadable != reloadablePrograms.end() && reloadable->second.generation > generation_)
+        {
+            ResolveUniformLocations();
+            ResolveDynamicUniforms(reloadable->second.def);
+        }
+        generation_ = reloadGeneration;
     }
-    for (const auto& pair : dynamicInts_)
+    glUseProgram(PROGRAM_);
+    isBound_ = true;
+    if (dynamicUniforms_.empty()) return;
+
+    if (*lastUploader_ != this)
     {
-        SetInt(pair);
+        InvalidateDynamicUniforms();
+        *lastUploader_ = this;
     }
-    for (const auto& pair : dynamicMat4s_)
+
+    // Only upload the dynamic uniforms that changed since this program last received them.
+    for (auto& uniform : dynamicUniforms_)
     {
-        SetMat4(pair);
+        const float* value = static_cast<const float*>(uniform.ptr);
+        const size_t nrOfFloats = NrOfFloats((int)uniform.type);
+        if (uniform.uploaded)
+        {
+            const bool equal = uniform.type == UniformType::MAT4 ?
+                Mat4Equal(uniform.shadow.data(), value) :
+                std::memcmp(uniform.shadow.data(), value, nrOfFloats * sizeof(float)) == 0;
+            if (equal)
+            {
+                uploadStats_.skipped++;
+                continue;
+            }
+        }
+
+        switch (uniform.type)
+        {
+            case UniformType::INT:
+                glUniform1i(uniform.location, *static_cast<const int*>(uniform.ptr));
+                break;
+            case UniformType::FLOAT:
+                glUniform1f(uniform.location, *value);
+                break;
+            case UniformType::VEC3:
+                glUniform3fv(uniform.location, 1, value);
+                break;
+            case UniformType::MAT4:
+                glUniformMatrix4fv(uniform.location, 1, GL_FALSE, value);
+                break;
+        }
+        std::memcpy(uniform.shadow.data(), value, nrOfFloats * sizeof(float));
+        uniform.uploaded = true;
+        uploadStats_.uploaded++;
     }
-    for (const auto& pair : dynamicVec3s_)
+    CheckGlError();
+}
+
+void gl::Shader::InvalidateDynamicUniforms(const int location)
+{
+    for (auto& uniform : dynamicUniforms_)
     {
-        SetVec3(pair);
+        if (location == -1 || uniform.location == location)
+        {
+            uniform.uploaded = false;
+        }
     }
 }
 
-void gl::Shader::Unbind()
+const gl::Shader::UniformUploadStats& gl::Shader::GetUniformUploadStats()
 {
-    glUseProgram(0);
-    isBound_ = false;
+    return uploadStats_;
 }
 
-uint32_t gl::Shader::Definition::GetHash() const
+void gl::Shader::ResetUniformUploadStats()
 {
-    std::string accumulatedData = vertexPath.data();
-    accumulatedData += fragmentPath.data();
-    for (const auto& pair : staticFloats)
-    {
-        accumulatedData += pair.first; // Name of shader variable.
-        accumulatedData += std::to_string(pair.second);
-    }
-    for (const auto& pair : staticInts)
+    uploadStats_ = {};
+}
+
+void gl::Shader::ResolveDynamicUniforms(const Definition& def)
+{
+    dynamicUniforms_.clear();
+    dynamicUniforms_.reserve(def.dynamicFloats.size() + def.dynamicInts.size() + def.dynamicMat4s.size() + def.dynamicVec3s.size());
+    for (const auto& pair : def.dynamicFloats)
     {
-        accumulatedData += pair.first;
-        accumulatedData += std::to_string(pair.second);
+        DynamicUniform& uniform = dynamicUniforms_.emplace_back();
+        uniform.location = GetUniformLocation(UniformId::FromRuntime(pair.first));
+        uniform.type = UniformType::FLOAT;
+        uniform.ptr = pair.second;
     }
-    for (const auto& pair : staticMat4s)
+    for (const auto& pair : def.dynamicInts)
     {
-        accumulatedData += pair.first;
-
-        accumulatedData += std::to_string(pair.second[0][0]);
-        accumulatedData += std::to_string(pair.second[0][1]);
-        accumulatedData += std::to_string(pair.second[0][2]);
-        accumulatedData += std::to_string(pair.second[0][3]);
-
-        accumulatedData += std::to_string(pair.second[1][0]);
-        accumulatedData += std::to_string(pair.second[1][1]);
-        accumulatedData += std::to_string(pair.second[1][2]);
-        accumulatedData += std::to_string(pair.second[1][3]);
-
-        accumulatedData += std::to_string(pair.second[2][0]);
-        accumulatedData += std::to_string(pair.second[2][1]);
-        accumulatedData += std::to_string(pair.second[2][2]);
-        accumulatedData += std::to_string(pair.second[2][3]);
-
-        accumulatedData += std::to_string(pair.second[3][0]);
-        accumulatedData += std::to_string(pair.second[3][1]);
-        accumulatedData += std::to_string(pair.second[3][2]);
-        accumulatedData += std::to_string(pair.second[3][3]);
+        DynamicUniform& uniform = dynamicUniforms_.emplace_back();
+        uniform.location = GetUniformLocation(UniformId::FromRuntime(pair.first));
+        uniform.type = UniformType::INT;
+        uniform.ptr = pair.second;
     }
-    for (const auto& pair : staticVec3s)
+    for (const auto& pair : def.dynamicMat4s)
     {
-        accumulatedData += pair.first;
-        accumulatedData += std::to_string(pair.second[0]);
-        accumulatedData += std::to_string(pair.second[1]);
-        accumulatedData += std::to_string(pair.second[2]);
+        DynamicUniform& uniform = dynamicUniforms_.emplace_back();
+        uniform.location = GetUniformLocation(UniformId::FromRuntime(pair.first));
+        uniform.type = UniformType::MAT4;
+        uniform.ptr = pair.second;
     }
-    for (const auto& pair : dynamicFloats)
+    for (const auto& pair : def.dynamicVec3s)
     {
-        accumulatedData += pair.first;
-        accumulatedData += std::to_string((size_t)&pair.second); // addr of variable being referenced.
+        DynamicUniform& uniform = dynamicUniforms_.emplace_back();
+        uniform.location = GetUniformLocation(UniformId::FromRuntime(pair.first));
+        uniform.type = UniformType::VEC3;
+        uniform.ptr = pair.second;
     }
-    for (const auto& pair : dynamicInts)
+}
+
+void gl::Shader::Unbind()
+{
+    glUseProgram(0);
+    isBound_ = false;
+}
+
+uint64_t gl::Shader::Definition::GetHash() const
+{
+    // Note: identical sources in different directories make different keys. Shouldn't be a problem since all shaders are in the same folder anyways.
+    Hasher hasher(HASHING_SEED);
+    hasher.Add(vertexPath).Add(fragmentPath);
+    std::vector<std::string_view> sortedKeywords(keywords.begin(), keywords.end()); // The order keywords are enabled in doesn't make a different variant.
+    std::sort(sortedKeywords.begin(), sortedKeywords.end());
+    hasher.Add(sortedKeywords.size());
+    for (const auto keyword : sortedKeywords)
     {
-        accumulatedData += pair.first;
-        accumulatedData += std::to_string((size_t)&pair.second);
+        hasher.Add(keyword);
     }
-    for (const auto& pair : dynamicMat4s)
+    // Maps are ordered by name, their content hashes the same whatever order it was filled in.
+    const auto addStatics = [&hasher](const auto& uniforms)
     {
-        accumulatedData += pair.first;
-        accumulatedData += std::to_string((size_t)&pair.second);
-    }
-    for (const auto& pair : dynamicVec3s)
+        hasher.Add(uniforms.size());
+        for (const auto& pair : uniforms)
+        {
+            hasher.Add(pair.first).Add(pair.second);
+        }
+    };
+    addStatics(staticFloats);
+    addStatics(staticInts);
+    addStatics(staticMat4s);
+    addStatics(staticVec3s);
+    // Dynamic uniforms are the same when they read the same variable, hash the address they point to.
+    const auto addDynamics = [&hasher](const auto& uniforms)
     {
-        accumulatedData += pair.first;
-        accumulatedData += std::to_string((size_t)&pair.second);
-    }
-    return XXH32(accumulatedData.c_str(), sizeof(char) * accumulatedData.size(), HASHING_SEED);
+        hasher.Add(uniforms.size());
+        for (const auto& pair : uniforms)
+        {
+            hasher.Add(pair.first).AddAddress(pair.second);
+        }
+    };
+    addDynamics(dynamicFloats);
+    addDynamics(dynamicInts);
+    addDynamics(dynamicMat4s);
+    addDynamics(dynamicVec3s);
+    return hasher.Digest64();
 }
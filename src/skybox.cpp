@@ -1,5 +1,8 @@
 #include "skybox.h"
 
+#include <algorithm>
+#include <string>
+
 #include <glad/glad.h>
 
 #include "resource_manager.h"
@@ -71,7 +74,16 @@ void gl::Skybox::Create(Definition def)
     }
     shader_.Create(def.shader);
 
-    // cubemap_.Create(Texture::Type::CUBEMAP, def.path);
+    Material::Definition matdef;
+    matdef.texturePathsAndTypes.push_back({ def.path, Texture::Type::CUBEMAP });
+    matdef.sampler.filter = Sampler::Filter::LINEAR;
+    cubemap_.Create(matdef);
+
+    IblBaker::Result lighting;
+    if (def.bakeLighting && IblBaker::Load(def.path, def.lighting, lighting))
+    {
+        CreateLightingTextures(lighting);
+    }
 }
 
 void gl::Skybox::Draw()
@@ -83,4 +95,106 @@ void gl::Skybox::Draw()
     cubemap_.Unbind();
     shader_.Unbind();
     glDepthFunc(GL_LESS);
-}
\ No newline at end of file
+}
+void gl::Skybox::AddLightingUniforms(Shader::Definition& def) const
+{
+    if (lightingTEXs_[0] == 0) return; // Not baked, the shader keeps its fallback ambient.
+
+    def.keywords.push_back(IMAGE_BASED_LIGHTING_KEYWORD);
+    for (size_t i = 0; i < irradianceSH_.size(); i++)
+    {
+        def.staticVec3s.insert({ "irradianceSH[" + std::to_string(i) + "]", irradianceSH_[i] });
+    }
+    def.staticInts.insert({ "prefilteredMap", IBL_SPECULAR_TEXTURE_UNIT });
+    def.staticInts.insert({ "brdfLut", IBL_BRDF_LUT_TEXTURE_UNIT });
+    def.staticFloats.insert({ "maxSpecularLod", nrOfSpecularLevels_ - 1.0f });
+}
+
+void gl::Skybox::BindLighting() const
+{
+    static_assert(IBL_BRDF_LUT_TEXTURE_UNIT == IBL_SPECULAR_TEXTURE_UNIT + 1);
+    glBindTextures(IBL_SPECULAR_TEXTURE_UNIT, (GLsizei)lightingTEXs_.size(), lightingTEXs_.data());
+    CheckGlError();
+}
+
+void gl::Skybox::UnbindLighting() const
+{
+    glBindTextures(IBL_SPECULAR_TEXTURE_UNIT, (GLsizei)lightingTEXs_.size(), nullptr);
+    CheckGlError();
+}
+
+void gl::Skybox::CreateLightingTextures(const IblBaker::Result& result)
+{
+    EngineGlScope("Skybox::CreateLightingTextures");
+    irradianceSH_ = result.irradianceSH;
+    nrOfSpecularLevels_ = (float)result.nrOfSpecularLevels;
+    const GLsizei specularSize = (GLsizei)result.specularSize, lutSize = (GLsizei)result.brdfLutSize;
+    const auto specularLevel = [&result](const size_t level, const size_t face)
+    {
+        const size_t size = std::max<size_t>(1, result.specularSize >> level);
+        return result.specular.data() + IblBaker::GetSpecularLevelOffset(result, level) + face * size * size * 4;
+    };
+
+    // Half floats, the baked radiance isn't limited to [0, 1]. Sampling state is set on the textures, no material binds samplers to their units.
+    unsigned int& SPECULAR = lightingTEXs_[0];
+    unsigned int& LUT = lightingTEXs_[1];
+    if (HasDirectStateAccess())
+    {
+        glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &SPECULAR);
+        glTextureStorage2D(SPECULAR, (GLsizei)result.nrOfSpecularLevels, GL_RGBA16F, specularSize, specularSize);
+        for (size_t level = 0; level < result.nrOfSpecularLevels; level++)
+        {
+            const GLsizei size = std::max<GLsizei>(1, specularSize >> level);
+            for (size_t face = 0; face < 6; face++)
+            {
+                glTextureSubImage3D(SPECULAR, (GLint)level, 0, 0, (GLint)face, size, size, 1, GL_RGBA, GL_FLOAT, specularLevel(level, face));
+            }
+        }
+        glTextureParameteri(SPECULAR, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(SPECULAR, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(SPECULAR, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(SPECULAR, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(SPECULAR, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+        glCreateTextures(GL_TEXTURE_2D, 1, &LUT);
+        glTextureStorage2D(LUT, 1, GL_RG16F, lutSize, lutSize);
+        glTextureSubImage2D(LUT, 0, 0, 0, lutSize, lutSize, GL_RG, GL_FLOAT, result.brdfLut.data());
+        glTextureParameteri(LUT, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(LUT, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(LUT, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(LUT, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    else
+    {
+        glGenTextures(1, &SPECULAR);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, SPECULAR);
+        glTexStorage2D(GL_TEXTURE_CUBE_MAP, (GLsizei)result.nrOfSpecularLevels, GL_RGBA16F, specularSize, specularSize);
+        for (size_t level = 0; level < result.nrOfSpecularLevels; level++)
+        {
+            const GLsizei size = std::max<GLsizei>(1, specularSize >> level);
+            for (size_t face = 0; face < 6; face++)
+            {
+                glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)face, (GLint)level, 0, 0, size, size, GL_RGBA, GL_FLOAT, specularLevel(level, face));
+            }
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        glGenTextures(1, &LUT);
+        glBindTexture(GL_TEXTURE_2D, LUT);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG16F, lutSize, lutSize);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, lutSize, lutSize, GL_RG, GL_FLOAT, result.brdfLut.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    CheckGlError();
+    ResourceManager::Get().AppendNewTEX(SPECULAR); // Owned by the skybox, never tracked.
+    ResourceManager::Get().AppendNewTEX(LUT);
+}
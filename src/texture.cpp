@@ -1,178 +1,713 @@
 #include "texture.h"
 
+#include <algorithm>
+#include <cstring>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include<glad/glad.h>
 #include <gli/gli.hpp>
-#ifndef XXH_INLINE_ALL
-#define XXH_INLINE_ALL
-#endif // !XXH_INLINE_ALL
-#include "xxhash.h"
 
+#include "file_system.h"
+#include "hasher.h"
 #include "resource_manager.h"
+#include "file_watcher.h"
+#include "mip_generator.h"
+#include "texture_streamer.h"
+#include "upload_stream.h"
+
+namespace
+{
+    // Empty when the file can't be read. gli parses the KTX/DDS straight from the file's span. RGBA8 2D images without mips get them from the MipGenerator, cooked ones already have theirs.
+    gli::texture LoadImageFile(std::string_view path)
+    {
+        const gl::FileSystem::File file = gl::FileSystem::Get().Read(path);
+        if (!file.Exists()) return gli::texture();
+        return gl::MipGenerator::Generate(gli::load(file.GetData(), file.GetSize()));
+    }
+
+    // Direct state access, one image of Texture into the immutable storage of TEX. pixels is its data, or its offset in the bound GL_PIXEL_UNPACK_BUFFER.
+    void UploadImage(const GLuint TEX, const gli::texture& Texture, const gli::gl::format& Format, const size_t Layer, const size_t Face, const size_t Level, const void* pixels)
+    {
+        GLsizei const LayerGL = static_cast<GLsizei>(Layer);
+        glm::tvec3<GLsizei> Extent(Texture.extent(Level));
+
+        switch (Texture.target())
+        {
+            case gli::TARGET_1D_ARRAY:
+            case gli::TARGET_2D:
+                if (gli::is_compressed(Texture.format()))
+                {
+                    glCompressedTextureSubImage2D(
+                        TEX, static_cast<GLint>(Level),
+                        0, Texture.target() == gli::TARGET_1D_ARRAY ? LayerGL : 0,
+                        Extent.x,
+                        Texture.target() == gli::TARGET_1D_ARRAY ? 1 : Extent.y,
+                        Format.Internal, static_cast<GLsizei>(Texture.size(Level)),
+                        pixels);
+                }
+                else
+                {
+                    glTextureSubImage2D(
+                        TEX, static_cast<GLint>(Level),
+                        0, Texture.target() == gli::TARGET_1D_ARRAY ? LayerGL : 0,
+                        Extent.x,
+                        Texture.target() == gli::TARGET_1D_ARRAY ? 1 : Extent.y,
+                        Format.External, Format.Type,
+                        pixels);
+                }
+                CheckGlError();
+                break;
+            case gli::TARGET_CUBE: // With direct state access, faces of a cubemap are addressed as layers.
+            case gli::TARGET_2D_ARRAY:
+            case gli::TARGET_3D:
+            case gli::TARGET_CUBE_ARRAY:
+            {
+                const GLint zOffset =
+                    Texture.target() == gli::TARGET_3D ? 0 :
+                    static_cast<GLint>(Layer * Texture.faces() + Face);
+                const GLsizei depth = Texture.target() == gli::TARGET_3D ? Extent.z : 1;
+                if (gli::is_compressed(Texture.format()))
+                {
+                    glCompressedTextureSubImage3D(
+                        TEX, static_cast<GLint>(Level),
+                        0, 0, zOffset,
+                        Extent.x, Extent.y, depth,
+                        Format.Internal, static_cast<GLsizei>(Texture.size(Level)),
+                        pixels);
+                }
+                else
+                {
+                    glTextureSubImage3D(
+                        TEX, static_cast<GLint>(Level),
+                        0, 0, zOffset,
+                        Extent.x, Extent.y, depth,
+                        Format.External, Format.Type,
+                        pixels);
+                }
+                CheckGlError();
+                break;
+            }
+            default: assert(0); break;
+        }
+    }
+
+    // Levels finer than firstLevel are skipped, ex: those a streamed texture doesn't hold.
+    void UploadLevels(const GLuint TEX, const gli::texture& Texture, const gli::gl::format& Format, const size_t firstLevel = 0)
+    {
+        for (std::size_t Layer = 0; Layer < Texture.layers(); ++Layer)
+            for (std::size_t Face = 0; Face < Texture.faces(); ++Face)
+                for (std::size_t Level = firstLevel; Level < Texture.levels(); ++Level)
+                {
+                    UploadImage(TEX, Texture, Format, Layer, Face, Level, Texture.data(Layer, Face, Level));
+                }
+    }
+
+    // One image of Texture into the immutable storage of the texture bound to Target.
+    void UploadImageBound(GLenum Target, const gli::texture& Texture, const gli::gl::format& Format, const size_t Layer, const size_t Face, const size_t Level, const void* pixels)
+    {
+        GLsizei const LayerGL = static_cast<GLsizei>(Layer);
+        glm::tvec3<GLsizei> Extent(Texture.extent(Level));
+        Target = gli::is_target_cube(Texture.target())
+            ? static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + Face)
+            : Target;
+
+        switch (Texture.target())
+        {
+            case gli::TARGET_1D_ARRAY:
+            case gli::TARGET_2D:
+            case gli::TARGET_CUBE:
+                if (gli::is_compressed(Texture.format()))
+                {
+                    glCompressedTexSubImage2D(
+                        Target, static_cast<GLint>(Level),
+                        0, 0,
+                        Extent.x,
+                        Texture.target() == gli::TARGET_1D_ARRAY ? LayerGL : Extent.y,
+                        Format.Internal, static_cast<GLsizei>(Texture.size(Level)),
+                        pixels);
+                    CheckGlError();
+                }
+                else
+                {
+                    glTexSubImage2D(
+                        Target, static_cast<GLint>(Level),
+                        0, 0,
+                        Extent.x,
+                        Texture.target() == gli::TARGET_1D_ARRAY ? LayerGL : Extent.y,
+                        Format.External, Format.Type,
+                        pixels);
+                    CheckGlError();
+                }
+                break;
+            case gli::TARGET_2D_ARRAY:
+            case gli::TARGET_3D:
+            case gli::TARGET_CUBE_ARRAY:
+                if (gli::is_compressed(Texture.format()))
+                {
+                    glCompressedTexSubImage3D(
+                        Target, static_cast<GLint>(Level),
+                        0, 0, 0,
+                        Extent.x, Extent.y,
+                        Texture.target() == gli::TARGET_3D ? Extent.z : LayerGL,
+                        Format.Internal, static_cast<GLsizei>(Texture.size(Level)),
+                        pixels);
+                    CheckGlError();
+                }
+                else
+                {
+                    glTexSubImage3D(
+                        Target, static_cast<GLint>(Level),
+                        0, 0, 0,
+                        Extent.x, Extent.y,
+                        Texture.target() == gli::TARGET_3D ? Extent.z : LayerGL,
+                        Format.External, Format.Type,
+                        pixels);
+                    CheckGlError();
+                }
+                break;
+            default: assert(0); break;
+        }
+    }
+
+    void UploadLevelsBound(GLenum Target, const gli::texture& Texture, const gli::gl::format& Format, const size_t firstLevel = 0)
+    {
+        for (std::size_t Layer = 0; Layer < Texture.layers(); ++Layer)
+            for (std::size_t Face = 0; Face < Texture.faces(); ++Face)
+                for (std::size_t Level = firstLevel; Level < Texture.levels(); ++Level)
+                {
+                    UploadImageBound(Target, Texture, Format, Layer, Face, Level, Texture.data(Layer, Face, Level));
+                }
+    }
+
+    // Storage a file was uploaded into. Immutable, a reloaded file is only uploaded in place when it still fits it exactly.
+    struct TextureFile
+    {
+        unsigned int TEX = 0;
+        gli::target target = gli::TARGET_2D;
+        gli::format format = gli::FORMAT_UNDEFINED;
+        gli::extent3d extent = gli::extent3d(0);
+        size_t levels = 0, layers = 0, faces = 0;
+    };
+    std::unordered_map<std::string, std::vector<TextureFile>> textureFiles;
+
+    void ReloadTextureFile(const std::string& path)
+    {
+        EngineGlScope("Texture::Reload");
+        const gli::texture Texture = LoadImageFile(path);
+        if (Texture.empty())
+        {
+            EngineWarning(("Could not open " + path + ", keeping the previous texture.").c_str());
+            return;
+        }
+
+        gli::gl GL(gli::gl::PROFILE_GL33);
+        const gli::gl::format Format = GL.translate(Texture.format(), Texture.swizzles());
+        const GLenum Target = GL.translate(Texture.target());
+        for (const auto& file : textureFiles[path])
+        {
+            if (file.target != Texture.target() || file.format != Texture.format() || file.extent != Texture.extent() ||
+                file.levels != Texture.levels() || file.layers != Texture.layers() || file.faces != Texture.faces())
+            {
+                EngineWarning((path + " changed size, format or number of mips, restart to see it.").c_str());
+                continue;
+            }
+            const size_t firstLevel = gl::TextureStreamer::Get().GetResidentLevel(file.TEX); // Streamed out levels get the new image when streamed in again.
+            if (gl::HasDirectStateAccess())
+            {
+                UploadLevels(file.TEX, Texture, Format, firstLevel);
+            }
+            else
+            {
+                glBindTexture(Target, file.TEX);
+                UploadLevelsBound(Target, Texture, Format, firstLevel);
+                glBindTexture(Target, 0);
+            }
+        }
+        CheckGlError();
+    }
+
+    void WatchTextureFile(const std::string& path, const unsigned int TEX, const gli::texture& Texture)
+    {
+        const bool watched = textureFiles.find(path) != textureFiles.end(); // Kept when its textures were evicted, the watcher still is.
+        auto& files = textureFiles[path];
+        if (!watched)
+        {
+            gl::FileWatcher::Get().Watch(path, ReloadTextureFile);
+        }
+        files.push_back({ TEX, Texture.target(), Texture.format(), Texture.extent(), Texture.levels(), Texture.layers(), Texture.faces() });
+    }
+
+    // Eviction callback of the ResourceManager, the texture is deleted right after.
+    void ForgetTexture(const unsigned int TEX)
+    {
+        for (auto& pair : textureFiles)
+        {
+            auto& files = pair.second;
+            files.erase(std::remove_if(files.begin(), files.end(), [TEX](const TextureFile& file) { return file.TEX == TEX; }), files.end());
+        }
+        gl::TextureStreamer::Get().Unregister(TEX);
+    }
+    bool forgetsEvictedTextures = false;
+
+    // Registers a texture created from a file with the ResourceManager. Unless publish, RequestTEX() doesn't hand it out yet, see PublishTexture().
+    void AppendTextureFile(const std::string& path, const unsigned int TEX, const uint64_t hash, const gli::texture& Texture, const bool publish = true)
+    {
+        WatchTextureFile(path, TEX, Texture);
+        if (publish) gl::ResourceManager::Get().AppendNewTEX(TEX, hash);
+        gl::ResourceManager::Get().TrackMemory(gl::ResourceManager::Resource::TEXTURE, TEX, Texture.size());
+        if (!forgetsEvictedTextures)
+        {
+            gl::ResourceManager::Get().SetEvictionCallback(gl::ResourceManager::Resource::TEXTURE, ForgetTexture);
+            forgetsEvictedTextures = true;
+        }
+    }
+
+    // Hands out a texture whose images all landed to the textures created from its file later on.
+    void PublishTexture(const unsigned int TEX, const uint64_t hash)
+    {
+        if (gl::ResourceManager::Get().RequestTEX(hash) == 0)
+        {
+            gl::ResourceManager::Get().AppendNewTEX(TEX, hash);
+        }
+        else
+        {
+            gl::ResourceManager::Get().AppendNewTEX(TEX); // A synchronous Create() of the same file landed first, this copy stays anonymous.
+        }
+    }
+
+    // 1x1 textures bound while the real ones load, by Texture::Type.
+    std::array<unsigned int, gl::Texture::Type::INVALID> placeholders = {};
+
+    unsigned int GetPlaceholder(const gl::Texture::Type type)
+    {
+        unsigned int& TEX = placeholders[type];
+        if (TEX != 0) return TEX;
+
+        EngineGlScope("Texture::GetPlaceholder");
+        std::array<unsigned char, 4> texel = { 128, 128, 128, 255 }; // Mid gray diffuse and cubemaps.
+        if (type == gl::Texture::Type::ALPHA) texel = { 255, 255, 255, 255 }; // Opaque.
+        if (type == gl::Texture::Type::NORMALMAP) texel = { 128, 128, 255, 255 }; // Flat, pointing along the surface's normal.
+        if (type == gl::Texture::Type::SPECULAR) texel = { 0, 0, 0, 255 }; // No highlights.
+
+        const GLenum Target = type == gl::Texture::Type::CUBEMAP ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+        const int nrOfFaces = type == gl::Texture::Type::CUBEMAP ? 6 : 1;
+        if (gl::HasDirectStateAccess())
+        {
+            glCreateTextures(Target, 1, &TEX);
+            glTextureStorage2D(TEX, 1, GL_RGBA8, 1, 1);
+            for (int face = 0; face < nrOfFaces; face++)
+            {
+                glTextureSubImage3D(TEX, 0, 0, 0, face, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, texel.data());
+            }
+        }
+        else
+        {
+            glGenTextures(1, &TEX);
+            glBindTexture(Target, TEX);
+            glTexParameteri(Target, GL_TEXTURE_MAX_LEVEL, 0);
+            for (int face = 0; face < nrOfFaces; face++)
+            {
+                glTexImage2D(nrOfFaces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel.data());
+            }
+            glBindTexture(Target, 0);
+        }
+        CheckGlError();
+        gl::ResourceManager::Get().AppendNewTEX(TEX); // Never tracked, they're never evicted.
+        return TEX;
+    }
+
+    // Gl half of a texture's creation, the image is already decoded. Without uploadLevels the storage is left to be filled, ex: by the UploadStream, and the texture is published once it is.
+    unsigned int CreateFromImage(const gli::texture& Texture, const std::string& path, const uint64_t hash, const bool uploadLevels = true)
+    {
+        unsigned int TEX = 0;
+        const gl::ResourceManager::CreationTimer timer(gl::ResourceManager::Resource::TEXTURE);
+
+        gli::gl GL(gli::gl::PROFILE_GL33);
+        gli::gl::format const Format = GL.translate(Texture.format(), Texture.swizzles());
+        GLenum Target = GL.translate(Texture.target());
+
+        glm::tvec3<GLsizei> const Extent(Texture.extent());
+        GLsizei const FaceTotal = static_cast<GLsizei>(Texture.layers() * Texture.faces());
+
+        if (gl::HasDirectStateAccess())
+        {
+            // Immutable storage, edited through the texture's name. Nothing gets bound.
+            glCreateTextures(Target, 1, &TEX);
+            CheckGlError();
+            glTextureParameteri(TEX, GL_TEXTURE_BASE_LEVEL, 0);
+            glTextureParameteri(TEX, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(Texture.levels() - 1));
+            glTextureParameteri(TEX, GL_TEXTURE_SWIZZLE_R, Format.Swizzles[0]);
+            glTextureParameteri(TEX, GL_TEXTURE_SWIZZLE_G, Format.Swizzles[1]);
+            glTextureParameteri(TEX, GL_TEXTURE_SWIZZLE_B, Format.Swizzles[2]);
+            glTextureParameteri(TEX, GL_TEXTURE_SWIZZLE_A, Format.Swizzles[3]);
+            CheckGlError();
+
+            switch (Texture.target())
+            {
+                case gli::TARGET_1D_ARRAY:
+                case gli::TARGET_2D:
+                case gli::TARGET_CUBE:
+                    glTextureStorage2D(
+                        TEX, static_cast<GLint>(Texture.levels()), Format.Internal,
+                        Extent.x, Extent.y);
+                    CheckGlError();
+                    break;
+                case gli::TARGET_2D_ARRAY:
+                case gli::TARGET_3D:
+                case gli::TARGET_CUBE_ARRAY:
+                    glTextureStorage3D(
+                        TEX, static_cast<GLint>(Texture.levels()), Format.Internal,
+                        Extent.x, Extent.y,
+                        Texture.target() == gli::TARGET_3D ? Extent.z : FaceTotal);
+                    CheckGlError();
+                    break;
+                default:
+                    assert(0);
+                    break;
+            }
+
+            if (uploadLevels) UploadLevels(TEX, Texture, Format);
+
+            AppendTextureFile(path, TEX, hash, Texture, uploadLevels);
+            return TEX;
+        }
+
+        glGenTextures(1, &TEX);
+        glBindTexture(Target, TEX);
+        CheckGlError();
+        glTexParameteri(Target, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(Target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(Texture.levels() - 1));
+        CheckGlError();
+        glTexParameteri(Target, GL_TEXTURE_SWIZZLE_R, Format.Swizzles[0]);
+        glTexParameteri(Target, GL_TEXTURE_SWIZZLE_G, Format.Swizzles[1]);
+        glTexParameteri(Target, GL_TEXTURE_SWIZZLE_B, Format.Swizzles[2]);
+        glTexParameteri(Target, GL_TEXTURE_SWIZZLE_A, Format.Swizzles[3]);
+        CheckGlError();
+
+        switch (Texture.target())
+        {
+            case gli::TARGET_1D_ARRAY:
+            case gli::TARGET_2D:
+            case gli::TARGET_CUBE:
+                glTexStorage2D(
+                    Target, static_cast<GLint>(Texture.levels()), Format.Internal,
+                    Extent.x, Extent.y);
+                CheckGlError();
+                break;
+            case gli::TARGET_2D_ARRAY:
+            case gli::TARGET_3D:
+            case gli::TARGET_CUBE_ARRAY:
+                glTexStorage3D(
+                    Target, static_cast<GLint>(Texture.levels()), Format.Internal,
+                    Extent.x, Extent.y,
+                    Texture.target() == gli::TARGET_3D ? Extent.z : FaceTotal);
+                CheckGlError();
+                break;
+            default:
+                assert(0);
+                break;
+        }
+
+        if (uploadLevels) UploadLevelsBound(Target, Texture, Format);
+        CheckGlError();
+
+        glBindTexture(GL.translate(Texture.target()), 0);
+
+        AppendTextureFile(path, TEX, hash, Texture, uploadLevels);
+        return TEX;
+    }
+
+    // Streamed textures keep the levels from this one on, the first no bigger than STREAMING_RESIDENT_EXTENT. 0 when the texture can't be streamed: only 2D textures whose finest levels are worth it.
+    size_t GetStreamingTailLevel(const gli::texture& Texture)
+    {
+        if (Texture.target() != gli::TARGET_2D || Texture.layers() != 1 || Texture.faces() != 1) return 0;
+        size_t level = 0;
+        while (level + 1 < Texture.levels() && (size_t)glm::max(Texture.extent(level).x, Texture.extent(level).y) > gl::STREAMING_RESIDENT_EXTENT)
+        {
+            level++;
+        }
+        return level;
+    }
+
+    // Mutable storage of the GL_TEXTURE_2D bound, (re)specifies level of Texture from pixels. Without Texture the level is emptied, which frees it.
+    void SpecifyLevelBound(const gli::texture* Texture, const gli::format format, const gli::gl::format& Format, const size_t Level, const void* pixels)
+    {
+        const glm::tvec3<GLsizei> Extent = Texture != nullptr ? glm::tvec3<GLsizei>(Texture->extent(Level)) : glm::tvec3<GLsizei>(0);
+        if (gli::is_compressed(format))
+        {
+            glCompressedTexImage2D(
+                GL_TEXTURE_2D, static_cast<GLint>(Level), Format.Internal,
+                Extent.x, Extent.y, 0,
+                Texture != nullptr ? static_cast<GLsizei>(Texture->size(Level)) : 0,
+                pixels);
+        }
+        else
+        {
+            glTexImage2D(
+                GL_TEXTURE_2D, static_cast<GLint>(Level), Format.Internal,
+                Extent.x, Extent.y, 0,
+                Format.External, Format.Type,
+                pixels);
+        }
+        CheckGlError();
+    }
+
+    // Gl half of a streamed texture's creation, its levels from tailLevel on are specified by the UploadStream. Published once they are.
+    unsigned int CreateStreamedTexture(const gli::texture& Texture, const std::string& path, const uint64_t hash, const size_t tailLevel)
+    {
+        unsigned int TEX = 0;
+        const gl::ResourceManager::CreationTimer timer(gl::ResourceManager::Resource::TEXTURE);
+
+        gli::gl GL(gli::gl::PROFILE_GL33);
+        gli::gl::format const Format = GL.translate(Texture.format(), Texture.swizzles());
+
+        // Mutable storage even with direct state access: released levels are respecified empty while TEX, which handles, materials and the ResourceManager know the texture by, stays the same.
+        glGenTextures(1, &TEX);
+        glBindTexture(GL_TEXTURE_2D, TEX);
+        CheckGlError();
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(tailLevel));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(Texture.levels() - 1));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, Format.Swizzles[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, Format.Swizzles[1]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, Format.Swizzles[2]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, Format.Swizzles[3]);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        CheckGlError();
+
+        AppendTextureFile(path, TEX, hash, Texture, false);
+        return TEX;
+    }
+
+    // Reads path again on a worker and streams the levels [first, end) of TEX in, see TextureStreamer. Uploads of a load the streamer gave up on, ex: the texture was evicted, are dropped.
+    gl::AsyncLoader::Task StreamLevels(const unsigned int TEX, const std::string path, const size_t first, const size_t end, const uint64_t load)
+    {
+        co_await gl::AsyncLoader::Get().ToWorker();
+        const auto Texture = std::make_shared<const gli::texture>(LoadImageFile(path));
+        if (Texture->empty() || Texture->target() != gli::TARGET_2D || Texture->levels() < end)
+        {
+            co_await gl::AsyncLoader::Get().ToGlThread();
+            EngineWarning(("Could not stream the mips of " + path + " in, keeping its coarse ones.").c_str());
+            if (gl::TextureStreamer::Get().IsLoading(TEX, load)) gl::TextureStreamer::Get().Unregister(TEX);
+            co_return;
+        }
+
+        auto remainingLevels = std::make_shared<size_t>(end - first);
+        for (size_t level = first; level < end; level++)
+        {
+            gl::UploadStream::Get().Stage(
+                Texture->size(level),
+                [Texture, level](char* destination)
+                {
+                    std::memcpy(destination, Texture->data(0, 0, level), Texture->size(level));
+                },
+                [Texture, remainingLevels, TEX, first, level, load](const void* pixels)
+                {
+                    if (!gl::TextureStreamer::Get().IsLoading(TEX, load)) return;
+                    EngineGlScope("Texture::StreamLevels");
+                    gli::gl GL(gli::gl::PROFILE_GL33);
+                    const gli::gl::format Format = GL.translate(Texture->format(), Texture->swizzles());
+                    glBindTexture(GL_TEXTURE_2D, TEX);
+                    SpecifyLevelBound(Texture.get(), Texture->format(), Format, level, pixels);
+                    glBindTexture(GL_TEXTURE_2D, 0);
+                    if (--*remainingLevels == 0) gl::TextureStreamer::Get().OnStreamedIn(TEX, load, first);
+                });
+        }
+    }
+
+    // Hands a streamed texture whose levels from tailLevel on landed to the TextureStreamer.
+    void RegisterStreamedTexture(const unsigned int TEX, const std::string& path, const gli::texture& Texture, const size_t tailLevel)
+    {
+        std::vector<size_t> levelBytes(Texture.levels());
+        for (size_t level = 0; level < levelBytes.size(); level++)
+        {
+            levelBytes[level] = Texture.size(level);
+        }
+        gli::gl GL(gli::gl::PROFILE_GL33);
+        const gli::format format = Texture.format();
+        const gli::gl::format Format = GL.translate(Texture.format(), Texture.swizzles());
+        gl::TextureStreamer::Get().Register(TEX, (size_t)Texture.extent().x, (size_t)Texture.extent().y, std::move(levelBytes), tailLevel,
+            [TEX, path](size_t first, size_t end, uint64_t load)
+            {
+                StreamLevels(TEX, path, first, end, load);
+            },
+            [TEX, format, Format](size_t level)
+            {
+                glBindTexture(GL_TEXTURE_2D, TEX);
+                for (size_t finer = 0; finer < level; finer++)
+                {
+                    SpecifyLevelBound(nullptr, format, Format, finer, nullptr);
+                }
+                glBindTexture(GL_TEXTURE_2D, 0);
+            });
+    }
+}//!anonymous
+
+std::unordered_map<uint64_t, std::weak_ptr<gl::Texture::Loading>> gl::Texture::loadsInFlight_;
 
 void gl::Texture::Create(Type textureType, std::string_view path)
 {
+    EngineGlScope("Texture::Create");
     if (TEX_ != 0)
     {
         EngineError("Calling Create() a second time...");
     }
 
-    // assert((int)textureType < (int)Type::CUBEMAP + 1 && (int)textureType > -1 && !path.empty());
-
-    // Accumulate all the relevant data in a single string for hashing.
-    std::string accumulatedData = path.data();
-    accumulatedData += std::to_string((int)textureType);
+    assert((int)textureType < (int)Type::INVALID && (int)textureType > -1 && !path.empty());
 
-    const XXH32_hash_t hash = XXH32(accumulatedData.c_str(), sizeof(char) * accumulatedData.size(), HASHING_SEED);
+    Hasher hasher(HASHING_SEED);
+    hasher.Add(path).Add(textureType);
+    const uint64_t hash = hasher.Digest64();
 
     TEX_ = ResourceManager::Get().RequestTEX(hash);
-    // type_ = textureType;
+    type_ = textureType;
     if (TEX_ != 0) // This means the data has been already loaded. Just use the returned gpu name.
     {
+        handle_ = Handle<gl::Texture>(TEX_);
         return;
     }
 
-    gli::texture Texture = gli::load(path.data());
+    const gli::texture Texture = LoadImageFile(path);
     if (Texture.empty()) EngineError("Could not open image file!");
+    TEX_ = CreateFromImage(Texture, std::string(path), hash);
+    handle_ = Handle<gl::Texture>(TEX_);
+}
 
-    gli::gl GL(gli::gl::PROFILE_GL33);
-    gli::gl::format const Format = GL.translate(Texture.format(), Texture.swizzles());
-    GLenum Target = GL.translate(Texture.target());
+void gl::Texture::CreateAsync(Type textureType, std::string_view path, bool streamMips)
+{
+    if (TEX_ != 0)
+    {
+        EngineError("Calling Create() a second time...");
+    }
 
-    glGenTextures(1, &TEX_);
-    glBindTexture(Target, TEX_);
-    CheckGlError();
-    glTexParameteri(Target, GL_TEXTURE_BASE_LEVEL, 0);
-    glTexParameteri(Target, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(Texture.levels() - 1));
-    CheckGlError();
-    glTexParameteri(Target, GL_TEXTURE_SWIZZLE_R, Format.Swizzles[0]);
-    glTexParameteri(Target, GL_TEXTURE_SWIZZLE_G, Format.Swizzles[1]);
-    glTexParameteri(Target, GL_TEXTURE_SWIZZLE_B, Format.Swizzles[2]);
-    glTexParameteri(Target, GL_TEXTURE_SWIZZLE_A, Format.Swizzles[3]);
-    CheckGlError();
+    assert((int)textureType < (int)Type::INVALID && (int)textureType > -1 && !path.empty());
 
-    glm::tvec3<GLsizei> const Extent(Texture.extent());
-    GLsizei const FaceTotal = static_cast<GLsizei>(Texture.layers() * Texture.faces());
+    Hasher hasher(HASHING_SEED);
+    hasher.Add(path).Add(textureType);
+    const uint64_t hash = hasher.Digest64();
 
-    switch (Texture.target())
+    TEX_ = ResourceManager::Get().RequestTEX(hash);
+    type_ = textureType;
+    if (TEX_ != 0)
     {
-        case gli::TARGET_1D_ARRAY:
-        case gli::TARGET_2D:
-        case gli::TARGET_CUBE:
-            glTexStorage2D(
-                Target, static_cast<GLint>(Texture.levels()), Format.Internal,
-                Extent.x, Extent.y);
-            CheckGlError();
-            break;
-        case gli::TARGET_2D_ARRAY:
-        case gli::TARGET_3D:
-        case gli::TARGET_CUBE_ARRAY:
-            glTexStorage3D(
-                Target, static_cast<GLint>(Texture.levels()), Format.Internal,
-                Extent.x, Extent.y,
-                Texture.target() == gli::TARGET_3D ? Extent.z : FaceTotal);
-            CheckGlError();
-            break;
-        default:
-            assert(0);
-            break;
+        handle_ = Handle<Texture>(TEX_);
+        return;
     }
 
-    for (std::size_t Layer = 0; Layer < Texture.layers(); ++Layer)
-        for (std::size_t Face = 0; Face < Texture.faces(); ++Face)
-            for (std::size_t Level = 0; Level < Texture.levels(); ++Level)
-            {
-                GLsizei const LayerGL = static_cast<GLsizei>(Layer);
-                glm::tvec3<GLsizei> Extent(Texture.extent(Level));
-                Target = gli::is_target_cube(Texture.target())
-                    ? static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + Face)
-                    : Target;
+    std::weak_ptr<Loading>& inFlight = loadsInFlight_[hash];
+    loading_ = inFlight.lock();
+    TEX_ = GetPlaceholder(textureType);
+    if (loading_ == nullptr)
+    {
+        loading_ = std::make_shared<Loading>();
+        inFlight = loading_;
+        Load(loading_, std::string(path), hash, streamMips);
+    }
+}
 
-                switch (Texture.target())
-                {
-                    case gli::TARGET_1D_ARRAY:
-                    case gli::TARGET_2D:
-                    case gli::TARGET_CUBE:
-                        if (gli::is_compressed(Texture.format()))
+gl::AsyncLoader::Task gl::Texture::Load(std::shared_ptr<Loading> loading, std::string path, uint64_t hash, bool streamMips)
+{
+    co_await AsyncLoader::Get().ToWorker();
+    const auto Texture = std::make_shared<const gli::texture>(LoadImageFile(path));
+    if (Texture->empty())
+    {
+        co_await AsyncLoader::Get().ToGlThread();
+        EngineError(("Could not open image file " + path).c_str());
+    }
+
+    // Every image is copied into the UploadStream from this worker. The storage is created by the upload of the first one, the texture lands with the last one. Streamed textures only start with their coarse levels.
+    const size_t firstLevel = streamMips ? GetStreamingTailLevel(*Texture) : 0;
+    struct Streamed
+    {
+        unsigned int TEX = 0;
+        bool createdMeanwhile = false; // Synchronously, nothing to upload.
+        size_t remainingImages = 0;
+    };
+    auto streamed = std::make_shared<Streamed>();
+    streamed->remainingImages = Texture->layers() * Texture->faces() * (Texture->levels() - firstLevel);
+    for (size_t layer = 0; layer < Texture->layers(); layer++)
+        for (size_t face = 0; face < Texture->faces(); face++)
+            for (size_t level = firstLevel; level < Texture->levels(); level++)
+            {
+                UploadStream::Get().Stage(
+                    Texture->size(level),
+                    [Texture, layer, face, level](char* destination)
+                    {
+                        std::memcpy(destination, Texture->data(layer, face, level), Texture->size(level));
+                    },
+                    [Texture, streamed, loading, path, hash, firstLevel, layer, face, level](const void* pixels)
+                    {
+                        EngineGlScope("Texture::Load");
+                        gli::gl GL(gli::gl::PROFILE_GL33);
+                        const gli::gl::format Format = GL.translate(Texture->format(), Texture->swizzles());
+                        const GLenum Target = GL.translate(Texture->target());
+                        if (streamed->TEX == 0)
                         {
-                            glCompressedTexSubImage2D(
-                                Target, static_cast<GLint>(Level),
-                                0, 0,
-                                Extent.x,
-                                Texture.target() == gli::TARGET_1D_ARRAY ? LayerGL : Extent.y,
-                                Format.Internal, static_cast<GLsizei>(Texture.size(Level)),
-                                Texture.data(Layer, Face, Level));
-                            CheckGlError();
+                            streamed->TEX = ResourceManager::Get().RequestTEX(hash);
+                            streamed->createdMeanwhile = streamed->TEX != 0;
+                            if (!streamed->createdMeanwhile) streamed->TEX = firstLevel > 0 ? CreateStreamedTexture(*Texture, path, hash, firstLevel) : CreateFromImage(*Texture, path, hash, false);
+                            loading->handle = Handle<gl::Texture>(streamed->TEX); // Can't be evicted while its images land.
                         }
-                        else
+                        if (!streamed->createdMeanwhile && firstLevel > 0)
                         {
-                            glTexSubImage2D(
-                                Target, static_cast<GLint>(Level),
-                                0, 0,
-                                Extent.x,
-                                Texture.target() == gli::TARGET_1D_ARRAY ? LayerGL : Extent.y,
-                                Format.External, Format.Type,
-                                Texture.data(Layer, Face, Level));
-                            CheckGlError();
+                            glBindTexture(GL_TEXTURE_2D, streamed->TEX);
+                            SpecifyLevelBound(Texture.get(), Texture->format(), Format, level, pixels);
+                            glBindTexture(GL_TEXTURE_2D, 0);
                         }
-                        break;
-                    case gli::TARGET_2D_ARRAY:
-                    case gli::TARGET_3D:
-                    case gli::TARGET_CUBE_ARRAY:
-                        if (gli::is_compressed(Texture.format()))
+                        else if (!streamed->createdMeanwhile)
                         {
-                            glCompressedTexSubImage3D(
-                                Target, static_cast<GLint>(Level),
-                                0, 0, 0,
-                                Extent.x, Extent.y,
-                                Texture.target() == gli::TARGET_3D ? Extent.z : LayerGL,
-                                Format.Internal, static_cast<GLsizei>(Texture.size(Level)),
-                                Texture.data(Layer, Face, Level));
-                            CheckGlError();
+                            if (HasDirectStateAccess())
+                            {
+                                UploadImage(streamed->TEX, *Texture, Format, layer, face, level, pixels);
+                            }
+                            else
+                            {
+                                glBindTexture(Target, streamed->TEX);
+                                UploadImageBound(Target, *Texture, Format, layer, face, level, pixels);
+                                glBindTexture(Target, 0);
+                            }
                         }
-                        else
+                        if (--streamed->remainingImages == 0)
                         {
-                            glTexSubImage3D(
-                                Target, static_cast<GLint>(Level),
-                                0, 0, 0,
-                                Extent.x, Extent.y,
-                                Texture.target() == gli::TARGET_3D ? Extent.z : LayerGL,
-                                Format.External, Format.Type,
-                                Texture.data(Layer, Face, Level));
-                            CheckGlError();
+                            if (!streamed->createdMeanwhile)
+                            {
+                                PublishTexture(streamed->TEX, hash);
+                                if (firstLevel > 0) RegisterStreamedTexture(streamed->TEX, path, *Texture, firstLevel);
+                            }
+                            loading->TEX = streamed->TEX;
+                            loadsInFlight_.erase(hash); // Later textures find it through the ResourceManager.
                         }
-                        break;
-                    default: assert(0); break;
-                }
+                    });
             }
+}
 
-    CheckGlError();
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    ResourceManager::Get().AppendNewTEX(TEX_, hash);
+bool gl::Texture::IsLoaded() const
+{
+    return loading_ == nullptr || loading_->TEX != 0;
 }
 
 GLuint gl::Texture::GetTEX() const
 {
-    return TEX_;
+    return loading_ != nullptr && loading_->TEX != 0 ? loading_->TEX : TEX_;
+}
+
+gl::Texture::Type gl::Texture::GetType() const
+{
+    return type_;
 }
 
 void gl::Texture::Bind() const
 {
-    CheckGlError();
-    // assert((int)type_ > -1 && (int)type_ < (int)Type::INVALID);
-    // glActiveTexture(GL_TEXTURE0 + (int)type_);
-    // glBindTexture((int)type_ == (int)Type::CUBEMAP ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, TEX_);
+    assert((int)type_ > -1 && (int)type_ < (int)Type::INVALID);
+    const unsigned int TEX = GetTEX();
+    glBindTextures((GLuint)type_, 1, &TEX);
     CheckGlError();
 }
 
 void gl::Texture::Unbind() const
 {
-    CheckGlError();
-    // assert((int)type_ > -1 && (int)type_ < (int)Type::INVALID);
-    // glActiveTexture(GL_TEXTURE0 + (int)type_);
-    // glBindTexture((int)type_ == (int)Type::CUBEMAP ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, 0);
+    assert((int)type_ > -1 && (int)type_ < (int)Type::INVALID);
+    glBindTextures((GLuint)type_, 1, nullptr);
     CheckGlError();
 }
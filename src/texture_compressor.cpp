@@ -0,0 +1,341 @@
+#include "texture_compressor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "defines.h"
+#if GL_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr size_t NR_OF_TEXELS = gl::TextureCompressor::BLOCK_EXTENT * gl::TextureCompressor::BLOCK_EXTENT;
+    constexpr size_t BLOCKS_PER_THREAD = 256; // Smaller images, and most mips, aren't worth starting threads for.
+
+    struct ColorBlock
+    {
+        uint16_t color0 = 0;
+        uint16_t color1 = 0;
+        uint32_t indices = 0; // 2 bits per texel, the first texel in the lowest bits.
+        int error = 0; // Sum of the squared differences with the texels.
+    };
+
+    uint16_t To565(const int* color)
+    {
+        const int r = (color[0] * 31 + 127) / 255, g = (color[1] * 63 + 127) / 255, b = (color[2] * 31 + 127) / 255;
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    void From565(const uint16_t packed, int* color)
+    {
+        const int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    void FindBounds(const uint8_t* texels, int* minColor, int* maxColor)
+    {
+#if GL_SIMD_SSE2
+        const __m128i row0 = _mm_loadu_si128((const __m128i*)texels), row1 = _mm_loadu_si128((const __m128i*)(texels + 16));
+        const __m128i row2 = _mm_loadu_si128((const __m128i*)(texels + 32)), row3 = _mm_loadu_si128((const __m128i*)(texels + 48));
+        __m128i minimum = _mm_min_epu8(_mm_min_epu8(row0, row1), _mm_min_epu8(row2, row3));
+        __m128i maximum = _mm_max_epu8(_mm_max_epu8(row0, row1), _mm_max_epu8(row2, row3));
+        // Then across the 4 texels of a row.
+        minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+        minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+        maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(1, 0, 3, 2)));
+        maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(2, 3, 0, 1)));
+        const uint32_t packedMin = (uint32_t)_mm_cvtsi128_si32(minimum), packedMax = (uint32_t)_mm_cvtsi128_si32(maximum);
+        for (int c = 0; c < 3; c++)
+        {
+            minColor[c] = (int)((packedMin >> (8 * c)) & 0xFF);
+            maxColor[c] = (int)((packedMax >> (8 * c)) & 0xFF);
+        }
+#else
+        for (int c = 0; c < 3; c++)
+        {
+            minColor[c] = 255;
+            maxColor[c] = 0;
+            for (size_t i = 0; i < NR_OF_TEXELS; i++)
+            {
+                minColor[c] = std::min<int>(minColor[c], texels[i * 4 + c]);
+                maxColor[c] = std::max<int>(maxColor[c], texels[i * 4 + c]);
+            }
+        }
+#endif
+    }
+
+    // Palette position of every texel along the line from color1 to color0, in BC1's index order.
+    uint32_t ProjectIndices(const uint8_t* texels, const int* color0, const int* color1)
+    {
+        constexpr uint32_t INDEX_OF_STEP[4] = { 1, 3, 2, 0 }; // color1, 2/3 color1 + 1/3 color0, 1/3 color1 + 2/3 color0, color0.
+        const int axis[3] = { color0[0] - color1[0], color0[1] - color1[1], color0[2] - color1[2] };
+        const int lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+        if (lengthSquared == 0) return 0;
+        const float scale = 3.0f / (float)lengthSquared;
+
+        int16_t steps[NR_OF_TEXELS];
+#if GL_SIMD_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i origin = _mm_setr_epi16((short)color1[0], (short)color1[1], (short)color1[2], 0, (short)color1[0], (short)color1[1], (short)color1[2], 0);
+        const __m128i direction = _mm_setr_epi16((short)axis[0], (short)axis[1], (short)axis[2], 0, (short)axis[0], (short)axis[1], (short)axis[2], 0);
+        const __m128 scales = _mm_set1_ps(scale), half = _mm_set1_ps(0.5f);
+        __m128i rowSteps[4];
+        for (size_t row = 0; row < 4; row++)
+        {
+            const __m128i texelRow = _mm_loadu_si128((const __m128i*)(texels + row * 16));
+            // r * dr + g * dg and b * db of 2 texels per register, then summed per texel.
+            const __m128 low = _mm_castsi128_ps(_mm_madd_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(texelRow, zero), origin), direction));
+            const __m128 high = _mm_castsi128_ps(_mm_madd_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(texelRow, zero), origin), direction));
+            const __m128i dots = _mm_add_epi32(
+                _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0))),
+                _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1))));
+            rowSteps[row] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(dots), scales), half));
+        }
+        const __m128i first = _mm_packs_epi32(rowSteps[0], rowSteps[1]), second = _mm_packs_epi32(rowSteps[2], rowSteps[3]);
+        const __m128i lowest = _mm_setzero_si128(), highest = _mm_set1_epi16(3);
+        _mm_storeu_si128((__m128i*)steps, _mm_min_epi16(_mm_max_epi16(first, lowest), highest));
+        _mm_storeu_si128((__m128i*)(steps + 8), _mm_min_epi16(_mm_max_epi16(second, lowest), highest));
+#else
+        for (size_t i = 0; i < NR_OF_TEXELS; i++)
+        {
+            int dot = 0;
+            for (int c = 0; c < 3; c++)
+            {
+                dot += ((int)texels[i * 4 + c] - color1[c]) * axis[c];
+            }
+            steps[i] = (int16_t)std::clamp((int)((float)dot * scale + 0.5f), 0, 3);
+        }
+#endif
+        uint32_t indices = 0;
+        for (size_t i = 0; i < NR_OF_TEXELS; i++)
+        {
+            indices |= INDEX_OF_STEP[steps[i]] << (2 * i);
+        }
+        return indices;
+    }
+
+    ColorBlock FitIndices(const uint8_t* texels, uint16_t color0, uint16_t color1)
+    {
+        if (color0 < color1) std::swap(color0, color1); // color0 > color1 selects the 4 colors palette. When equal every index is 0 anyway.
+        ColorBlock fit;
+        fit.color0 = color0;
+        fit.color1 = color1;
+        int palette[4][3];
+        From565(color0, palette[0]);
+        From565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        if (color0 != color1) fit.indices = ProjectIndices(texels, palette[0], palette[1]);
+        for (size_t i = 0; i < NR_OF_TEXELS; i++)
+        {
+            const int* color = palette[(fit.indices >> (2 * i)) & 3];
+            for (int c = 0; c < 3; c++)
+            {
+                const int difference = (int)texels[i * 4 + c] - color[c];
+                fit.error += difference * difference;
+            }
+        }
+        return fit;
+    }
+
+    // Least squares endpoints for the indices of fit, they often lower the error of the bounding box ones.
+    ColorBlock RefineEndpoints(const uint8_t* texels, const ColorBlock& fit)
+    {
+        constexpr int WEIGHT_OF_INDEX[4] = { 3, 0, 2, 1 }; // Thirds of color0.
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[3] = {}, bx[3] = {};
+        for (size_t i = 0; i < NR_OF_TEXELS; i++)
+        {
+            const float a = (float)WEIGHT_OF_INDEX[(fit.indices >> (2 * i)) & 3], b = 3.0f - a;
+            aa += a * a;
+            bb += b * b;
+            ab += a * b;
+            for (int c = 0; c < 3; c++)
+            {
+                ax[c] += a * texels[i * 4 + c];
+                bx[c] += b * texels[i * 4 + c];
+            }
+        }
+        const float determinant = aa * bb - ab * ab;
+        if (determinant == 0.0f) return fit; // Every texel on the same index.
+
+        int color0[3], color1[3];
+        for (int c = 0; c < 3; c++)
+        {
+            color0[c] = std::clamp((int)(3.0f * (bb * ax[c] - ab * bx[c]) / determinant + 0.5f), 0, 255);
+            color1[c] = std::clamp((int)(3.0f * (aa * bx[c] - ab * ax[c]) / determinant + 0.5f), 0, 255);
+        }
+        const ColorBlock refined = FitIndices(texels, To565(color0), To565(color1));
+        return refined.error < fit.error ? refined : fit;
+    }
+
+    void EncodeColorBlock(const uint8_t* texels, uint8_t* block)
+    {
+        int minColor[3], maxColor[3];
+        FindBounds(texels, minColor, maxColor);
+
+        // The box diagonal from min to max follows colors growing together, flip the channels that shrink when green grows.
+        int center[3], covariance[3] = {};
+        for (int c = 0; c < 3; c++)
+        {
+            center[c] = (minColor[c] + maxColor[c]) / 2;
+        }
+        for (size_t i = 0; i < NR_OF_TEXELS; i++)
+        {
+            const int green = (int)texels[i * 4 + 1] - center[1];
+            covariance[0] += ((int)texels[i * 4] - center[0]) * green;
+            covariance[2] += ((int)texels[i * 4 + 2] - center[2]) * green;
+        }
+        for (int c = 0; c < 3; c += 2)
+        {
+            if (covariance[c] < 0) std::swap(minColor[c], maxColor[c]);
+        }
+        // Pulled in by a sixteenth, the extremes are rarely worth a palette entry for themselves.
+        for (int c = 0; c < 3; c++)
+        {
+            const int inset = (maxColor[c] - minColor[c]) / 16;
+            minColor[c] += inset;
+            maxColor[c] -= inset;
+        }
+
+        const ColorBlock fit = RefineEndpoints(texels, FitIndices(texels, To565(maxColor), To565(minColor)));
+        block[0] = (uint8_t)(fit.color0 & 0xFF);
+        block[1] = (uint8_t)(fit.color0 >> 8);
+        block[2] = (uint8_t)(fit.color1 & 0xFF);
+        block[3] = (uint8_t)(fit.color1 >> 8);
+        std::memcpy(block + 4, &fit.indices, sizeof(uint32_t)); // Little endian, as every target of this engine.
+    }
+
+    void EncodeChannelBlock(const uint8_t* texels, const size_t channel, uint8_t* block)
+    {
+        alignas(16) uint8_t values[NR_OF_TEXELS];
+        int minimum = 255, maximum = 0;
+        for (size_t i = 0; i < NR_OF_TEXELS; i++)
+        {
+            values[i] = texels[i * 4 + channel];
+            minimum = std::min<int>(minimum, values[i]);
+            maximum = std::max<int>(maximum, values[i]);
+        }
+        // value0 > value1 selects the 8 values palette: value0, value1, then 6 steps from value0 to value1.
+        block[0] = (uint8_t)maximum;
+        block[1] = (uint8_t)minimum;
+        std::memset(block + 2, 0, 6);
+        if (maximum == minimum) return;
+
+        // Steps from minimum, 0 to 7, counted as the thresholds halfway between palette values each value reaches.
+        const int range = maximum - minimum;
+        uint8_t indices[NR_OF_TEXELS];
+#if GL_SIMD_SSE2
+        const __m128i zero = _mm_setzero_si128(), fourteen = _mm_set1_epi16(14);
+        const __m128i loaded = _mm_load_si128((const __m128i*)values);
+        const __m128i low = _mm_mullo_epi16(_mm_unpacklo_epi8(loaded, zero), fourteen), high = _mm_mullo_epi16(_mm_unpackhi_epi8(loaded, zero), fourteen);
+        __m128i lowSteps = zero, highSteps = zero;
+        for (int step = 1; step < 8; step++)
+        {
+            const __m128i threshold = _mm_set1_epi16((short)(minimum * 14 + (2 * step - 1) * range - 1)); // Fits 16 bits: at most 255 * 14 + 13 * 255.
+            lowSteps = _mm_sub_epi16(lowSteps, _mm_cmpgt_epi16(low, threshold));
+            highSteps = _mm_sub_epi16(highSteps, _mm_cmpgt_epi16(high, threshold));
+        }
+        // Step s is index 8 - s, but steps 7 and 0 are value0 and value1: index 0 and 1.
+        const __m128i eight = _mm_set1_epi16(8), seven = _mm_set1_epi16(7), two = _mm_set1_epi16(2), one = _mm_set1_epi16(1);
+        __m128i lowIndices = _mm_and_si128(_mm_sub_epi16(eight, lowSteps), seven), highIndices = _mm_and_si128(_mm_sub_epi16(eight, highSteps), seven);
+        lowIndices = _mm_xor_si128(lowIndices, _mm_and_si128(_mm_cmplt_epi16(lowIndices, two), one));
+        highIndices = _mm_xor_si128(highIndices, _mm_and_si128(_mm_cmplt_epi16(highIndices, two), one));
+        _mm_storeu_si128((__m128i*)indices, _mm_packus_epi16(lowIndices, highIndices));
+#else
+        for (size_t i = 0; i < NR_OF_TEXELS; i++)
+        {
+            int steps = 0;
+            for (int step = 1; step < 8; step++)
+            {
+                steps += values[i] * 14 >= minimum * 14 + (2 * step - 1) * range ? 1 : 0;
+            }
+            const int index = (8 - steps) & 7;
+            indices[i] = (uint8_t)(index < 2 ? index ^ 1 : index);
+        }
+#endif
+        uint64_t packed = 0;
+        for (size_t i = 0; i < NR_OF_TEXELS; i++)
+        {
+            packed |= (uint64_t)indices[i] << (3 * i);
+        }
+        for (size_t i = 0; i < 6; i++)
+        {
+            block[2 + i] = (uint8_t)(packed >> (8 * i));
+        }
+    }
+}//!anonymous
+
+size_t gl::TextureCompressor::GetBlockSize(Format format)
+{
+    return format == Format::BC1 || format == Format::BC4 ? 8 : 16;
+}
+
+size_t gl::TextureCompressor::GetCompressedSize(Format format, size_t width, size_t height)
+{
+    return ((width + BLOCK_EXTENT - 1) / BLOCK_EXTENT) * ((height + BLOCK_EXTENT - 1) / BLOCK_EXTENT) * GetBlockSize(format);
+}
+
+gl::TextureCompressor::Format gl::TextureCompressor::ChooseFormat(const uint8_t* rgba, size_t nrOfTexels)
+{
+    for (size_t i = 0; i < nrOfTexels; i++)
+    {
+        if (rgba[i * 4 + 3] != 255) return Format::BC3;
+    }
+    return Format::BC1;
+}
+
+void gl::TextureCompressor::EncodeBlock(const uint8_t* texels, Format format, uint8_t* block)
+{
+    switch (format)
+    {
+        case Format::BC1:
+            EncodeColorBlock(texels, block);
+            break;
+        case Format::BC3:
+            EncodeChannelBlock(texels, 3, block);
+            EncodeColorBlock(texels, block + 8);
+            break;
+        case Format::BC4:
+            EncodeChannelBlock(texels, 0, block);
+            break;
+        case Format::BC5:
+            EncodeChannelBlock(texels, 0, block);
+            EncodeChannelBlock(texels, 1, block + 8);
+            break;
+    }
+}
+
+void gl::TextureCompressor::Compress(const uint8_t* rgba, size_t width, size_t height, Format format, uint8_t* blocks)
+{
+    const size_t blocksX = (width + BLOCK_EXTENT - 1) / BLOCK_EXTENT, blocksY = (height + BLOCK_EXTENT - 1) / BLOCK_EXTENT;
+    const size_t blockSize = GetBlockSize(format);
+    ParallelFor(blocksY, blocksX, BLOCKS_PER_THREAD, [&](const size_t blockY)
+    {
+        alignas(16) uint8_t texels[NR_OF_TEXELS * 4];
+        for (size_t blockX = 0; blockX < blocksX; blockX++)
+        {
+            const size_t x = blockX * BLOCK_EXTENT;
+            for (size_t row = 0; row < BLOCK_EXTENT; row++)
+            {
+                const uint8_t* line = rgba + std::min(blockY * BLOCK_EXTENT + row, height - 1) * width * 4;
+                if (x + BLOCK_EXTENT <= width)
+                {
+                    std::memcpy(texels + row * BLOCK_EXTENT * 4, line + x * 4, BLOCK_EXTENT * 4);
+                    continue;
+                }
+                for (size_t column = 0; column < BLOCK_EXTENT; column++)
+                {
+                    std::memcpy(texels + (row * BLOCK_EXTENT + column) * 4, line + std::min(x + column, width - 1) * 4, 4);
+                }
+            }
+            EncodeBlock(texels, format, blocks + (blockY * blocksX + blockX) * blockSize);
+        }
+    });
+}
@@ -0,0 +1,186 @@
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <queue>
+
+#include <glad/glad.h>
+
+#include "defines.h"
+#include "resource_manager.h"
+#include "utility.h"
+
+void gl::TextureStreamer::Register(unsigned int TEX, size_t width, size_t height, std::vector<size_t> levelBytes, size_t residentLevel,
+    std::function<void(size_t first, size_t end, uint64_t load)> streamIn, std::function<void(size_t level)> release)
+{
+    assert(TEX != 0 && residentLevel < levelBytes.size() && streamIn != nullptr && release != nullptr);
+    Streamed& streamed = streamed_[TEX];
+    streamed = {};
+    streamed.width = width;
+    streamed.height = height;
+    streamed.levelBytes = std::move(levelBytes);
+    streamed.tailLevel = residentLevel;
+    streamed.wantedLevel = residentLevel;
+    streamed.grantedLevel = residentLevel;
+    streamed.wantedFrame = frame_;
+    streamed.streamIn = std::move(streamIn);
+    streamed.release = std::move(release);
+    SetResidentLevel(TEX, streamed, residentLevel);
+}
+
+void gl::TextureStreamer::Unregister(unsigned int TEX)
+{
+    streamed_.erase(TEX);
+}
+
+size_t gl::TextureStreamer::GetResidentLevel(unsigned int TEX) const
+{
+    const auto match = streamed_.find(TEX);
+    return match != streamed_.end() ? match->second.residentLevel : 0;
+}
+
+bool gl::TextureStreamer::IsLoading(unsigned int TEX, uint64_t load) const
+{
+    const auto match = streamed_.find(TEX);
+    return match != streamed_.end() && match->second.load == load;
+}
+
+void gl::TextureStreamer::OnStreamedIn(unsigned int TEX, uint64_t load, size_t level)
+{
+    const auto match = streamed_.find(TEX);
+    if (match == streamed_.end() || match->second.load != load) return;
+    Streamed& streamed = match->second;
+    streamed.load = 0;
+    if (level >= streamed.residentLevel) return;
+    stats_.levelsStreamedIn += streamed.residentLevel - level;
+    SetResidentLevel(TEX, streamed, level);
+}
+
+void gl::TextureStreamer::Request(unsigned int TEX, float screenSize)
+{
+    const auto match = streamed_.find(TEX);
+    if (match == streamed_.end()) return;
+    Streamed& streamed = match->second;
+
+    // The finest level with at least as many texels as the pixels it covers.
+    const float texels = (float)std::max(streamed.width, streamed.height);
+    const size_t level = screenSize > 0.0f ? std::min((size_t)std::max(0.0f, std::floor(std::log2(texels / screenSize))), streamed.tailLevel) : streamed.tailLevel;
+    if (streamed.requestFrame != frame_)
+    {
+        streamed.requestFrame = frame_;
+        streamed.requestedLevel = level;
+    }
+    else
+    {
+        streamed.requestedLevel = std::min(streamed.requestedLevel, level);
+    }
+}
+
+void gl::TextureStreamer::Update(size_t budgetBytes)
+{
+    // Finer requests apply right away, coarser ones once the finer level went unasked for STREAMING_RELEASE_FRAMES.
+    std::vector<Streamed*> upgradable;
+    size_t grantedBytes = 0, wantedBytes = 0;
+    for (auto& [TEX, streamed] : streamed_)
+    {
+        const size_t requested = streamed.requestFrame == frame_ ? streamed.requestedLevel : streamed.tailLevel;
+        if (requested <= streamed.wantedLevel || frame_ - streamed.wantedFrame > STREAMING_RELEASE_FRAMES)
+        {
+            streamed.wantedLevel = requested;
+            streamed.wantedFrame = frame_;
+        }
+        streamed.grantedLevel = streamed.tailLevel;
+        grantedBytes += GetBytesFrom(streamed, streamed.tailLevel);
+        wantedBytes += GetBytesFrom(streamed, streamed.wantedLevel);
+        if (streamed.wantedLevel < streamed.tailLevel) upgradable.push_back(&streamed);
+    }
+
+    // Coarsest, so cheapest, next level first. A level that doesn't fit doesn't stop cheaper ones of other textures.
+    const auto later = [](const Streamed* a, const Streamed* b) { return a->levelBytes[a->grantedLevel - 1] > b->levelBytes[b->grantedLevel - 1]; };
+    std::priority_queue<Streamed*, std::vector<Streamed*>, decltype(later)> queue(later, std::move(upgradable));
+    while (!queue.empty())
+    {
+        Streamed& streamed = *queue.top();
+        queue.pop();
+        const size_t bytes = streamed.levelBytes[streamed.grantedLevel - 1];
+        if (grantedBytes + bytes > budgetBytes) continue;
+        grantedBytes += bytes;
+        streamed.grantedLevel--;
+        if (streamed.grantedLevel > streamed.wantedLevel) queue.push(&streamed);
+    }
+
+    size_t loadsStarted = 0;
+    for (auto& [TEX, streamed] : streamed_)
+    {
+        if (streamed.load != 0) continue; // Decided again once its levels landed.
+        if (streamed.grantedLevel > streamed.residentLevel)
+        {
+            SetResidentLevel(TEX, streamed, streamed.grantedLevel);
+        }
+        else if (streamed.grantedLevel < streamed.residentLevel && loadsStarted < STREAMING_LOADS_PER_FRAME)
+        {
+            loadsStarted++;
+            streamed.load = nextLoad_++;
+            streamed.streamIn(streamed.grantedLevel, streamed.residentLevel, streamed.load);
+        }
+    }
+
+    stats_.textures = streamed_.size();
+    stats_.residentBytes = 0;
+    stats_.loadsInFlight = 0;
+    for (const auto& [TEX, streamed] : streamed_)
+    {
+        stats_.residentBytes += GetBytesFrom(streamed, streamed.residentLevel);
+        stats_.loadsInFlight += streamed.load != 0 ? 1 : 0;
+    }
+    stats_.wantedBytes = wantedBytes;
+    stats_.grantedBytes = grantedBytes;
+    frame_++;
+}
+
+void gl::TextureStreamer::Shutdown()
+{
+    streamed_.clear();
+    stats_ = {};
+}
+
+gl::TextureStreamer::Stats gl::TextureStreamer::GetStats() const
+{
+    return stats_;
+}
+
+size_t gl::TextureStreamer::GetBytesFrom(const Streamed& streamed, size_t level) const
+{
+    size_t bytes = 0;
+    for (size_t i = level; i < streamed.levelBytes.size(); i++)
+    {
+        bytes += streamed.levelBytes[i];
+    }
+    return bytes;
+}
+
+void gl::TextureStreamer::SetResidentLevel(unsigned int TEX, Streamed& streamed, size_t level)
+{
+    // Sampling is clamped to the resident levels before finer ones are released.
+    if (HasDirectStateAccess())
+    {
+        glTextureParameteri(TEX, GL_TEXTURE_BASE_LEVEL, (GLint)level);
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, TEX);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)level);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    CheckGlError();
+
+    const size_t previous = streamed.residentLevel;
+    streamed.residentLevel = level;
+    if (level > previous)
+    {
+        streamed.release(level);
+        stats_.levelsReleased += level - previous;
+    }
+    ResourceManager::Get().TrackMemory(ResourceManager::Resource::TEXTURE, TEX, GetBytesFrom(streamed, level));
+}
@@ -0,0 +1,102 @@
+#include "uniform_buffers.h"
+
+#include <glad/glad.h>
+
+static_assert(sizeof(gl::UniformBuffers::FrameData) == 4 * 64 + 2 * 16 + 16, "FrameData must match the std140 layout of the block in GetShaderDeclarations().");
+static_assert(sizeof(gl::UniformBuffers::PassData) == 64 + 16, "PassData must match the std140 layout of the block in GetShaderDeclarations().");
+
+void gl::UniformBuffers::Create()
+{
+    EngineGlScope("UniformBuffers::Create");
+    if (frameUBO_ != 0)
+    {
+        EngineError("Calling Create() a second time...");
+    }
+
+    const FrameData frameData = {};
+    const PassData passData = {};
+    if (HasDirectStateAccess())
+    {
+        glCreateBuffers(1, &frameUBO_);
+        glNamedBufferStorage(frameUBO_, sizeof(FrameData), &frameData, GL_DYNAMIC_STORAGE_BIT);
+        glCreateBuffers(1, &passUBO_);
+        glNamedBufferStorage(passUBO_, sizeof(PassData), &passData, GL_DYNAMIC_STORAGE_BIT);
+    }
+    else
+    {
+        glGenBuffers(1, &frameUBO_);
+        glBindBuffer(GL_UNIFORM_BUFFER, frameUBO_);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), &frameData, GL_DYNAMIC_DRAW);
+        glGenBuffers(1, &passUBO_);
+        glBindBuffer(GL_UNIFORM_BUFFER, passUBO_);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(PassData), &passData, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    CheckGlError();
+
+    // Binding points are never rebound, the blocks of GetShaderDeclarations() read from them in every program.
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, frameUBO_);
+    glBindBufferBase(GL_UNIFORM_BUFFER, PASS_DATA_BINDING, passUBO_);
+    CheckGlError();
+}
+
+void gl::UniformBuffers::Destroy()
+{
+    if (frameUBO_ == 0) return;
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, PASS_DATA_BINDING, 0);
+    glDeleteBuffers(1, &frameUBO_);
+    glDeleteBuffers(1, &passUBO_);
+    frameUBO_ = 0;
+    passUBO_ = 0;
+}
+
+void gl::UniformBuffers::UploadFrameData(const FrameData& data)
+{
+    assert(frameUBO_ != 0);
+    Upload(frameUBO_, &data, sizeof(FrameData));
+}
+
+void gl::UniformBuffers::UploadPassData(const PassData& data)
+{
+    assert(passUBO_ != 0);
+    Upload(passUBO_, &data, sizeof(PassData));
+}
+
+void gl::UniformBuffers::Upload(const unsigned int UBO, const void* data, const size_t size)
+{
+    if (HasDirectStateAccess())
+    {
+        glNamedBufferSubData(UBO, 0, (GLsizeiptr)size, data);
+    }
+    else
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr)size, data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    CheckGlError();
+}
+
+const std::string& gl::UniformBuffers::GetShaderDeclarations()
+{
+    static const std::string declarations =
+        "layout (std140, binding = " + std::to_string(FRAME_DATA_BINDING) + ") uniform FrameData\n"
+        "{\n"
+        "    mat4 cameraMatrix; // projection * view.\n"
+        "    mat4 viewMatrix;\n"
+        "    mat4 projectionMatrix;\n"
+        "    mat4 lightMatrix;\n"
+        "    vec4 viewPos; // w unused.\n"
+        "    vec4 lightDir; // w unused.\n"
+        "    float time;\n"
+        "    float deltaTime;\n"
+        "};\n"
+        "layout (std140, binding = " + std::to_string(PASS_DATA_BINDING) + ") uniform PassData\n"
+        "{\n"
+        "    mat4 passMatrix; // projection * view of the current pass.\n"
+        "    vec4 resolution; // xy: render target size, zw: texel size.\n"
+        "};\n";
+    return declarations;
+}
@@ -0,0 +1,260 @@
+#include "upload_stream.h"
+
+#include <cassert>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "defines.h"
+
+namespace
+{
+    // Offsets into the ring suit any texel or compressed block size.
+    constexpr const size_t STAGING_ALIGNMENT = 16;
+}//!anonymous
+
+void gl::UploadStream::Stage(size_t size, std::function<void(char* destination)> write, std::function<void(const void* pixels)> upload)
+{
+    assert(size > 0 && write != nullptr && upload != nullptr);
+    auto staging = std::make_unique<Staging>();
+    staging->size = size;
+    staging->write = std::move(write);
+    staging->upload = std::move(upload);
+
+    Staging* toWrite = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.empty() && mapping_ != nullptr && Allocate(*staging))
+        {
+            toWrite = staging.get();
+            staged_.push_back(std::move(staging));
+        }
+        else
+        {
+            pending_.push_back(std::move(staging)); // Staged in order, nothing overtakes data already waiting.
+        }
+    }
+    if (toWrite == nullptr) return;
+
+    // Outside the lock, other threads stage while this one copies. Update() doesn't issue it until it's written.
+    toWrite->write(mapping_ + toWrite->offset);
+    toWrite->write = nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    toWrite->written = true;
+}
+
+bool gl::UploadStream::Allocate(Staging& staging)
+{
+    const size_t size = (staging.size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+    if (size > ringBytes_) return false;
+    size_t offset = head_;
+    size_t padding = 0;
+    if (offset + size > ringBytes_)
+    {
+        padding = ringBytes_ - offset; // Staged data is contiguous, the end of the ring is skipped.
+        offset = 0;
+    }
+    if (allocated_ - released_ + padding + size > ringBytes_) return false;
+
+    allocated_ += padding + size;
+    head_ = offset + size;
+    staging.offset = offset;
+    staging.end = allocated_;
+    return true;
+}
+
+void gl::UploadStream::CreateRing()
+{
+    EngineGlScope("UploadStream::CreateRing");
+    unsigned int PBO = 0;
+    char* mapping = nullptr;
+    if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage)
+    {
+        // Written by any thread while the gpu reads other parts of it. Coherent, so nothing needs flushing.
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        if (HasDirectStateAccess())
+        {
+            glCreateBuffers(1, &PBO);
+            glNamedBufferStorage(PBO, (GLsizeiptr)UPLOAD_RING_BYTES, nullptr, flags);
+            mapping = static_cast<char*>(glMapNamedBufferRange(PBO, 0, (GLsizeiptr)UPLOAD_RING_BYTES, flags));
+        }
+        else
+        {
+            glGenBuffers(1, &PBO);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)UPLOAD_RING_BYTES, nullptr, flags);
+            mapping = static_cast<char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)UPLOAD_RING_BYTES, flags));
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        CheckGlError();
+        if (mapping == nullptr)
+        {
+            EngineWarning("Could not map the upload ring, textures are streamed from client memory.");
+            glDeleteBuffers(1, &PBO);
+            PBO = 0;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ringCreated_ = true;
+    PBO_ = PBO;
+    mapping_ = mapping;
+    ringBytes_ = mapping != nullptr ? UPLOAD_RING_BYTES : 0;
+    stats_.ringBytes = ringBytes_;
+}
+
+void gl::UploadStream::Update(size_t budgetBytes)
+{
+    EngineGlScope("UploadStream::Update");
+    if (!ringCreated_)
+    {
+        CreateRing();
+    }
+
+    // Ring memory read by uploads the gpu finished is free again.
+    while (!fences_.empty())
+    {
+        const GLsync sync = static_cast<GLsync>(fences_.front().sync);
+        const GLenum status = glClientWaitSync(sync, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(sync);
+        std::lock_guard<std::mutex> lock(mutex_);
+        released_ = fences_.front().end;
+        fences_.pop_front();
+    }
+
+    // Data that waited for room is written here, on the gl thread.
+    std::vector<Staging*> toWrite;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (!pending_.empty())
+        {
+            Staging& staging = *pending_.front();
+            if (mapping_ == nullptr || staging.size > ringBytes_)
+            {
+                staging.direct = true; // Written when uploaded.
+            }
+            else if (Allocate(staging))
+            {
+                toWrite.push_back(&staging);
+            }
+            else
+            {
+                stats_.ringFullFrames++;
+                break;
+            }
+            staged_.push_back(std::move(pending_.front()));
+            pending_.pop_front();
+        }
+    }
+    for (Staging* staging : toWrite)
+    {
+        staging->write(mapping_ + staging->offset);
+        staging->write = nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Staging* staging : toWrite)
+        {
+            staging->written = true;
+        }
+    }
+
+    // In staging order, until the budget is spent or the next data is still being written.
+    size_t bytes = 0;
+    uint64_t fencedEnd = 0;
+    bool ringBound = false;
+    while (bytes == 0 || bytes < budgetBytes)
+    {
+        Staging* staging = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (staged_.empty() || !(staged_.front()->written || staged_.front()->direct)) break;
+            staging = staged_.front().get();
+        }
+
+        if (staging->direct)
+        {
+            if (ringBound)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                ringBound = false;
+            }
+            std::vector<char> data(staging->size);
+            staging->write(data.data());
+            staging->upload(data.data());
+            stats_.directUploads++;
+        }
+        else
+        {
+            if (!ringBound)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO_);
+                ringBound = true;
+            }
+            staging->upload(reinterpret_cast<const void*>(staging->offset));
+            fencedEnd = staging->end;
+        }
+        CheckGlError();
+        bytes += staging->size;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.uploads++;
+        staged_.pop_front();
+    }
+    if (ringBound)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    if (fencedEnd != 0)
+    {
+        fences_.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), fencedEnd });
+        CheckGlError();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.lastFrameBytes = bytes;
+}
+
+void gl::UploadStream::Shutdown()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.clear();
+    staged_.clear();
+    for (const auto& fence : fences_)
+    {
+        glDeleteSync(static_cast<GLsync>(fence.sync));
+    }
+    fences_.clear();
+    if (PBO_ != 0)
+    {
+        if (HasDirectStateAccess())
+        {
+            glUnmapNamedBuffer(PBO_);
+        }
+        else
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO_);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &PBO_);
+        CheckGlError();
+    }
+    PBO_ = 0;
+    mapping_ = nullptr;
+    ringBytes_ = 0;
+    ringCreated_ = false;
+    head_ = 0;
+    allocated_ = released_ = 0;
+    stats_ = {};
+}
+
+gl::UploadStream::Stats gl::UploadStream::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.ringBytesInUse = (size_t)(allocated_ - released_);
+    stats.pending = pending_.size();
+    stats.staged = staged_.size();
+    return stats;
+}
@@ -1,10 +1,91 @@
 #include "utility.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <vector>
 #include <glad/glad.h>
 
+namespace
+{
+    struct Scope
+    {
+        const char* name = "";
+        const char* file = "";
+        int line = 0;
+        bool allowErrors = false;
+    };
+    thread_local std::vector<Scope> scopes;
+    thread_local const char* lastCheckpointFile = nullptr;
+    thread_local int lastCheckpointLine = 0;
+    thread_local size_t parallelScopes = 0; // The thread is one of a pool already, see ParallelScope.
+    bool debugOutputEnabled = false;
+
+    void APIENTRY DebugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
+    {
+        (void)source; (void)id; (void)length; (void)userParam;
+        const bool isError = type == GL_DEBUG_TYPE_ERROR;
+        const bool abortOnError = isError && (scopes.empty() || !scopes.back().allowErrors);
+        std::ostream& stream = abortOnError ? std::cerr : std::cout;
+        stream << (isError ? "GL ERROR" : severity == GL_DEBUG_SEVERITY_HIGH ? "GL WARNING" : "GL MESSAGE") << ": " << message << "\n";
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); scope++)
+        {
+            stream << "    in " << scope->name << " (file: " << scope->file << ", line: " << scope->line << ")\n";
+        }
+        if (lastCheckpointFile != nullptr)
+        {
+            stream << "    after the check at file: " << lastCheckpointFile << ", line: " << lastCheckpointLine << "\n";
+        }
+        stream.flush();
+        if (abortOnError)
+        {
+            abort();
+        }
+    }
+}//!anonymous
+
+bool gl::EnableDebugOutput()
+{
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT)) return false;
+
+    glEnable(GL_DEBUG_OUTPUT);
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS); // Report from within the faulty call, on the thread that issued it, so that the scope stack is the right one.
+    glDebugMessageCallback(DebugMessageCallback, nullptr);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+    debugOutputEnabled = glGetError() == GL_NO_ERROR;
+    return debugOutputEnabled;
+}
+
+gl::DebugScope::DebugScope(const char* name, const char* file, int line, bool allowErrors)
+{
+    scopes.push_back({ name, file, line, allowErrors });
+    if (debugOutputEnabled)
+    {
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+    }
+}
+
+gl::DebugScope::~DebugScope()
+{
+    if (debugOutputEnabled)
+    {
+        glPopDebugGroup();
+    }
+    scopes.pop_back();
+}
+
 void gl::CheckGlError(const char* file, int line)
 {
+    if (debugOutputEnabled) // The driver reports errors through DebugMessageCallback as they happen.
+    {
+        lastCheckpointFile = file;
+        lastCheckpointLine = line;
+        return;
+    }
+
     auto error_code = glGetError();
     if (error_code != GL_NO_ERROR)
     {
@@ -99,34 +180,91 @@ glm::vec2 gl::ScreenToNdc(const glm::vec2 pos, const float SCREEN_RESOLUTION[2])
     return glm::vec2(RemapToRange(0.0f, SCREEN_RESOLUTION[0], -1.0f, 1.0f, pos.x), RemapToRange(0.0f, SCREEN_RESOLUTION[1], 1.0f, -1.0f, pos.y));
 }
 
+namespace
+{
+    void PrintFramebufferStatus(const char* file, int line, const GLenum status)
+    {
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::string log;
+            switch (status)
+            {
+                case GL_FRAMEBUFFER_UNDEFINED:
+                    log = "Framebuffer is undefined!";
+                    break;
+                case GL_FRAMEBUFFER_UNSUPPORTED:
+                    log = "Framebuffer is unsupported!";
+                    break;
+                case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:
+                    log = "Framebuffer has incomplete attachment!";
+                    break;
+                case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT:
+                    log = "Framebuffer has incomplete missing attachment!";
+                    break;
+                default:
+                    return;
+            }
+            std::cerr << "ERROR at file: " << file << ", line: " << line << ": " << log << std::endl;
+            abort();
+        }
+    }
+}
+
 void gl::CheckFramebufferStatus(const char* file, int line)
 {
-    const auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    if (status != GL_FRAMEBUFFER_COMPLETE)
+    PrintFramebufferStatus(file, line, glCheckFramebufferStatus(GL_FRAMEBUFFER));
+}
+
+void gl::CheckNamedFramebufferStatus(const char* file, int line, unsigned int FBO)
+{
+    PrintFramebufferStatus(file, line, glCheckNamedFramebufferStatus(FBO, GL_FRAMEBUFFER));
+}
+
+bool gl::HasDirectStateAccess()
+{
+#if GL_FORCE_BIND_TO_EDIT
+    return false;
+#else
+    return GLAD_GL_VERSION_4_5 || GLAD_GL_ARB_direct_state_access;
+#endif // GL_FORCE_BIND_TO_EDIT
+}
+
+void gl::ParallelFor(size_t count, size_t workPerItem, size_t minWorkPerThread, const std::function<void(size_t)>& function)
+{
+    std::atomic<size_t> next = 0;
+    const auto work = [&]()
     {
-        std::string log;
-        switch (status)
+        const ParallelScope scope; // Nested ParallelFor() calls stay on this thread.
+        for (size_t i = next++; i < count; i = next++)
         {
-            case GL_FRAMEBUFFER_UNDEFINED:
-                log = "Framebuffer is undefined!";
-                break;
-            case GL_FRAMEBUFFER_UNSUPPORTED:
-                log = "Framebuffer is unsupported!";
-                break;
-            case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:
-                log = "Framebuffer has incomplete attachment!";
-                break;
-            case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT:
-                log = "Framebuffer has incomplete missing attachment!";
-                break;
-            default:
-                return;
+            function(i);
         }
-        std::cerr << "ERROR at file: " << file << ", line: " << line << ": " << log << std::endl;
-        abort();
+    };
+
+    // hardware_concurrency() is 0 when unknown. The calling thread works too.
+    const size_t nrOfThreads = parallelScopes > 0 ? 1 : std::min<size_t>({ std::max(1u, std::thread::hardware_concurrency()), count, (count * workPerItem + minWorkPerThread - 1) / std::max<size_t>(1, minWorkPerThread) });
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nrOfThreads; i++)
+    {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& thread : threads)
+    {
+        thread.join();
     }
 }
 
+gl::ParallelScope::ParallelScope()
+{
+    parallelScopes++;
+}
+
+gl::ParallelScope::~ParallelScope()
+{
+    parallelScopes--;
+}
+
 float gl::RemapToRange(const float inputRangeLower, const float inputRangeUpper, const float outputRangeLower, const float outputRangeUpper, const float value)
 {
     return outputRangeLower + (value - inputRangeLower) * (outputRangeUpper - outputRangeLower) / (inputRangeUpper - inputRangeLower);
@@ -1,70 +1,282 @@
 #include "vertex_buffer.h"
 
+#include <algorithm>
 #include <string>
 #include <numeric>
+#include <unordered_map>
 
 #include <glad/glad.h>
-#ifndef XXH_INLINE_ALL
-#define XXH_INLINE_ALL
-#endif // !XXH_INLINE_ALL
-#include "xxhash.h"
 
+#include "hasher.h"
 #include "resource_manager.h"
+#include "file_watcher.h"
 #include "defines.h"
 
+namespace
+{
+    std::unordered_map<unsigned int, std::shared_ptr<int>> verticesCounts; // By VAO.
+    struct IndexBuffer
+    {
+        unsigned int EBO = 0;
+        unsigned int type = 0; // Gl type of its indices.
+    };
+    std::unordered_map<unsigned int, IndexBuffer> indexBuffers; // Element buffer of indexed VAOs.
+
+    size_t GetIndexSize(const gl::VertexBuffer::IndexType type)
+    {
+        switch (type)
+        {
+            case gl::VertexBuffer::IndexType::UNSIGNED_BYTE: return 1;
+            case gl::VertexBuffer::IndexType::UNSIGNED_SHORT: return 2;
+            default: return 4;
+        }
+    }
+
+    // Vertex buffers built from a file, see VertexBuffer::Definition::reload.
+    struct ReloadableBuffer
+    {
+        unsigned int VAO = 0, VBO = 0;
+        std::vector<unsigned int> dataLayout = {};
+        std::function<std::vector<float>()> reload = nullptr;
+    };
+    std::unordered_map<std::string, std::vector<ReloadableBuffer>> buffersByFile;
+
+    void ReloadBufferFile(const std::string& path)
+    {
+        EngineGlScope("VertexBuffer::Reload");
+        for (const auto& buffer : buffersByFile[path])
+        {
+            const std::vector<float> data = buffer.reload();
+            const size_t stride = std::accumulate(buffer.dataLayout.begin(), buffer.dataLayout.end(), 0);
+            if (data.empty() || data.size() % stride != 0)
+            {
+                EngineWarning(("Reloading " + path + " didn't give whole vertices, keeping the previous vertex buffer.").c_str());
+                continue;
+            }
+
+            // Same names, the VAO keeps pointing at the reallocated buffer.
+            if (gl::HasDirectStateAccess())
+            {
+                glNamedBufferData(buffer.VBO, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
+            }
+            else
+            {
+                glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+                glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+            CheckGlError();
+            *verticesCounts.at(buffer.VAO) = (int)(data.size() / stride);
+            gl::ResourceManager::Get().TrackMemory(gl::ResourceManager::Resource::VERTEX_BUFFER, buffer.VAO, data.size() * sizeof(float));
+
+            // Identical data created later has to share the reloaded buffer, not the content it had at startup.
+            gl::Hasher hasher(gl::HASHING_SEED);
+            hasher.Add(data);
+            hasher.Add(buffer.dataLayout);
+            const uint64_t hash = hasher.Digest64();
+            gl::ResourceManager::Get().RekeyVAO(buffer.VAO, hash);
+            gl::ResourceManager::Get().RekeyVBO(buffer.VBO, hash);
+        }
+    }
+
+    // Eviction callback of the ResourceManager, the VAO and its VBO are deleted right after.
+    void ForgetBuffer(const unsigned int VAO)
+    {
+        verticesCounts.erase(VAO);
+        const auto indexBuffer = indexBuffers.find(VAO);
+        if (indexBuffer != indexBuffers.end())
+        {
+            gl::ResourceManager::Get().DeleteVBO(indexBuffer->second.EBO);
+            indexBuffers.erase(indexBuffer);
+        }
+        for (auto& pair : buffersByFile)
+        {
+            auto& buffers = pair.second;
+            buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [VAO](const ReloadableBuffer& buffer) { return buffer.VAO == VAO; }), buffers.end());
+        }
+    }
+    bool forgetsEvictedBuffers = false;
+}//!anonymous
+
 void gl::VertexBuffer::Create(Definition def)
 {
+    EngineGlScope("VertexBuffer::Create");
     if (VAO_ != 0)
     {
         EngineError("Calling Create() a second time...");
     }
 
-    assert(def.data.size() > 0 && def.dataLayout.size() > 0);
+    const bool packed = !def.packedData.empty();
+    assert(packed ?
+        !def.packedLayout.empty() && def.packedStride > 0 && (def.packedVerticesCount > 0 || def.packedData.size() % def.packedStride == 0) && def.reload == nullptr :
+        def.data.size() > 0 && def.dataLayout.size() > 0);
+
+    // Float vertices are described as packed ones, both are set up the same way.
+    std::span<const char> vertices = def.packedData;
+    std::vector<PackedAttribute> layout = def.packedLayout;
+    size_t stride = def.packedStride;
+    if (!packed)
+    {
+        vertices = std::span<const char>(reinterpret_cast<const char*>(def.data.data()), def.data.size() * sizeof(float));
+        layout.clear();
+        stride = 0;
+        for (const unsigned int size : def.dataLayout)
+        {
+            layout.push_back({ size, AttributeType::FLOAT, false, (unsigned int)stride });
+            stride += size * sizeof(float);
+        }
+    }
+    const std::span<const char> indices = def.indices;
+    assert(indices.size() % GetIndexSize(def.indexType) == 0);
 
     // Hash the data of the buffer and check if it's not loaded already.
-    std::string accumulatedData = std::to_string(XXH32(def.data.data(), sizeof(float) * def.data.size(), HASHING_SEED));
-    for (const auto& layout : def.dataLayout)
+    Hasher hasher(HASHING_SEED);
+    if (packed)
+    {
+        hasher.AddBytes(vertices.data(), vertices.size());
+        for (const auto& attribute : layout)
+        {
+            hasher.Add(attribute.size).Add(attribute.type).Add(attribute.normalized).Add(attribute.offset).Add(attribute.stride);
+        }
+        hasher.Add(stride).Add((uint64_t)def.packedVerticesCount);
+    }
+    else
+    {
+        hasher.Add(def.data);
+        hasher.Add(def.dataLayout); // The same data interpreted differently is still different data.
+    }
+    if (!indices.empty())
     {
-        accumulatedData += std::to_string(layout); // The same data interpreted differently is still different data.
+        hasher.Add(def.indexType).Add((uint64_t)indices.size()).AddBytes(indices.data(), indices.size());
     }
-    const XXH32_hash_t hash = XXH32(accumulatedData.c_str(), sizeof(char) * accumulatedData.size(), HASHING_SEED);
+    const uint64_t hash = hasher.Digest64();
 
     VBO_ = ResourceManager::Get().RequestVBO(hash);
     VAO_ = ResourceManager::Get().RequestVAO(hash);
-    const size_t stride = std::accumulate(def.dataLayout.begin(), def.dataLayout.end(), 0);
-    verticesCount_ = def.data.size() / stride;
     if (VBO_ != 0)
     {
+        verticesCount_ = verticesCounts.at(VAO_);
+        const auto indexBuffer = indexBuffers.find(VAO_);
+        indexType_ = indexBuffer != indexBuffers.end() ? indexBuffer->second.type : 0;
+        handle_ = Handle<VertexBuffer>(VAO_);
         return;
     }
+    indexType_ = indices.empty() ? 0 : (unsigned int)def.indexType;
+    const size_t verticesCount = packed && def.packedVerticesCount > 0 ? def.packedVerticesCount : vertices.size() / stride;
+    verticesCount_ = std::make_shared<int>((int)(indexType_ != 0 ? indices.size() / GetIndexSize(def.indexType) : verticesCount));
 
-    CheckGlError();
-    glGenVertexArrays(1, &VAO_);
-    glBindVertexArray(VAO_);
-    CheckGlError();
-    glGenBuffers(1, &VBO_);
-    CheckGlError();
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-    CheckGlError();
-    glBufferData(GL_ARRAY_BUFFER, def.data.size() * sizeof(float), def.data.data(), GL_STATIC_DRAW);
-    CheckGlError();
+    const ResourceManager::CreationTimer timer(ResourceManager::Resource::VERTEX_BUFFER);
 
-    // Enable the vertex attribute pointers.
-    size_t accumulatedOffset = 0;
-    for (size_t i = 0; i < def.dataLayout.size(); i++)
+    unsigned int EBO = 0;
+    CheckGlError();
+    if (HasDirectStateAccess())
     {
-        glEnableVertexAttribArray((unsigned int)i);
-        glVertexAttribPointer((unsigned int)i, def.dataLayout[i], GL_FLOAT, GL_FALSE, (size_t)(stride * sizeof(float)), (void*)accumulatedOffset);
-        accumulatedOffset += def.dataLayout[i] * sizeof(float);
+        // Immutable storage, the vertex format is described once and never needs the buffer to be bound.
+        glCreateBuffers(1, &VBO_);
+        if (def.reload != nullptr)
+        {
+            glNamedBufferData(VBO_, vertices.size(), vertices.data(), GL_STATIC_DRAW); // Reallocated by reloads.
+        }
+        else
+        {
+            glNamedBufferStorage(VBO_, vertices.size(), vertices.data(), 0);
+        }
         CheckGlError();
+        glCreateVertexArrays(1, &VAO_);
+        glVertexArrayVertexBuffer(VAO_, VERTEX_BUFFER_BINDING, VBO_, 0, (GLsizei)stride);
+        CheckGlError();
+
+        for (size_t i = 0; i < layout.size(); i++)
+        {
+            if (layout[i].size == 0) continue;
+            glEnableVertexArrayAttrib(VAO_, (unsigned int)i);
+            if (layout[i].stride == 0)
+            {
+                glVertexArrayAttribFormat(VAO_, (unsigned int)i, layout[i].size, (GLenum)layout[i].type, layout[i].normalized ? GL_TRUE : GL_FALSE, layout[i].offset);
+                glVertexArrayAttribBinding(VAO_, (unsigned int)i, VERTEX_BUFFER_BINDING);
+            }
+            else
+            {
+                // Separate array, bound on its own at its attribute index as the instanced attributes are.
+                glVertexArrayVertexBuffer(VAO_, (unsigned int)i, VBO_, layout[i].offset, (GLsizei)layout[i].stride);
+                glVertexArrayAttribFormat(VAO_, (unsigned int)i, layout[i].size, (GLenum)layout[i].type, layout[i].normalized ? GL_TRUE : GL_FALSE, 0);
+                glVertexArrayAttribBinding(VAO_, (unsigned int)i, (unsigned int)i);
+            }
+            CheckGlError();
+        }
+
+        if (indexType_ != 0)
+        {
+            glCreateBuffers(1, &EBO);
+            glNamedBufferStorage(EBO, indices.size(), indices.data(), 0);
+            glVertexArrayElementBuffer(VAO_, EBO);
+            CheckGlError();
+        }
     }
+    else
+    {
+        glGenVertexArrays(1, &VAO_);
+        glBindVertexArray(VAO_);
+        CheckGlError();
+        glGenBuffers(1, &VBO_);
+        CheckGlError();
+        glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+        CheckGlError();
+        glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), GL_STATIC_DRAW);
+        CheckGlError();
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    CheckGlError();
+        // Enable the vertex attribute pointers.
+        for (size_t i = 0; i < layout.size(); i++)
+        {
+            if (layout[i].size == 0) continue;
+            glEnableVertexAttribArray((unsigned int)i);
+            glVertexAttribPointer((unsigned int)i, layout[i].size, (GLenum)layout[i].type, layout[i].normalized ? GL_TRUE : GL_FALSE, (GLsizei)(layout[i].stride != 0 ? layout[i].stride : stride), (void*)(size_t)layout[i].offset);
+            CheckGlError();
+        }
+
+        if (indexType_ != 0)
+        {
+            glGenBuffers(1, &EBO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO); // Recorded by the VAO, only unbound after it.
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.data(), GL_STATIC_DRAW);
+            CheckGlError();
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        CheckGlError();
+    }
 
     ResourceManager::Get().AppendNewVAO(VAO_, hash);
     ResourceManager::Get().AppendNewVBO(VBO_, hash);
+    if (EBO != 0)
+    {
+        Hasher indicesHasher(hash); // Keeps the VBO the only buffer found by the vertex buffer's hash.
+        indicesHasher.Add(std::string_view("indices"));
+        ResourceManager::Get().AppendNewVBO(EBO, indicesHasher.Digest64());
+        indexBuffers[VAO_] = { EBO, indexType_ };
+    }
+    ResourceManager::Get().TrackMemory(ResourceManager::Resource::VERTEX_BUFFER, VAO_, vertices.size() + indices.size(), VBO_);
+    handle_ = Handle<VertexBuffer>(VAO_);
+    verticesCounts[VAO_] = verticesCount_;
+    if (!forgetsEvictedBuffers)
+    {
+        ResourceManager::Get().SetEvictionCallback(ResourceManager::Resource::VERTEX_BUFFER, ForgetBuffer);
+        forgetsEvictedBuffers = true;
+    }
+
+    if (def.reload != nullptr)
+    {
+        assert(!def.path.empty() && indexType_ == 0);
+        const bool watched = buffersByFile.find(def.path) != buffersByFile.end(); // Kept when its buffers were evicted, the watcher still is.
+        auto& buffers = buffersByFile[def.path];
+        if (!watched)
+        {
+            FileWatcher::Get().Watch(def.path, ReloadBufferFile);
+        }
+        buffers.push_back({ VAO_, VBO_, std::move(def.dataLayout), std::move(def.reload) });
+    }
 }
 
 std::array<unsigned int, 2> gl::VertexBuffer::GetVAOandVBO() const
@@ -89,7 +301,14 @@ void gl::VertexBuffer::Draw(int nrOfInstances) const
     assert(VAO_ != 0 && VBO_ != 0);
 
     Bind();
-    glDrawArraysInstanced(GL_TRIANGLES, 0, verticesCount_, nrOfInstances);
+    if (indexType_ != 0)
+    {
+        glDrawElementsInstanced(GL_TRIANGLES, *verticesCount_, (GLenum)indexType_, nullptr, nrOfInstances);
+    }
+    else
+    {
+        glDrawArraysInstanced(GL_TRIANGLES, 0, *verticesCount_, nrOfInstances);
+    }
     CheckGlError();
     Unbind();
 }
@@ -99,7 +318,14 @@ void gl::VertexBuffer::DrawSingle() const
     assert(VAO_ != 0 && VBO_ != 0);
 
     Bind();
-    glDrawArrays(GL_TRIANGLES, 0, verticesCount_);
+    if (indexType_ != 0)
+    {
+        glDrawElements(GL_TRIANGLES, *verticesCount_, (GLenum)indexType_, nullptr);
+    }
+    else
+    {
+        glDrawArrays(GL_TRIANGLES, 0, *verticesCount_);
+    }
     CheckGlError();
     Unbind();
 }